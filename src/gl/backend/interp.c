@@ -0,0 +1,2489 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Shader bytecode interpreter backend
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+#include <GLES/gl.h>
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "frontend/il.h"
+#include "frontend/linker.h"
+#include "backend/interp.h"
+#include "backend/mathlib.h"
+
+#if GLES_MATH_SSE2 && (GLES_SHADER_BATCH % 4) == 0
+#	include <emmintrin.h>
+#	define INTERP_SSE2	1
+#else
+#	define INTERP_SSE2	0
+#endif
+
+/*
+** --------------------------------------------------------------------------
+** Module-local data
+** --------------------------------------------------------------------------
+*/
+
+#define IDENTITY_SWIZZLE	(0 | (1 << 2) | (2 << 4) | (3 << 6))
+#define MAX_LOOP_STACK		(GLES_MAX_LOOP_DEPTH * GLES_MAX_FUNCTION_DEPTH)
+
+/**
+ * Return address and loop state saved by a subroutine call.
+ */
+typedef struct CallFrame {
+	const InterpInst *	ip;				/**< return address					*/
+	GLsizei				loop;			/**< loop stack depth at call		*/
+} CallFrame;
+
+/**
+ * State of a single shader invocation.
+ */
+typedef struct Machine {
+	GLfloat *			segment[InterpSegCount];	/**< segment base addresses	*/
+	const TextureImageUnit *
+						textureImageUnit;			/**< texture units to use	*/
+	Vec4f				cc;							/**< condition code register*/
+	GLint				addr[GLES_MAX_ADDRESS_REGISTERS];	/**< address regs.	*/
+	GLint				loop[MAX_LOOP_STACK];		/**< loop counters			*/
+	CallFrame			call[GLES_MAX_FUNCTION_DEPTH];	/**< call stack			*/
+} Machine;
+
+/**
+ * Dispatch addresses for direct threaded code; initialized on first use.
+ */
+static const void * const * Handlers = NULL;
+
+#define LANE_MASK			((1u << GLES_SHADER_BATCH) - 1)
+#define MAX_COND_STACK		(GLES_MAX_IF_DEPTH * GLES_MAX_FUNCTION_DEPTH)
+
+/**
+ * A vector value for each lane of a batch; stored as structure of
+ * arrays such that each operation can be applied to all lanes at once.
+ */
+typedef struct BatchVec4f {
+	GLfloat				v[4][GLES_SHADER_BATCH];	/**< component, then lane	*/
+} BatchVec4f;
+
+/**
+ * Execution mask state saved by an IF instruction in batched execution.
+ */
+typedef struct BatchCond {
+	GLuint				saved;			/**< execution mask before IF		*/
+	GLuint				taken;			/**< lanes that passed the test		*/
+} BatchCond;
+
+/**
+ * Loop state saved by a REP instruction in batched execution.
+ */
+typedef struct BatchLoop {
+	GLint				count[GLES_SHADER_BATCH];	/**< remaining iterations	*/
+	GLuint				saved;			/**< execution mask before REP		*/
+	GLuint				active;			/**< lanes still executing the loop	*/
+	GLsizei				cond;			/**< IF stack depth at REP			*/
+} BatchLoop;
+
+/**
+ * State of a batched shader invocation.
+ */
+typedef struct BatchMachine {
+	GLfloat *			segment[InterpSegCount];	/**< segment base addresses	*/
+	const TextureImageUnit *
+						textureImageUnit;			/**< texture units to use	*/
+	BatchVec4f			cc;							/**< condition code register*/
+	GLint				addr[GLES_MAX_ADDRESS_REGISTERS][GLES_SHADER_BATCH];
+	BatchCond			cond[MAX_COND_STACK];		/**< IF stack				*/
+	BatchLoop			loop[MAX_LOOP_STACK];		/**< loop stack				*/
+	const InterpInst *	call[GLES_MAX_FUNCTION_DEPTH];	/**< return addresses	*/
+	GLboolean			quads;						/**< lanes are 2x2 quads	*/
+} BatchMachine;
+
+/**
+ * Dispatch addresses for batched direct threaded code.
+ */
+static const void * const * BatchHandlers = NULL;
+
+/**
+ * Structured control flow constructs that are open during code generation.
+ */
+typedef struct Construct {
+	Opcode		op;						/**< opening IL operation			*/
+	GLsizei		inst;					/**< index of opening instruction	*/
+	GLsizei		breaks;					/**< chain of pending BRK jumps		*/
+} Construct;
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: code generation
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Map an IL operation code onto the interpreter operation.
+ *
+ * @param	op			the IL operation code
+ * @param	result		out: interpreter operation code
+ * @param	saturate	out: GL_TRUE if the result needs to be clamped
+ *
+ * @return	GL_TRUE if the operation can be executed by the interpreter
+ */
+static GLboolean MapOpcode(Opcode op, InterpOp * result, GLubyte * saturate) {
+	*saturate = GL_FALSE;
+
+	switch (op) {
+	case OpcodeABS_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeABS:		*result = InterpOpABS;	return GL_TRUE;
+	case OpcodeADD_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeADD:		*result = InterpOpADD;	return GL_TRUE;
+	case OpcodeCMP_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeCMP:		*result = InterpOpCMP;	return GL_TRUE;
+	case OpcodeCOS_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeCOS:		*result = InterpOpCOS;	return GL_TRUE;
+	case OpcodeDDX_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeDDX:		*result = InterpOpDDX;	return GL_TRUE;
+	case OpcodeDDY_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeDDY:		*result = InterpOpDDY;	return GL_TRUE;
+	case OpcodeDP2_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeDP2:		*result = InterpOpDP2;	return GL_TRUE;
+	case OpcodeDP3_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeDP3:		*result = InterpOpDP3;	return GL_TRUE;
+	case OpcodeDP4_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeDP4:		*result = InterpOpDP4;	return GL_TRUE;
+	case OpcodeDPH_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeDPH:		*result = InterpOpDPH;	return GL_TRUE;
+	case OpcodeDST_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeDST:		*result = InterpOpDST;	return GL_TRUE;
+	case OpcodeEX2_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeEX2:		*result = InterpOpEX2;	return GL_TRUE;
+	case OpcodeEXP_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeEXP:		*result = InterpOpEXP;	return GL_TRUE;
+	case OpcodeFLR_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeFLR:		*result = InterpOpFLR;	return GL_TRUE;
+	case OpcodeFRC_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeFRC:		*result = InterpOpFRC;	return GL_TRUE;
+	case OpcodeLG2_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeLG2:		*result = InterpOpLG2;	return GL_TRUE;
+	case OpcodeLOG_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeLOG:		*result = InterpOpLOG;	return GL_TRUE;
+	case OpcodeLRP_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeLRP:		*result = InterpOpLRP;	return GL_TRUE;
+	case OpcodeMAD_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeMAD:		*result = InterpOpMAD;	return GL_TRUE;
+	case OpcodeMAX_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeMAX:		*result = InterpOpMAX;	return GL_TRUE;
+	case OpcodeMIN_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeMIN:		*result = InterpOpMIN;	return GL_TRUE;
+	case OpcodeMOV_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeMOV:		*result = InterpOpMOV;	return GL_TRUE;
+	case OpcodeMUL_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeMUL:		*result = InterpOpMUL;	return GL_TRUE;
+	case OpcodePOW:		*result = InterpOpPOW;	return GL_TRUE;
+	case OpcodeRCP_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeRCP:		*result = InterpOpRCP;	return GL_TRUE;
+	case OpcodeRSQ_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeRSQ:		*result = InterpOpRSQ;	return GL_TRUE;
+	case OpcodeSCS_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeSCS:		*result = InterpOpSCS;	return GL_TRUE;
+	case OpcodeSEQ:		*result = InterpOpSEQ;	return GL_TRUE;
+	case OpcodeSFL:		*result = InterpOpSFL;	return GL_TRUE;
+	case OpcodeSGE:		*result = InterpOpSGE;	return GL_TRUE;
+	case OpcodeSGT:		*result = InterpOpSGT;	return GL_TRUE;
+	case OpcodeSIN_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeSIN:		*result = InterpOpSIN;	return GL_TRUE;
+	case OpcodeSLE:		*result = InterpOpSLE;	return GL_TRUE;
+	case OpcodeSLT:		*result = InterpOpSLT;	return GL_TRUE;
+	case OpcodeSNE:		*result = InterpOpSNE;	return GL_TRUE;
+	case OpcodeSSG:		*result = InterpOpSSG;	return GL_TRUE;
+	case OpcodeSTR:		*result = InterpOpSTR;	return GL_TRUE;
+	case OpcodeSUB_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeSUB:		*result = InterpOpSUB;	return GL_TRUE;
+	case OpcodeSWZ_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeSWZ:		*result = InterpOpSWZ;	return GL_TRUE;
+	case OpcodeTEX_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeTEX:		*result = InterpOpTEX;	return GL_TRUE;
+	case OpcodeTXB_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeTXB:		*result = InterpOpTXB;	return GL_TRUE;
+	case OpcodeTXL_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeTXL:		*result = InterpOpTXL;	return GL_TRUE;
+	case OpcodeTXP_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeTXP:		*result = InterpOpTXP;	return GL_TRUE;
+	case OpcodeXPD_SAT:	*saturate = GL_TRUE;	/* fall through */
+	case OpcodeXPD:		*result = InterpOpXPD;	return GL_TRUE;
+	case OpcodeARL:		*result = InterpOpARL;	return GL_TRUE;
+	case OpcodeSCC:		*result = InterpOpSCC;	return GL_TRUE;
+	case OpcodeIF:		*result = InterpOpIF;	return GL_TRUE;
+	case OpcodeELSE:	*result = InterpOpJMP;	return GL_TRUE;
+	case OpcodeLOOP:
+	case OpcodeREP:		*result = InterpOpREP;	return GL_TRUE;
+	case OpcodeENDLOOP:
+	case OpcodeENDREP:	*result = InterpOpENDREP;	return GL_TRUE;
+	case OpcodeBRK:		*result = InterpOpBRK;	return GL_TRUE;
+	case OpcodeCAL:		*result = InterpOpCAL;	return GL_TRUE;
+	case OpcodeRET:		*result = InterpOpRET;	return GL_TRUE;
+	case OpcodeKIL:		*result = InterpOpKIL;	return GL_TRUE;
+
+	default:
+		return GL_FALSE;
+	}
+}
+
+/**
+ * Resolve a reference to a shader variable into an interpreter operand.
+ *
+ * @param	var		the variable being referenced
+ * @param	offset	constant offset in vec4 units
+ * @param	index	optional address register used for indexing
+ * @param	operand	out: the resolved operand
+ *
+ * @return	GL_TRUE if the variable has been allocated into a segment
+ */
+static GLboolean ResolveVar(const ProgVarBase * var, GLsizeiptr offset,
+							const ProgVarAddr * index, InterpOperand * operand) {
+
+	switch (var->segment) {
+	case ProgVarSegParam:	operand->segment = InterpSegConstant;	break;
+	case ProgVarSegUniform:	operand->segment = InterpSegUniform;	break;
+	case ProgVarSegAttrib:	operand->segment = InterpSegAttrib;		break;
+	case ProgVarSegVarying:	operand->segment = InterpSegVarying;	break;
+	case ProgVarSegLocal:	operand->segment = InterpSegTemp;		break;
+	case ProgVarSegResult:	operand->segment = InterpSegResult;		break;
+	case ProgVarSegSpecial:	operand->segment = InterpSegSpecial;	break;
+
+	default:
+		/* variable has not been allocated */
+		return GL_FALSE;
+	}
+
+	if (index) {
+		if (index->id >= GLES_MAX_ADDRESS_REGISTERS) {
+			return GL_FALSE;
+		}
+
+		operand->index = index->id + 1;
+	} else {
+		operand->index = 0;
+	}
+
+	operand->offset = var->location + offset * 4;
+	operand->swizzle = IDENTITY_SWIZZLE;
+	operand->negate = GL_FALSE;
+
+	return GL_TRUE;
+}
+
+static GLboolean ResolveSrc(const SrcReg * reg, InterpOperand * operand) {
+	if (!ResolveVar(reg->reference.base, reg->offset, reg->index, operand)) {
+		return GL_FALSE;
+	}
+
+	operand->swizzle =
+		reg->selectX | (reg->selectY << 2) | (reg->selectZ << 4) | (reg->selectW << 6);
+	operand->negate = reg->negate;
+
+	return GL_TRUE;
+}
+
+static GLboolean ResolveDst(const DstReg * reg, InterpInst * inst) {
+	if (!ResolveVar(reg->reference.base, reg->offset, NULL, &inst->dst)) {
+		return GL_FALSE;
+	}
+
+	inst->mask =
+		(reg->maskX ? 1 : 0) | (reg->maskY ? 2 : 0) |
+		(reg->maskZ ? 4 : 0) | (reg->maskW ? 8 : 0);
+
+	return GL_TRUE;
+}
+
+static void InitCond(InterpInst * inst, Cond cond,
+					 GLubyte selectX, GLubyte selectY,
+					 GLubyte selectZ, GLubyte selectW) {
+	inst->cond = cond;
+	inst->select = selectX | (selectY << 2) | (selectZ << 4) | (selectW << 6);
+}
+
+/**
+ * Translate a single IL instruction into interpreter code.
+ *
+ * @param	inst		the IL instruction to translate
+ * @param	code		the interpreter instruction to fill in
+ * @param	blockStart	for each block id, index of first interpreter instruction
+ *
+ * @return	GL_TRUE if the translation was successful
+ */
+static GLboolean TranslateInst(const Inst * inst, InterpInst * code,
+							   const GLsizei * blockStart) {
+	InterpOp op;
+
+	if (!MapOpcode(inst->base.op, &op, &code->saturate)) {
+		return GL_FALSE;
+	}
+
+	code->op = op;
+	code->mask = 0;
+	code->target = 0;
+	code->precision = PrecisionHigh;
+	InitCond(code, CondT, 0, 0, 0, 0);
+
+	switch (inst->base.kind) {
+	case InstKindUnary:
+		code->precision = inst->unary.alu.prec;
+
+		return
+			ResolveDst(&inst->unary.alu.dst, code) &&
+			ResolveSrc(&inst->unary.arg, &code->src[0]);
+
+	case InstKindBinary:
+		code->precision = inst->binary.alu.prec;
+
+		return
+			ResolveDst(&inst->binary.alu.dst, code) &&
+			ResolveSrc(&inst->binary.left, &code->src[0]) &&
+			ResolveSrc(&inst->binary.right, &code->src[1]);
+
+	case InstKindTernary:
+		code->precision = inst->ternary.alu.prec;
+
+		return
+			ResolveDst(&inst->ternary.alu.dst, code) &&
+			ResolveSrc(&inst->ternary.arg0, &code->src[0]) &&
+			ResolveSrc(&inst->ternary.arg1, &code->src[1]) &&
+			ResolveSrc(&inst->ternary.arg2, &code->src[2]);
+
+	case InstKindArl:
+		if (inst->arl.dst->id >= GLES_MAX_ADDRESS_REGISTERS) {
+			return GL_FALSE;
+		}
+
+		code->target = inst->arl.dst->id;
+		return ResolveSrc(&inst->arl.arg, &code->src[0]);
+
+	case InstKindSrc:
+		return ResolveSrc(&inst->src.arg, &code->src[0]);
+
+	case InstKindCond:
+		InitCond(code, inst->cond.cond,
+				 inst->cond.selectX, inst->cond.selectY,
+				 inst->cond.selectZ, inst->cond.selectW);
+		return GL_TRUE;
+
+	case InstKindBranch:
+		InitCond(code, inst->branch.cond,
+				 inst->branch.selectX, inst->branch.selectY,
+				 inst->branch.selectZ, inst->branch.selectW);
+
+		if (!inst->branch.target->target) {
+			return GL_FALSE;
+		}
+
+		code->target = blockStart[inst->branch.target->target->id];
+		return GL_TRUE;
+
+	case InstKindBase:
+		return GL_TRUE;
+
+	case InstKindSwizzle:
+		code->target =
+			inst->swizzle.optionX 		 | (inst->swizzle.optionY << 4) |
+			(inst->swizzle.optionZ << 8) | (inst->swizzle.optionW << 12);
+
+		return
+			ResolveDst(&inst->swizzle.alu.dst, code) &&
+			ResolveVar(inst->swizzle.arg.base, 0, NULL, &code->src[0]);
+
+	case InstKindTex:
+		code->texture = inst->tex.target;
+
+		return
+			ResolveDst(&inst->tex.alu.dst, code) &&
+			ResolveSrc(&inst->tex.coords, &code->src[0]) &&
+			ResolveVar(&inst->tex.sampler->base, inst->tex.offset, NULL, &code->src[1]);
+
+	default:
+		/* phi instructions need to be eliminated before code generation */
+		return GL_FALSE;
+	}
+}
+
+/**
+ * Report an error during lowering; code generation for batched execution
+ * is optional, so failures are not reported to the linker log.
+ */
+static GLboolean LowerError(Linker * linker, GLboolean batch, LinkError error) {
+	if (!batch) {
+		GlesLinkError(linker, error);
+	}
+
+	return GL_FALSE;
+}
+
+/**
+ * Batched execution stores special variables as structure of arrays
+ * starting at batchFragCoord instead of at fragCoord.
+ */
+static void RelocateSpecial(InterpOperand * operand) {
+	if (operand->segment == InterpSegSpecial) {
+		operand->offset -= offsetof(FragContext, fragCoord) / sizeof(GLfloat);
+	}
+}
+
+/**
+ * Lower the IL instructions of a shader program into interpreter code.
+ *
+ * Structured control flow is lowered into explicit jumps; subroutine
+ * calls are resolved to the first instruction of the target block.
+ *
+ * For batched execution, ELSE and ENDIF are kept as instructions that
+ * update the execution mask, and a BRK that terminates the loop for all
+ * lanes jumps to the ENDREP instruction to restore it. The lanes of
+ * a batch may not diverge across subroutine boundaries, which rules out
+ * conditional CAL and RET, as well as RET within a control flow construct.
+ *
+ * @param	linker	reference to linker object
+ * @param	program	the shader program to translate
+ * @param	type	GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ * @param	batch	GL_TRUE to generate code for batched execution
+ * @param	segment	out: the generated code segment
+ *
+ * @return	GL_TRUE if the code generation was successful
+ */
+static GLboolean Lower(Linker * linker, ShaderProgram * program, GLenum type,
+					   GLboolean batch, Segment * segment) {
+	const void * const * handlers = batch ? BatchHandlers : Handlers;
+	GLsizei * blockStart;
+	Construct * constructs;
+	GLsizei numInsts = 0, numConstructs = 0, loopDepth = 0, condDepth = 0, index;
+	InterpInst * code;
+	Block * block;
+	Inst * inst;
+
+	/* determine start of each block and overall size */
+
+	blockStart =
+		GlesMemoryPoolAllocate(linker->tempMemory,
+							   sizeof(GLsizei) * (program->numBlocks + 1));
+
+	for (block = program->blocks.head; block; block = block->next) {
+		blockStart[block->id] = numInsts;
+
+		for (inst = block->first; inst; inst = inst->base.next) {
+			if (batch || inst->base.op != OpcodeENDIF) {
+				++numInsts;
+			}
+		}
+	}
+
+	constructs =
+		GlesMemoryPoolAllocate(linker->tempMemory,
+							   sizeof(Construct) * (numInsts + 1));
+
+	code = GlesMalloc(sizeof(InterpInst) * (numInsts + 1));
+
+	if (!code) {
+		return LowerError(linker, batch, LinkI0001);
+	}
+
+	segment->base = code;
+	segment->size = numInsts + 1;
+
+	/* translate each instruction */
+
+	index = 0;
+
+	for (block = program->blocks.head; block; block = block->next) {
+		for (inst = block->first; inst; inst = inst->base.next) {
+			Construct * construct =
+				numConstructs ? &constructs[numConstructs - 1] : NULL;
+
+			if (inst->base.op == OpcodeENDIF) {
+				if (!construct ||
+					(construct->op != OpcodeIF && construct->op != OpcodeELSE)) {
+					return LowerError(linker, batch, LinkI0000);
+				}
+
+				code[construct->inst].target = index;
+				--numConstructs;
+
+				if (batch) {
+					code[index++].op = InterpOpENDIF;
+					--condDepth;
+				}
+
+				continue;
+			}
+
+			if (!TranslateInst(inst, &code[index], blockStart)) {
+				return LowerError(linker, batch, LinkI0000);
+			}
+
+			switch (inst->base.op) {
+			case OpcodeIF:
+				if (batch && ++condDepth > GLES_MAX_IF_DEPTH) {
+					return GL_FALSE;
+				}
+
+				constructs[numConstructs].op = OpcodeIF;
+				constructs[numConstructs].inst = index;
+				++numConstructs;
+				break;
+
+			case OpcodeELSE:
+				if (!construct || construct->op != OpcodeIF) {
+					return LowerError(linker, batch, LinkI0000);
+				}
+
+				if (batch) {
+					/* failed IF test continues at the ELSE mask inversion */
+					code[index].op = InterpOpELSE;
+					code[construct->inst].target = index;
+				} else {
+					/* failed IF test continues after the ELSE jump */
+					code[construct->inst].target = index + 1;
+				}
+
+				construct->op = OpcodeELSE;
+				construct->inst = index;
+				break;
+
+			case OpcodeLOOP:
+			case OpcodeREP:
+				if (++loopDepth > GLES_MAX_LOOP_DEPTH) {
+					return LowerError(linker, batch, LinkI0000);
+				}
+
+				constructs[numConstructs].op = OpcodeREP;
+				constructs[numConstructs].inst = index;
+				constructs[numConstructs].breaks = -1;
+				++numConstructs;
+				break;
+
+			case OpcodeENDLOOP:
+			case OpcodeENDREP:
+				if (!construct || construct->op != OpcodeREP) {
+					return LowerError(linker, batch, LinkI0000);
+				}
+
+				/* resolve loop jumps and pending BRK instructions */
+				code[index].target = construct->inst + 1;
+				code[construct->inst].target = index + 1;
+
+				while (construct->breaks >= 0) {
+					GLsizei next = code[construct->breaks].target;
+					code[construct->breaks].target = batch ? index : index + 1;
+					construct->breaks = next;
+				}
+
+				--numConstructs;
+				--loopDepth;
+				break;
+
+			case OpcodeBRK:
+				/* find innermost loop */
+				while (construct && construct->op != OpcodeREP) {
+					construct = construct > constructs ? construct - 1 : NULL;
+				}
+
+				if (!construct) {
+					return LowerError(linker, batch, LinkI0000);
+				}
+
+				code[index].target = construct->breaks;
+				construct->breaks = index;
+				break;
+
+			case OpcodeCAL:
+			case OpcodeRET:
+				if (batch &&
+					(code[index].cond != CondT ||
+					 (inst->base.op == OpcodeRET && numConstructs))) {
+					return GL_FALSE;
+				}
+
+				break;
+
+			default:
+				;
+			}
+
+			++index;
+		}
+	}
+
+	if (numConstructs) {
+		/* unterminated control flow construct */
+		return LowerError(linker, batch, LinkI0000);
+	}
+
+	GLES_ASSERT(index == numInsts);
+	GlesMemset(&code[index], 0, sizeof(InterpInst));
+	code[index].op = InterpOpEND;
+
+	for (index = 0; index <= numInsts; ++index) {
+		if (batch && type == GL_FRAGMENT_SHADER) {
+			RelocateSpecial(&code[index].dst);
+			RelocateSpecial(&code[index].src[0]);
+			RelocateSpecial(&code[index].src[1]);
+			RelocateSpecial(&code[index].src[2]);
+		}
+
+#if GLES_INTERP_THREADED
+		code[index].handler = handlers[code[index].op];
+#endif
+	}
+
+	return GL_TRUE;
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: execution
+** --------------------------------------------------------------------------
+*/
+
+static GLES_INLINE void Fetch(const Machine * machine, const InterpOperand * operand,
+							  Vec4f * result) {
+	const GLfloat * base = machine->segment[operand->segment] + operand->offset;
+
+	if (operand->index) {
+		base += machine->addr[operand->index - 1] * 4;
+	}
+
+	result->x = base[ operand->swizzle       & 3];
+	result->y = base[(operand->swizzle >> 2) & 3];
+	result->z = base[(operand->swizzle >> 4) & 3];
+	result->w = base[(operand->swizzle >> 6) & 3];
+
+	if (operand->negate) {
+		result->x = -result->x;
+		result->y = -result->y;
+		result->z = -result->z;
+		result->w = -result->w;
+	}
+}
+
+static GLES_INLINE void Store(const Machine * machine, const InterpInst * inst,
+							  Vec4f * value) {
+	GLfloat * base = machine->segment[inst->dst.segment] + inst->dst.offset;
+
+	if (inst->saturate) {
+		value->x = GlesClampf(value->x);
+		value->y = GlesClampf(value->y);
+		value->z = GlesClampf(value->z);
+		value->w = GlesClampf(value->w);
+	}
+
+	if (inst->mask & 1) base[0] = value->x;
+	if (inst->mask & 2) base[1] = value->y;
+	if (inst->mask & 4) base[2] = value->z;
+	if (inst->mask & 8) base[3] = value->w;
+}
+
+static GLES_INLINE void Replicate(Vec4f * result, GLfloat value) {
+	result->x = result->y = result->z = result->w = value;
+}
+
+/**
+ * Determine the condition flags for a single condition code component.
+ *
+ * @param	value	the condition code component
+ *
+ * @return	the flag mask using the bit assignments of the Cond enumeration
+ */
+static GLES_INLINE GLuint Flags(GLfloat value) {
+	return value < 0.0f ? CondLT : value > 0.0f ? CondGT : CondEQ;
+}
+
+/**
+ * Test the condition code register; the test passes if it passes for any
+ * of the selected components.
+ */
+static GLES_INLINE GLboolean TestCond(const Machine * machine, const InterpInst * inst) {
+	if (inst->cond == CondT) {
+		return GL_TRUE;
+	} else if (inst->cond == CondF) {
+		return GL_FALSE;
+	} else {
+		return
+			((Flags(machine->cc.v[ inst->select       & 3]) |
+			  Flags(machine->cc.v[(inst->select >> 2) & 3]) |
+			  Flags(machine->cc.v[(inst->select >> 4) & 3]) |
+			  Flags(machine->cc.v[(inst->select >> 6) & 3])) & inst->cond) != 0;
+	}
+}
+
+static GLES_INLINE GLfloat ExtSwizzle(const Vec4f * value, GLuint option) {
+	GLfloat result;
+
+	switch (option & ~ExtSwizzleSelectNeg) {
+	case ExtSwizzleSelect0:	result = 0.0f;		break;
+	case ExtSwizzleSelect1:	result = 1.0f;		break;
+	case ExtSwizzleSelectX:	result = value->x;	break;
+	case ExtSwizzleSelectY:	result = value->y;	break;
+	case ExtSwizzleSelectZ:	result = value->z;	break;
+	default:				result = value->w;	break;
+	}
+
+	return (option & ExtSwizzleSelectNeg) ? -result : result;
+}
+
+/**
+ * Perform a texture access on behalf of a TEX, TXB, TXL or TXP instruction.
+ */
+static GLES_INLINE void Sample(const Machine * machine, const InterpInst * inst,
+							   Vec4f * coords, Vec4f * result) {
+	Vec4f sampler;
+
+	Fetch(machine, &inst->src[1], &sampler);
+	GlesInterpSample(machine->textureImageUnit, sampler.x, inst->texture,
+					 coords, result);
+}
+
+#if GLES_INTERP_THREADED
+#	define OP(name)		Op##name:
+#	define DISPATCH()	goto *ip->handler
+#else
+#	define OP(name)		case InterpOp##name:
+#	define DISPATCH()	goto dispatch
+#endif
+
+#define NEXT()			++ip; DISPATCH()
+#define STORE_NEXT()	Store(machine, ip, &r); NEXT()
+#define FETCH1()		Fetch(machine, &ip->src[0], &a)
+#define FETCH2()		FETCH1(); Fetch(machine, &ip->src[1], &b)
+#define FETCH3()		FETCH2(); Fetch(machine, &ip->src[2], &c)
+
+#define COMPARE(rel)							\
+	FETCH2();									\
+	r.x = a.x rel b.x ? 1.0f : 0.0f;			\
+	r.y = a.y rel b.y ? 1.0f : 0.0f;			\
+	r.z = a.z rel b.z ? 1.0f : 0.0f;			\
+	r.w = a.w rel b.w ? 1.0f : 0.0f;			\
+	STORE_NEXT()
+
+/**
+ * Execute a sequence of interpreter instructions.
+ *
+ * @param	machine	the state of the shader invocation; if NULL, the function
+ * 					only publishes its dispatch addresses
+ * @param	code	the code to execute
+ *
+ * @return	GL_FALSE if the shader executed a KIL instruction
+ */
+static GLboolean Execute(Machine * machine, const InterpInst * code) {
+
+#if GLES_INTERP_THREADED
+	static const void * const dispatch[InterpOpCount] = {
+		[InterpOpABS] 		= &&OpABS,
+		[InterpOpADD] 		= &&OpADD,
+		[InterpOpARL] 		= &&OpARL,
+		[InterpOpCMP] 		= &&OpCMP,
+		[InterpOpCOS] 		= &&OpCOS,
+		[InterpOpDDX] 		= &&OpDDX,
+		[InterpOpDDY] 		= &&OpDDY,
+		[InterpOpDP2] 		= &&OpDP2,
+		[InterpOpDP3] 		= &&OpDP3,
+		[InterpOpDP4] 		= &&OpDP4,
+		[InterpOpDPH] 		= &&OpDPH,
+		[InterpOpDST] 		= &&OpDST,
+		[InterpOpEX2] 		= &&OpEX2,
+		[InterpOpEXP] 		= &&OpEXP,
+		[InterpOpFLR] 		= &&OpFLR,
+		[InterpOpFRC] 		= &&OpFRC,
+		[InterpOpLG2] 		= &&OpLG2,
+		[InterpOpLOG] 		= &&OpLOG,
+		[InterpOpLRP] 		= &&OpLRP,
+		[InterpOpMAD] 		= &&OpMAD,
+		[InterpOpMAX] 		= &&OpMAX,
+		[InterpOpMIN] 		= &&OpMIN,
+		[InterpOpMOV] 		= &&OpMOV,
+		[InterpOpMUL] 		= &&OpMUL,
+		[InterpOpPOW] 		= &&OpPOW,
+		[InterpOpRCP] 		= &&OpRCP,
+		[InterpOpRSQ] 		= &&OpRSQ,
+		[InterpOpSCS] 		= &&OpSCS,
+		[InterpOpSEQ] 		= &&OpSEQ,
+		[InterpOpSFL] 		= &&OpSFL,
+		[InterpOpSGE] 		= &&OpSGE,
+		[InterpOpSGT] 		= &&OpSGT,
+		[InterpOpSIN] 		= &&OpSIN,
+		[InterpOpSLE] 		= &&OpSLE,
+		[InterpOpSLT] 		= &&OpSLT,
+		[InterpOpSNE] 		= &&OpSNE,
+		[InterpOpSSG] 		= &&OpSSG,
+		[InterpOpSTR] 		= &&OpSTR,
+		[InterpOpSUB] 		= &&OpSUB,
+		[InterpOpSWZ] 		= &&OpSWZ,
+		[InterpOpXPD] 		= &&OpXPD,
+		[InterpOpTEX] 		= &&OpTEX,
+		[InterpOpTXB] 		= &&OpTXB,
+		[InterpOpTXL] 		= &&OpTXL,
+		[InterpOpTXP] 		= &&OpTXP,
+		[InterpOpSCC] 		= &&OpSCC,
+		[InterpOpIF] 		= &&OpIF,
+		[InterpOpJMP] 		= &&OpJMP,
+		[InterpOpREP] 		= &&OpREP,
+		[InterpOpENDREP]	= &&OpENDREP,
+		[InterpOpBRK] 		= &&OpBRK,
+		[InterpOpCAL] 		= &&OpCAL,
+		[InterpOpRET] 		= &&OpRET,
+		[InterpOpKIL] 		= &&OpKIL,
+		[InterpOpEND] 		= &&OpEND,
+	};
+#endif
+
+	const InterpInst * ip = code;
+	GLsizei loop = 0, call = 0;
+	Vec4f a, b, c, r;
+
+#if GLES_INTERP_THREADED
+	if (!machine) {
+		Handlers = dispatch;
+		return GL_TRUE;
+	}
+
+	DISPATCH();
+#else
+	if (!machine) {
+		return GL_TRUE;
+	}
+
+dispatch:
+	switch (ip->op) {
+#endif
+
+	OP(ABS)
+		FETCH1();
+		r.x = GlesFabsf(a.x);
+		r.y = GlesFabsf(a.y);
+		r.z = GlesFabsf(a.z);
+		r.w = GlesFabsf(a.w);
+		STORE_NEXT();
+
+	OP(ADD)
+		FETCH2();
+		r.x = a.x + b.x;
+		r.y = a.y + b.y;
+		r.z = a.z + b.z;
+		r.w = a.w + b.w;
+		STORE_NEXT();
+
+	OP(ARL)
+		FETCH1();
+		machine->addr[ip->target] = (GLint) GlesFloorf(a.x);
+		NEXT();
+
+	OP(CMP)
+		FETCH3();
+		r.x = a.x < 0.0f ? b.x : c.x;
+		r.y = a.y < 0.0f ? b.y : c.y;
+		r.z = a.z < 0.0f ? b.z : c.z;
+		r.w = a.w < 0.0f ? b.w : c.w;
+		STORE_NEXT();
+
+	OP(COS)
+		FETCH1();
+		Replicate(&r, GlesMathCosf(a.x, (Precision) ip->precision));
+		STORE_NEXT();
+
+	OP(DDX)
+	OP(DDY)
+		/* derivatives are only available for pixel quads */
+		Replicate(&r, 0.0f);
+		STORE_NEXT();
+
+	OP(DP2)
+		FETCH2();
+		Replicate(&r, a.x * b.x + a.y * b.y);
+		STORE_NEXT();
+
+	OP(DP3)
+		FETCH2();
+		Replicate(&r, a.x * b.x + a.y * b.y + a.z * b.z);
+		STORE_NEXT();
+
+	OP(DP4)
+		FETCH2();
+		Replicate(&r, a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+		STORE_NEXT();
+
+	OP(DPH)
+		FETCH2();
+		Replicate(&r, a.x * b.x + a.y * b.y + a.z * b.z + b.w);
+		STORE_NEXT();
+
+	OP(DST)
+		FETCH2();
+		r.x = 1.0f;
+		r.y = a.y * b.y;
+		r.z = a.z;
+		r.w = b.w;
+		STORE_NEXT();
+
+	OP(EX2)
+		FETCH1();
+		Replicate(&r, GlesMathExp2f(a.x, (Precision) ip->precision));
+		STORE_NEXT();
+
+	OP(EXP)
+		FETCH1();
+		r.x = GlesMathExp2f(GlesFloorf(a.x), (Precision) ip->precision);
+		r.y = GlesFracf(a.x);
+		r.z = GlesMathExp2f(a.x, (Precision) ip->precision);
+		r.w = 1.0f;
+		STORE_NEXT();
+
+	OP(FLR)
+		FETCH1();
+		r.x = GlesFloorf(a.x);
+		r.y = GlesFloorf(a.y);
+		r.z = GlesFloorf(a.z);
+		r.w = GlesFloorf(a.w);
+		STORE_NEXT();
+
+	OP(FRC)
+		FETCH1();
+		r.x = GlesFracf(a.x);
+		r.y = GlesFracf(a.y);
+		r.z = GlesFracf(a.z);
+		r.w = GlesFracf(a.w);
+		STORE_NEXT();
+
+	OP(LG2)
+		FETCH1();
+		Replicate(&r, GlesMathLog2f(a.x, (Precision) ip->precision));
+		STORE_NEXT();
+
+	OP(LOG)
+		FETCH1();
+		r.z = GlesMathLog2f(GlesFabsf(a.x), (Precision) ip->precision);
+		r.x = GlesFloorf(r.z);
+		r.y = GlesFabsf(a.x) / GlesMathExp2f(r.x, (Precision) ip->precision);
+		r.w = 1.0f;
+		STORE_NEXT();
+
+	OP(LRP)
+		FETCH3();
+		r.x = a.x * b.x + (1.0f - a.x) * c.x;
+		r.y = a.y * b.y + (1.0f - a.y) * c.y;
+		r.z = a.z * b.z + (1.0f - a.z) * c.z;
+		r.w = a.w * b.w + (1.0f - a.w) * c.w;
+		STORE_NEXT();
+
+	OP(MAD)
+		FETCH3();
+		r.x = a.x * b.x + c.x;
+		r.y = a.y * b.y + c.y;
+		r.z = a.z * b.z + c.z;
+		r.w = a.w * b.w + c.w;
+		STORE_NEXT();
+
+	OP(MAX)
+		FETCH2();
+		r.x = GlesMaxf(a.x, b.x);
+		r.y = GlesMaxf(a.y, b.y);
+		r.z = GlesMaxf(a.z, b.z);
+		r.w = GlesMaxf(a.w, b.w);
+		STORE_NEXT();
+
+	OP(MIN)
+		FETCH2();
+		r.x = GlesMinf(a.x, b.x);
+		r.y = GlesMinf(a.y, b.y);
+		r.z = GlesMinf(a.z, b.z);
+		r.w = GlesMinf(a.w, b.w);
+		STORE_NEXT();
+
+	OP(MOV)
+		Fetch(machine, &ip->src[0], &r);
+		STORE_NEXT();
+
+	OP(MUL)
+		FETCH2();
+		r.x = a.x * b.x;
+		r.y = a.y * b.y;
+		r.z = a.z * b.z;
+		r.w = a.w * b.w;
+		STORE_NEXT();
+
+	OP(POW)
+		FETCH2();
+		Replicate(&r, GlesMathPowf(a.x, b.x, (Precision) ip->precision));
+		STORE_NEXT();
+
+	OP(RCP)
+		FETCH1();
+		Replicate(&r, 1.0f / a.x);
+		STORE_NEXT();
+
+	OP(RSQ)
+		FETCH1();
+		Replicate(&r, GlesMathRsqf(a.x, (Precision) ip->precision));
+		STORE_NEXT();
+
+	OP(SCS)
+		FETCH1();
+		r.x = GlesMathCosf(a.x, (Precision) ip->precision);
+		r.y = GlesMathSinf(a.x, (Precision) ip->precision);
+		r.z = r.w = 0.0f;
+		STORE_NEXT();
+
+	OP(SEQ)
+		COMPARE(==);
+
+	OP(SFL)
+		Replicate(&r, 0.0f);
+		STORE_NEXT();
+
+	OP(SGE)
+		COMPARE(>=);
+
+	OP(SGT)
+		COMPARE(>);
+
+	OP(SIN)
+		FETCH1();
+		Replicate(&r, GlesMathSinf(a.x, (Precision) ip->precision));
+		STORE_NEXT();
+
+	OP(SLE)
+		COMPARE(<=);
+
+	OP(SLT)
+		COMPARE(<);
+
+	OP(SNE)
+		COMPARE(!=);
+
+	OP(SSG)
+		FETCH1();
+		r.x = GlesSignf(a.x);
+		r.y = GlesSignf(a.y);
+		r.z = GlesSignf(a.z);
+		r.w = GlesSignf(a.w);
+		STORE_NEXT();
+
+	OP(STR)
+		Replicate(&r, 1.0f);
+		STORE_NEXT();
+
+	OP(SUB)
+		FETCH2();
+		r.x = a.x - b.x;
+		r.y = a.y - b.y;
+		r.z = a.z - b.z;
+		r.w = a.w - b.w;
+		STORE_NEXT();
+
+	OP(SWZ)
+		FETCH1();
+		r.x = ExtSwizzle(&a,  ip->target        & 0xf);
+		r.y = ExtSwizzle(&a, (ip->target >>  4) & 0xf);
+		r.z = ExtSwizzle(&a, (ip->target >>  8) & 0xf);
+		r.w = ExtSwizzle(&a, (ip->target >> 12) & 0xf);
+		STORE_NEXT();
+
+	OP(XPD)
+		FETCH2();
+		r.x = a.y * b.z - a.z * b.y;
+		r.y = a.z * b.x - a.x * b.z;
+		r.z = a.x * b.y - a.y * b.x;
+		r.w = 0.0f;
+		STORE_NEXT();
+
+	OP(TEX)
+		FETCH1();
+		a.w = 0.0f;
+		Sample(machine, ip, &a, &r);
+		STORE_NEXT();
+
+	OP(TXB)
+	OP(TXL)
+		/* coordinate w-component carries the lod (bias) */
+		FETCH1();
+		Sample(machine, ip, &a, &r);
+		STORE_NEXT();
+
+	OP(TXP)
+		FETCH1();
+		a.x /= a.w;
+		a.y /= a.w;
+		a.z /= a.w;
+		a.w = 0.0f;
+		Sample(machine, ip, &a, &r);
+		STORE_NEXT();
+
+	OP(SCC)
+		Fetch(machine, &ip->src[0], &machine->cc);
+		NEXT();
+
+	OP(IF)
+		if (TestCond(machine, ip)) {
+			++ip;
+		} else {
+			ip = code + ip->target;
+		}
+
+		DISPATCH();
+
+	OP(JMP)
+		ip = code + ip->target;
+		DISPATCH();
+
+	OP(REP)
+		FETCH1();
+
+		if ((GLint) a.x <= 0) {
+			ip = code + ip->target;
+		} else {
+			GLES_ASSERT(loop < MAX_LOOP_STACK);
+			machine->loop[loop++] = (GLint) a.x;
+			++ip;
+		}
+
+		DISPATCH();
+
+	OP(ENDREP)
+		if (--machine->loop[loop - 1] > 0) {
+			ip = code + ip->target;
+		} else {
+			--loop;
+			++ip;
+		}
+
+		DISPATCH();
+
+	OP(BRK)
+		if (TestCond(machine, ip)) {
+			--loop;
+			ip = code + ip->target;
+		} else {
+			++ip;
+		}
+
+		DISPATCH();
+
+	OP(CAL)
+		if (TestCond(machine, ip)) {
+			GLES_ASSERT(call < GLES_MAX_FUNCTION_DEPTH);
+			machine->call[call].ip = ip + 1;
+			machine->call[call].loop = loop;
+			++call;
+			ip = code + ip->target;
+		} else {
+			++ip;
+		}
+
+		DISPATCH();
+
+	OP(RET)
+		if (TestCond(machine, ip)) {
+			if (!call) {
+				/* return from main */
+				return GL_TRUE;
+			}
+
+			--call;
+			ip = machine->call[call].ip;
+			loop = machine->call[call].loop;
+		} else {
+			++ip;
+		}
+
+		DISPATCH();
+
+	OP(KIL)
+		if (TestCond(machine, ip)) {
+			return GL_FALSE;
+		}
+
+		NEXT();
+
+	OP(END)
+		return GL_TRUE;
+
+#if !GLES_INTERP_THREADED
+	default:
+		GLES_ASSERT(GL_FALSE);
+		return GL_FALSE;
+	}
+#endif
+}
+
+#undef OP
+#undef DISPATCH
+#undef NEXT
+#undef STORE_NEXT
+#undef FETCH1
+#undef FETCH2
+#undef FETCH3
+#undef COMPARE
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: batched execution
+** --------------------------------------------------------------------------
+*/
+
+#if INTERP_SSE2
+
+/**
+ * Select the lanes of x where the mask is set, and those of y elsewhere
+ */
+static GLES_INLINE __m128 SelectLanes(__m128 mask, __m128 x, __m128 y) {
+	return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y));
+}
+
+/**
+ * Convert the result of a comparison to 1.0 for true and 0.0 for false
+ */
+static GLES_INLINE __m128 MaskToOne(__m128 mask) {
+	return _mm_and_ps(mask, _mm_set1_ps(1.0f));
+}
+
+#endif
+
+/**
+ * Fetch an operand for all lanes of a batch.
+ *
+ * Constants and uniforms are shared by all lanes, all other segments
+ * are stored as structure of arrays. Relatively addressed operands are
+ * only fetched for the lanes selected by the mask, because the address
+ * register of the remaining lanes may not have been initialized.
+ */
+static GLES_INLINE void FetchBatch(const BatchMachine * machine, const InterpOperand * operand,
+								   GLuint mask, BatchVec4f * result) {
+	const GLfloat * base = machine->segment[operand->segment];
+	const GLint * addr = operand->index ? machine->addr[operand->index - 1] : NULL;
+	GLsizei select[4], i, j;
+
+	for (i = 0; i < 4; ++i) {
+		select[i] = (operand->swizzle >> (i * 2)) & 3;
+	}
+
+	if (operand->segment == InterpSegConstant || operand->segment == InterpSegUniform) {
+		base += operand->offset;
+
+		for (j = 0; j < GLES_SHADER_BATCH; ++j) {
+			const GLfloat * elem = base;
+
+			if (addr) {
+				if (!(mask & (1u << j))) {
+					result->v[0][j] = result->v[1][j] = result->v[2][j] = result->v[3][j] = 0.0f;
+					continue;
+				}
+
+				elem += addr[j] * 4;
+			}
+
+			for (i = 0; i < 4; ++i) {
+				result->v[i][j] = elem[select[i]];
+			}
+		}
+	} else {
+		base += operand->offset * GLES_SHADER_BATCH;
+
+		if (!addr) {
+			for (i = 0; i < 4; ++i) {
+				const GLfloat * lanes = base + select[i] * GLES_SHADER_BATCH;
+
+#if INTERP_SSE2
+				for (j = 0; j < GLES_SHADER_BATCH; j += 4) {
+					__m128 value = _mm_loadu_ps(lanes + j);
+					
+					if (operand->negate) {
+						value = _mm_xor_ps(value, _mm_set1_ps(-0.0f));
+					}
+					
+					_mm_storeu_ps(&result->v[i][j], value);
+				}
+#else
+				for (j = 0; j < GLES_SHADER_BATCH; ++j) {
+					result->v[i][j] = lanes[j];
+				}
+#endif
+			}
+
+#if INTERP_SSE2
+			/* negated while copying */
+			return;
+#endif
+		} else {
+			for (j = 0; j < GLES_SHADER_BATCH; ++j) {
+				if (mask & (1u << j)) {
+					const GLfloat * elem = base + addr[j] * 4 * GLES_SHADER_BATCH + j;
+
+					for (i = 0; i < 4; ++i) {
+						result->v[i][j] = elem[select[i] * GLES_SHADER_BATCH];
+					}
+				} else {
+					result->v[0][j] = result->v[1][j] = result->v[2][j] = result->v[3][j] = 0.0f;
+				}
+			}
+		}
+	}
+
+	if (operand->negate) {
+		for (i = 0; i < 4; ++i) {
+			for (j = 0; j < GLES_SHADER_BATCH; ++j) {
+				result->v[i][j] = -result->v[i][j];
+			}
+		}
+	}
+}
+
+/**
+ * Store the result of an instruction for the lanes selected by the mask.
+ */
+static GLES_INLINE void StoreBatch(const BatchMachine * machine, const InterpInst * inst,
+								   GLuint mask, BatchVec4f * value) {
+	GLfloat * base =
+		machine->segment[inst->dst.segment] + inst->dst.offset * GLES_SHADER_BATCH;
+	GLsizei i, j;
+
+#if INTERP_SSE2
+	for (j = 0; j < GLES_SHADER_BATCH; j += 4) {
+		/* expand the bits of the lane mask to all bits of each lane */
+		__m128i bits = _mm_set_epi32(8, 4, 2, 1);
+		__m128 select = _mm_castsi128_ps(
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((mask >> j) & 0xf), bits), bits));
+		
+		for (i = 0; i < 4; ++i) {
+			if (inst->mask & (1u << i)) {
+				GLfloat * lanes = base + i * GLES_SHADER_BATCH + j;
+				__m128 result = _mm_loadu_ps(&value->v[i][j]);
+				
+				if (inst->saturate) {
+					/* NaN passes through, as with GlesClampf */
+					result = _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_setzero_ps(), result));
+				}
+				
+				_mm_storeu_ps(lanes, SelectLanes(select, result, _mm_loadu_ps(lanes)));
+			}
+		}
+	}
+#else
+	if (inst->saturate) {
+		for (i = 0; i < 4; ++i) {
+			for (j = 0; j < GLES_SHADER_BATCH; ++j) {
+				value->v[i][j] = GlesClampf(value->v[i][j]);
+			}
+		}
+	}
+
+	for (i = 0; i < 4; ++i) {
+		if (inst->mask & (1u << i)) {
+			GLfloat * lanes = base + i * GLES_SHADER_BATCH;
+
+			for (j = 0; j < GLES_SHADER_BATCH; ++j) {
+				lanes[j] = (mask & (1u << j)) ? value->v[i][j] : lanes[j];
+			}
+		}
+	}
+#endif
+}
+
+/**
+ * Test the condition code register for each lane of the batch.
+ *
+ * @return	the mask of lanes for which the test passes
+ */
+static GLES_INLINE GLuint TestCondBatch(const BatchMachine * machine, const InterpInst * inst) {
+	GLuint result = 0;
+	GLsizei j;
+
+	if (inst->cond == CondT) {
+		return LANE_MASK;
+	} else if (inst->cond == CondF) {
+		return 0;
+	}
+
+	for (j = 0; j < GLES_SHADER_BATCH; ++j) {
+		if (((Flags(machine->cc.v[ inst->select       & 3][j]) |
+			  Flags(machine->cc.v[(inst->select >> 2) & 3][j]) |
+			  Flags(machine->cc.v[(inst->select >> 4) & 3][j]) |
+			  Flags(machine->cc.v[(inst->select >> 6) & 3][j])) & inst->cond) != 0) {
+			result |= 1u << j;
+		}
+	}
+
+	return result;
+}
+
+/**
+ * Perform the texture accesses of a TEX, TXB, TXL or TXP instruction for
+ * the lanes selected by the mask. If the lanes form 2x2 pixel quads, the
+ * level of detail is derived once per quad from the differences of the
+ * texture coordinates across the quad, including those of helper lanes.
+ */
+static void SampleBatch(const BatchMachine * machine, const InterpInst * inst,
+						GLuint mask, const BatchVec4f * coords, BatchVec4f * result) {
+	BatchVec4f sampler;
+	Vec4f coord[GLES_SHADER_BATCH], dx, dy, texel;
+	GLfloat lod = 0.0f;
+	GLsizei i, j, quad = -1;
+
+	FetchBatch(machine, &inst->src[1], mask, &sampler);
+
+	for (j = 0; j < GLES_SHADER_BATCH; ++j) {
+		for (i = 0; i < 4; ++i) {
+			coord[j].v[i] = coords->v[i][j];
+		}
+
+		if (inst->op == InterpOpTXP) {
+			coord[j].x /= coord[j].w;
+			coord[j].y /= coord[j].w;
+			coord[j].z /= coord[j].w;
+		}
+
+		if (inst->op == InterpOpTEX || inst->op == InterpOpTXP) {
+			coord[j].w = 0.0f;
+		}
+	}
+
+	for (j = 0; j < GLES_SHADER_BATCH; ++j) {
+		if (!(mask & (1u << j))) {
+			continue;
+		}
+
+		if (machine->quads && inst->op != InterpOpTXL && (j & ~3) != quad) {
+			/* first active lane of a quad */
+			quad = j & ~3;
+
+			for (i = 0; i < 4; ++i) {
+				dx.v[i] = coord[quad + 1].v[i] - coord[quad].v[i];
+				dy.v[i] = coord[quad + 2].v[i] - coord[quad].v[i];
+			}
+
+			lod = GlesInterpLod(machine->textureImageUnit, sampler.v[0][j],
+								inst->texture, &coord[quad], &dx, &dy);
+		}
+
+		coord[j].w += lod;
+
+		GlesInterpSample(machine->textureImageUnit, sampler.v[0][j], inst->texture,
+						 &coord[j], &texel);
+
+		for (i = 0; i < 4; ++i) {
+			result->v[i][j] = texel.v[i];
+		}
+	}
+}
+
+#if GLES_INTERP_THREADED
+#	define OP(name)		Op##name:
+#	define DISPATCH()	goto *ip->handler
+#else
+#	define OP(name)		case InterpOp##name:
+#	define DISPATCH()	goto dispatch
+#endif
+
+#define NEXT()			++ip; DISPATCH()
+#define STORE_NEXT()	StoreBatch(machine, ip, exec, &r); NEXT()
+#define FETCH1()		FetchBatch(machine, &ip->src[0], exec, &a)
+#define FETCH2()		FETCH1(); FetchBatch(machine, &ip->src[1], exec, &b)
+#define FETCH3()		FETCH2(); FetchBatch(machine, &ip->src[2], exec, &c)
+
+#define EACH_LANE(stmt)	for (j = 0; j < GLES_SHADER_BATCH; ++j) { stmt; }
+#define EACH(stmt)		for (i = 0; i < 4; ++i) EACH_LANE(stmt)
+#define REPLICATE(expr)	EACH_LANE(r.v[0][j] = r.v[1][j] = r.v[2][j] = r.v[3][j] = (expr))
+
+/*
+ * Arithmetic kernels are given as an SSE2 expression on four lanes at a time,
+ * where LANES(x, i) are the lanes j to j + 3 of component i of operand x, 
+ * and as a scalar expression on lane j, which is used without SSE2.
+ */
+#if INTERP_SSE2
+#	define LANES(x, i)				_mm_loadu_ps(&(x).v[i][j])
+#	define EACH_VEC(vec, scalar)									\
+	for (i = 0; i < 4; ++i)												\
+		for (j = 0; j < GLES_SHADER_BATCH; j += 4)						\
+			_mm_storeu_ps(&r.v[i][j], (vec))
+#	define REPLICATE_VEC(vec, scalar)								\
+	for (j = 0; j < GLES_SHADER_BATCH; j += 4) {						\
+		__m128 value = (vec);											\
+		for (i = 0; i < 4; ++i)											\
+			_mm_storeu_ps(&r.v[i][j], value);							\
+	}
+#else
+#	define EACH_VEC(vec, scalar)		EACH(r.v[i][j] = (scalar))
+#	define REPLICATE_VEC(vec, scalar)	REPLICATE(scalar)
+#endif
+
+#define COMPARE(rel, cmp)							\
+	FETCH2();										\
+	EACH_VEC(MaskToOne(cmp(LANES(a, i), LANES(b, i))), 	\
+			 a.v[i][j] rel b.v[i][j] ? 1.0f : 0.0f);	\
+	STORE_NEXT()
+
+/* lanes that have neither been discarded nor left the innermost loop */
+#define ACTIVE()		(live & (loop ? machine->loop[loop - 1].active : LANE_MASK))
+
+/**
+ * Execute a sequence of batched interpreter instructions on all lanes
+ * of a batch.
+ *
+ * Each instruction is applied to all lanes, but results are only stored
+ * for the lanes within the current execution mask. Divergent control flow
+ * is handled by narrowing the execution mask at IF, ELSE, BRK and KIL, and
+ * by restoring it at ENDIF and when leaving a loop.
+ *
+ * @param	machine	the state of the shader invocation; if NULL, the function
+ * 					only publishes its dispatch addresses
+ * @param	code	the code to execute
+ * @param	live	the lanes of the batch to process
+ *
+ * @return	mask of the lanes that have not been discarded
+ */
+static GLuint ExecuteBatch(BatchMachine * machine, const InterpInst * code, GLuint live) {
+
+#if GLES_INTERP_THREADED
+	static const void * const dispatch[InterpOpCount] = {
+		[InterpOpABS] 		= &&OpABS,
+		[InterpOpADD] 		= &&OpADD,
+		[InterpOpARL] 		= &&OpARL,
+		[InterpOpCMP] 		= &&OpCMP,
+		[InterpOpCOS] 		= &&OpCOS,
+		[InterpOpDDX] 		= &&OpDDX,
+		[InterpOpDDY] 		= &&OpDDY,
+		[InterpOpDP2] 		= &&OpDP2,
+		[InterpOpDP3] 		= &&OpDP3,
+		[InterpOpDP4] 		= &&OpDP4,
+		[InterpOpDPH] 		= &&OpDPH,
+		[InterpOpDST] 		= &&OpDST,
+		[InterpOpEX2] 		= &&OpEX2,
+		[InterpOpEXP] 		= &&OpEXP,
+		[InterpOpFLR] 		= &&OpFLR,
+		[InterpOpFRC] 		= &&OpFRC,
+		[InterpOpLG2] 		= &&OpLG2,
+		[InterpOpLOG] 		= &&OpLOG,
+		[InterpOpLRP] 		= &&OpLRP,
+		[InterpOpMAD] 		= &&OpMAD,
+		[InterpOpMAX] 		= &&OpMAX,
+		[InterpOpMIN] 		= &&OpMIN,
+		[InterpOpMOV] 		= &&OpMOV,
+		[InterpOpMUL] 		= &&OpMUL,
+		[InterpOpPOW] 		= &&OpPOW,
+		[InterpOpRCP] 		= &&OpRCP,
+		[InterpOpRSQ] 		= &&OpRSQ,
+		[InterpOpSCS] 		= &&OpSCS,
+		[InterpOpSEQ] 		= &&OpSEQ,
+		[InterpOpSFL] 		= &&OpSFL,
+		[InterpOpSGE] 		= &&OpSGE,
+		[InterpOpSGT] 		= &&OpSGT,
+		[InterpOpSIN] 		= &&OpSIN,
+		[InterpOpSLE] 		= &&OpSLE,
+		[InterpOpSLT] 		= &&OpSLT,
+		[InterpOpSNE] 		= &&OpSNE,
+		[InterpOpSSG] 		= &&OpSSG,
+		[InterpOpSTR] 		= &&OpSTR,
+		[InterpOpSUB] 		= &&OpSUB,
+		[InterpOpSWZ] 		= &&OpSWZ,
+		[InterpOpXPD] 		= &&OpXPD,
+		[InterpOpTEX] 		= &&OpTEX,
+		[InterpOpTXB] 		= &&OpTEX,
+		[InterpOpTXL] 		= &&OpTEX,
+		[InterpOpTXP] 		= &&OpTEX,
+		[InterpOpSCC] 		= &&OpSCC,
+		[InterpOpIF] 		= &&OpIF,
+		[InterpOpJMP] 		= &&OpJMP,
+		[InterpOpELSE] 		= &&OpELSE,
+		[InterpOpENDIF] 	= &&OpENDIF,
+		[InterpOpREP] 		= &&OpREP,
+		[InterpOpENDREP]	= &&OpENDREP,
+		[InterpOpBRK] 		= &&OpBRK,
+		[InterpOpCAL] 		= &&OpCAL,
+		[InterpOpRET] 		= &&OpRET,
+		[InterpOpKIL] 		= &&OpKIL,
+		[InterpOpEND] 		= &&OpEND,
+	};
+#endif
+
+	const InterpInst * ip = code;
+	GLsizei loop = 0, cond = 0, call = 0, i, j;
+	GLuint exec = live, pass;
+	BatchLoop * frame;
+	BatchVec4f a, b, c, r;
+
+#if GLES_INTERP_THREADED
+	if (!machine) {
+		BatchHandlers = dispatch;
+		return 0;
+	}
+
+	DISPATCH();
+#else
+	if (!machine) {
+		return 0;
+	}
+
+dispatch:
+	switch (ip->op) {
+#endif
+
+	OP(ABS)
+		FETCH1();
+		EACH_VEC(_mm_andnot_ps(_mm_set1_ps(-0.0f), LANES(a, i)), GlesFabsf(a.v[i][j]));
+		STORE_NEXT();
+
+	OP(ADD)
+		FETCH2();
+		EACH_VEC(_mm_add_ps(LANES(a, i), LANES(b, i)), a.v[i][j] + b.v[i][j]);
+		STORE_NEXT();
+
+	OP(ARL)
+		FETCH1();
+		EACH_LANE(
+			if (exec & (1u << j))
+				machine->addr[ip->target][j] = (GLint) GlesFloorf(a.v[0][j]));
+		NEXT();
+
+	OP(CMP)
+		FETCH3();
+		EACH_VEC(SelectLanes(_mm_cmplt_ps(LANES(a, i), _mm_setzero_ps()), LANES(b, i), LANES(c, i)),
+				 a.v[i][j] < 0.0f ? b.v[i][j] : c.v[i][j]);
+		STORE_NEXT();
+
+	OP(COS)
+		FETCH1();
+		GlesMathCos(r.v[0], a.v[0], (Precision) ip->precision);
+		REPLICATE(r.v[0][j]);
+		STORE_NEXT();
+
+	OP(DDX)
+		/* difference between the right and left pixel of each quad row */
+		FETCH1();
+		EACH(r.v[i][j] = machine->quads ? a.v[i][j | 1] - a.v[i][j & ~1] : 0.0f);
+		STORE_NEXT();
+
+	OP(DDY)
+		/* difference between the lower and upper pixel of each quad column */
+		FETCH1();
+		EACH(r.v[i][j] = machine->quads ? a.v[i][j | 2] - a.v[i][j & ~2] : 0.0f);
+		STORE_NEXT();
+
+	OP(DP2)
+		FETCH2();
+		REPLICATE_VEC(_mm_add_ps(_mm_mul_ps(LANES(a, 0), LANES(b, 0)), 
+								 _mm_mul_ps(LANES(a, 1), LANES(b, 1))),
+					  a.v[0][j] * b.v[0][j] + a.v[1][j] * b.v[1][j]);
+		STORE_NEXT();
+
+	OP(DP3)
+		FETCH2();
+		REPLICATE_VEC(_mm_add_ps(_mm_add_ps(_mm_mul_ps(LANES(a, 0), LANES(b, 0)), 
+											_mm_mul_ps(LANES(a, 1), LANES(b, 1))),
+								 _mm_mul_ps(LANES(a, 2), LANES(b, 2))),
+					  a.v[0][j] * b.v[0][j] + a.v[1][j] * b.v[1][j] + a.v[2][j] * b.v[2][j]);
+		STORE_NEXT();
+
+	OP(DP4)
+		FETCH2();
+		REPLICATE_VEC(_mm_add_ps(_mm_add_ps(_mm_mul_ps(LANES(a, 0), LANES(b, 0)), 
+											_mm_mul_ps(LANES(a, 1), LANES(b, 1))),
+								 _mm_add_ps(_mm_mul_ps(LANES(a, 2), LANES(b, 2)),
+											_mm_mul_ps(LANES(a, 3), LANES(b, 3)))),
+					  a.v[0][j] * b.v[0][j] + a.v[1][j] * b.v[1][j] +
+					  a.v[2][j] * b.v[2][j] + a.v[3][j] * b.v[3][j]);
+		STORE_NEXT();
+
+	OP(DPH)
+		FETCH2();
+		REPLICATE_VEC(_mm_add_ps(_mm_add_ps(_mm_mul_ps(LANES(a, 0), LANES(b, 0)), 
+											_mm_mul_ps(LANES(a, 1), LANES(b, 1))),
+								 _mm_add_ps(_mm_mul_ps(LANES(a, 2), LANES(b, 2)),
+											LANES(b, 3))),
+					  a.v[0][j] * b.v[0][j] + a.v[1][j] * b.v[1][j] +
+					  a.v[2][j] * b.v[2][j] + b.v[3][j]);
+		STORE_NEXT();
+
+	OP(DST)
+		FETCH2();
+		EACH_LANE(
+			r.v[0][j] = 1.0f;
+			r.v[1][j] = a.v[1][j] * b.v[1][j];
+			r.v[2][j] = a.v[2][j];
+			r.v[3][j] = b.v[3][j]);
+		STORE_NEXT();
+
+	OP(EX2)
+		FETCH1();
+		GlesMathExp2(r.v[0], a.v[0], (Precision) ip->precision);
+		REPLICATE(r.v[0][j]);
+		STORE_NEXT();
+
+	OP(EXP)
+		FETCH1();
+		EACH_LANE(
+			r.v[0][j] = GlesFloorf(a.v[0][j]);
+			r.v[1][j] = GlesFracf(a.v[0][j]);
+			r.v[3][j] = 1.0f);
+		GlesMathExp2(r.v[0], r.v[0], (Precision) ip->precision);
+		GlesMathExp2(r.v[2], a.v[0], (Precision) ip->precision);
+		STORE_NEXT();
+
+	OP(FLR)
+		FETCH1();
+		EACH(r.v[i][j] = GlesFloorf(a.v[i][j]));
+		STORE_NEXT();
+
+	OP(FRC)
+		FETCH1();
+		EACH(r.v[i][j] = GlesFracf(a.v[i][j]));
+		STORE_NEXT();
+
+	OP(LG2)
+		FETCH1();
+		GlesMathLog2(r.v[0], a.v[0], (Precision) ip->precision);
+		REPLICATE(r.v[0][j]);
+		STORE_NEXT();
+
+	OP(LOG)
+		FETCH1();
+		EACH_LANE(r.v[1][j] = GlesFabsf(a.v[0][j]));
+		GlesMathLog2(r.v[2], r.v[1], (Precision) ip->precision);
+		EACH_LANE(r.v[0][j] = GlesFloorf(r.v[2][j]));
+		GlesMathExp2(r.v[3], r.v[0], (Precision) ip->precision);
+		EACH_LANE(
+			r.v[1][j] /= r.v[3][j];
+			r.v[3][j] = 1.0f);
+		STORE_NEXT();
+
+	OP(LRP)
+		FETCH3();
+		EACH_VEC(_mm_add_ps(_mm_mul_ps(LANES(a, i), LANES(b, i)),
+							_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), LANES(a, i)), LANES(c, i))),
+				 a.v[i][j] * b.v[i][j] + (1.0f - a.v[i][j]) * c.v[i][j]);
+		STORE_NEXT();
+
+	OP(MAD)
+		FETCH3();
+		EACH_VEC(_mm_add_ps(_mm_mul_ps(LANES(a, i), LANES(b, i)), LANES(c, i)),
+				 a.v[i][j] * b.v[i][j] + c.v[i][j]);
+		STORE_NEXT();
+
+	OP(MAX)
+		FETCH2();
+		EACH_VEC(_mm_max_ps(LANES(a, i), LANES(b, i)), GlesMaxf(a.v[i][j], b.v[i][j]));
+		STORE_NEXT();
+
+	OP(MIN)
+		FETCH2();
+		EACH_VEC(_mm_min_ps(LANES(a, i), LANES(b, i)), GlesMinf(a.v[i][j], b.v[i][j]));
+		STORE_NEXT();
+
+	OP(MOV)
+		FetchBatch(machine, &ip->src[0], exec, &r);
+		STORE_NEXT();
+
+	OP(MUL)
+		FETCH2();
+		EACH_VEC(_mm_mul_ps(LANES(a, i), LANES(b, i)), a.v[i][j] * b.v[i][j]);
+		STORE_NEXT();
+
+	OP(POW)
+		FETCH2();
+		GlesMathPow(r.v[0], a.v[0], b.v[0], (Precision) ip->precision);
+		REPLICATE(r.v[0][j]);
+		STORE_NEXT();
+
+	OP(RCP)
+		FETCH1();
+		REPLICATE_VEC(_mm_div_ps(_mm_set1_ps(1.0f), LANES(a, 0)), 1.0f / a.v[0][j]);
+		STORE_NEXT();
+
+	OP(RSQ)
+		FETCH1();
+		GlesMathRsq(r.v[0], a.v[0], (Precision) ip->precision);
+		REPLICATE(r.v[0][j]);
+		STORE_NEXT();
+
+	OP(SCS)
+		FETCH1();
+		GlesMathCos(r.v[0], a.v[0], (Precision) ip->precision);
+		GlesMathSin(r.v[1], a.v[0], (Precision) ip->precision);
+		EACH_LANE(r.v[2][j] = r.v[3][j] = 0.0f);
+		STORE_NEXT();
+
+	OP(SEQ)
+		COMPARE(==, _mm_cmpeq_ps);
+
+	OP(SFL)
+		EACH(r.v[i][j] = 0.0f);
+		STORE_NEXT();
+
+	OP(SGE)
+		COMPARE(>=, _mm_cmpge_ps);
+
+	OP(SGT)
+		COMPARE(>, _mm_cmpgt_ps);
+
+	OP(SIN)
+		FETCH1();
+		GlesMathSin(r.v[0], a.v[0], (Precision) ip->precision);
+		REPLICATE(r.v[0][j]);
+		STORE_NEXT();
+
+	OP(SLE)
+		COMPARE(<=, _mm_cmple_ps);
+
+	OP(SLT)
+		COMPARE(<, _mm_cmplt_ps);
+
+	OP(SNE)
+		COMPARE(!=, _mm_cmpneq_ps);
+
+	OP(SSG)
+		FETCH1();
+		EACH(r.v[i][j] = GlesSignf(a.v[i][j]));
+		STORE_NEXT();
+
+	OP(STR)
+		EACH(r.v[i][j] = 1.0f);
+		STORE_NEXT();
+
+	OP(SUB)
+		FETCH2();
+		EACH_VEC(_mm_sub_ps(LANES(a, i), LANES(b, i)), a.v[i][j] - b.v[i][j]);
+		STORE_NEXT();
+
+	OP(SWZ)
+		FETCH1();
+		EACH_LANE(
+			Vec4f value;
+
+			for (i = 0; i < 4; ++i) {
+				value.v[i] = a.v[i][j];
+			}
+
+			for (i = 0; i < 4; ++i) {
+				r.v[i][j] = ExtSwizzle(&value, (ip->target >> (i * 4)) & 0xf);
+			});
+		STORE_NEXT();
+
+	OP(XPD)
+		FETCH2();
+		EACH_LANE(
+			r.v[0][j] = a.v[1][j] * b.v[2][j] - a.v[2][j] * b.v[1][j];
+			r.v[1][j] = a.v[2][j] * b.v[0][j] - a.v[0][j] * b.v[2][j];
+			r.v[2][j] = a.v[0][j] * b.v[1][j] - a.v[1][j] * b.v[0][j];
+			r.v[3][j] = 0.0f);
+		STORE_NEXT();
+
+#if !GLES_INTERP_THREADED
+	OP(TXB)
+	OP(TXL)
+	OP(TXP)
+#endif
+	OP(TEX)
+		FETCH1();
+		SampleBatch(machine, ip, exec, &a, &r);
+		STORE_NEXT();
+
+	OP(SCC)
+		FETCH1();
+		EACH(
+			if (exec & (1u << j))
+				machine->cc.v[i][j] = a.v[i][j]);
+		NEXT();
+
+	OP(IF)
+		GLES_ASSERT(cond < MAX_COND_STACK);
+		pass = exec & TestCondBatch(machine, ip);
+		machine->cond[cond].saved = exec;
+		machine->cond[cond].taken = pass;
+		++cond;
+
+		if ((exec = pass)) {
+			++ip;
+		} else {
+			ip = code + ip->target;
+		}
+
+		DISPATCH();
+
+	OP(JMP)
+		ip = code + ip->target;
+		DISPATCH();
+
+	OP(ELSE)
+		exec = machine->cond[cond - 1].saved & ~machine->cond[cond - 1].taken & ACTIVE();
+
+		if (exec) {
+			++ip;
+		} else {
+			ip = code + ip->target;
+		}
+
+		DISPATCH();
+
+	OP(ENDIF)
+		--cond;
+		exec = machine->cond[cond].saved & ACTIVE();
+		NEXT();
+
+	OP(REP)
+		GLES_ASSERT(loop < MAX_LOOP_STACK);
+		FETCH1();
+		frame = &machine->loop[loop];
+		pass = 0;
+
+		EACH_LANE(
+			frame->count[j] = (GLint) a.v[0][j];
+
+			if (frame->count[j] > 0)
+				pass |= 1u << j);
+
+		if (!(pass &= exec)) {
+			ip = code + ip->target;
+		} else {
+			frame->saved = exec;
+			frame->active = pass;
+			frame->cond = cond;
+			++loop;
+			exec = pass;
+			++ip;
+		}
+
+		DISPATCH();
+
+	OP(ENDREP)
+		frame = &machine->loop[loop - 1];
+
+		EACH_LANE(
+			if ((frame->active & (1u << j)) && --frame->count[j] <= 0)
+				frame->active &= ~(1u << j));
+
+		if ((frame->active &= live)) {
+			exec = frame->active;
+			ip = code + ip->target;
+		} else {
+			/* BRK may leave the loop from within nested IF blocks */
+			cond = frame->cond;
+			--loop;
+			exec = frame->saved & ACTIVE();
+			++ip;
+		}
+
+		DISPATCH();
+
+	OP(BRK)
+		pass = exec & TestCondBatch(machine, ip);
+		frame = &machine->loop[loop - 1];
+		frame->active &= ~pass;
+		exec &= ~pass;
+
+		if (!frame->active) {
+			/* all lanes have left the loop */
+			ip = code + ip->target;
+		} else {
+			++ip;
+		}
+
+		DISPATCH();
+
+	OP(CAL)
+		if (exec) {
+			GLES_ASSERT(call < GLES_MAX_FUNCTION_DEPTH);
+			machine->call[call++] = ip + 1;
+			ip = code + ip->target;
+		} else {
+			++ip;
+		}
+
+		DISPATCH();
+
+	OP(RET)
+		if (!call) {
+			/* return from main */
+			return live;
+		}
+
+		ip = machine->call[--call];
+		DISPATCH();
+
+	OP(KIL)
+		pass = exec & TestCondBatch(machine, ip);
+		exec &= ~pass;
+
+		if (!(live &= ~pass)) {
+			return 0;
+		}
+
+		NEXT();
+
+	OP(END)
+		return live;
+
+#if !GLES_INTERP_THREADED
+	default:
+		GLES_ASSERT(GL_FALSE);
+		return 0;
+	}
+#endif
+}
+
+#undef OP
+#undef DISPATCH
+#undef NEXT
+#undef STORE_NEXT
+#undef FETCH1
+#undef FETCH2
+#undef FETCH3
+#undef EACH_LANE
+#undef EACH
+#undef REPLICATE
+#undef LANES
+#undef EACH_VEC
+#undef REPLICATE_VEC
+#undef COMPARE
+#undef ACTIVE
+
+/*
+** --------------------------------------------------------------------------
+** Internal functions
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Publish the dispatch addresses of the interpreter. This happens on first
+ * use, but needs to be done up-front before code is generated on several
+ * threads concurrently.
+ */
+void GlesInterpInitialize(void) {
+	if (!Handlers) {
+		Execute(NULL, NULL);
+		ExecuteBatch(NULL, NULL, 0);
+	}
+}
+
+/**
+ * Generate interpreter code for a shader program whose variables have
+ * all been allocated by the linker.
+ *
+ * The shader is additionally lowered for batched execution; if that is
+ * not possible, vertices and fragments are processed one at a time.
+ *
+ * @param	linker	reference to linker object
+ * @param	program	the shader program to translate
+ * @param	binary	the shader binary receiving code segment and entry point
+ * @param	type	GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ *
+ * @return	GL_TRUE if the code generation was successful
+ */
+GLboolean GlesInterpGenerate(Linker * linker, ShaderProgram * program,
+							 ShaderBinary * binary, GLenum type) {
+
+	GlesInterpInitialize();
+
+	if (!Lower(linker, program, type, GL_FALSE, &binary->code)) {
+		return GL_FALSE;
+	}
+
+	binary->entry =
+		type == GL_VERTEX_SHADER ?
+			(void *) GlesInterpVertexProgram :
+			(void *) GlesInterpFragmentProgram;
+
+	if (Lower(linker, program, type, GL_TRUE, &binary->batch)) {
+		binary->batchEntry =
+			type == GL_VERTEX_SHADER ?
+				(void *) GlesInterpVertexBatch :
+				(void *) GlesInterpFragmentBatch;
+	} else if (binary->batch.base) {
+		GlesFree(binary->batch.base);
+		binary->batch.base = NULL;
+		binary->batch.size = 0;
+	}
+
+	return GL_TRUE;
+}
+
+/**
+ * Generate interpreter code for the pre-shader split off a shader program,
+ * which is evaluated once per draw call.
+ *
+ * @param	linker	reference to linker object
+ * @param	program	the pre-shader to translate
+ * @param	binary	the shader binary receiving the pre-shader code segment
+ * @param	type	GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ *
+ * @return	GL_TRUE if the code generation was successful
+ */
+GLboolean GlesInterpGeneratePre(Linker * linker, ShaderProgram * program,
+								ShaderBinary * binary, GLenum type) {
+
+	GlesInterpInitialize();
+
+	return Lower(linker, program, type, GL_FALSE, &binary->pre);
+}
+
+/**
+ * Validate a segment of interpreter code that has been read back from a
+ * program binary and re-establish its dispatch addresses, which are not
+ * preserved across processes.
+ *
+ * @param	segment	the code segment to relocate
+ * @param	batch	GL_TRUE if the code has been lowered for batched execution
+ *
+ * @return	GL_TRUE if the code segment is well-formed
+ */
+static GLboolean Relocate(Segment * segment, GLboolean batch) {
+	const void * const * handlers = batch ? BatchHandlers : Handlers;
+	InterpInst * code = (InterpInst *) segment->base;
+	GLsizei index, operand;
+
+	if (segment->size < 1 || code[segment->size - 1].op != InterpOpEND) {
+		return GL_FALSE;
+	}
+
+	for (index = 0; index < segment->size; ++index) {
+		/* jump targets and address register numbers need to be in range */
+		GLsizei limit =
+			code[index].op == InterpOpSWZ ? GLES_INT_MAX :
+			code[index].op == InterpOpARL ? GLES_MAX_ADDRESS_REGISTERS :
+			segment->size;
+
+		if (code[index].op >= InterpOpCount ||
+			code[index].target < 0 || code[index].target >= limit ||
+			code[index].dst.segment >= InterpSegCount ||
+			code[index].dst.index > GLES_MAX_ADDRESS_REGISTERS) {
+			return GL_FALSE;
+		}
+
+		for (operand = 0; operand < 3; ++operand) {
+			if (code[index].src[operand].segment >= InterpSegCount ||
+				code[index].src[operand].index > GLES_MAX_ADDRESS_REGISTERS) {
+				return GL_FALSE;
+			}
+		}
+
+#if GLES_INTERP_THREADED
+		code[index].handler = handlers[code[index].op];
+#endif
+	}
+
+	return GL_TRUE;
+}
+
+/**
+ * Prepare a shader binary that has been loaded from a program binary
+ * for execution by the interpreter.
+ *
+ * @param	binary	the shader binary with code segments in place
+ * @param	type	GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ *
+ * @return	GL_TRUE if the code segments are well-formed
+ */
+GLboolean GlesInterpRelocate(ShaderBinary * binary, GLenum type) {
+
+	GlesInterpInitialize();
+
+	if (!Relocate(&binary->code, GL_FALSE)) {
+		return GL_FALSE;
+	}
+
+	binary->entry =
+		type == GL_VERTEX_SHADER ?
+			(void *) GlesInterpVertexProgram :
+			(void *) GlesInterpFragmentProgram;
+
+	if (binary->pre.base && !Relocate(&binary->pre, GL_FALSE)) {
+		return GL_FALSE;
+	}
+
+	if (binary->batch.base) {
+		if (!Relocate(&binary->batch, GL_TRUE)) {
+			return GL_FALSE;
+		}
+
+		binary->batchEntry =
+			type == GL_VERTEX_SHADER ?
+				(void *) GlesInterpVertexBatch :
+				(void *) GlesInterpFragmentBatch;
+	}
+
+	return GL_TRUE;
+}
+
+/**
+ * Determine if the batched code of a shader binary relies on its lanes 
+ * forming 2x2 pixel quads, i.e. if it takes derivatives or accesses
+ * textures with a level of detail derived from them.
+ *
+ * @param	binary	the shader binary
+ *
+ * @return	GL_TRUE if the batched code needs to run on pixel quads
+ */
+GLboolean GlesInterpNeedsQuads(const ShaderBinary * binary) {
+	const InterpInst * code = (const InterpInst *) binary->batch.base;
+	GLsizei index;
+
+	for (index = 0; index < binary->batch.size; ++index) {
+		switch (code[index].op) {
+		case InterpOpDDX:
+		case InterpOpDDY:
+		case InterpOpTEX:
+		case InterpOpTXB:
+		case InterpOpTXP:
+			return GL_TRUE;
+
+		default:
+			break;
+		}
+	}
+
+	return GL_FALSE;
+}
+
+/**
+ * Determine the texture unit addressed by a sampler value.
+ *
+ * @param	units	the texture image units of the execution context
+ * @param	sampler	value of the sampler variable, i.e. the texture unit
+ * @param	texture	the TextureTarget expected by the shader
+ *
+ * @return	the texture unit, or NULL if it has no texture of matching type
+ */
+static const TextureImageUnit * GetTextureUnit(const TextureImageUnit * units,
+											   GLfloat sampler, GLubyte texture) {
+	GLuint unit = (GLuint) sampler;
+	GLenum textureType;
+
+	switch (texture) {
+	case TextureTarget2D:	textureType = GL_TEXTURE_2D;		break;
+	case TextureTarget3D:	textureType = GL_TEXTURE_3D;		break;
+	default:				textureType = GL_TEXTURE_CUBE_MAP;	break;
+	}
+
+	if (unit >= GLES_MAX_TEXTURE_UNITS ||
+		!units[unit].boundTexture ||
+		units[unit].boundTexture->base.textureType != textureType) {
+		return NULL;
+	}
+
+	return &units[unit];
+}
+
+/**
+ * Determine the level of detail of a texture access from the derivatives
+ * of the texture coordinates across a pixel quad.
+ *
+ * @param	units	the texture image units of the execution context
+ * @param	sampler	value of the sampler variable, i.e. the texture unit
+ * @param	texture	the TextureTarget expected by the shader
+ * @param	coords	the texture coordinates of the upper left pixel
+ * @param	dx		difference of the coordinates in x direction
+ * @param	dy		difference of the coordinates in y direction
+ *
+ * @return	the level of detail to add to the coordinate w-component
+ */
+GLfloat GlesInterpLod(const TextureImageUnit * units, GLfloat sampler,
+					  GLubyte texture, const Vec4f * coords,
+					  const Vec4f * dx, const Vec4f * dy) {
+	const TextureImageUnit * textureUnit = GetTextureUnit(units, sampler, texture);
+
+	return textureUnit ? GlesTextureLod(textureUnit, coords, dx, dy) : 0.0f;
+}
+
+/**
+ * Perform a texture access on behalf of a shader.
+ *
+ * No derivatives are passed on, so the coordinate w-component always
+ * carries the lod to use; for pixel quads it includes the lod determined
+ * by GlesInterpLod.
+ *
+ * @param	units	the texture image units of the execution context
+ * @param	sampler	value of the sampler variable, i.e. the texture unit
+ * @param	texture	the TextureTarget expected by the shader
+ * @param	coords	the texture coordinates
+ * @param	result	out: the sampled color value
+ */
+void GlesInterpSample(const TextureImageUnit * units, GLfloat sampler,
+					  GLubyte texture, Vec4f * coords, Vec4f * result) {
+	const TextureImageUnit * textureUnit = GetTextureUnit(units, sampler, texture);
+
+	if (!textureUnit) {
+		/* incomplete texture */
+		result->x = result->y = result->z = 0.0f;
+		result->w = 1.0f;
+		return;
+	}
+
+	switch (texture) {
+	case TextureTarget2D:
+		GlesTextureSample2D(textureUnit, coords, NULL, NULL, result);
+		break;
+
+	case TextureTarget3D:
+		GlesTextureSample3D(textureUnit, coords, NULL, NULL, result);
+		break;
+
+	default:
+		GlesTextureSampleCube(textureUnit, coords, NULL, NULL, result);
+		break;
+	}
+}
+
+/**
+ * Evaluate the pre-shader of a shader binary. The data segment of the
+ * binary is copied into the given per-draw storage, which then receives
+ * the values computed from constants and uniform variables. The binary
+ * itself is not modified.
+ *
+ * @param	binary	the shader binary
+ * @param	uniform	the uniform data of the program
+ * @param	temp	temporary storage of at least binary->bssSize vectors
+ * @param	data	storage of at least binary->data.size vectors, which
+ * 					the shader then uses as its constant segment
+ */
+void GlesInterpPreProgram(const ShaderBinary * binary, const Vec4f * uniform,
+						  Vec4f * temp, Vec4f * data) {
+	Machine machine;
+
+	if (!binary->pre.base) {
+		return;
+	}
+
+	GlesMemcpy(data, binary->data.base, binary->data.size * sizeof(Vec4f));
+
+	machine.segment[InterpSegConstant] 	= (GLfloat *) data;
+	machine.segment[InterpSegUniform] 	= (GLfloat *) uniform;
+	machine.segment[InterpSegAttrib] 	= NULL;
+	machine.segment[InterpSegVarying] 	= NULL;
+	machine.segment[InterpSegTemp] 		= (GLfloat *) temp;
+	machine.segment[InterpSegResult] 	= (GLfloat *) data;
+	machine.segment[InterpSegSpecial] 	= NULL;
+	machine.textureImageUnit = NULL;
+
+	Execute(&machine, (const InterpInst *) binary->pre.base);
+}
+
+/**
+ * Execute a vertex shader on behalf of the given execution context.
+ *
+ * @param	context	the vertex shader execution context
+ *
+ * @return	GL_TRUE
+ */
+GLboolean GlesInterpVertexProgram(const VertexContext * context) {
+	Machine machine;
+
+	machine.segment[InterpSegConstant] 	= (GLfloat *) context->constant;
+	machine.segment[InterpSegUniform] 	= (GLfloat *) context->uniform;
+	machine.segment[InterpSegAttrib] 	= (GLfloat *) context->attrib;
+	machine.segment[InterpSegVarying] 	= context->varying;
+	machine.segment[InterpSegTemp] 		= (GLfloat *) context->temp;
+	machine.segment[InterpSegResult] 	= (GLfloat *) context->geometry;
+	machine.segment[InterpSegSpecial] 	= (GLfloat *) context;
+	machine.textureImageUnit = context->textureImageUnit;
+
+	return Execute(&machine, (const InterpInst *) context->code);
+}
+
+/**
+ * Execute a fragment shader on behalf of the given execution context.
+ *
+ * @param	context	the fragment shader execution context
+ *
+ * @return	GL_FALSE if the fragment has been discarded
+ */
+GLboolean GlesInterpFragmentProgram(const FragContext * context) {
+	Machine machine;
+
+	machine.segment[InterpSegConstant] 	= (GLfloat *) context->constant;
+	machine.segment[InterpSegUniform] 	= (GLfloat *) context->uniform;
+	machine.segment[InterpSegAttrib] 	= NULL;
+	machine.segment[InterpSegVarying] 	= (GLfloat *) context->varying;
+	machine.segment[InterpSegTemp] 		= (GLfloat *) context->temp;
+	machine.segment[InterpSegResult] 	= (GLfloat *) context->result;
+	machine.segment[InterpSegSpecial] 	= (GLfloat *) context;
+	machine.textureImageUnit = context->textureImageUnit;
+
+	return Execute(&machine, (const InterpInst *) context->code);
+}
+
+/**
+ * Execute a vertex shader on behalf of the given execution context for
+ * a batch of vertices, whose data is stored as structure of arrays.
+ *
+ * @param	context	the vertex shader execution context
+ * @param	mask	the vertices of the batch to process
+ */
+void GlesInterpVertexBatch(const VertexContext * context, GLuint mask) {
+	BatchMachine machine;
+
+	machine.segment[InterpSegConstant] 	= (GLfloat *) context->constant;
+	machine.segment[InterpSegUniform] 	= (GLfloat *) context->uniform;
+	machine.segment[InterpSegAttrib] 	= (GLfloat *) context->batchAttrib;
+	machine.segment[InterpSegVarying] 	= context->batchVarying;
+	machine.segment[InterpSegTemp] 		= (GLfloat *) context->batchTemp;
+	machine.segment[InterpSegResult] 	= context->batchGeometry;
+	machine.segment[InterpSegSpecial] 	= NULL;
+	machine.textureImageUnit = context->textureImageUnit;
+	machine.quads = GL_FALSE;
+
+	ExecuteBatch(&machine, (const InterpInst *) context->batchCode, mask & LANE_MASK);
+}
+
+/**
+ * Execute a fragment shader on behalf of the given execution context for
+ * a batch of fragments, whose data is stored as structure of arrays.
+ *
+ * @param	context	the fragment shader execution context
+ * @param	mask	the fragments of the batch to process
+ *
+ * @return	the mask of fragments that have not been discarded
+ */
+GLuint GlesInterpFragmentBatch(const FragContext * context, GLuint mask) {
+	BatchMachine machine;
+
+	machine.segment[InterpSegConstant] 	= (GLfloat *) context->constant;
+	machine.segment[InterpSegUniform] 	= (GLfloat *) context->uniform;
+	machine.segment[InterpSegAttrib] 	= NULL;
+	machine.segment[InterpSegVarying] 	= (GLfloat *) context->batchVarying;
+	machine.segment[InterpSegTemp] 		= (GLfloat *) context->batchTemp;
+	machine.segment[InterpSegResult] 	= context->batchResult;
+	machine.segment[InterpSegSpecial] 	= (GLfloat *) context->batchFragCoord;
+	machine.textureImageUnit = context->textureImageUnit;
+	machine.quads = GL_TRUE;
+
+	return ExecuteBatch(&machine, (const InterpInst *) context->batchCode,
+						mask & LANE_MASK);
+}
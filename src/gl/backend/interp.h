@@ -0,0 +1,201 @@
+#ifndef GLES_BACKEND_INTERP_H
+#define GLES_BACKEND_INTERP_H 1
+
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Shader bytecode interpreter backend
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+#include "gl/state.h"
+#include "frontend/il.h"
+#include "frontend/linker.h"
+
+/*
+** --------------------------------------------------------------------------
+** Constants
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Memory segments that can be addressed by an interpreter operand. The
+ * base addresses of the segments are taken from the execution context
+ * at the start of each shader invocation.
+ */
+typedef enum InterpSegment {
+	InterpSegConstant,				/**< constant data (context->constant)	*/
+	InterpSegUniform,				/**< uniform data (context->uniform)	*/
+	InterpSegAttrib,				/**< vertex attributes					*/
+	InterpSegVarying,				/**< varying data						*/
+	InterpSegTemp,					/**< temporary data (context->temp)		*/
+	InterpSegResult,				/**< fragment color or vertex geometry	*/
+	InterpSegSpecial,				/**< execution context itself			*/
+	InterpSegCount
+} InterpSegment;
+
+/**
+ * Operations understood by the interpreter. ALU operations carry the
+ * saturation modifier as separate flag, structured control flow has been
+ * lowered into explicit jumps. Batched code keeps ELSE and ENDIF as
+ * separate instructions to maintain the execution mask.
+ */
+typedef enum InterpOp {
+	InterpOpABS,
+	InterpOpADD,
+	InterpOpARL,
+	InterpOpCMP,
+	InterpOpCOS,
+	InterpOpDDX,
+	InterpOpDDY,
+	InterpOpDP2,
+	InterpOpDP3,
+	InterpOpDP4,
+	InterpOpDPH,
+	InterpOpDST,
+	InterpOpEX2,
+	InterpOpEXP,
+	InterpOpFLR,
+	InterpOpFRC,
+	InterpOpLG2,
+	InterpOpLOG,
+	InterpOpLRP,
+	InterpOpMAD,
+	InterpOpMAX,
+	InterpOpMIN,
+	InterpOpMOV,
+	InterpOpMUL,
+	InterpOpPOW,
+	InterpOpRCP,
+	InterpOpRSQ,
+	InterpOpSCS,
+	InterpOpSEQ,
+	InterpOpSFL,
+	InterpOpSGE,
+	InterpOpSGT,
+	InterpOpSIN,
+	InterpOpSLE,
+	InterpOpSLT,
+	InterpOpSNE,
+	InterpOpSSG,
+	InterpOpSTR,
+	InterpOpSUB,
+	InterpOpSWZ,
+	InterpOpXPD,
+	InterpOpTEX,
+	InterpOpTXB,
+	InterpOpTXL,
+	InterpOpTXP,
+	InterpOpSCC,					/**< set condition code register		*/
+	InterpOpIF,						/**< jump to target if test fails		*/
+	InterpOpJMP,					/**< unconditional jump to target		*/
+	InterpOpELSE,					/**< batched: invert mask or jump		*/
+	InterpOpENDIF,					/**< batched: restore mask				*/
+	InterpOpREP,					/**< push loop counter, may skip loop	*/
+	InterpOpENDREP,					/**< decrement counter, jump to target	*/
+	InterpOpBRK,					/**< pop loop counter, jump to target	*/
+	InterpOpCAL,					/**< push return address, jump			*/
+	InterpOpRET,					/**< pop return address or terminate	*/
+	InterpOpKIL,					/**< discard fragment					*/
+	InterpOpEND,					/**< end of program						*/
+	InterpOpCount
+} InterpOp;
+
+/*
+** --------------------------------------------------------------------------
+** Structures
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Resolved operand of an interpreter instruction.
+ */
+typedef struct InterpOperand {
+	GLubyte			segment;		/**< InterpSegment to address			*/
+	GLubyte			index;			/**< address register + 1, or 0			*/
+	GLubyte			swizzle;		/**< 2 bits per component selection		*/
+	GLubyte			negate;			/**< negate value before use			*/
+	GLint			offset;			/**< offset within segment in words		*/
+} InterpOperand;
+
+/**
+ * A single interpreter instruction. The first word is the dispatch address
+ * of the operation, such that the code sequence forms direct threaded code.
+ */
+typedef struct InterpInst {
+	const void *	handler;		/**< dispatch address of operation		*/
+	GLubyte			op;				/**< InterpOp of this instruction		*/
+	GLubyte			saturate;		/**< clamp result to [0, 1]				*/
+	GLubyte			mask;			/**< write mask, bit 0 = x-component	*/
+	GLubyte			cond;			/**< Cond for control flow				*/
+	GLubyte			select;			/**< cc component selection for cond	*/
+	GLubyte			texture;		/**< TextureTarget of texture access	*/
+	GLubyte			precision;		/**< Precision tier for math functions	*/
+	GLint			target;			/**< jump target or SWZ options			*/
+	InterpOperand	dst;			/**< destination operand				*/
+	InterpOperand	src[3];			/**< source operands					*/
+} InterpInst;
+
+/*
+** --------------------------------------------------------------------------
+** Functions
+** --------------------------------------------------------------------------
+*/
+
+void GlesInterpInitialize(void);
+GLboolean GlesInterpGenerate(Linker * linker, ShaderProgram * program,
+							 ShaderBinary * binary, GLenum type);
+GLboolean GlesInterpGeneratePre(Linker * linker, ShaderProgram * program,
+								ShaderBinary * binary, GLenum type);
+GLboolean GlesInterpRelocate(ShaderBinary * binary, GLenum type);
+GLboolean GlesInterpNeedsQuads(const ShaderBinary * binary);
+
+void GlesInterpSample(const TextureImageUnit * units, GLfloat sampler,
+					  GLubyte texture, Vec4f * coords, Vec4f * result);
+GLfloat GlesInterpLod(const TextureImageUnit * units, GLfloat sampler,
+					  GLubyte texture, const Vec4f * coords,
+					  const Vec4f * dx, const Vec4f * dy);
+
+void GlesInterpPreProgram(const ShaderBinary * binary, const Vec4f * uniform,
+						  Vec4f * temp, Vec4f * data);
+GLboolean GlesInterpVertexProgram(const VertexContext * context);
+GLboolean GlesInterpFragmentProgram(const FragContext * context);
+void GlesInterpVertexBatch(const VertexContext * context, GLuint mask);
+GLuint GlesInterpFragmentBatch(const FragContext * context, GLuint mask);
+
+#endif /* GLES_BACKEND_INTERP_H */
@@ -0,0 +1,666 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Vectorized transcendental functions for shader execution
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+#include <GLES/gl.h>
+#include "config.h"
+#include "platform/platform.h"
+#include "frontend/types.h"
+#include "backend/mathlib.h"
+
+#if GLES_MATH_SSE2 && (GLES_SHADER_BATCH % 4) == 0
+#	include <emmintrin.h>
+#	define MATH_SSE2	1
+#else
+#	define MATH_SSE2	0
+#endif
+
+/*
+** --------------------------------------------------------------------------
+** Module-local data
+** --------------------------------------------------------------------------
+*/
+
+/*
+** The polynomial approximations follow the single precision routines of
+** the Cephes library. Lower precision tiers evaluate fewer terms of the
+** same polynomials, starting at the index given by the tables below.
+*/
+
+#define FOUR_OVER_PI	1.27323954473516f
+#define DP1				0.78515625f		/* pi/4 split into three parts		*/
+#define DP2				2.4187564849853515625e-4f
+#define DP3				3.77489497744594108e-8f
+#define SQRT_HALF		0.707106781186547524f
+#define LOG2_E			1.44269504088896340736f
+#define EXP2_MIN		-200.0f			/* results underflow to 0 below		*/
+#define EXP2_MAX		200.0f			/* results overflow to +inf above	*/
+
+/*
+** Arguments of sine and cosine above SINCOS_REDUCE are first reduced to
+** [-pi, pi] in double precision, with 2 pi split into a 31 bit head and a
+** tail so that the product with the multiple stays exact below 2^24.
+** Beyond SINCOS_LIMIT finite arguments have no usable phase left.
+*/
+
+#define SINCOS_REDUCE	8192.0f
+#define SINCOS_LIMIT	4294967296.0f	/* 2^32								*/
+#define INV_TWO_PI		0.15915494309189535
+#define TWO_PI_HI		6.2831853069365025
+#define TWO_PI_LO		2.430840202602477e-10
+#define ROUND_MAGIC		6755399441055744.0	/* 1.5 * 2^52				*/
+
+#define LOG2_DENORMAL_SCALE	33554432.0f		/* 2^25, normalizes denormals	*/
+#define LOG2_DENORMAL_BITS	25.0f
+
+static const GLfloat SinCoeff[] = {
+	-1.9515295891E-4f, 8.3321608736E-3f, -1.6666654611E-1f
+};
+
+static const GLfloat CosCoeff[] = {
+	2.443315711809948E-5f, -1.388731625493765E-3f, 4.166664568298827E-2f
+};
+
+static const GLfloat Exp2Coeff[] = {
+	1.535336188319500E-4f, 1.339887440266574E-3f, 9.618437357674640E-3f,
+	5.550332471162809E-2f, 2.402264791363012E-1f, 6.931472028550421E-1f
+};
+
+static const GLfloat Log2Coeff[] = {
+	7.0376836292E-2f, -1.1514610310E-1f, 1.1676998740E-1f,
+	-1.2420140846E-1f, 1.4249322787E-1f, -1.6668057665E-1f,
+	2.0000714765E-1f, -2.4999993993E-1f, 3.3333331174E-1f
+};
+
+/* first coefficient evaluated; indexed by Precision	*/
+static const GLsizei SinCosStart[]	= { 0, 2, 1, 0 };
+static const GLsizei Exp2Start[]	= { 0, 3, 2, 0 };
+static const GLsizei Log2Start[]	= { 0, 6, 4, 0 };
+
+#define NUM_COEFF(table)	((GLsizei) (sizeof(table) / sizeof(table[0])))
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: SSE2 implementation
+** --------------------------------------------------------------------------
+*/
+
+#if MATH_SSE2
+
+static GLES_INLINE __m128 Polynomial(__m128 x, const GLfloat * coeff,
+									 GLsizei start, GLsizei count) {
+	__m128 result = _mm_set1_ps(coeff[start]);
+
+	while (++start < count) {
+		result = _mm_add_ps(_mm_mul_ps(result, x), _mm_set1_ps(coeff[start]));
+	}
+
+	return result;
+}
+
+static GLES_INLINE __m128d ReduceTwoPi(__m128d x) {
+	const __m128d round = _mm_set1_pd(ROUND_MAGIC);
+	__m128d k = _mm_mul_pd(x, _mm_set1_pd(INV_TWO_PI));
+
+	k = _mm_sub_pd(_mm_add_pd(k, round), round);
+	x = _mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(TWO_PI_HI)));
+
+	return _mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(TWO_PI_LO)));
+}
+
+/**
+ * Reduce four angles to [-pi, pi]. Finite values beyond SINCOS_LIMIT
+ * are mapped to 0, infinities to NaN.
+ */
+static __m128 ReduceLarge(__m128 x, __m128 ax) {
+	__m128d lo = ReduceTwoPi(_mm_cvtps_pd(x));
+	__m128d hi = ReduceTwoPi(_mm_cvtps_pd(_mm_movehl_ps(x, x)));
+	__m128 beyond = _mm_and_ps(_mm_cmpge_ps(ax, _mm_set1_ps(SINCOS_LIMIT)),
+							   _mm_cmple_ps(ax, _mm_set1_ps(FLT_MAX)));
+
+	x = _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+	return _mm_andnot_ps(beyond, x);
+}
+
+/**
+ * Evaluate sine or cosine of four values. The argument is reduced to
+ * [-pi/4, pi/4] by subtracting the nearest multiple of pi/2; the octant
+ * then selects the polynomial and the sign of the result.
+ */
+static __m128 SinCos(__m128 x, GLboolean cosine, GLsizei start) {
+	const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2),
+		four = _mm_set1_epi32(4);
+	__m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	__m128 ax = _mm_andnot_ps(signMask, x);
+	__m128 y, z, sign, sinPoly, cosPoly, polyMask, swap;
+	__m128i octant;
+
+	if (_mm_movemask_ps(_mm_cmpgt_ps(ax, _mm_set1_ps(SINCOS_REDUCE)))) {
+		x = ReduceLarge(x, ax);
+		ax = _mm_andnot_ps(signMask, x);
+	}
+
+	sign = cosine ? _mm_setzero_ps() : _mm_and_ps(x, signMask);
+	octant = _mm_cvttps_epi32(_mm_mul_ps(ax, _mm_set1_ps(FOUR_OVER_PI)));
+	octant = _mm_andnot_si128(one, _mm_add_epi32(octant, one));
+	y = _mm_cvtepi32_ps(octant);
+
+	if (cosine) {
+		octant = _mm_sub_epi32(octant, two);
+		swap = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(octant, four), 29));
+	} else {
+		swap = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, four), 29));
+	}
+
+	sign = _mm_xor_ps(sign, swap);
+	polyMask = _mm_castsi128_ps(
+		_mm_cmpeq_epi32(_mm_and_si128(octant, two), _mm_setzero_si128()));
+
+	ax = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+	ax = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+	ax = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+	z = _mm_mul_ps(ax, ax);
+
+	cosPoly = _mm_mul_ps(Polynomial(z, CosCoeff, start, NUM_COEFF(CosCoeff)),
+						 _mm_mul_ps(z, z));
+	cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	cosPoly = _mm_add_ps(cosPoly, _mm_set1_ps(1.0f));
+
+	sinPoly = _mm_mul_ps(Polynomial(z, SinCoeff, start, NUM_COEFF(SinCoeff)),
+						 _mm_mul_ps(z, ax));
+	sinPoly = _mm_add_ps(sinPoly, ax);
+
+	y = _mm_or_ps(_mm_and_ps(polyMask, sinPoly), _mm_andnot_ps(polyMask, cosPoly));
+	return _mm_xor_ps(y, sign);
+}
+
+/**
+ * Evaluate 2^x for four values by splitting x into integer and fraction;
+ * the integer part is placed into the exponent bits of two factors, so
+ * that the product over- and underflows like the exact result. The
+ * operand order of the clamp lets NaN pass through.
+ */
+static __m128 Exp2(__m128 x, GLsizei start) {
+	const __m128i bias = _mm_set1_epi32(127);
+	__m128i n, half;
+	__m128 f, scale0, scale1;
+
+	x = _mm_min_ps(_mm_set1_ps(EXP2_MAX), _mm_max_ps(_mm_set1_ps(EXP2_MIN), x));
+	n = _mm_cvtps_epi32(x);
+	half = _mm_srai_epi32(n, 1);
+	f = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+	scale0 = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(half, bias), 23));
+	scale1 = _mm_castsi128_ps(
+		_mm_slli_epi32(_mm_add_epi32(_mm_sub_epi32(n, half), bias), 23));
+
+	f = _mm_add_ps(_mm_mul_ps(Polynomial(f, Exp2Coeff, start, NUM_COEFF(Exp2Coeff)), f),
+				   _mm_set1_ps(1.0f));
+
+	return _mm_mul_ps(_mm_mul_ps(f, scale0), scale1);
+}
+
+/**
+ * Evaluate log2(x) for four values by splitting x into exponent and a
+ * mantissa in [sqrt(1/2), sqrt(2)). Denormals are scaled into the normal
+ * range first. Zero yields -infinity, +infinity itself, and negative
+ * values and NaN yield NaN.
+ */
+static __m128 Log2(__m128 x, GLsizei start) {
+	__m128 inf = _mm_set1_ps(HUGE_VALF);
+	__m128 valid = _mm_and_ps(_mm_cmpgt_ps(x, _mm_setzero_ps()), _mm_cmplt_ps(x, inf));
+	__m128 zero = _mm_cmpeq_ps(x, _mm_setzero_ps());
+	__m128 denormal = _mm_cmplt_ps(x, _mm_set1_ps(FLT_MIN));
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 e, m, z, y, small, special;
+	__m128i bits;
+
+	x = _mm_or_ps(_mm_and_ps(denormal, _mm_mul_ps(x, _mm_set1_ps(LOG2_DENORMAL_SCALE))),
+				  _mm_andnot_ps(denormal, x));
+	bits = _mm_castps_si128(x);
+
+	e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+	e = _mm_sub_ps(e, _mm_and_ps(denormal, _mm_set1_ps(LOG2_DENORMAL_BITS)));
+	m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+									  _mm_set1_epi32(0x3f000000)));
+
+	small = _mm_cmplt_ps(m, _mm_set1_ps(SQRT_HALF));
+	e = _mm_sub_ps(e, _mm_and_ps(small, one));
+	m = _mm_add_ps(_mm_sub_ps(m, one), _mm_and_ps(small, m));
+
+	z = _mm_mul_ps(m, m);
+	y = _mm_mul_ps(Polynomial(m, Log2Coeff, start, NUM_COEFF(Log2Coeff)),
+				   _mm_mul_ps(z, m));
+	y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	y = _mm_add_ps(_mm_mul_ps(_mm_add_ps(y, m), _mm_set1_ps(LOG2_E)), e);
+
+	special = _mm_or_ps(_mm_and_ps(_mm_cmpeq_ps(x, inf), inf),
+						_mm_andnot_ps(_mm_cmpeq_ps(x, inf), _mm_set1_ps(NAN)));
+	special = _mm_or_ps(_mm_and_ps(zero, _mm_set1_ps(-HUGE_VALF)),
+						_mm_andnot_ps(zero, special));
+
+	return _mm_or_ps(_mm_and_ps(valid, y), _mm_andnot_ps(valid, special));
+}
+
+#else /* !MATH_SSE2 */
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: portable implementation
+** --------------------------------------------------------------------------
+*/
+
+static GLES_INLINE GLfloat Polynomial(GLfloat x, const GLfloat * coeff,
+									  GLsizei start, GLsizei count) {
+	GLfloat result = coeff[start];
+
+	while (++start < count) {
+		result = result * x + coeff[start];
+	}
+
+	return result;
+}
+
+static GLfloat ReduceLarge(GLfloat x) {
+	double k, r;
+
+	if (GlesFabsf(x) >= SINCOS_LIMIT && GlesFabsf(x) <= FLT_MAX) {
+		return 0.0f;
+	}
+
+	k = floor(x * INV_TWO_PI + 0.5);
+	r = ((double) x - k * TWO_PI_HI) - k * TWO_PI_LO;
+
+	return (GLfloat) r;
+}
+
+static GLfloat SinCos(GLfloat x, GLboolean cosine, GLsizei start) {
+	GLfloat ax, y, z, result;
+	GLint octant;
+	GLboolean negate;
+
+	if (GlesFabsf(x) > SINCOS_REDUCE) {
+		x = ReduceLarge(x);
+	}
+
+	if (x != x) {
+		return x;
+	}
+
+	ax = GlesFabsf(x);
+	octant = (GLint) (ax * FOUR_OVER_PI);
+	negate = !cosine && x < 0.0f;
+
+	octant = (octant + 1) & ~1;
+	y = (GLfloat) octant;
+
+	if (cosine) {
+		octant -= 2;
+		negate ^= !(octant & 4);
+	} else {
+		negate ^= (octant & 4) != 0;
+	}
+
+	ax = ((ax - y * DP1) - y * DP2) - y * DP3;
+	z = ax * ax;
+
+	if (octant & 2) {
+		result = Polynomial(z, CosCoeff, start, NUM_COEFF(CosCoeff)) * z * z
+			- 0.5f * z + 1.0f;
+	} else {
+		result = Polynomial(z, SinCoeff, start, NUM_COEFF(SinCoeff)) * z * ax + ax;
+	}
+
+	return negate ? -result : result;
+}
+
+static GLfloat Exp2(GLfloat x, GLsizei start) {
+	union {
+		GLfloat	f;
+		GLint	i;
+	} scale;
+
+	GLint n, half;
+	GLfloat result;
+
+	if (x != x) {
+		return x;
+	}
+
+	x = GlesMinf(GlesMaxf(x, EXP2_MIN), EXP2_MAX);
+	n = (GLint) GlesFloorf(x + 0.5f);
+	half = n >> 1;
+	x -= (GLfloat) n;
+
+	result = Polynomial(x, Exp2Coeff, start, NUM_COEFF(Exp2Coeff)) * x + 1.0f;
+	scale.i = (half + 127) << 23;
+	result *= scale.f;
+	scale.i = (n - half + 127) << 23;
+
+	return result * scale.f;
+}
+
+static GLfloat Log2(GLfloat x, GLsizei start) {
+	union {
+		GLfloat	f;
+		GLint	i;
+	} bits;
+
+	GLfloat e, z, y;
+
+	if (x == 0.0f) {
+		return -HUGE_VALF;
+	} else if (!(x > 0.0f)) {
+		return NAN;
+	} else if (x == HUGE_VALF) {
+		return x;
+	}
+
+	e = 0.0f;
+
+	if (x < FLT_MIN) {
+		x *= LOG2_DENORMAL_SCALE;
+		e = -LOG2_DENORMAL_BITS;
+	}
+
+	bits.f = x;
+	e += (GLfloat) (((bits.i >> 23) & 0xff) - 126);
+	bits.i = (bits.i & 0x007fffff) | 0x3f000000;
+
+	if (bits.f < SQRT_HALF) {
+		e -= 1.0f;
+		x = bits.f + bits.f - 1.0f;
+	} else {
+		x = bits.f - 1.0f;
+	}
+
+	z = x * x;
+	y = Polynomial(x, Log2Coeff, start, NUM_COEFF(Log2Coeff)) * z * x - 0.5f * z;
+
+	return (y + x) * LOG2_E + e;
+}
+
+#endif /* MATH_SSE2 */
+
+/*
+** --------------------------------------------------------------------------
+** Public functions
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Calculate the sine of GLES_SHADER_BATCH values.
+ *
+ * @param	result	array receiving the results
+ * @param	value	array of angles in radians
+ * @param	prec	accuracy tier to use
+ */
+void GlesMathSin(GLfloat * result, const GLfloat * value, Precision prec) {
+	GLsizei start = SinCosStart[prec], lane;
+
+#if MATH_SSE2
+	for (lane = 0; lane < GLES_SHADER_BATCH; lane += 4) {
+		_mm_storeu_ps(result + lane, SinCos(_mm_loadu_ps(value + lane), GL_FALSE, start));
+	}
+#else
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		result[lane] = SinCos(value[lane], GL_FALSE, start);
+	}
+#endif
+}
+
+/**
+ * Calculate the cosine of GLES_SHADER_BATCH values.
+ *
+ * @param	result	array receiving the results
+ * @param	value	array of angles in radians
+ * @param	prec	accuracy tier to use
+ */
+void GlesMathCos(GLfloat * result, const GLfloat * value, Precision prec) {
+	GLsizei start = SinCosStart[prec], lane;
+
+#if MATH_SSE2
+	for (lane = 0; lane < GLES_SHADER_BATCH; lane += 4) {
+		_mm_storeu_ps(result + lane, SinCos(_mm_loadu_ps(value + lane), GL_TRUE, start));
+	}
+#else
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		result[lane] = SinCos(value[lane], GL_TRUE, start);
+	}
+#endif
+}
+
+/**
+ * Calculate 2 raised to the power of GLES_SHADER_BATCH values.
+ *
+ * @param	result	array receiving the results
+ * @param	value	array of exponents
+ * @param	prec	accuracy tier to use
+ */
+void GlesMathExp2(GLfloat * result, const GLfloat * value, Precision prec) {
+	GLsizei start = Exp2Start[prec], lane;
+
+#if MATH_SSE2
+	for (lane = 0; lane < GLES_SHADER_BATCH; lane += 4) {
+		_mm_storeu_ps(result + lane, Exp2(_mm_loadu_ps(value + lane), start));
+	}
+#else
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		result[lane] = Exp2(value[lane], start);
+	}
+#endif
+}
+
+/**
+ * Calculate the base 2 logarithm of GLES_SHADER_BATCH values.
+ *
+ * @param	result	array receiving the results
+ * @param	value	array of values; zero yields -infinity, negative values NaN
+ * @param	prec	accuracy tier to use
+ */
+void GlesMathLog2(GLfloat * result, const GLfloat * value, Precision prec) {
+	GLsizei start = Log2Start[prec], lane;
+
+#if MATH_SSE2
+	for (lane = 0; lane < GLES_SHADER_BATCH; lane += 4) {
+		_mm_storeu_ps(result + lane, Log2(_mm_loadu_ps(value + lane), start));
+	}
+#else
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		result[lane] = Log2(value[lane], start);
+	}
+#endif
+}
+
+/**
+ * Calculate base^exponent for GLES_SHADER_BATCH pairs of values as
+ * 2^(exponent * log2(base)).
+ *
+ * @param	result		array receiving the results
+ * @param	base		array of base values
+ * @param	exponent	array of exponents
+ * @param	prec		accuracy tier to use
+ */
+void GlesMathPow(GLfloat * result, const GLfloat * base,
+				 const GLfloat * exponent, Precision prec) {
+	GLsizei lane;
+
+#if MATH_SSE2
+	for (lane = 0; lane < GLES_SHADER_BATCH; lane += 4) {
+		__m128 log = Log2(_mm_loadu_ps(base + lane), Log2Start[prec]);
+		log = _mm_mul_ps(log, _mm_loadu_ps(exponent + lane));
+		_mm_storeu_ps(result + lane, Exp2(log, Exp2Start[prec]));
+	}
+#else
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		result[lane] =
+			Exp2(Log2(base[lane], Log2Start[prec]) * exponent[lane], Exp2Start[prec]);
+	}
+#endif
+}
+
+/**
+ * Calculate the reciprocal square root of the absolute value of
+ * GLES_SHADER_BATCH values. Lower precision tiers use the hardware
+ * estimate where available.
+ *
+ * @param	result	array receiving the results
+ * @param	value	array of values
+ * @param	prec	accuracy tier to use
+ */
+void GlesMathRsq(GLfloat * result, const GLfloat * value, Precision prec) {
+	GLsizei lane;
+
+#if MATH_SSE2
+	__m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+
+	for (lane = 0; lane < GLES_SHADER_BATCH; lane += 4) {
+		__m128 x = _mm_andnot_ps(signMask, _mm_loadu_ps(value + lane));
+
+		if (prec == PrecisionLow || prec == PrecisionMedium) {
+			x = _mm_rsqrt_ps(x);
+		} else {
+			x = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(x));
+		}
+
+		_mm_storeu_ps(result + lane, x);
+	}
+#else
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		result[lane] = 1.0f / GlesSqrtf(GlesFabsf(value[lane]));
+	}
+#endif
+}
+
+/**
+ * Calculate the sine of a single value.
+ *
+ * @param	value	angle in radians
+ * @param	prec	accuracy tier to use
+ *
+ * @return	sin(value)
+ */
+GLfloat GlesMathSinf(GLfloat value, Precision prec) {
+#if MATH_SSE2
+	return _mm_cvtss_f32(SinCos(_mm_set_ss(value), GL_FALSE, SinCosStart[prec]));
+#else
+	return SinCos(value, GL_FALSE, SinCosStart[prec]);
+#endif
+}
+
+/**
+ * Calculate the cosine of a single value.
+ *
+ * @param	value	angle in radians
+ * @param	prec	accuracy tier to use
+ *
+ * @return	cos(value)
+ */
+GLfloat GlesMathCosf(GLfloat value, Precision prec) {
+#if MATH_SSE2
+	return _mm_cvtss_f32(SinCos(_mm_set_ss(value), GL_TRUE, SinCosStart[prec]));
+#else
+	return SinCos(value, GL_TRUE, SinCosStart[prec]);
+#endif
+}
+
+/**
+ * Calculate 2 raised to the power of a single value.
+ *
+ * @param	value	the exponent
+ * @param	prec	accuracy tier to use
+ *
+ * @return	2^value
+ */
+GLfloat GlesMathExp2f(GLfloat value, Precision prec) {
+#if MATH_SSE2
+	return _mm_cvtss_f32(Exp2(_mm_set_ss(value), Exp2Start[prec]));
+#else
+	return Exp2(value, Exp2Start[prec]);
+#endif
+}
+
+/**
+ * Calculate the base 2 logarithm of a single value.
+ *
+ * @param	value	the value; zero yields -infinity, negative values NaN
+ * @param	prec	accuracy tier to use
+ *
+ * @return	log2(value)
+ */
+GLfloat GlesMathLog2f(GLfloat value, Precision prec) {
+#if MATH_SSE2
+	return _mm_cvtss_f32(Log2(_mm_set_ss(value), Log2Start[prec]));
+#else
+	return Log2(value, Log2Start[prec]);
+#endif
+}
+
+/**
+ * Calculate base^exponent for a single pair of values.
+ *
+ * @param	base		the base value
+ * @param	exponent	the exponent
+ * @param	prec		accuracy tier to use
+ *
+ * @return	base^exponent
+ */
+GLfloat GlesMathPowf(GLfloat base, GLfloat exponent, Precision prec) {
+	return GlesMathExp2f(GlesMathLog2f(base, prec) * exponent, prec);
+}
+
+/**
+ * Calculate the reciprocal square root of the absolute value of a single
+ * value.
+ *
+ * @param	value	the value
+ * @param	prec	accuracy tier to use
+ *
+ * @return	1 / sqrt(|value|)
+ */
+GLfloat GlesMathRsqf(GLfloat value, Precision prec) {
+#if MATH_SSE2
+	if (prec == PrecisionLow || prec == PrecisionMedium) {
+		return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(GlesFabsf(value))));
+	}
+#endif
+
+	return 1.0f / GlesSqrtf(GlesFabsf(value));
+}
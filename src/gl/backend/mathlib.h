@@ -0,0 +1,82 @@
+#ifndef GLES_BACKEND_MATHLIB_H
+#define GLES_BACKEND_MATHLIB_H 1
+
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Vectorized transcendental functions for shader execution
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+#include "frontend/types.h"
+
+/*
+** --------------------------------------------------------------------------
+** Functions
+** --------------------------------------------------------------------------
+*/
+
+/*
+** The array functions evaluate GLES_SHADER_BATCH lanes at once, the
+** functions with an f suffix a single value. The precision
+** argument selects the accuracy tier. Measured against the C library, the
+** error of sin, cos and log2 (absolute) and of exp2 and pow (relative) is
+** within 2e-6 for PrecisionHigh, 2e-4 for PrecisionMedium and 3e-3 for
+** PrecisionLow. rsq uses the hardware estimate at medium and low, with a
+** relative error below 4e-4. PrecisionUndefined is treated as high.
+**
+** Angles are reduced in double precision; beyond 2^32 the reduction is
+** meaningless, and sin and cos return the values for an angle of 0.
+*/
+
+void GlesMathSin(GLfloat * result, const GLfloat * value, Precision prec);
+void GlesMathCos(GLfloat * result, const GLfloat * value, Precision prec);
+void GlesMathExp2(GLfloat * result, const GLfloat * value, Precision prec);
+void GlesMathLog2(GLfloat * result, const GLfloat * value, Precision prec);
+void GlesMathPow(GLfloat * result, const GLfloat * base,
+				 const GLfloat * exponent, Precision prec);
+void GlesMathRsq(GLfloat * result, const GLfloat * value, Precision prec);
+
+GLfloat GlesMathSinf(GLfloat value, Precision prec);
+GLfloat GlesMathCosf(GLfloat value, Precision prec);
+GLfloat GlesMathExp2f(GLfloat value, Precision prec);
+GLfloat GlesMathLog2f(GLfloat value, Precision prec);
+GLfloat GlesMathPowf(GLfloat base, GLfloat exponent, Precision prec);
+GLfloat GlesMathRsqf(GLfloat value, Precision prec);
+
+#endif /* GLES_BACKEND_MATHLIB_H */
@@ -0,0 +1,2968 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Optimization passes on the intermediate shader representation
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+#include <GLES/gl.h>
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "frontend/il.h"
+#include "frontend/linker.h"
+#include "backend/optimize.h"
+
+/*
+** --------------------------------------------------------------------------
+** Module-local data
+** --------------------------------------------------------------------------
+*/
+
+#define MAX_USES		8				/* register accesses per instruction	*/
+
+/**
+ * Control flow information for a single instruction. Successor indices
+ * equal to the number of instructions denote the exit of the program.
+ * A RET instruction may continue at the program exit as well as at any
+ * return site of a subroutine call.
+ */
+typedef struct Node {
+	Inst *			inst;			/**< the IL instruction					*/
+	Block *			block;			/**< block containing the instruction	*/
+	GLsizei			next;			/**< fall-through successor, or -1		*/
+	GLsizei			target;			/**< jump successor, or -1				*/
+	GLboolean		ret;			/**< continues at return sites			*/
+	GLboolean		reached;		/**< reachable from the entry point		*/
+} Node;
+
+/**
+ * Control flow construct that is open while building the flow graph.
+ */
+typedef struct Construct {
+	Opcode			op;				/**< IF, ELSE or REP					*/
+	GLsizei			node;			/**< index of opening instruction		*/
+	GLsizei			breaks;			/**< chain of pending BRK instructions	*/
+} Construct;
+
+/**
+ * Register access of an instruction. Registers are tracked in units of
+ * vec4 slots; each variable occupies one slot per row of its type, followed
+ * by a slot for each address register and one for the condition code.
+ */
+typedef struct Access {
+	GLsizei			slot;			/**< first slot accessed				*/
+	GLsizei			count;			/**< number of slots accessed			*/
+	GLuint			mask;			/**< components accessed within slot	*/
+} Access;
+
+/**
+ * A copy of a single component performed by a MOV instruction.
+ */
+typedef struct Copy {
+	SrcReg			src;			/**< source operand before rewriting	*/
+	GLsizei			dstSlot;		/**< slot written by the MOV			*/
+	GLsizei			srcSlot;		/**< slot read by the MOV				*/
+	GLubyte			dstComponent;	/**< component written					*/
+	GLubyte			srcComponent;	/**< component read						*/
+} Copy;
+
+/**
+ * Live range of a temporary variable, as interval of instruction indices.
+ */
+typedef struct LiveRange {
+	ProgVar *		var;			/**< the temporary variable				*/
+	GLsizei			start;			/**< first instruction within range		*/
+	GLsizei			end;			/**< last instruction in range, or -1	*/
+} LiveRange;
+
+/**
+ * Loop that is open while scanning a program for loops to unroll.
+ */
+typedef struct OpenLoop {
+	Inst *			inst;			/**< the REP or LOOP instruction		*/
+	GLboolean		breaks;			/**< loop contains a BRK instruction	*/
+} OpenLoop;
+
+/**
+ * State of the optimizer for a single shader program.
+ */
+typedef struct Optimizer {
+	ShaderProgram *	program;		/**< the program to optimize			*/
+	MemoryPool *	memory;			/**< storage for analysis results		*/
+	GLbitfield		passes;			/**< OptimizePass selection				*/
+
+	GLsizei *		varSlot;		/**< first slot of variable by id		*/
+	GLsizei			addrSlot;		/**< first slot of address registers	*/
+	GLsizei			ccSlot;			/**< slot of condition code register	*/
+	GLsizei			numSlots;		/**< total number of slots				*/
+	GLsizei			slotWords;		/**< words in slot mask bit vector		*/
+	GLuint *		exitLive;		/**< registers live at program exit		*/
+
+	Node *			nodes;			/**< flow graph in program order		*/
+	GLsizei			numNodes;		/**< number of instructions				*/
+	GLsizei *		blockStart;		/**< first node index of each block		*/
+	Construct *		constructs;		/**< stack of open constructs			*/
+	GLsizei *		returnSites;	/**< nodes following subroutine calls	*/
+	GLsizei			numReturnSites;	/**< number of return sites				*/
+	GLsizei *		successors;		/**< buffer for successor enumeration	*/
+	GLsizei *		worklist;		/**< nodes pending reachability check	*/
+} Optimizer;
+
+/**
+ * Optimization step that rewrites the program.
+ *
+ * @param	optimizer	the optimizer state with a valid flow graph
+ *
+ * @return	GL_TRUE if the program has been changed
+ */
+typedef GLboolean (*OptimizerStep)(Optimizer * optimizer);
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: bit vectors
+** --------------------------------------------------------------------------
+*/
+
+/*
+ * Slot masks are stored as 4-bit nibbles, 8 slots per word.
+ */
+
+static GLES_INLINE GLuint GetMask(const GLuint * bits, GLsizei slot) {
+	return (bits[slot >> 3] >> ((slot & 7) << 2)) & 0xf;
+}
+
+static GLES_INLINE void SetMask(GLuint * bits, GLsizei slot, GLuint mask) {
+	bits[slot >> 3] |= mask << ((slot & 7) << 2);
+}
+
+static GLES_INLINE void ClearMask(GLuint * bits, GLsizei slot, GLuint mask) {
+	bits[slot >> 3] &= ~(mask << ((slot & 7) << 2));
+}
+
+static GLES_INLINE GLboolean TestBit(const GLuint * bits, GLsizei index) {
+	return (bits[index >> 5] >> (index & 31)) & 1;
+}
+
+static GLES_INLINE void SetBit(GLuint * bits, GLsizei index) {
+	bits[index >> 5] |= 1u << (index & 31);
+}
+
+static GLES_INLINE void ClearBit(GLuint * bits, GLsizei index) {
+	bits[index >> 5] &= ~(1u << (index & 31));
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: def/use analysis
+** --------------------------------------------------------------------------
+*/
+
+static GLES_INLINE GLuint GetSelect(const SrcReg * reg, GLsizei component) {
+	switch (component) {
+	case 0:		return reg->selectX;
+	case 1:		return reg->selectY;
+	case 2:		return reg->selectZ;
+	default:	return reg->selectW;
+	}
+}
+
+static GLES_INLINE void SetSelect(SrcReg * reg, GLsizei component, GLuint select) {
+	switch (component) {
+	case 0:		reg->selectX = select;	break;
+	case 1:		reg->selectY = select;	break;
+	case 2:		reg->selectZ = select;	break;
+	default:	reg->selectW = select;	break;
+	}
+}
+
+static GLES_INLINE GLuint GetWriteMask(const DstReg * reg) {
+	return
+		(reg->maskX ? 1 : 0) | (reg->maskY ? 2 : 0) |
+		(reg->maskZ ? 4 : 0) | (reg->maskW ? 8 : 0);
+}
+
+static GLES_INLINE void SetWriteMask(DstReg * reg, GLuint mask) {
+	reg->maskX = (mask & 1) != 0;
+	reg->maskY = (mask & 2) != 0;
+	reg->maskZ = (mask & 4) != 0;
+	reg->maskW = (mask & 8) != 0;
+}
+
+/**
+ * Determine the destination register of an ALU instruction.
+ *
+ * @param	inst	the instruction
+ *
+ * @return	the destination register, or NULL if the instruction is not an
+ * 			ALU instruction
+ */
+static DstReg * GetDstReg(Inst * inst) {
+	switch (inst->base.kind) {
+	case InstKindUnary:
+	case InstKindBinary:
+	case InstKindTernary:
+	case InstKindSwizzle:
+	case InstKindTex:
+		return &inst->alu.dst;
+
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * Determine the components of a source operand value that are used by an
+ * instruction. Component-wise operations only use the components that
+ * they write.
+ *
+ * @param	op			the instruction opcode
+ * @param	arg			index of the operand
+ * @param	writeMask	write mask of the instruction
+ *
+ * @return	the component mask, bit 0 = x-component
+ */
+static GLuint GetReadMask(Opcode op, GLsizei arg, GLuint writeMask) {
+	switch (op) {
+	case OpcodeABS:	case OpcodeABS_SAT:
+	case OpcodeADD:	case OpcodeADD_SAT:
+	case OpcodeCMP:	case OpcodeCMP_SAT:
+	case OpcodeDDX:	case OpcodeDDX_SAT:
+	case OpcodeDDY:	case OpcodeDDY_SAT:
+	case OpcodeFLR:	case OpcodeFLR_SAT:
+	case OpcodeFRC:	case OpcodeFRC_SAT:
+	case OpcodeLRP:	case OpcodeLRP_SAT:
+	case OpcodeMAD:	case OpcodeMAD_SAT:
+	case OpcodeMAX:	case OpcodeMAX_SAT:
+	case OpcodeMIN:	case OpcodeMIN_SAT:
+	case OpcodeMOV:	case OpcodeMOV_SAT:
+	case OpcodeMUL:	case OpcodeMUL_SAT:
+	case OpcodeSUB:	case OpcodeSUB_SAT:
+	case OpcodeSEQ:	case OpcodeSGE:	case OpcodeSGT:
+	case OpcodeSLE:	case OpcodeSLT:	case OpcodeSNE:
+	case OpcodeSSG:
+		return writeMask;
+
+	case OpcodeARL:
+	case OpcodeREP:
+	case OpcodeCOS:	case OpcodeCOS_SAT:
+	case OpcodeEX2:	case OpcodeEX2_SAT:
+	case OpcodeEXP:	case OpcodeEXP_SAT:
+	case OpcodeLG2:	case OpcodeLG2_SAT:
+	case OpcodeLOG:	case OpcodeLOG_SAT:
+	case OpcodePOW:
+	case OpcodeRCP:	case OpcodeRCP_SAT:
+	case OpcodeRSQ:	case OpcodeRSQ_SAT:
+	case OpcodeSCS:	case OpcodeSCS_SAT:
+	case OpcodeSIN:	case OpcodeSIN_SAT:
+		return 1;
+
+	case OpcodeDP2:	case OpcodeDP2_SAT:
+		return 3;
+
+	case OpcodeDP3:	case OpcodeDP3_SAT:
+	case OpcodeXPD:	case OpcodeXPD_SAT:
+		return 7;
+
+	case OpcodeDPH:	case OpcodeDPH_SAT:
+		return arg ? 0xf : 7;
+
+	case OpcodeDST:	case OpcodeDST_SAT:
+		/* (1, a.y * b.y, a.z, b.w) */
+		return (writeMask & 2) | (arg ? writeMask & 8 : writeMask & 4);
+
+	case OpcodeSFL:
+	case OpcodeSTR:
+		return 0;
+
+	default:
+		return 0xf;
+	}
+}
+
+/**
+ * Collect the regular source operands of an instruction.
+ *
+ * @param	inst	the instruction
+ * @param	regs	out: the source operands
+ * @param	masks	out: the components of each operand value used
+ *
+ * @return	the number of source operands
+ */
+static GLsizei GetSrcRegs(Inst * inst, SrcReg ** regs, GLuint * masks) {
+	GLuint writeMask = GetDstReg(inst) ? GetWriteMask(&inst->alu.dst) : 0xf;
+	GLsizei count = 0, index;
+
+	switch (inst->base.kind) {
+	case InstKindUnary:
+		regs[count++] = &inst->unary.arg;
+		break;
+
+	case InstKindBinary:
+		regs[count++] = &inst->binary.left;
+		regs[count++] = &inst->binary.right;
+		break;
+
+	case InstKindTernary:
+		regs[count++] = &inst->ternary.arg0;
+		regs[count++] = &inst->ternary.arg1;
+		regs[count++] = &inst->ternary.arg2;
+		break;
+
+	case InstKindTex:
+		regs[count++] = &inst->tex.coords;
+		break;
+
+	case InstKindArl:
+		regs[count++] = &inst->arl.arg;
+		break;
+
+	case InstKindSrc:
+		regs[count++] = &inst->src.arg;
+		break;
+
+	default:
+		;
+	}
+
+	for (index = 0; index < count; ++index) {
+		masks[index] = GetReadMask(inst->base.op, index, writeMask);
+	}
+
+	return count;
+}
+
+/**
+ * Determine the register written by an instruction.
+ *
+ * @param	optimizer	the optimizer state
+ * @param	inst		the instruction
+ * @param	def			out: the register written
+ *
+ * @return	GL_TRUE if the instruction writes a register
+ */
+static GLboolean GetDef(const Optimizer * optimizer, Inst * inst, Access * def) {
+	DstReg * dst = GetDstReg(inst);
+
+	def->count = 1;
+
+	if (dst) {
+		def->slot = optimizer->varSlot[dst->reference.base->id] + dst->offset;
+		def->mask = GetWriteMask(dst);
+		return GL_TRUE;
+	} else if (inst->base.kind == InstKindArl) {
+		def->slot = optimizer->addrSlot + inst->arl.dst->id;
+		def->mask = 1;
+		return GL_TRUE;
+	} else if (inst->base.op == OpcodeSCC) {
+		def->slot = optimizer->ccSlot;
+		def->mask = 0xf;
+		return GL_TRUE;
+	} else {
+		return GL_FALSE;
+	}
+}
+
+/**
+ * Determine the condition code components tested by a conditional
+ * instruction.
+ *
+ * @return	the component mask, or 0 if the condition code is not tested
+ */
+static GLuint GetCondMask(Cond cond, GLubyte selectX, GLubyte selectY,
+						  GLubyte selectZ, GLubyte selectW) {
+	if (cond == CondT || cond == CondF) {
+		return 0;
+	}
+
+	return (1 << selectX) | (1 << selectY) | (1 << selectZ) | (1 << selectW);
+}
+
+/**
+ * Determine the registers read by an instruction.
+ *
+ * @param	optimizer	the optimizer state
+ * @param	inst		the instruction
+ * @param	uses		out: the registers read, at least MAX_USES entries
+ *
+ * @return	the number of register accesses
+ */
+static GLsizei GetUses(const Optimizer * optimizer, Inst * inst, Access * uses) {
+	SrcReg * regs[3];
+	GLuint masks[3];
+	GLsizei numRegs = GetSrcRegs(inst, regs, masks);
+	GLsizei count = 0, index, component;
+	GLuint selects;
+
+	for (index = 0; index < numRegs; ++index) {
+		const SrcReg * reg = regs[index];
+		GLuint mask = 0;
+
+		for (component = 0; component < 4; ++component) {
+			if (masks[index] & (1 << component)) {
+				mask |= 1 << GetSelect(reg, component);
+			}
+		}
+
+		if (!mask) {
+			continue;
+		}
+
+		uses[count].slot = optimizer->varSlot[reg->reference.base->id];
+		uses[count].mask = mask;
+
+		if (reg->index) {
+			/* relative addressing may access any row of the variable */
+			uses[count++].count = reg->reference.base->type->base.size;
+
+			uses[count].slot = optimizer->addrSlot + reg->index->id;
+			uses[count].count = 1;
+			uses[count++].mask = 1;
+		} else {
+			uses[count].slot += reg->offset;
+			uses[count++].count = 1;
+		}
+	}
+
+	switch (inst->base.kind) {
+	case InstKindSwizzle:
+		selects = 0;
+
+		if (inst->swizzle.alu.dst.maskX)	selects |= 1 << (inst->swizzle.optionX & 7);
+		if (inst->swizzle.alu.dst.maskY)	selects |= 1 << (inst->swizzle.optionY & 7);
+		if (inst->swizzle.alu.dst.maskZ)	selects |= 1 << (inst->swizzle.optionZ & 7);
+		if (inst->swizzle.alu.dst.maskW)	selects |= 1 << (inst->swizzle.optionW & 7);
+
+		/* drop the selection of constant 0 and 1 */
+		selects >>= ExtSwizzleSelectX;
+
+		if (selects) {
+			uses[count].slot = optimizer->varSlot[inst->swizzle.arg.base->id];
+			uses[count].count = 1;
+			uses[count++].mask = selects & 0xf;
+		}
+
+		break;
+
+	case InstKindCond:
+		selects = GetCondMask(inst->cond.cond,
+							  inst->cond.selectX, inst->cond.selectY,
+							  inst->cond.selectZ, inst->cond.selectW);
+		break;
+
+	case InstKindBranch:
+		selects = GetCondMask(inst->branch.cond,
+							  inst->branch.selectX, inst->branch.selectY,
+							  inst->branch.selectZ, inst->branch.selectW);
+		break;
+
+	default:
+		selects = 0;
+	}
+
+	if ((inst->base.kind == InstKindCond || inst->base.kind == InstKindBranch) &&
+		selects) {
+		uses[count].slot = optimizer->ccSlot;
+		uses[count].count = 1;
+		uses[count++].mask = selects;
+	}
+
+	GLES_ASSERT(count <= MAX_USES);
+
+	return count;
+}
+
+/**
+ * Condition of a conditional instruction.
+ */
+static Cond GetCond(const Inst * inst) {
+	return
+		inst->base.kind == InstKindBranch ? inst->branch.cond : inst->cond.cond;
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: control flow analysis
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Assign register slots to all variables of the program and determine
+ * the registers that are live at the exit of the program.
+ *
+ * @param	optimizer	the optimizer state to initialize
+ */
+static void AssignSlots(Optimizer * optimizer) {
+	ShaderProgram * program = optimizer->program;
+	ProgVar * lists[4];
+	ProgVar * var;
+	GLsizei numSlots = 0, index, row;
+
+	optimizer->varSlot =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLsizei) * (program->numVars + 1));
+	GlesMemset(optimizer->varSlot, 0, sizeof(GLsizei) * (program->numVars + 1));
+
+	lists[0] = program->param;
+	lists[1] = program->temp;
+	lists[2] = program->out;
+	lists[3] = program->in;
+
+	for (index = 0; index < 4; ++index) {
+		for (var = lists[index]; var; var = var->base.next) {
+			optimizer->varSlot[var->base.id] = numSlots;
+			numSlots += var->base.type->base.size;
+		}
+	}
+
+	for (var = program->constants; var; var = var->base.next) {
+		optimizer->varSlot[var->base.id] = numSlots;
+		numSlots += var->base.type->base.size;
+	}
+
+	optimizer->addrSlot = numSlots;
+	optimizer->ccSlot = numSlots + program->numAddrVars;
+	optimizer->numSlots = optimizer->ccSlot + 1;
+	optimizer->slotWords = (optimizer->numSlots + 7) / 8;
+
+	/* output values are live at the end of the program */
+	optimizer->exitLive =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLuint) * optimizer->slotWords);
+	GlesMemset(optimizer->exitLive, 0, sizeof(GLuint) * optimizer->slotWords);
+
+	for (var = program->out; var; var = var->base.next) {
+		for (row = 0; row < var->base.type->base.size; ++row) {
+			SetMask(optimizer->exitLive, optimizer->varSlot[var->base.id] + row, 0xf);
+		}
+	}
+}
+
+/**
+ * Enumerate the successors of an instruction.
+ *
+ * @param	optimizer	the optimizer state
+ * @param	index		index of the instruction
+ *
+ * @return	the number of successors stored in optimizer->successors
+ */
+static GLsizei GetSuccessors(const Optimizer * optimizer, GLsizei index) {
+	const Node * node = &optimizer->nodes[index];
+	GLsizei * successors = optimizer->successors;
+	GLsizei count = 0, site;
+
+	if (node->next >= 0) {
+		successors[count++] = node->next;
+	}
+
+	if (node->target >= 0) {
+		successors[count++] = node->target;
+	}
+
+	if (node->ret) {
+		successors[count++] = optimizer->numNodes;
+
+		for (site = 0; site < optimizer->numReturnSites; ++site) {
+			successors[count++] = optimizer->returnSites[site];
+		}
+	}
+
+	return count;
+}
+
+/**
+ * Build the control flow graph of the program. Structured control flow
+ * is resolved the same way as during code generation.
+ *
+ * @param	optimizer	the optimizer state
+ *
+ * @return	GL_TRUE if the control flow constructs are well-formed
+ */
+static GLboolean BuildFlowGraph(Optimizer * optimizer) {
+	ShaderProgram * program = optimizer->program;
+	Node * nodes = optimizer->nodes;
+	Construct * constructs = optimizer->constructs;
+	GLsizei * worklist = optimizer->worklist;
+	GLsizei numNodes = 0, numConstructs = 0, index, count, succ;
+	Block * block;
+	Inst * inst;
+
+	for (block = program->blocks.head; block; block = block->next) {
+		optimizer->blockStart[block->id] = numNodes;
+
+		for (inst = block->first; inst; inst = inst->base.next) {
+			nodes[numNodes].inst = inst;
+			nodes[numNodes].block = block;
+			++numNodes;
+		}
+	}
+
+	optimizer->numNodes = numNodes;
+	optimizer->numReturnSites = 0;
+
+	for (index = 0; index < numNodes; ++index) {
+		Node * node = &nodes[index];
+		Construct * construct =
+			numConstructs ? &constructs[numConstructs - 1] : NULL;
+		Cond cond;
+
+		inst = node->inst;
+		node->next = index + 1;
+		node->target = -1;
+		node->ret = GL_FALSE;
+		node->reached = GL_FALSE;
+
+		switch (inst->base.op) {
+		case OpcodeIF:
+			constructs[numConstructs].op = OpcodeIF;
+			constructs[numConstructs].node = index;
+			++numConstructs;
+
+			if (GetCond(inst) == CondF) {
+				/* test always fails */
+				node->next = -1;
+			}
+
+			break;
+
+		case OpcodeELSE:
+			if (!construct || construct->op != OpcodeIF) {
+				return GL_FALSE;
+			}
+
+			/* failed IF test continues after the ELSE */
+			if (GetCond(nodes[construct->node].inst) != CondT) {
+				nodes[construct->node].target = index + 1;
+			}
+
+			construct->op = OpcodeELSE;
+			construct->node = index;
+			node->next = -1;
+			break;
+
+		case OpcodeENDIF:
+			if (!construct ||
+				(construct->op != OpcodeIF && construct->op != OpcodeELSE)) {
+				return GL_FALSE;
+			}
+
+			if (construct->op == OpcodeELSE ||
+				GetCond(nodes[construct->node].inst) != CondT) {
+				nodes[construct->node].target = index;
+			}
+
+			--numConstructs;
+			break;
+
+		case OpcodeLOOP:
+		case OpcodeREP:
+			constructs[numConstructs].op = OpcodeREP;
+			constructs[numConstructs].node = index;
+			constructs[numConstructs].breaks = -1;
+			++numConstructs;
+			break;
+
+		case OpcodeENDLOOP:
+		case OpcodeENDREP:
+			if (!construct || construct->op != OpcodeREP) {
+				return GL_FALSE;
+			}
+
+			/* loop may be skipped entirely or repeated */
+			node->target = construct->node + 1;
+			nodes[construct->node].target = index + 1;
+
+			while (construct->breaks >= 0) {
+				GLsizei next = nodes[construct->breaks].target;
+				nodes[construct->breaks].target = index + 1;
+				construct->breaks = next;
+			}
+
+			--numConstructs;
+			break;
+
+		case OpcodeBRK:
+			while (construct && construct->op != OpcodeREP) {
+				construct = construct > constructs ? construct - 1 : NULL;
+			}
+
+			if (!construct) {
+				return GL_FALSE;
+			}
+
+			cond = GetCond(inst);
+
+			if (cond != CondF) {
+				node->target = construct->breaks;
+				construct->breaks = index;
+			}
+
+			if (cond == CondT) {
+				node->next = -1;
+			}
+
+			break;
+
+		case OpcodeCAL:
+			if (!inst->branch.target->target) {
+				return GL_FALSE;
+			}
+
+			cond = GetCond(inst);
+
+			if (cond != CondF) {
+				node->target = optimizer->blockStart[inst->branch.target->target->id];
+				optimizer->returnSites[optimizer->numReturnSites++] = index + 1;
+			}
+
+			if (cond == CondT) {
+				node->next = -1;
+			}
+
+			break;
+
+		case OpcodeRET:
+			cond = GetCond(inst);
+			node->ret = cond != CondF;
+
+			if (cond == CondT) {
+				node->next = -1;
+			}
+
+			break;
+
+		default:
+			;
+		}
+	}
+
+	if (numConstructs) {
+		return GL_FALSE;
+	}
+
+	/* determine the instructions reachable from the entry point */
+
+	if (!numNodes) {
+		return GL_TRUE;
+	}
+
+	worklist[0] = 0;
+	count = 1;
+	nodes[0].reached = GL_TRUE;
+
+	while (count) {
+		GLsizei numSuccessors = GetSuccessors(optimizer, worklist[--count]);
+
+		for (succ = 0; succ < numSuccessors; ++succ) {
+			index = optimizer->successors[succ];
+
+			if (index < numNodes && !nodes[index].reached) {
+				nodes[index].reached = GL_TRUE;
+				worklist[count++] = index;
+			}
+		}
+	}
+
+	return GL_TRUE;
+}
+
+/**
+ * Remove an instruction from the block containing it.
+ *
+ * @param	block	the block containing the instruction
+ * @param	inst	the instruction to remove
+ */
+static void UnlinkInst(Block * block, Inst * inst) {
+	if (inst->base.prev) {
+		inst->base.prev->base.next = inst->base.next;
+	} else {
+		block->first = inst->base.next;
+	}
+
+	if (inst->base.next) {
+		inst->base.next->base.prev = inst->base.prev;
+	} else {
+		block->last = inst->base.prev;
+	}
+}
+
+/**
+ * Remove an instruction from the program.
+ *
+ * @param	node	flow graph node of the instruction
+ */
+static void RemoveInst(Node * node) {
+	UnlinkInst(node->block, node->inst);
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: dead code elimination
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Determine the set of registers live after an instruction.
+ *
+ * @param	optimizer	the optimizer state
+ * @param	liveIn		registers live before each instruction
+ * @param	index		index of the instruction
+ * @param	liveOut		out: registers live after the instruction
+ */
+static void GetLiveOut(const Optimizer * optimizer, const GLuint * liveIn,
+					   GLsizei index, GLuint * liveOut) {
+	GLsizei words = optimizer->slotWords;
+	GLsizei numSuccessors = GetSuccessors(optimizer, index);
+	GLsizei succ, word;
+
+	GlesMemset(liveOut, 0, sizeof(GLuint) * words);
+
+	for (succ = 0; succ < numSuccessors; ++succ) {
+		GLsizei next = optimizer->successors[succ];
+		const GLuint * live = next < optimizer->numNodes ?
+			liveIn + next * words : optimizer->exitLive;
+
+		for (word = 0; word < words; ++word) {
+			liveOut[word] |= live[word];
+		}
+	}
+}
+
+/**
+ * Compute the registers live before each instruction by iterating the
+ * backward data flow equations until they are stable.
+ *
+ * @param	optimizer	the optimizer state
+ *
+ * @return	the live register vectors, slotWords for each instruction
+ */
+static GLuint * ComputeLiveness(Optimizer * optimizer) {
+	GLsizei words = optimizer->slotWords;
+	GLsizei numNodes = optimizer->numNodes;
+	GLuint * liveIn, * live;
+	GLsizei index, word, slot, numUses, use;
+	Access def, uses[MAX_USES];
+	GLboolean changed;
+
+	liveIn = GlesMemoryPoolAllocate(optimizer->memory,
+									sizeof(GLuint) * words * (numNodes + 1));
+	GlesMemset(liveIn, 0, sizeof(GLuint) * words * numNodes);
+	live = liveIn + words * numNodes;
+
+	do {
+		changed = GL_FALSE;
+
+		for (index = numNodes - 1; index >= 0; --index) {
+			Inst * inst = optimizer->nodes[index].inst;
+			GLuint * in = liveIn + index * words;
+
+			GetLiveOut(optimizer, liveIn, index, live);
+
+			if (GetDef(optimizer, inst, &def)) {
+				ClearMask(live, def.slot, def.mask);
+			}
+
+			numUses = GetUses(optimizer, inst, uses);
+
+			for (use = 0; use < numUses; ++use) {
+				for (slot = 0; slot < uses[use].count; ++slot) {
+					SetMask(live, uses[use].slot + slot, uses[use].mask);
+				}
+			}
+
+			for (word = 0; word < words; ++word) {
+				if (in[word] != live[word]) {
+					in[word] = live[word];
+					changed = GL_TRUE;
+				}
+			}
+		}
+	} while (changed);
+
+	return liveIn;
+}
+
+/**
+ * Remove instructions whose results are never used, and drop unused
+ * components from the write masks of the remaining instructions.
+ *
+ * @param	optimizer	the optimizer state with a valid flow graph
+ *
+ * @return	GL_TRUE if the program has been changed
+ */
+static GLboolean SweepDeadCode(Optimizer * optimizer) {
+	GLuint * liveIn = ComputeLiveness(optimizer);
+	GLuint * liveOut =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLuint) * optimizer->slotWords);
+	GLboolean changed = GL_FALSE;
+	GLsizei index;
+	Access def;
+
+	for (index = 0; index < optimizer->numNodes; ++index) {
+		Node * node = &optimizer->nodes[index];
+		DstReg * dst = GetDstReg(node->inst);
+		GLuint live;
+
+		if (!GetDef(optimizer, node->inst, &def)) {
+			continue;
+		}
+
+		GetLiveOut(optimizer, liveIn, index, liveOut);
+		live = node->reached ? GetMask(liveOut, def.slot) & def.mask : 0;
+
+		if (!live) {
+			RemoveInst(node);
+			changed = GL_TRUE;
+		} else if (dst && live != def.mask) {
+			SetWriteMask(dst, live);
+			changed = GL_TRUE;
+		}
+	}
+
+	return changed;
+}
+
+/**
+ * Dead code elimination. Removing an instruction may render the
+ * instructions computing its operands dead as well, so the step is
+ * repeated until no further instructions can be removed.
+ *
+ * @param	optimizer	the optimizer state with a valid flow graph
+ *
+ * @return	GL_TRUE if the program has been changed
+ */
+static GLboolean EliminateDeadCode(Optimizer * optimizer) {
+	GLboolean changed = GL_FALSE;
+
+	while (SweepDeadCode(optimizer)) {
+		changed = GL_TRUE;
+
+		if (!BuildFlowGraph(optimizer)) {
+			break;
+		}
+	}
+
+	return changed;
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: constant and copy propagation
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Determine if a MOV instruction establishes copies that can be propagated
+ * to subsequent uses of its destination register.
+ *
+ * @param	optimizer	the optimizer state
+ * @param	inst		the instruction
+ *
+ * @return	GL_TRUE if the instruction is a copy to be propagated
+ */
+static GLboolean IsCopy(const Optimizer * optimizer, const Inst * inst) {
+	const SrcReg * src = &inst->unary.arg;
+	const DstReg * dst = &inst->unary.alu.dst;
+
+	if (inst->base.op != OpcodeMOV || src->index) {
+		return GL_FALSE;
+	}
+
+	if (optimizer->varSlot[src->reference.base->id] + src->offset ==
+		optimizer->varSlot[dst->reference.base->id] + dst->offset) {
+		return GL_FALSE;
+	}
+
+	if (src->reference.base->kind == ProgVarKindConst) {
+		return (optimizer->passes & OptimizeConstants) != 0;
+	} else {
+		return (optimizer->passes & OptimizeCopies) != 0;
+	}
+}
+
+/**
+ * Apply the effect of an instruction to the set of available copies: a
+ * write to a register invalidates all copies from and to that register,
+ * then a MOV makes its own copies available.
+ *
+ * @param	optimizer	the optimizer state
+ * @param	index		index of the instruction
+ * @param	copies		all copies within the program
+ * @param	firstCopy	for each instruction, index of its first copy
+ * @param	slotCopies	for each slot, index into slotList
+ * @param	slotList	copies from and to each slot
+ * @param	available	the set of available copies to update
+ */
+static void TransferCopies(const Optimizer * optimizer, GLsizei index,
+						   const Copy * copies, const GLsizei * firstCopy,
+						   const GLsizei * slotCopies, const GLsizei * slotList,
+						   GLuint * available) {
+	Access def;
+	GLsizei entry, copy;
+
+	if (GetDef(optimizer, optimizer->nodes[index].inst, &def)) {
+		for (entry = slotCopies[def.slot]; entry < slotCopies[def.slot + 1]; ++entry) {
+			copy = slotList[entry];
+
+			if ((copies[copy].dstSlot == def.slot &&
+				 (def.mask & (1 << copies[copy].dstComponent))) ||
+				(copies[copy].srcSlot == def.slot &&
+				 (def.mask & (1 << copies[copy].srcComponent)))) {
+				ClearBit(available, copy);
+			}
+		}
+	}
+
+	for (copy = firstCopy[index]; copy < firstCopy[index + 1]; ++copy) {
+		SetBit(available, copy);
+	}
+}
+
+/**
+ * Constant and copy propagation. Operands reading a register that holds
+ * a copy of another register on all paths are rewritten to read the
+ * original register, which may leave the copying MOV dead.
+ *
+ * @param	optimizer	the optimizer state with a valid flow graph
+ *
+ * @return	GL_TRUE if the program has been changed
+ */
+static GLboolean PropagateCopies(Optimizer * optimizer) {
+	GLsizei numNodes = optimizer->numNodes;
+	GLsizei numCopies = 0, words, index, component, entry, word, succ;
+	GLsizei * firstCopy, * slotCopies, * slotList;
+	GLuint * available, * current;
+	Copy * copies;
+	GLboolean changed;
+
+	/* enumerate the component copies of all MOV instructions */
+
+	firstCopy =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLsizei) * (numNodes + 1));
+
+	for (index = 0; index < numNodes; ++index) {
+		Inst * inst = optimizer->nodes[index].inst;
+
+		firstCopy[index] = numCopies;
+
+		if (optimizer->nodes[index].reached && IsCopy(optimizer, inst)) {
+			numCopies +=
+				inst->unary.alu.dst.maskX + inst->unary.alu.dst.maskY +
+				inst->unary.alu.dst.maskZ + inst->unary.alu.dst.maskW;
+		}
+	}
+
+	firstCopy[numNodes] = numCopies;
+
+	if (!numCopies) {
+		return GL_FALSE;
+	}
+
+	copies = GlesMemoryPoolAllocate(optimizer->memory, sizeof(Copy) * numCopies);
+	slotCopies =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLsizei) * (optimizer->numSlots + 1));
+	slotList =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLsizei) * numCopies * 2);
+	GlesMemset(slotCopies, 0, sizeof(GLsizei) * (optimizer->numSlots + 1));
+
+	for (index = 0; index < numNodes; ++index) {
+		Inst * inst = optimizer->nodes[index].inst;
+		Copy * copy = copies + firstCopy[index];
+		GLuint mask;
+
+		if (firstCopy[index] == firstCopy[index + 1]) {
+			continue;
+		}
+
+		mask = GetWriteMask(&inst->unary.alu.dst);
+
+		for (component = 0; component < 4; ++component) {
+			if (mask & (1 << component)) {
+				copy->src = inst->unary.arg;
+				copy->dstSlot =
+					optimizer->varSlot[inst->unary.alu.dst.reference.base->id] +
+					inst->unary.alu.dst.offset;
+				copy->srcSlot =
+					optimizer->varSlot[inst->unary.arg.reference.base->id] +
+					inst->unary.arg.offset;
+				copy->dstComponent = component;
+				copy->srcComponent = GetSelect(&inst->unary.arg, component);
+
+				++slotCopies[copy->dstSlot];
+				++slotCopies[copy->srcSlot];
+				++copy;
+			}
+		}
+	}
+
+	/* index the copies by the slots they are affected by */
+
+	for (index = 0, entry = 0; index <= optimizer->numSlots; ++index) {
+		GLsizei count = slotCopies[index];
+		slotCopies[index] = entry;
+		entry += count;
+	}
+
+	for (index = 0; index < numCopies; ++index) {
+		slotList[slotCopies[copies[index].dstSlot]++] = index;
+		slotList[slotCopies[copies[index].srcSlot]++] = index;
+	}
+
+	for (index = optimizer->numSlots; index > 0; --index) {
+		slotCopies[index] = slotCopies[index - 1];
+	}
+
+	slotCopies[0] = 0;
+
+	/*
+	 * Forward data flow analysis of available copies; a copy is available
+	 * if it is available on all paths.
+	 */
+
+	words = (numCopies + 31) / 32;
+	available =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLuint) * words * (numNodes + 1));
+	current = available + words * numNodes;
+
+	GlesMemset(available, 0xff, sizeof(GLuint) * words * numNodes);
+	GlesMemset(available, 0, sizeof(GLuint) * words);
+
+	do {
+		changed = GL_FALSE;
+
+		for (index = 0; index < numNodes; ++index) {
+			GLsizei numSuccessors;
+
+			if (!optimizer->nodes[index].reached) {
+				continue;
+			}
+
+			GlesMemcpy(current, available + index * words, sizeof(GLuint) * words);
+			TransferCopies(optimizer, index, copies, firstCopy,
+						   slotCopies, slotList, current);
+
+			numSuccessors = GetSuccessors(optimizer, index);
+
+			for (succ = 0; succ < numSuccessors; ++succ) {
+				GLsizei next = optimizer->successors[succ];
+				GLuint * in = available + next * words;
+
+				if (next >= numNodes) {
+					continue;
+				}
+
+				for (word = 0; word < words; ++word) {
+					if (in[word] & ~current[word]) {
+						in[word] &= current[word];
+						changed = GL_TRUE;
+					}
+				}
+			}
+		}
+	} while (changed);
+
+	/* rewrite operands whose values are available as copies */
+
+	changed = GL_FALSE;
+
+	for (index = 0; index < numNodes; ++index) {
+		SrcReg * regs[3];
+		GLuint masks[3];
+		GLsizei numRegs, reg;
+		const GLuint * in = available + index * words;
+
+		if (!optimizer->nodes[index].reached) {
+			continue;
+		}
+
+		numRegs = GetSrcRegs(optimizer->nodes[index].inst, regs, masks);
+
+		for (reg = 0; reg < numRegs; ++reg) {
+			SrcReg * src = regs[reg];
+			const SrcReg * origin = NULL;
+			GLsizei slot, selects[4];
+
+			if (src->index || !masks[reg]) {
+				continue;
+			}
+
+			slot = optimizer->varSlot[src->reference.base->id] + src->offset;
+
+			for (component = 0; component < 4; ++component) {
+				GLuint select = GetSelect(src, component);
+				const Copy * copy = NULL;
+
+				if (!(masks[reg] & (1 << component))) {
+					selects[component] = -1;
+					continue;
+				}
+
+				for (entry = slotCopies[slot]; entry < slotCopies[slot + 1]; ++entry) {
+					if (TestBit(in, slotList[entry]) &&
+						copies[slotList[entry]].dstSlot == slot &&
+						copies[slotList[entry]].dstComponent == select) {
+						copy = &copies[slotList[entry]];
+						break;
+					}
+				}
+
+				if (!copy ||
+					(origin &&
+					 (origin->reference.base != copy->src.reference.base ||
+					  origin->offset != copy->src.offset ||
+					  origin->negate != copy->src.negate))) {
+					break;
+				}
+
+				origin = &copy->src;
+				selects[component] = copy->srcComponent;
+			}
+
+			if (component < 4) {
+				continue;
+			}
+
+			src->reference = origin->reference;
+			src->offset = origin->offset;
+			src->negate ^= origin->negate;
+
+			for (component = 0; component < 4; ++component) {
+				if (selects[component] < 0) {
+					/* unused components stay within the used part of the row */
+					for (entry = 0; selects[entry] < 0; ++entry)
+						;
+
+					selects[component] = selects[entry];
+				}
+
+				SetSelect(src, component, selects[component]);
+			}
+
+			changed = GL_TRUE;
+		}
+	}
+
+	return changed;
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: constant folding
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Determine the value of a component of a source operand that reads
+ * constant data.
+ *
+ * @param	reg			the source operand
+ * @param	component	the component of the operand value
+ * @param	value		out: the component value
+ *
+ * @return	GL_TRUE if the operand reads constant data
+ */
+static GLboolean GetConstant(const SrcReg * reg, GLsizei component,
+							 GLfloat * value) {
+	const Constant * constant;
+	GLuint select;
+
+	if (reg->reference.base->kind != ProgVarKindConst || reg->index) {
+		return GL_FALSE;
+	}
+
+	constant = reg->reference.constant->values + reg->offset;
+	select = GetSelect(reg, component);
+
+	switch (reg->reference.base->type->base.kind) {
+	case TypeBool:
+	case TypeBoolVec2:
+	case TypeBoolVec3:
+	case TypeBoolVec4:
+		*value = constant->boolValue[select] ? 1.0f : 0.0f;
+		break;
+
+	case TypeInt:
+	case TypeIntVec2:
+	case TypeIntVec3:
+	case TypeIntVec4:
+		*value = (GLfloat) constant->intValue[select];
+		break;
+
+	default:
+		*value = constant->floatValue[select];
+		break;
+	}
+
+	if (reg->negate) {
+		*value = -*value;
+	}
+
+	return GL_TRUE;
+}
+
+/**
+ * Determine if all components of an operand that are used by an
+ * instruction read the same constant value.
+ *
+ * @param	reg		the source operand
+ * @param	mask	the components used
+ * @param	value	the value to test for
+ *
+ * @return	GL_TRUE if the operand is known to equal the value
+ */
+static GLboolean IsConstantValue(const SrcReg * reg, GLuint mask, GLfloat value) {
+	GLsizei component;
+	GLfloat constant;
+
+	if (!mask) {
+		return GL_FALSE;
+	}
+
+	for (component = 0; component < 4; ++component) {
+		if ((mask & (1 << component)) &&
+			(!GetConstant(reg, component, &constant) || constant != value)) {
+			return GL_FALSE;
+		}
+	}
+
+	return GL_TRUE;
+}
+
+/**
+ * Evaluate an ALU instruction whose operands are all constant. The
+ * operations are carried out the same way as by the interpreter.
+ *
+ * @param	inst	the instruction
+ * @param	result	out: the result value
+ *
+ * @return	GL_TRUE if the instruction has been evaluated
+ */
+static GLboolean Evaluate(Inst * inst, GLfloat result[4]) {
+	SrcReg * regs[3];
+	GLuint masks[3];
+	GLfloat args[3][4];
+	GLsizei numRegs = GetSrcRegs(inst, regs, masks), reg, component;
+	GLfloat * a = args[0], * b = args[1], * c = args[2];
+	GLboolean saturate = GL_FALSE;
+
+	for (reg = 0; reg < numRegs; ++reg) {
+		for (component = 0; component < 4; ++component) {
+			args[reg][component] = 0.0f;
+
+			if ((masks[reg] & (1 << component)) &&
+				!GetConstant(regs[reg], component, &args[reg][component])) {
+				return GL_FALSE;
+			}
+		}
+	}
+
+	for (component = 0; component < 4; ++component) {
+		switch (inst->base.op) {
+		case OpcodeABS_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeABS:		result[component] = GlesFabsf(a[component]);			break;
+		case OpcodeADD_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeADD:		result[component] = a[component] + b[component];		break;
+		case OpcodeCMP_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeCMP:		result[component] = a[component] < 0.0f ? b[component] : c[component];	break;
+		case OpcodeDDX:	case OpcodeDDX_SAT:
+		case OpcodeDDY:	case OpcodeDDY_SAT:
+							result[component] = 0.0f;								break;
+		case OpcodeDP2_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeDP2:		result[component] = a[0] * b[0] + a[1] * b[1];		break;
+		case OpcodeDP3_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeDP3:		result[component] = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];	break;
+		case OpcodeDP4_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeDP4:		result[component] = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];	break;
+		case OpcodeDPH_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeDPH:		result[component] = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + b[3];	break;
+		case OpcodeEX2_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeEX2:		result[component] = GlesExp2f(a[0]);					break;
+		case OpcodeFLR_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeFLR:		result[component] = GlesFloorf(a[component]);			break;
+		case OpcodeFRC_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeFRC:		result[component] = GlesFracf(a[component]);			break;
+		case OpcodeLG2_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeLG2:		result[component] = GlesLog2f(a[0]);					break;
+		case OpcodeLRP_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeLRP:		result[component] = a[component] * b[component] + (1.0f - a[component]) * c[component];	break;
+		case OpcodeMAD_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeMAD:		result[component] = a[component] * b[component] + c[component];	break;
+		case OpcodeMAX_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeMAX:		result[component] = GlesMaxf(a[component], b[component]);	break;
+		case OpcodeMIN_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeMIN:		result[component] = GlesMinf(a[component], b[component]);	break;
+		case OpcodeMOV_SAT:	saturate = GL_TRUE;	result[component] = a[component];	break;
+		case OpcodeMUL_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeMUL:		result[component] = a[component] * b[component];		break;
+		case OpcodePOW:		result[component] = GlesPowf(a[0], b[0]);				break;
+		case OpcodeRCP_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeRCP:		result[component] = 1.0f / a[0];						break;
+		case OpcodeRSQ_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeRSQ:		result[component] = 1.0f / GlesSqrtf(GlesFabsf(a[0]));	break;
+		case OpcodeSEQ:		result[component] = a[component] == b[component] ? 1.0f : 0.0f;	break;
+		case OpcodeSFL:		result[component] = 0.0f;								break;
+		case OpcodeSGE:		result[component] = a[component] >= b[component] ? 1.0f : 0.0f;	break;
+		case OpcodeSGT:		result[component] = a[component] > b[component] ? 1.0f : 0.0f;	break;
+		case OpcodeSLE:		result[component] = a[component] <= b[component] ? 1.0f : 0.0f;	break;
+		case OpcodeSLT:		result[component] = a[component] < b[component] ? 1.0f : 0.0f;	break;
+		case OpcodeSNE:		result[component] = a[component] != b[component] ? 1.0f : 0.0f;	break;
+		case OpcodeSSG:		result[component] = GlesSignf(a[component]);			break;
+		case OpcodeSTR:		result[component] = 1.0f;								break;
+		case OpcodeSUB_SAT:	saturate = GL_TRUE;	/* fall through */
+		case OpcodeSUB:		result[component] = a[component] - b[component];		break;
+
+		default:
+			return GL_FALSE;
+		}
+
+		if (saturate) {
+			result[component] = GlesClampf(result[component]);
+		}
+	}
+
+	return GL_TRUE;
+}
+
+/**
+ * Turn an ALU instruction into a move of the given operand.
+ *
+ * @param	inst		the instruction to rewrite
+ * @param	arg			the operand to move
+ * @param	saturate	GL_TRUE if the value is to be clamped to [0, 1]
+ */
+static void RewriteMove(Inst * inst, const SrcReg * arg, GLboolean saturate) {
+	SrcReg value = *arg;
+
+	inst->base.kind = InstKindUnary;
+	inst->base.op = saturate ? OpcodeMOV_SAT : OpcodeMOV;
+	inst->unary.arg = value;
+}
+
+/**
+ * Turn an ALU instruction into a move of a newly created constant.
+ *
+ * @param	optimizer	the optimizer state
+ * @param	inst		the instruction to rewrite
+ * @param	value		the constant value
+ */
+static void RewriteConstant(Optimizer * optimizer, Inst * inst,
+							const GLfloat value[4]) {
+	Constant constant;
+	SrcRef ref;
+	SrcReg arg;
+
+	GlesMemset(&constant, 0, sizeof(Constant));
+	GlesMemcpy(constant.floatValue, value, sizeof(constant.floatValue));
+
+	ref.base =
+		&GlesCreateProgVarConst(optimizer->program, &constant,
+								GlesBasicType(TypeFloatVec4, PrecisionHigh))->base;
+	GlesMemset(&arg, 0, sizeof(SrcReg));
+	GlesInitSrcReg0(&arg, ref);
+	RewriteMove(inst, &arg, GL_FALSE);
+}
+
+/**
+ * Simplify an arithmetic instruction with an operand that is constant 0
+ * or 1 in all components used.
+ *
+ * @param	optimizer	the optimizer state
+ * @param	inst		the instruction
+ *
+ * @return	GL_TRUE if the instruction has been simplified
+ */
+static GLboolean Simplify(Optimizer * optimizer, Inst * inst) {
+	static const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	SrcReg * regs[3];
+	GLuint masks[3];
+	GLboolean saturate = GL_FALSE;
+	SrcReg left, right;
+
+	GetSrcRegs(inst, regs, masks);
+
+	switch (inst->base.op) {
+	case OpcodeADD_SAT:
+		saturate = GL_TRUE;
+		/* fall through */
+	case OpcodeADD:
+		if (IsConstantValue(regs[1], masks[1], 0.0f)) {
+			RewriteMove(inst, regs[0], saturate);
+		} else if (IsConstantValue(regs[0], masks[0], 0.0f)) {
+			RewriteMove(inst, regs[1], saturate);
+		} else {
+			return GL_FALSE;
+		}
+
+		return GL_TRUE;
+
+	case OpcodeSUB_SAT:
+		saturate = GL_TRUE;
+		/* fall through */
+	case OpcodeSUB:
+		if (IsConstantValue(regs[1], masks[1], 0.0f)) {
+			RewriteMove(inst, regs[0], saturate);
+		} else if (IsConstantValue(regs[0], masks[0], 0.0f)) {
+			regs[1]->negate = !regs[1]->negate;
+			RewriteMove(inst, regs[1], saturate);
+		} else {
+			return GL_FALSE;
+		}
+
+		return GL_TRUE;
+
+	case OpcodeMUL_SAT:
+		saturate = GL_TRUE;
+		/* fall through */
+	case OpcodeMUL:
+		if (IsConstantValue(regs[0], masks[0], 0.0f) ||
+			IsConstantValue(regs[1], masks[1], 0.0f)) {
+			RewriteConstant(optimizer, inst, zero);
+		} else if (IsConstantValue(regs[1], masks[1], 1.0f)) {
+			RewriteMove(inst, regs[0], saturate);
+		} else if (IsConstantValue(regs[0], masks[0], 1.0f)) {
+			RewriteMove(inst, regs[1], saturate);
+		} else {
+			return GL_FALSE;
+		}
+
+		return GL_TRUE;
+
+	case OpcodeMAD_SAT:
+		saturate = GL_TRUE;
+		/* fall through */
+	case OpcodeMAD:
+		if (IsConstantValue(regs[0], masks[0], 0.0f) ||
+			IsConstantValue(regs[1], masks[1], 0.0f)) {
+			RewriteMove(inst, regs[2], saturate);
+			return GL_TRUE;
+		} else if (IsConstantValue(regs[1], masks[1], 1.0f)) {
+			left = *regs[0];
+		} else if (IsConstantValue(regs[0], masks[0], 1.0f)) {
+			left = *regs[1];
+		} else {
+			return GL_FALSE;
+		}
+
+		right = *regs[2];
+		inst->base.kind = InstKindBinary;
+		inst->base.op = saturate ? OpcodeADD_SAT : OpcodeADD;
+		inst->binary.left = left;
+		inst->binary.right = right;
+		return GL_TRUE;
+
+	default:
+		return GL_FALSE;
+	}
+}
+
+/**
+ * Resolve the condition of a conditional instruction whose condition code
+ * is set from constant data by the preceding SCC instruction. Conditional
+ * instructions are never jump targets, so the SCC is their only
+ * predecessor.
+ *
+ * @param	inst	the conditional instruction
+ *
+ * @return	GL_TRUE if the condition has been resolved
+ */
+static GLboolean FoldCond(Inst * inst) {
+	Inst * scc = inst->base.prev;
+	GLfloat cc[4];
+	GLuint select, flags = 0;
+	GLsizei component;
+	Cond cond;
+
+	switch (inst->base.op) {
+	case OpcodeIF:
+	case OpcodeKIL:
+	case OpcodeBRK:
+	case OpcodeCAL:
+	case OpcodeRET:
+		break;
+
+	default:
+		return GL_FALSE;
+	}
+
+	cond = GetCond(inst);
+
+	if (cond == CondT || cond == CondF ||
+		!scc || scc->base.op != OpcodeSCC) {
+		return GL_FALSE;
+	}
+
+	for (component = 0; component < 4; ++component) {
+		if (!GetConstant(&scc->src.arg, component, &cc[component])) {
+			return GL_FALSE;
+		}
+	}
+
+	if (inst->base.kind == InstKindBranch) {
+		select = inst->branch.selectX | inst->branch.selectY << 2 |
+			inst->branch.selectZ << 4 | inst->branch.selectW << 6;
+	} else {
+		select = inst->cond.selectX | inst->cond.selectY << 2 |
+			inst->cond.selectZ << 4 | inst->cond.selectW << 6;
+	}
+
+	/* the test passes if it passes for any of the selected components */
+	for (component = 0; component < 4; ++component, select >>= 2) {
+		GLfloat value = cc[select & 3];
+		flags |= value < 0.0f ? CondLT : value > 0.0f ? CondGT : CondEQ;
+	}
+
+	cond = (flags & cond) ? CondT : CondF;
+
+	if (inst->base.kind == InstKindBranch) {
+		inst->branch.cond = cond;
+	} else {
+		inst->cond.cond = cond;
+	}
+
+	return GL_TRUE;
+}
+
+/**
+ * Constant folding. Instructions whose operands are all constant are
+ * replaced by a move of the result, arithmetic with constant 0 or 1 is
+ * simplified, and conditions tested on constant data are resolved, such
+ * that the code not taken becomes unreachable.
+ *
+ * @param	optimizer	the optimizer state with a valid flow graph
+ *
+ * @return	GL_TRUE if the program has been changed
+ */
+static GLboolean FoldConstants(Optimizer * optimizer) {
+	GLuint numVars = optimizer->program->numVars;
+	GLboolean changed = GL_FALSE;
+	GLfloat value[4];
+	GLsizei index;
+
+	for (index = 0; index < optimizer->numNodes; ++index) {
+		Node * node = &optimizer->nodes[index];
+		Inst * inst = node->inst;
+
+		if (!node->reached) {
+			continue;
+		}
+
+		switch (inst->base.kind) {
+		case InstKindUnary:
+		case InstKindBinary:
+		case InstKindTernary:
+			if (Evaluate(inst, value)) {
+				RewriteConstant(optimizer, inst, value);
+				changed = GL_TRUE;
+			} else if (Simplify(optimizer, inst)) {
+				changed = GL_TRUE;
+			}
+
+			break;
+
+		case InstKindCond:
+		case InstKindBranch:
+			if (FoldCond(inst)) {
+				if (GetCond(inst) == CondF && inst->base.op != OpcodeIF) {
+					/* instruction never takes effect */
+					RemoveInst(node);
+				}
+
+				changed = GL_TRUE;
+			}
+
+			break;
+
+		default:
+			;
+		}
+	}
+
+	if (optimizer->program->numVars != numVars) {
+		/* new constants need register slots */
+		AssignSlots(optimizer);
+	}
+
+	return changed;
+}
+
+/**
+ * Remove all constants that are no longer referenced by any instruction
+ * from the program, such that they do not occupy space in the data
+ * segment.
+ *
+ * @param	program	the program
+ */
+static void RemoveUnusedConstants(ShaderProgram * program) {
+	SrcReg * regs[3];
+	GLuint masks[3];
+	GLsizei numRegs, index;
+	ProgVar ** link, * var;
+	Block * block;
+	Inst * inst;
+
+	for (var = program->constants; var; var = var->base.next) {
+		var->base.used = GL_FALSE;
+	}
+
+	for (block = program->blocks.head; block; block = block->next) {
+		for (inst = block->first; inst; inst = inst->base.next) {
+			numRegs = GetSrcRegs(inst, regs, masks);
+
+			for (index = 0; index < numRegs; ++index) {
+				regs[index]->reference.base->used = GL_TRUE;
+			}
+
+			if (inst->base.kind == InstKindSwizzle) {
+				inst->swizzle.arg.base->used = GL_TRUE;
+			}
+		}
+	}
+
+	for (link = &program->constants; *link; ) {
+		if ((*link)->base.used) {
+			link = &(*link)->base.next;
+		} else {
+			*link = (*link)->base.next;
+		}
+	}
+	
+	/* the index would still refer to the removed constants */
+	program->constantIndex = NULL;
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: inlining and loop unrolling
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Determine the storage size of an instruction.
+ *
+ * @param	inst	the instruction
+ *
+ * @return	the size in bytes, or 0 if the instruction cannot be copied
+ */
+static GLsizeiptr GetInstSize(const Inst * inst) {
+	switch (inst->base.kind) {
+	case InstKindBase:		return sizeof(InstBase);
+	case InstKindSrc:		return sizeof(InstSrc);
+	case InstKindUnary:		return sizeof(InstUnary);
+	case InstKindBinary:	return sizeof(InstBinary);
+	case InstKindTernary:	return sizeof(InstTernary);
+	case InstKindArl:		return sizeof(InstArl);
+	case InstKindBranch:	return sizeof(InstBranch);
+	case InstKindCond:		return sizeof(InstCond);
+	case InstKindSwizzle:	return sizeof(InstSwizzle);
+	case InstKindTex:		return sizeof(InstTex);
+	default:				return 0;
+	}
+}
+
+/**
+ * Insert a copy of an instruction into a block.
+ *
+ * @param	program	the program owning the block
+ * @param	block	the block to insert into
+ * @param	pos		the instruction to insert after, or NULL for the start
+ * @param	inst	the instruction to copy
+ *
+ * @return	the inserted copy
+ */
+static Inst * InsertCopy(ShaderProgram * program, Block * block, Inst * pos,
+						 const Inst * inst) {
+	GLsizeiptr size = GetInstSize(inst);
+	Inst * copy = GlesMemoryPoolAllocate(program->memory, size);
+
+	GlesMemcpy(copy, inst, size);
+	copy->base.prev = pos;
+	copy->base.next = pos ? pos->base.next : block->first;
+
+	if (copy->base.next) {
+		copy->base.next->base.prev = copy;
+	} else {
+		block->last = copy;
+	}
+
+	if (pos) {
+		pos->base.next = copy;
+	} else {
+		block->first = copy;
+	}
+
+	return copy;
+}
+
+/**
+ * Determine if a subroutine can be inlined. This requires that the only
+ * way to leave the subroutine is the unconditional RET terminating it.
+ *
+ * @param	entry	the first block of the subroutine
+ *
+ * @return	the number of instructions preceding the terminating RET, or
+ * 			-1 if the subroutine cannot be inlined
+ */
+static GLsizei GetSubroutineSize(const Block * entry) {
+	const Block * block;
+	const Inst * inst;
+	GLsizei size = 0, depth = 0;
+
+	for (block = entry; block; block = block->next) {
+		for (inst = block->first; inst; inst = inst->base.next, ++size) {
+			switch (inst->base.op) {
+			case OpcodeIF:
+			case OpcodeLOOP:
+			case OpcodeREP:
+				++depth;
+				break;
+
+			case OpcodeENDIF:
+			case OpcodeENDLOOP:
+			case OpcodeENDREP:
+				--depth;
+				break;
+
+			case OpcodeRET:
+				if (!depth && GetCond(inst) == CondT) {
+					return size;
+				} else if (GetCond(inst) != CondF) {
+					return -1;
+				}
+
+				break;
+
+			default:
+				if (!GetInstSize(inst)) {
+					return -1;
+				}
+			}
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Replace a subroutine call by a copy of the subroutine body.
+ *
+ * @param	program	the program containing the call
+ * @param	main	the block containing the call
+ * @param	call	the CAL instruction
+ * @param	size	the number of instructions to copy, see GetSubroutineSize
+ *
+ * @return	the first instruction following the call after inlining
+ */
+static Inst * InlineCall(ShaderProgram * program, Block * main, Inst * call,
+						 GLsizei size) {
+	const Block * block = call->branch.target->target;
+	const Inst * inst = block->first;
+	Inst * pos = call, * next;
+
+	while (size) {
+		if (!inst) {
+			block = block->next;
+			inst = block->first;
+			continue;
+		}
+
+		pos = InsertCopy(program, main, pos, inst);
+		inst = inst->base.next;
+		--size;
+	}
+
+	next = call->base.next;
+	UnlinkInst(main, call);
+
+	return next;
+}
+
+/**
+ * Inline all unconditional subroutine calls of the main function, as long
+ * as the program stays within the size budget. Instructions copied into
+ * the main function are scanned again, such that nested calls are inlined
+ * as well.
+ *
+ * @param	program	the program to transform
+ * @param	main	the block holding the main function
+ * @param	size	in/out: the size of the program in instructions
+ * @param	budget	the maximum size of the program in instructions
+ */
+static void InlineCalls(ShaderProgram * program, Block * main, GLsizei * size,
+						GLsizei budget) {
+	Inst * inst, * next;
+	GLsizei body;
+
+	for (inst = main->first; inst; inst = next) {
+		next = inst->base.next;
+
+		if (inst->base.op != OpcodeCAL || GetCond(inst) != CondT ||
+			!inst->branch.target->target) {
+			continue;
+		}
+
+		body = GetSubroutineSize(inst->branch.target->target);
+
+		/* the CAL is not credited, so recursive calls exhaust the budget */
+		if (body >= 0 && *size + body <= budget) {
+			*size += body;
+			next = InlineCall(program, main, inst, body);
+		}
+	}
+}
+
+/**
+ * Replace a loop by the given number of copies of its body.
+ *
+ * @param	program	the program containing the loop
+ * @param	main	the block containing the loop
+ * @param	rep		the REP instruction opening the loop
+ * @param	endrep	the ENDREP instruction closing the loop
+ * @param	count	the number of iterations
+ */
+static void UnrollLoop(ShaderProgram * program, Block * main, Inst * rep,
+					   Inst * endrep, GLsizei count) {
+	Inst * inst, * pos = endrep;
+	GLsizei iteration;
+
+	if (count <= 0) {
+		/* the loop is skipped entirely */
+		while (rep->base.next != endrep) {
+			UnlinkInst(main, rep->base.next);
+		}
+	} else {
+		for (iteration = 1; iteration < count; ++iteration) {
+			for (inst = rep->base.next; inst != endrep; inst = inst->base.next) {
+				pos = InsertCopy(program, main, pos, inst);
+			}
+		}
+	}
+
+	UnlinkInst(main, rep);
+	UnlinkInst(main, endrep);
+}
+
+/**
+ * Unroll the loops of the main function that have a constant trip count
+ * and no BRK instruction, as long as the program stays within the size
+ * budget. Inner loops are considered before their enclosing loops.
+ *
+ * @param	program	the program to transform
+ * @param	main	the block holding the main function
+ * @param	size	in/out: the size of the program in instructions
+ * @param	budget	the maximum size of the program in instructions
+ */
+static void UnrollLoops(ShaderProgram * program, Block * main, GLsizei * size,
+						GLsizei budget) {
+	OpenLoop loops[GLES_MAX_LOOP_DEPTH];
+	GLsizei depth = 0, body, count;
+	Inst * inst, * next, * scan;
+	GLfloat value;
+
+	for (inst = main->first; inst; inst = next) {
+		OpenLoop * loop;
+
+		next = inst->base.next;
+
+		switch (inst->base.op) {
+		case OpcodeLOOP:
+		case OpcodeREP:
+			if (depth == GLES_MAX_LOOP_DEPTH) {
+				return;
+			}
+
+			loops[depth].inst = inst;
+			loops[depth].breaks = GL_FALSE;
+			++depth;
+			break;
+
+		case OpcodeBRK:
+			if (depth) {
+				loops[depth - 1].breaks = GL_TRUE;
+			}
+
+			break;
+
+		case OpcodeENDLOOP:
+		case OpcodeENDREP:
+			if (!depth) {
+				return;
+			}
+
+			loop = &loops[--depth];
+
+			if (inst->base.op != OpcodeENDREP || 
+				loop->inst->base.op != OpcodeREP || loop->breaks ||
+				!GetConstant(&loop->inst->src.arg, 0, &value)) {
+				break;
+			}
+
+			for (scan = loop->inst->base.next, body = 0; scan != inst; 
+				 scan = scan->base.next) {
+				++body;
+			}
+
+			count = (GLsizei) value;
+
+			if (count <= 0) {
+				*size -= body + 2;
+			} else if (*size + body * (count - 1) - 2 <= budget) {
+				*size += body * (count - 1) - 2;
+			} else {
+				break;
+			}
+
+			UnrollLoop(program, main, loop->inst, inst, count);
+			break;
+
+		default:
+			;
+		}
+	}
+}
+
+/**
+ * Inline the subroutine calls and unroll the loops of a program, such that
+ * its main function becomes straight-line code as far as possible. The
+ * blocks of the main function are merged into a single block first;
+ * subroutines are removed once no calls to them remain.
+ *
+ * @param	program	the program to transform
+ * @param	passes	OptimizeInline and/or OptimizeUnroll
+ * @param	budget	the maximum size of the program in instructions
+ */
+static void ExpandProgram(ShaderProgram * program, GLbitfield passes,
+						  GLsizei budget) {
+	Block * main = program->blocks.head, * end = NULL, * block;
+	Label ** link;
+	Inst * inst;
+	GLsizei size = 0, depth = 0;
+
+	if (!main) {
+		return;
+	}
+
+	/* the main function extends up to its unconditional return */
+
+	for (block = main; block; block = block->next) {
+		for (inst = block->first; inst; inst = inst->base.next, ++size) {
+			if (!GetInstSize(inst)) {
+				return;
+			}
+
+			switch (inst->base.op) {
+			case OpcodeIF:
+			case OpcodeLOOP:
+			case OpcodeREP:
+				++depth;
+				break;
+
+			case OpcodeENDIF:
+			case OpcodeENDLOOP:
+			case OpcodeENDREP:
+				--depth;
+				break;
+
+			case OpcodeRET:
+				if (!depth && !end && GetCond(inst) == CondT) {
+					end = block;
+				}
+
+				break;
+
+			default:
+				;
+			}
+		}
+	}
+
+	if (!end || size > budget) {
+		return;
+	}
+
+	for (link = &program->labels; *link; link = &(*link)->next) {
+		for (block = main->next; block && block != end->next; block = block->next) {
+			if ((*link)->target == block) {
+				/* the main function is entered in the middle */
+				return;
+			}
+		}
+	}
+
+	/* merge the blocks of the main function */
+
+	while (main != end) {
+		block = main->next;
+
+		if (block->first) {
+			if (main->last) {
+				main->last->base.next = block->first;
+				block->first->base.prev = main->last;
+			} else {
+				main->first = block->first;
+			}
+
+			main->last = block->last;
+		}
+
+		main->next = block->next;
+
+		if (block->next) {
+			block->next->prev = main;
+		} else {
+			program->blocks.tail = main;
+		}
+
+		if (block == end) {
+			end = main;
+		}
+	}
+
+	if (passes & OptimizeInline) {
+		InlineCalls(program, main, &size, budget);
+	}
+
+	if (passes & OptimizeUnroll) {
+		UnrollLoops(program, main, &size, budget);
+	}
+
+	/* drop the subroutines if they are no longer called */
+
+	for (inst = main->first; inst; inst = inst->base.next) {
+		if (inst->base.op == OpcodeCAL) {
+			return;
+		}
+	}
+
+	main->next = NULL;
+	program->blocks.tail = main;
+
+	for (link = &program->labels; *link; ) {
+		if ((*link)->target != main) {
+			*link = (*link)->next;
+		} else {
+			link = &(*link)->next;
+		}
+	}
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: pre-shader extraction
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Determine if the value computed by an instruction depends only on its
+ * operands, such that it can be evaluated ahead of the shader invocation.
+ *
+ * @param	inst	the instruction
+ *
+ * @return	GL_TRUE for ALU instructions other than texture accesses
+ */
+static GLboolean IsHoistable(const Inst * inst) {
+	switch (inst->base.kind) {
+	case InstKindUnary:
+	case InstKindBinary:
+	case InstKindTernary:
+	case InstKindSwizzle:
+		return GL_TRUE;
+
+	default:
+		return GL_FALSE;
+	}
+}
+
+/**
+ * Determine if a source operand is invariant during a draw call, given
+ * the set of temporaries that are computed by the pre-shader.
+ *
+ * @param	var		the variable referenced by the operand
+ * @param	index	the index register of the operand, or NULL
+ * @param	hoisted	hoisted flag of each temporary by variable id
+ *
+ * @return	GL_TRUE if the operand refers to a constant, a uniform or a
+ * 			hoisted temporary
+ */
+static GLboolean IsInvariant(const ProgVarBase * var, const ProgVarAddr * index,
+							 const GLboolean * hoisted) {
+	if (index) {
+		return GL_FALSE;
+	}
+
+	switch (var->kind) {
+	case ProgVarKindConst:
+	case ProgVarKindParam:
+		return GL_TRUE;
+
+	case ProgVarKindTemp:
+		return hoisted[var->id];
+
+	default:
+		return GL_FALSE;
+	}
+}
+
+/**
+ * Determine the temporaries of a program whose values can be computed once
+ * per draw call. These are the temporaries that are only written at the
+ * top level of the main function, by instructions whose operands are
+ * invariant, and that are not read by the remaining instructions before
+ * their last write.
+ *
+ * Instructions of subroutines are considered to execute at the position of
+ * the first subroutine call within the main function.
+ *
+ * @param	optimizer	the optimizer state with a valid flow graph
+ * @param	hoisted		out: hoisted flag of each temporary by variable id
+ *
+ * @return	the number of instructions moved into the pre-shader
+ */
+static GLsizei SelectHoisted(Optimizer * optimizer, GLboolean * hoisted) {
+	ShaderProgram * program = optimizer->program;
+	Node * nodes = optimizer->nodes;
+	GLsizei numNodes = optimizer->numNodes;
+	GLsizei * position, * lastDef;
+	GLboolean * topLevel, changed;
+	GLsizei index, depth = 0, end = numNodes, call = -1, count, numRegs, reg;
+	SrcReg * regs[3];
+	GLuint masks[3];
+	DstReg * dst;
+	ProgVar * var;
+
+	position = GlesMemoryPoolAllocate(optimizer->memory, sizeof(GLsizei) * (numNodes + 1));
+	topLevel = GlesMemoryPoolAllocate(optimizer->memory, sizeof(GLboolean) * (numNodes + 1));
+	lastDef = GlesMemoryPoolAllocate(optimizer->memory,
+									 sizeof(GLsizei) * (program->numVars + 1));
+
+	/* the main function extends up to its unconditional return */
+
+	for (index = 0; index < numNodes && end == numNodes; ++index) {
+		Inst * inst = nodes[index].inst;
+
+		switch (inst->base.op) {
+		case OpcodeIF:
+		case OpcodeLOOP:
+		case OpcodeREP:
+			topLevel[index] = !depth++;
+			break;
+
+		case OpcodeENDIF:
+		case OpcodeENDLOOP:
+		case OpcodeENDREP:
+			topLevel[index] = !--depth;
+			break;
+
+		case OpcodeCAL:
+			if (call < 0) {
+				call = index;
+			}
+
+			topLevel[index] = !depth;
+			break;
+
+		case OpcodeRET:
+			if (!depth && GetCond(inst) == CondT) {
+				end = index + 1;
+			}
+
+			topLevel[index] = !depth;
+			break;
+
+		default:
+			topLevel[index] = !depth;
+		}
+	}
+
+	for (index = 0; index < numNodes; ++index) {
+		if (index < end) {
+			position[index] = index;
+		} else {
+			topLevel[index] = GL_FALSE;
+			position[index] = call >= 0 ? call : end;
+		}
+	}
+
+	/* start with all temporaries written at the top level only */
+
+	for (var = program->temp; var; var = var->base.next) {
+		hoisted[var->base.id] = GL_FALSE;
+	}
+
+	for (index = 0; index < numNodes; ++index) {
+		if ((dst = GetDstReg(nodes[index].inst)) != NULL &&
+			dst->reference.base->kind == ProgVarKindTemp) {
+			hoisted[dst->reference.base->id] = GL_TRUE;
+		}
+	}
+
+	for (index = 0; index < numNodes; ++index) {
+		if ((dst = GetDstReg(nodes[index].inst)) != NULL &&
+			(!topLevel[index] || !IsHoistable(nodes[index].inst))) {
+			hoisted[dst->reference.base->id] = GL_FALSE;
+		}
+	}
+
+	/* remove temporaries until the remaining set is consistent */
+
+	do {
+		changed = GL_FALSE;
+
+		for (index = 0; index < numNodes; ++index) {
+			if ((dst = GetDstReg(nodes[index].inst)) != NULL) {
+				lastDef[dst->reference.base->id] = index;
+			}
+		}
+
+		for (index = 0; index < numNodes; ++index) {
+			Inst * inst = nodes[index].inst;
+			ProgVarBase * target = NULL;
+			GLboolean invariant = GL_TRUE;
+
+			if ((dst = GetDstReg(inst)) != NULL &&
+				dst->reference.base->kind == ProgVarKindTemp &&
+				hoisted[dst->reference.base->id]) {
+				target = dst->reference.base;
+			}
+
+			numRegs = GetSrcRegs(inst, regs, masks);
+
+			for (reg = 0; reg < numRegs; ++reg) {
+				ProgVarBase * src = regs[reg]->reference.base;
+
+				if (target) {
+					invariant &= IsInvariant(src, regs[reg]->index, hoisted);
+				} else if (src->kind == ProgVarKindTemp && hoisted[src->id] &&
+						   position[index] <= lastDef[src->id]) {
+					/* value is read before it has been computed completely */
+					hoisted[src->id] = GL_FALSE;
+					changed = GL_TRUE;
+				}
+			}
+
+			if (inst->base.kind == InstKindSwizzle) {
+				ProgVarBase * src = inst->swizzle.arg.base;
+
+				if (target) {
+					invariant &= IsInvariant(src, NULL, hoisted);
+				} else if (src->kind == ProgVarKindTemp && hoisted[src->id] &&
+						   position[index] <= lastDef[src->id]) {
+					hoisted[src->id] = GL_FALSE;
+					changed = GL_TRUE;
+				}
+			}
+
+			if (target && !invariant) {
+				hoisted[target->id] = GL_FALSE;
+				changed = GL_TRUE;
+			}
+		}
+	} while (changed);
+
+	for (index = 0, count = 0; index < numNodes; ++index) {
+		if ((dst = GetDstReg(nodes[index].inst)) != NULL &&
+			dst->reference.base->kind == ProgVarKindTemp &&
+			hoisted[dst->reference.base->id]) {
+			++count;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * Replace a reference to a hoisted temporary by a reference to the
+ * variable that holds its value computed by the pre-shader.
+ *
+ * @param	ref		the reference to update
+ * @param	results	the result variable of each hoisted temporary by id
+ */
+static GLES_INLINE void MapHoisted(SrcRef * ref, ProgVar ** results) {
+	if (ref->base->kind == ProgVarKindTemp && results[ref->base->id]) {
+		ref->base = &results[ref->base->id]->base;
+	}
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: temporary allocation
+** --------------------------------------------------------------------------
+*/
+
+static GLES_INLINE void ExtendRange(LiveRange * range, GLsizei index) {
+	if (range->end < 0) {
+		range->start = index;
+	}
+
+	range->end = index;
+}
+
+/**
+ * Determine the live range of each temporary variable. The range of a
+ * variable covers every instruction where any of its rows is live on entry
+ * or on exit, or is written. Values that are carried around a loop or
+ * across a subroutine call are live along the back edge or the return,
+ * so the range extends over the complete loop body or subroutine.
+ *
+ * @param	optimizer	the optimizer state with a valid flow graph
+ * @param	ranges		out: the live range of each variable in the temp list
+ * @param	slotRange	out: index of the range of each slot, or -1
+ */
+static void ComputeLiveRanges(Optimizer * optimizer, LiveRange * ranges,
+							  GLsizei * slotRange) {
+	GLsizei words = optimizer->slotWords;
+	GLuint * liveIn = ComputeLiveness(optimizer), * liveOut;
+	GLsizei numRanges = 0, index, slot, row;
+	const GLuint * in;
+	ProgVar * var;
+	Access def;
+
+	liveOut = GlesMemoryPoolAllocate(optimizer->memory, sizeof(GLuint) * words);
+
+	for (slot = 0; slot < optimizer->numSlots; ++slot) {
+		slotRange[slot] = -1;
+	}
+
+	for (var = optimizer->program->temp; var; var = var->base.next) {
+		ranges[numRanges].var = var;
+		ranges[numRanges].start = optimizer->numNodes;
+		ranges[numRanges].end = -1;
+
+		for (row = 0; row < var->base.type->base.size; ++row) {
+			slotRange[optimizer->varSlot[var->base.id] + row] = numRanges;
+		}
+
+		++numRanges;
+	}
+
+	for (index = 0; index < optimizer->numNodes; ++index) {
+		in = liveIn + index * words;
+		GetLiveOut(optimizer, liveIn, index, liveOut);
+
+		if (GetDef(optimizer, optimizer->nodes[index].inst, &def) &&
+			slotRange[def.slot] >= 0) {
+			ExtendRange(ranges + slotRange[def.slot], index);
+		}
+
+		for (slot = 0; slot < optimizer->numSlots; ++slot) {
+			if (slotRange[slot] >= 0 &&
+				(GetMask(in, slot) || GetMask(liveOut, slot))) {
+				ExtendRange(ranges + slotRange[slot], index);
+			}
+		}
+	}
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: pass manager
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Sequence of optimization steps, and the passes enabling each step.
+ */
+static const struct {
+	GLbitfield		passes;				/**< OptimizePass bits enabling step	*/
+	OptimizerStep	step;				/**< step function						*/
+} Pipeline[] = {
+	{ OptimizeConstants | OptimizeCopies,	PropagateCopies		},
+	{ OptimizeConstants,					FoldConstants		},
+	{ OptimizeDeadCode,						EliminateDeadCode	},
+};
+
+/**
+ * Initialize the optimizer state for a program.
+ *
+ * @param	optimizer	the optimizer state to initialize
+ * @param	linker		reference to linker object
+ * @param	program		the program to optimize
+ * @param	passes		the optimization passes to apply
+ */
+static void InitOptimizer(Optimizer * optimizer, Linker * linker,
+						  ShaderProgram * program, GLbitfield passes) {
+	GLsizei numNodes = 0;
+	Block * block;
+	Inst * inst;
+
+	GlesMemset(optimizer, 0, sizeof(Optimizer));
+
+	optimizer->program = program;
+	optimizer->memory = linker->tempMemory;
+	optimizer->passes = passes;
+
+	AssignSlots(optimizer);
+
+	/* optimization never adds instructions */
+	for (block = program->blocks.head; block; block = block->next) {
+		for (inst = block->first; inst; inst = inst->base.next) {
+			++numNodes;
+		}
+	}
+
+	optimizer->nodes =
+		GlesMemoryPoolAllocate(optimizer->memory, sizeof(Node) * (numNodes + 1));
+	optimizer->blockStart =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLsizei) * (program->numBlocks + 1));
+	optimizer->constructs =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(Construct) * (numNodes + 1));
+	optimizer->returnSites =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLsizei) * (numNodes + 1));
+	optimizer->successors =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLsizei) * (numNodes + 3));
+	optimizer->worklist =
+		GlesMemoryPoolAllocate(optimizer->memory,
+							   sizeof(GLsizei) * (numNodes + 1));
+}
+
+/*
+** --------------------------------------------------------------------------
+** Functions
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Optimize a shader program before its constants are packed into the data
+ * segment. Subroutine calls are inlined and loops are unrolled first, up
+ * to a program size of GLES_MAX_EXPANDED_SIZE instructions. The enabled
+ * optimization steps are then repeated until the program does not change
+ * anymore, or GLES_MAX_OPTIMIZER_ROUNDS is reached. With dead code
+ * elimination enabled, constants that are no longer used are removed from
+ * the program afterwards.
+ *
+ * Programs whose control flow constructs are malformed are left unchanged;
+ * the error is reported during code generation.
+ *
+ * @param	linker	reference to linker object
+ * @param	program	the program to optimize
+ * @param	passes	set of OptimizePass values to apply
+ */
+void GlesOptimizeShaderProgram(Linker * linker, ShaderProgram * program,
+							   GLbitfield passes) {
+	Optimizer optimizer;
+	GLsizei round, index;
+	GLboolean changed;
+
+	if (!(passes & OptimizeAll)) {
+		return;
+	}
+
+	if (passes & (OptimizeInline | OptimizeUnroll)) {
+		ExpandProgram(program, passes, GLES_MAX_EXPANDED_SIZE);
+	}
+
+	InitOptimizer(&optimizer, linker, program, passes);
+
+	for (round = 0; round < GLES_MAX_OPTIMIZER_ROUNDS; ++round) {
+		changed = GL_FALSE;
+
+		for (index = 0; index < (GLsizei) GLES_ELEMENTSOF(Pipeline); ++index) {
+			if (!(Pipeline[index].passes & passes)) {
+				continue;
+			}
+
+			if (!BuildFlowGraph(&optimizer)) {
+				return;
+			}
+
+			changed |= Pipeline[index].step(&optimizer);
+		}
+
+		if (!changed) {
+			break;
+		}
+	}
+
+	if (passes & OptimizeDeadCode) {
+		RemoveUnusedConstants(program);
+	}
+}
+
+/**
+ * Assign storage locations to the temporary variables of a program, such
+ * that variables whose live ranges do not overlap share the same rows of
+ * the local data segment. Ranges are processed in order of their start,
+ * and each variable is placed at the lowest location whose rows are no
+ * longer in use (linear scan allocation). Multi-row variables, such as
+ * arrays and matrices, are kept contiguous for relative addressing.
+ *
+ * @param	linker	reference to linker object
+ * @param	program	the program whose temporaries are to be allocated
+ * @param	size	out: number of vec4 rows of temporary storage
+ *
+ * @return	GL_FALSE if the control flow of the program is malformed
+ */
+GLboolean GlesAllocateShaderTemps(Linker * linker, ShaderProgram * program,
+								  GLsizeiptr * size) {
+	Optimizer optimizer;
+	LiveRange * ranges, * range;
+	GLsizei * slotRange, * order, * rowEnd;
+	GLsizei numRanges = 0, numRows = 0, index, pos, base, row, rows;
+	ProgVar * var;
+
+	InitOptimizer(&optimizer, linker, program, 0);
+
+	if (!BuildFlowGraph(&optimizer)) {
+		return GL_FALSE;
+	}
+
+	for (var = program->temp; var; var = var->base.next) {
+		++numRanges;
+		numRows += var->base.type->base.size;
+	}
+
+	ranges = GlesMemoryPoolAllocate(optimizer.memory,
+									sizeof(LiveRange) * (numRanges + 1));
+	order = GlesMemoryPoolAllocate(optimizer.memory,
+								   sizeof(GLsizei) * (numRanges + 1));
+	rowEnd = GlesMemoryPoolAllocate(optimizer.memory,
+									sizeof(GLsizei) * (numRows + 1));
+	slotRange = GlesMemoryPoolAllocate(optimizer.memory,
+									   sizeof(GLsizei) * optimizer.numSlots);
+
+	ComputeLiveRanges(&optimizer, ranges, slotRange);
+
+	/* temporaries are created in program order, so this is mostly sorted */
+	for (index = 0; index < numRanges; ++index) {
+		for (pos = index; 
+			 pos > 0 && ranges[order[pos - 1]].start > ranges[index].start;
+			 --pos) {
+			order[pos] = order[pos - 1];
+		}
+
+		order[pos] = index;
+	}
+
+	for (row = 0; row < numRows; ++row) {
+		rowEnd[row] = -1;
+	}
+
+	*size = 0;
+
+	for (index = 0; index < numRanges; ++index) {
+		range = ranges + order[index];
+		range->var->base.segment = ProgVarSegLocal;
+
+		if (range->end < 0) {
+			/* variable is never accessed */
+			range->var->base.location = 0;
+			continue;
+		}
+
+		rows = range->var->base.type->base.size;
+
+		for (base = 0; ; ++base) {
+			for (row = 0; row < rows && rowEnd[base + row] < range->start; ++row)
+				;
+
+			if (row == rows) {
+				break;
+			}
+		}
+
+		for (row = 0; row < rows; ++row) {
+			rowEnd[base + row] = range->end;
+		}
+
+		range->var->base.location = base * 4;
+
+		if (base + rows > *size) {
+			*size = base + rows;
+		}
+	}
+
+	return GL_TRUE;
+}
+
+/**
+ * Split the computations of a shader program that depend only on constants
+ * and uniform variables off into a separate pre-shader, which is evaluated
+ * once per draw call. Instructions are moved into the pre-shader in
+ * program order.
+ *
+ * Temporaries computed by the pre-shader and read by the remaining program
+ * are placed into the data segment of the shader, starting at the given
+ * row. The pre-shader writes them as results, and the program reads them
+ * through new input variables at the same locations.
+ *
+ * @param	linker	reference to linker object
+ * @param	program	the program to split, after its constants have been
+ * 					packed into the data segment
+ * @param	base	first row of the data segment available for results
+ * @param	rows	out: number of data segment rows used for results
+ *
+ * @return	the pre-shader, or NULL if there is nothing to hoist
+ */
+ShaderProgram * GlesHoistShaderProgram(Linker * linker, ShaderProgram * program,
+									   GLsizeiptr base, GLsizeiptr * rows) {
+	Optimizer optimizer;
+	ShaderProgram * pre;
+	GLboolean * hoisted, * read;
+	ProgVar ** results, ** link, ** temps, ** outs, * var;
+	GLsizei index, numRegs, reg;
+	SrcReg * regs[3];
+	GLuint masks[3];
+	Block * block;
+	DstReg * dst;
+
+	*rows = 0;
+
+	InitOptimizer(&optimizer, linker, program, OptimizeHoist);
+
+	if (!BuildFlowGraph(&optimizer)) {
+		return NULL;
+	}
+
+	hoisted = GlesMemoryPoolAllocate(optimizer.memory,
+									 sizeof(GLboolean) * (program->numVars + 1));
+	read = GlesMemoryPoolAllocate(optimizer.memory,
+								  sizeof(GLboolean) * (program->numVars + 1));
+	results = GlesMemoryPoolAllocate(optimizer.memory,
+									 sizeof(ProgVar *) * (program->numVars + 1));
+	GlesMemset(hoisted, 0, sizeof(GLboolean) * (program->numVars + 1));
+	GlesMemset(read, 0, sizeof(GLboolean) * (program->numVars + 1));
+	GlesMemset(results, 0, sizeof(ProgVar *) * (program->numVars + 1));
+
+	if (!SelectHoisted(&optimizer, hoisted)) {
+		return NULL;
+	}
+
+	pre = GlesMemoryPoolAllocate(program->memory, sizeof(ShaderProgram));
+	block = GlesMemoryPoolAllocate(program->memory, sizeof(Block));
+	GlesMemset(pre, 0, sizeof(ShaderProgram));
+	GlesMemset(block, 0, sizeof(Block));
+
+	pre->memory = program->memory;
+	pre->numVars = program->numVars;
+	pre->numAddrVars = program->numAddrVars;
+	pre->numBlocks = 1;
+	pre->blocks.head = pre->blocks.tail = block;
+
+	/* move the hoisted instructions and note the values still needed */
+
+	for (index = 0; index < optimizer.numNodes; ++index) {
+		Inst * inst = optimizer.nodes[index].inst;
+
+		if ((dst = GetDstReg(inst)) != NULL &&
+			dst->reference.base->kind == ProgVarKindTemp &&
+			hoisted[dst->reference.base->id]) {
+			RemoveInst(&optimizer.nodes[index]);
+
+			inst->base.prev = block->last;
+			inst->base.next = NULL;
+
+			if (block->last) {
+				block->last->base.next = inst;
+			} else {
+				block->first = inst;
+			}
+
+			block->last = inst;
+			continue;
+		}
+
+		numRegs = GetSrcRegs(inst, regs, masks);
+
+		for (reg = 0; reg < numRegs; ++reg) {
+			read[regs[reg]->reference.base->id] = GL_TRUE;
+		}
+
+		if (inst->base.kind == InstKindSwizzle) {
+			read[inst->swizzle.arg.base->id] = GL_TRUE;
+		}
+	}
+
+	/* partition the hoisted temporaries, preserving their order */
+
+	link = &program->temp;
+	temps = &pre->temp;
+	outs = &pre->out;
+
+	while ((var = *link) != NULL) {
+		if (!hoisted[var->base.id]) {
+			link = &var->base.next;
+			continue;
+		}
+
+		*link = var->base.next;
+		var->base.next = NULL;
+
+		if (!read[var->base.id]) {
+			*temps = var;
+			temps = &var->base.next;
+			continue;
+		}
+
+		*outs = var;
+		outs = &var->base.next;
+
+		/* the program reads the result from the data segment */
+		results[var->base.id] =
+			GlesMemoryPoolAllocate(program->memory, sizeof(ProgVar));
+		GlesMemset(results[var->base.id], 0, sizeof(ProgVar));
+		results[var->base.id]->base.kind = ProgVarKindIn;
+		results[var->base.id]->base.id = var->base.id;
+		results[var->base.id]->base.type = var->base.type;
+		results[var->base.id]->base.segment = ProgVarSegParam;
+		results[var->base.id]->base.location = (base + *rows) * 4;
+		results[var->base.id]->base.next = program->in;
+		program->in = results[var->base.id];
+
+		var->base.segment = ProgVarSegResult;
+		var->base.location = (base + *rows) * 4;
+		*rows += var->base.type->base.size;
+	}
+
+	for (block = program->blocks.head; block; block = block->next) {
+		Inst * inst;
+
+		for (inst = block->first; inst; inst = inst->base.next) {
+			numRegs = GetSrcRegs(inst, regs, masks);
+
+			for (reg = 0; reg < numRegs; ++reg) {
+				MapHoisted(&regs[reg]->reference, results);
+			}
+
+			if (inst->base.kind == InstKindSwizzle) {
+				MapHoisted(&inst->swizzle.arg, results);
+			}
+		}
+	}
+
+	return pre;
+}
+
+/**
+ * Mark the words of an input segment read through a variable reference.
+ *
+ * @param	var		the variable referenced
+ * @param	row		the row accessed, or -1 for any row of the variable
+ * @param	selects	the components read, bit 0 = x-component
+ * @param	segment	the segment of interest
+ * @param	base	word offset within the segment corresponding to bit 0
+ * @param	mask	in/out: the words read
+ */
+static void MarkInputWords(const ProgVarBase * var, GLsizeiptr row, 
+						   GLuint selects, ProgVarSegment segment, 
+						   GLsizeiptr base, GLuint * mask) {
+	GLsizeiptr first = row, last = row, component, word;
+
+	if (var->segment != segment) {
+		return;
+	}
+
+	if (row < 0) {
+		/* relative addressing may access any row of the variable */
+		first = 0;
+		last = var->type->base.size - 1;
+	}
+
+	for (row = first; row <= last; ++row) {
+		for (component = 0; component < 4; ++component) {
+			word = var->location + row * 4 + component - base;
+
+			if ((selects & (1 << component)) && word >= 0 && word < 32) {
+				*mask |= 1u << word;
+			}
+		}
+	}
+}
+
+/**
+ * Determine the words of an input segment that a shader program reads.
+ * The rasterizer uses this to interpolate only the varyings and special
+ * inputs actually consumed by the fragment shader.
+ *
+ * @param	program	the optimized shader program
+ * @param	segment	the input segment, i.e. varyings or special inputs
+ * @param	base	word offset within the segment corresponding to bit 0
+ *
+ * @return	bit mask of the words base ... base + 31 read by the program
+ */
+GLuint GlesShaderInputMask(const ShaderProgram * program, 
+						   ProgVarSegment segment, GLsizeiptr base) {
+	const Block * block;
+	Inst * inst;
+	SrcReg * regs[3];
+	GLuint masks[3], mask = 0, selects;
+	GLsizei numRegs, index, component;
+
+	for (block = program->blocks.head; block; block = block->next) {
+		for (inst = block->first; inst; inst = inst->base.next) {
+			numRegs = GetSrcRegs(inst, regs, masks);
+
+			for (index = 0; index < numRegs; ++index) {
+				selects = 0;
+
+				for (component = 0; component < 4; ++component) {
+					if (masks[index] & (1 << component)) {
+						selects |= 1 << GetSelect(regs[index], component);
+					}
+				}
+
+				MarkInputWords(regs[index]->reference.base, 
+							   regs[index]->index ? -1 : regs[index]->offset,
+							   selects, segment, base, &mask);
+			}
+
+			if (inst->base.kind == InstKindSwizzle) {
+				selects = 0;
+
+				if (inst->swizzle.alu.dst.maskX)	selects |= 1 << (inst->swizzle.optionX & 7);
+				if (inst->swizzle.alu.dst.maskY)	selects |= 1 << (inst->swizzle.optionY & 7);
+				if (inst->swizzle.alu.dst.maskZ)	selects |= 1 << (inst->swizzle.optionZ & 7);
+				if (inst->swizzle.alu.dst.maskW)	selects |= 1 << (inst->swizzle.optionW & 7);
+
+				/* drop the selection of constant 0 and 1 */
+				MarkInputWords(inst->swizzle.arg.base, 0, 
+							   (selects >> ExtSwizzleSelectX) & 0xf,
+							   segment, base, &mask);
+			}
+		}
+	}
+
+	return mask;
+}
@@ -0,0 +1,1262 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** x86-64 native code generator backend
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+#include <GLES/gl.h>
+
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "frontend/il.h"
+#include "frontend/linker.h"
+#include "backend/interp.h"
+#include "backend/mathlib.h"
+#include "backend/x86.h"
+
+#if GLES_JIT_X86_64
+
+/*
+** --------------------------------------------------------------------------
+** Module-local data
+** --------------------------------------------------------------------------
+*/
+
+#define IDENTITY_SWIZZLE	(0 | (1 << 2) | (2 << 4) | (3 << 6))
+
+/*
+** General purpose registers. The generated code keeps the frame pointer
+** and the most frequently used segment base addresses in callee-saved
+** registers; RAX and RCX are used for address calculations.
+*/
+#define RAX		0
+#define RCX		1
+#define RDX		2
+#define RBX		3					/* frame pointer					*/
+#define RSP		4
+#define RBP		5					/* saved stack pointer around calls	*/
+#define RSI		6
+#define RDI		7					/* execution context on entry		*/
+#define R12		12					/* temporary segment				*/
+#define R13		13					/* constant segment					*/
+#define R14		14					/* uniform segment					*/
+#define R15		15					/* attrib (VS) or varying (FS)		*/
+#define RIP		(-1)				/* constant pool addressing			*/
+
+/*
+** Layout of the constant pool at the start of the code area
+*/
+#define POOL_MASK		0				/* 16 write masks					*/
+#define POOL_SIGN		256				/* sign bits						*/
+#define POOL_ABS		272				/* all bits but sign bits			*/
+#define POOL_ONE		288				/* 1.0f in all components			*/
+#define POOL_ZERO		304				/* 0.0f in all components			*/
+#define POOL_SIZE		320
+
+/*
+** Layout of the stack frame addressed through RBX
+*/
+#define FRAME_SEGMENT	0				/* segment base addresses			*/
+#define FRAME_UNITS		56				/* texture image units				*/
+#define FRAME_CC		64				/* condition code register			*/
+#define FRAME_ADDR		80				/* address registers				*/
+#define FRAME_ARG0		144				/* first helper argument			*/
+#define FRAME_ARG1		160				/* second helper argument			*/
+#define FRAME_RESULT	176				/* helper result					*/
+#define FRAME_SIZE		200				/* keeps RSP 16-byte aligned		*/
+
+/*
+** Opcodes; values above 0xff include the 0x0f escape byte
+*/
+#define X86_ADD			0x03			/* add r64, r/m64					*/
+#define X86_MOVSXD		0x63			/* movsxd r64, r/m32				*/
+#define X86_ALU_IMM32	0x81			/* /0 add, /5 sub					*/
+#define X86_ALU_IMM8	0x83			/* /4 and							*/
+#define X86_TEST		0x85			/* test r/m32, r32					*/
+#define X86_XOR			0x31			/* xor r/m32, r32					*/
+#define X86_STORE		0x89			/* mov r/m, r						*/
+#define X86_LOAD		0x8b			/* mov r, r/m						*/
+#define X86_LEA			0x8d			/* lea r64, m						*/
+#define X86_SHIFT_IMM8	0xc1			/* /4 shl							*/
+#define X86_GROUP5		0xff			/* /1 dec, /2 call					*/
+
+#define SSE_MOVUPS_LOAD	0x0f10			/* also movss with 0xf3 prefix		*/
+#define SSE_MOVUPS_STORE 0x0f11			/* also movss with 0xf3 prefix		*/
+#define SSE_MOVAPS		0x0f28
+#define SSE_CVTTSS2SI	0x0f2c			/* with 0xf3 prefix					*/
+#define SSE_MOVMSKPS	0x0f50
+#define SSE_SQRTSS		0x0f51			/* with 0xf3 prefix					*/
+#define SSE_RSQRTSS		0x0f52			/* with 0xf3 prefix					*/
+#define SSE_ANDPS		0x0f54
+#define SSE_ANDNPS		0x0f55
+#define SSE_ORPS		0x0f56
+#define SSE_XORPS		0x0f57
+#define SSE_ADDPS		0x0f58
+#define SSE_MULPS		0x0f59
+#define SSE_CVTDQ2PS	0x0f5b			/* cvttps2dq with 0xf3 prefix		*/
+#define SSE_SUBPS		0x0f5c
+#define SSE_MINPS		0x0f5d
+#define SSE_DIVPS		0x0f5e			/* divss with 0xf3 prefix			*/
+#define SSE_MAXPS		0x0f5f
+#define SSE_PSHUFD		0x0f70			/* with 0x66 prefix					*/
+#define SSE_CMPPS		0x0fc2
+#define SSE_SHUFPS		0x0fc6
+
+#define CMP_EQ			0				/* cmpps predicates					*/
+#define CMP_LT			1
+#define CMP_LE			2
+#define CMP_NEQ			4
+
+#define JCC_Z			0x84			/* second opcode byte of jcc rel32	*/
+#define JCC_NZ			0x85
+#define JCC_LE			0x8e
+
+/**
+ * Signature of C functions called by the generated code for operations
+ * that have no compact SSE2 equivalent.
+ */
+typedef void (*Helper)(Vec4f * result, Vec4f * a, Vec4f * b, const void * param);
+
+/**
+ * Reference to a jump target that needs to be resolved once all 
+ * instructions have been emitted.
+ */
+typedef struct Fixup {
+	GLsizeiptr		position;			/**< offset of rel32 field			*/
+	GLsizei			target;				/**< index of target label			*/
+} Fixup;
+
+/**
+ * Code generation state.
+ */
+typedef struct Emitter {
+	GLubyte *		code;				/**< code buffer					*/
+	GLsizeiptr		size;				/**< number of bytes emitted		*/
+	GLsizeiptr		capacity;			/**< size of code buffer			*/
+	GLsizeiptr *	labels;				/**< code offset for each label		*/
+	Fixup *			fixups;				/**< unresolved jumps				*/
+	GLsizei			numFixups;			/**< number of unresolved jumps		*/
+	GLenum			type;				/**< vertex or fragment shader		*/
+	GLboolean		error;				/**< out of memory					*/
+} Emitter;
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: run-time helpers
+** --------------------------------------------------------------------------
+*/
+
+static GLES_INLINE void Replicate(Vec4f * result, GLfloat value) {
+	result->x = result->y = result->z = result->w = value;
+}
+
+/* the helper parameter of math functions is the Precision of the result	*/
+#define PRECISION(param)	((Precision) (size_t) (param))
+
+static void HelperCOS(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	(void) b;
+	Replicate(result, GlesMathCosf(a->x, PRECISION(param)));
+}
+
+static void HelperSIN(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	(void) b;
+	Replicate(result, GlesMathSinf(a->x, PRECISION(param)));
+}
+
+static void HelperSCS(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	(void) b;
+	result->x = GlesMathCosf(a->x, PRECISION(param));
+	result->y = GlesMathSinf(a->x, PRECISION(param));
+	result->z = result->w = 0.0f;
+}
+
+static void HelperEX2(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	(void) b;
+	Replicate(result, GlesMathExp2f(a->x, PRECISION(param)));
+}
+
+static void HelperLG2(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	(void) b;
+	Replicate(result, GlesMathLog2f(a->x, PRECISION(param)));
+}
+
+static void HelperPOW(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	Replicate(result, GlesMathPowf(a->x, b->x, PRECISION(param)));
+}
+
+static void HelperEXP(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	(void) b;
+	result->x = GlesMathExp2f(GlesFloorf(a->x), PRECISION(param));
+	result->y = GlesFracf(a->x);
+	result->z = GlesMathExp2f(a->x, PRECISION(param));
+	result->w = 1.0f;
+}
+
+static void HelperLOG(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	(void) b;
+	result->z = GlesMathLog2f(GlesFabsf(a->x), PRECISION(param));
+	result->x = GlesFloorf(result->z);
+	result->y = GlesFabsf(a->x) / GlesMathExp2f(result->x, PRECISION(param));
+	result->w = 1.0f;
+}
+
+static void HelperDST(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	(void) param;
+	result->x = 1.0f;
+	result->y = a->y * b->y;
+	result->z = a->z;
+	result->w = b->w;
+}
+
+static GLES_INLINE GLfloat ExtSwizzle(const Vec4f * value, GLuint option) {
+	GLfloat result;
+
+	switch (option & ~ExtSwizzleSelectNeg) {
+	case ExtSwizzleSelect0:	result = 0.0f;		break;
+	case ExtSwizzleSelect1:	result = 1.0f;		break;
+	case ExtSwizzleSelectX:	result = value->x;	break;
+	case ExtSwizzleSelectY:	result = value->y;	break;
+	case ExtSwizzleSelectZ:	result = value->z;	break;
+	default:				result = value->w;	break;
+	}
+
+	return (option & ExtSwizzleSelectNeg) ? -result : result;
+}
+
+static void HelperSWZ(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	GLuint options = (GLuint) (size_t) param;
+	(void) b;
+
+	result->x = ExtSwizzle(a,  options        & 0xf);
+	result->y = ExtSwizzle(a, (options >>  4) & 0xf);
+	result->z = ExtSwizzle(a, (options >>  8) & 0xf);
+	result->w = ExtSwizzle(a, (options >> 12) & 0xf);
+}
+
+static void HelperSample2D(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	GlesInterpSample((const TextureImageUnit *) param, b->x, TextureTarget2D, a, result);
+}
+
+static void HelperSample3D(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	GlesInterpSample((const TextureImageUnit *) param, b->x, TextureTarget3D, a, result);
+}
+
+static void HelperSampleCube(Vec4f * result, Vec4f * a, Vec4f * b, const void * param) {
+	GlesInterpSample((const TextureImageUnit *) param, b->x, TextureTargetCube, a, result);
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: instruction encoding
+** --------------------------------------------------------------------------
+*/
+
+static void EmitByte(Emitter * e, GLubyte value) {
+	if (e->size == e->capacity) {
+		GLsizeiptr capacity = e->capacity * 2;
+		GLubyte * code = e->error ? NULL : GlesMalloc(capacity);
+		
+		if (!code) {
+			e->error = GL_TRUE;
+			e->size = 0;
+			return;
+		}
+		
+		GlesMemcpy(code, e->code, e->size);
+		GlesFree(e->code);
+		e->code = code;
+		e->capacity = capacity;
+	}
+	
+	e->code[e->size++] = value;
+}
+
+static void EmitInt32(Emitter * e, GLint value) {
+	EmitByte(e, (GLubyte)  value);
+	EmitByte(e, (GLubyte) (value >> 8));
+	EmitByte(e, (GLubyte) (value >> 16));
+	EmitByte(e, (GLubyte) (value >> 24));
+}
+
+static void EmitInt64(Emitter * e, size_t value) {
+	EmitInt32(e, (GLint) value);
+	EmitInt32(e, (GLint) (value >> 32));
+}
+
+static void Patch32(Emitter * e, GLsizeiptr position, GLint value) {
+	if (!e->error) {
+		e->code[position    ] = (GLubyte)  value;
+		e->code[position + 1] = (GLubyte) (value >> 8);
+		e->code[position + 2] = (GLubyte) (value >> 16);
+		e->code[position + 3] = (GLubyte) (value >> 24);
+	}
+}
+
+static void EmitPrefix(Emitter * e, GLuint prefix, GLuint w, GLuint reg, GLuint rm) {
+	GLubyte rex = 0x40 | (w << 3) | ((reg & 8) >> 1) | ((rm & 8) >> 3);
+	
+	if (prefix) {
+		EmitByte(e, prefix);
+	}
+	
+	if (rex != 0x40) {
+		EmitByte(e, rex);
+	}
+}
+
+static void EmitOpcode(Emitter * e, GLuint opcode) {
+	if (opcode > 0xff) {
+		EmitByte(e, opcode >> 8);
+	}
+	
+	EmitByte(e, opcode & 0xff);
+}
+
+/**
+ * Emit an instruction with register operands only.
+ * 
+ * @param	e		the code emitter
+ * @param	prefix	mandatory prefix byte, or 0
+ * @param	w		1 for 64-bit operand size
+ * @param	opcode	the operation code
+ * @param	reg		register (or opcode extension) for the ModRM reg field
+ * @param	rm		register for the ModRM r/m field
+ */
+static void EmitRR(Emitter * e, GLuint prefix, GLuint w, GLuint opcode, 
+				   GLuint reg, GLuint rm) {
+	EmitPrefix(e, prefix, w, reg, rm);
+	EmitOpcode(e, opcode);
+	EmitByte(e, 0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/**
+ * Emit an instruction with a memory operand [base + disp]. When base is RIP,
+ * disp is an offset into the code area; the instruction must not carry an
+ * immediate operand in this case.
+ * 
+ * @param	e		the code emitter
+ * @param	prefix	mandatory prefix byte, or 0
+ * @param	w		1 for 64-bit operand size
+ * @param	opcode	the operation code
+ * @param	reg		register (or opcode extension) for the ModRM reg field
+ * @param	base	base register of memory operand
+ * @param	disp	displacement of memory operand
+ */
+static void EmitRM(Emitter * e, GLuint prefix, GLuint w, GLuint opcode, 
+				   GLuint reg, GLint base, GLint disp) {
+	GLuint mod;
+	
+	if (base == RIP) {
+		EmitPrefix(e, prefix, w, reg, 0);
+		EmitOpcode(e, opcode);
+		EmitByte(e, ((reg & 7) << 3) | 5);
+		EmitInt32(e, disp - (e->size + 4));
+		return;
+	}
+	
+	EmitPrefix(e, prefix, w, reg, base);
+	EmitOpcode(e, opcode);
+	
+	if (disp == 0 && (base & 7) != RBP) {
+		mod = 0;
+	} else if (disp >= -128 && disp <= 127) {
+		mod = 1;
+	} else {
+		mod = 2;
+	}
+	
+	EmitByte(e, (mod << 6) | ((reg & 7) << 3) | (base & 7));
+	
+	if ((base & 7) == RSP) {
+		/* SIB byte without index */
+		EmitByte(e, 0x24);
+	}
+	
+	if (mod == 1) {
+		EmitByte(e, (GLubyte) disp);
+	} else if (mod == 2) {
+		EmitInt32(e, disp);
+	}
+}
+
+static void EmitSseImm(Emitter * e, GLuint prefix, GLuint opcode, 
+					   GLuint dst, GLuint src, GLubyte imm) {
+	EmitRR(e, prefix, 0, opcode, dst, src);
+	EmitByte(e, imm);
+}
+
+static void EmitPush(Emitter * e, GLuint reg) {
+	if (reg & 8) {
+		EmitByte(e, 0x41);
+	}
+	
+	EmitByte(e, 0x50 + (reg & 7));
+}
+
+static void EmitPop(Emitter * e, GLuint reg) {
+	if (reg & 8) {
+		EmitByte(e, 0x41);
+	}
+	
+	EmitByte(e, 0x58 + (reg & 7));
+}
+
+static void EmitAddRsp(Emitter * e, GLint value) {
+	if (value) {
+		EmitRR(e, 0, 1, X86_ALU_IMM32, 0, RSP);
+		EmitInt32(e, value);
+	}
+}
+
+/**
+ * Emit a jump or call to a label that is resolved at the end of the code 
+ * generation.
+ * 
+ * @param	e		the code emitter
+ * @param	opcode	0xe8 (call), 0xe9 (jmp) or 0x0f8x (jcc)
+ * @param	target	index of target label
+ */
+static void EmitJump(Emitter * e, GLuint opcode, GLsizei target) {
+	EmitOpcode(e, opcode);
+	e->fixups[e->numFixups].position = e->size;
+	e->fixups[e->numFixups].target = target;
+	++e->numFixups;
+	EmitInt32(e, 0);
+}
+
+/**
+ * Emit a conditional forward jump within the current instruction.
+ * 
+ * @return	position of the jump displacement to be passed to EmitLocalTarget
+ */
+static GLsizeiptr EmitLocalJump(Emitter * e, GLubyte cc) {
+	GLsizeiptr position;
+	
+	EmitByte(e, 0x0f);
+	EmitByte(e, cc);
+	position = e->size;
+	EmitInt32(e, 0);
+	
+	return position;
+}
+
+static void EmitLocalTarget(Emitter * e, GLsizeiptr position) {
+	Patch32(e, position, e->size - (position + 4));
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: shader operations
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Determine the register holding the base address of a segment, loading
+ * it from the frame if it is not kept in a register.
+ */
+static GLuint SegmentBase(Emitter * e, GLuint segment) {
+	switch (segment) {
+	case InterpSegTemp:		return R12;
+	case InterpSegConstant:	return R13;
+	case InterpSegUniform:	return R14;
+	
+	case InterpSegAttrib:
+		if (e->type == GL_VERTEX_SHADER) {
+			return R15;
+		}
+		
+		break;
+		
+	case InterpSegVarying:
+		if (e->type == GL_FRAGMENT_SHADER) {
+			return R15;
+		}
+		
+		break;
+		
+	default:
+		;
+	}
+	
+	EmitRM(e, 0, 1, X86_LOAD, RAX, RBX, FRAME_SEGMENT + segment * sizeof(void *));
+	return RAX;
+}
+
+/**
+ * Load a source operand with swizzle and negation applied.
+ * 
+ * @param	e		the code emitter
+ * @param	operand	the operand to load
+ * @param	xmm		the target register
+ */
+static void EmitLoad(Emitter * e, const InterpOperand * operand, GLuint xmm) {
+	GLuint base = SegmentBase(e, operand->segment);
+	
+	if (operand->index) {
+		/* base += addr[index] * sizeof(Vec4f) */
+		EmitRM(e, 0, 1, X86_MOVSXD, RCX, RBX, 
+			   FRAME_ADDR + (operand->index - 1) * sizeof(GLint));
+		EmitRR(e, 0, 1, X86_SHIFT_IMM8, 4, RCX);
+		EmitByte(e, 4);
+		EmitRR(e, 0, 1, X86_ADD, RCX, base);
+		base = RCX;
+	}
+	
+	EmitRM(e, 0, 0, SSE_MOVUPS_LOAD, xmm, base, operand->offset * sizeof(GLfloat));
+	
+	if (operand->swizzle != IDENTITY_SWIZZLE) {
+		EmitSseImm(e, 0x66, SSE_PSHUFD, xmm, xmm, operand->swizzle);
+	}
+	
+	if (operand->negate) {
+		EmitRM(e, 0, 0, SSE_XORPS, xmm, RIP, POOL_SIGN);
+	}
+}
+
+/**
+ * Store the result in XMM0 into the destination operand of an instruction,
+ * applying saturation and write mask. Components that are masked out are
+ * not touched in memory.
+ */
+static void EmitStore(Emitter * e, const InterpInst * inst) {
+	GLuint base, index;
+	GLint disp = inst->dst.offset * sizeof(GLfloat);
+	
+	if (inst->saturate) {
+		EmitRM(e, 0, 0, SSE_MAXPS, 0, RIP, POOL_ZERO);
+		EmitRM(e, 0, 0, SSE_MINPS, 0, RIP, POOL_ONE);
+	}
+	
+	base = SegmentBase(e, inst->dst.segment);
+	
+	if (inst->mask == 0xf) {
+		EmitRM(e, 0, 0, SSE_MOVUPS_STORE, 0, base, disp);
+		return;
+	}
+	
+	for (index = 0; index < 4; ++index) {
+		if (inst->mask & (1 << index)) {
+			if (index) {
+				EmitSseImm(e, 0x66, SSE_PSHUFD, 1, 0, index);
+				EmitRM(e, 0xf3, 0, SSE_MOVUPS_STORE, 1, base, disp + index * sizeof(GLfloat));
+			} else {
+				EmitRM(e, 0xf3, 0, SSE_MOVUPS_STORE, 0, base, disp);
+			}
+		}
+	}
+}
+
+static void EmitLoadArgs(Emitter * e, const InterpInst * inst, GLsizei count) {
+	GLsizei index;
+	
+	for (index = 0; index < count; ++index) {
+		EmitLoad(e, &inst->src[index], index);
+	}
+}
+
+/**
+ * Horizontal sum of XMM0, replicated into all components; clobbers XMM1.
+ */
+static void EmitHorizontalAdd(Emitter * e) {
+	EmitRR(e, 0, 0, SSE_MOVAPS, 1, 0);
+	EmitSseImm(e, 0, SSE_SHUFPS, 1, 1, 0xb1);
+	EmitRR(e, 0, 0, SSE_ADDPS, 0, 1);
+	EmitRR(e, 0, 0, SSE_MOVAPS, 1, 0);
+	EmitSseImm(e, 0, SSE_SHUFPS, 1, 1, 0x4e);
+	EmitRR(e, 0, 0, SSE_ADDPS, 0, 1);
+}
+
+/**
+ * Round XMM0 towards negative infinity; clobbers XMM1 and XMM2. Values 
+ * outside of the integer range are not supported.
+ */
+static void EmitFloor(Emitter * e) {
+	EmitRR(e, 0xf3, 0, SSE_CVTDQ2PS, 1, 0);		/* cvttps2dq */
+	EmitRR(e, 0, 0, SSE_CVTDQ2PS, 1, 1);
+	EmitRR(e, 0, 0, SSE_MOVAPS, 2, 0);
+	EmitSseImm(e, 0, SSE_CMPPS, 2, 1, CMP_LT);
+	EmitRM(e, 0, 0, SSE_ANDPS, 2, RIP, POOL_ONE);
+	EmitRR(e, 0, 0, SSE_SUBPS, 1, 2);
+	EmitRR(e, 0, 0, SSE_MOVAPS, 0, 1);
+}
+
+/**
+ * Emit a comparison of src[0] and src[1] producing 1.0 or 0.0.
+ */
+static void EmitCompare(Emitter * e, const InterpInst * inst, GLubyte predicate, 
+						GLboolean swap) {
+	EmitLoadArgs(e, inst, 2);
+	
+	if (swap) {
+		EmitSseImm(e, 0, SSE_CMPPS, 1, 0, predicate);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 0, 1);
+	} else {
+		EmitSseImm(e, 0, SSE_CMPPS, 0, 1, predicate);
+	}
+	
+	EmitRM(e, 0, 0, SSE_ANDPS, 0, RIP, POOL_ONE);
+}
+
+/**
+ * Call a run-time helper function for an operation; the arguments have to
+ * be stored in the frame already, the result is returned in XMM0.
+ */
+static void EmitCall(Emitter * e, Helper helper, GLboolean units, GLuint param) {
+	EmitRM(e, 0, 1, X86_LEA, RDI, RBX, FRAME_RESULT);
+	EmitRM(e, 0, 1, X86_LEA, RSI, RBX, FRAME_ARG0);
+	EmitRM(e, 0, 1, X86_LEA, RDX, RBX, FRAME_ARG1);
+	
+	if (units) {
+		EmitRM(e, 0, 1, X86_LOAD, RCX, RBX, FRAME_UNITS);
+	} else {
+		EmitByte(e, 0xb8 + RCX);
+		EmitInt32(e, param);
+	}
+	
+	/* subroutine calls and loop counters do not maintain stack alignment */
+	EmitRR(e, 0, 1, X86_LOAD, RBP, RSP);
+	EmitRR(e, 0, 1, X86_ALU_IMM8, 4, RSP);
+	EmitByte(e, 0xf0);
+	EmitPrefix(e, 0, 1, 0, RAX);
+	EmitByte(e, 0xb8 + RAX);
+	EmitInt64(e, (size_t) helper);
+	EmitRR(e, 0, 0, X86_GROUP5, 2, RAX);
+	EmitRR(e, 0, 1, X86_LOAD, RSP, RBP);
+	
+	EmitRM(e, 0, 0, SSE_MOVUPS_LOAD, 0, RBX, FRAME_RESULT);
+}
+
+static void EmitHelper(Emitter * e, const InterpInst * inst, GLsizei args, 
+					   Helper helper, GLuint param) {
+	EmitLoad(e, &inst->src[0], 0);
+	EmitRM(e, 0, 0, SSE_MOVUPS_STORE, 0, RBX, FRAME_ARG0);
+	
+	if (args > 1) {
+		EmitLoad(e, &inst->src[1], 0);
+		EmitRM(e, 0, 0, SSE_MOVUPS_STORE, 0, RBX, FRAME_ARG1);
+	}
+	
+	EmitCall(e, helper, GL_FALSE, param);
+}
+
+/**
+ * Emit a texture access. XMM0 holds the final texture coordinates.
+ */
+static void EmitSample(Emitter * e, const InterpInst * inst) {
+	Helper helper;
+	
+	switch (inst->texture) {
+	case TextureTarget2D:	helper = HelperSample2D;	break;
+	case TextureTarget3D:	helper = HelperSample3D;	break;
+	default:				helper = HelperSampleCube;	break;
+	}
+	
+	EmitRM(e, 0, 0, SSE_MOVUPS_STORE, 0, RBX, FRAME_ARG0);
+	EmitLoad(e, &inst->src[1], 0);
+	EmitRM(e, 0, 0, SSE_MOVUPS_STORE, 0, RBX, FRAME_ARG1);
+	EmitCall(e, helper, GL_TRUE, 0);
+}
+
+/**
+ * Test the condition code register against the condition of an instruction;
+ * the zero flag is cleared if the test passes for any selected component.
+ */
+static void EmitTestCond(Emitter * e, const InterpInst * inst) {
+	EmitRM(e, 0, 0, SSE_MOVUPS_LOAD, 0, RBX, FRAME_CC);
+	
+	if (inst->select != IDENTITY_SWIZZLE) {
+		EmitSseImm(e, 0x66, SSE_PSHUFD, 0, 0, inst->select);
+	}
+	
+	EmitRR(e, 0, 0, SSE_XORPS, 1, 1);
+	EmitRR(e, 0, 0, SSE_XORPS, 2, 2);
+	
+	if (inst->cond & CondLT) {
+		EmitRR(e, 0, 0, SSE_MOVAPS, 3, 0);
+		EmitSseImm(e, 0, SSE_CMPPS, 3, 2, CMP_LT);
+		EmitRR(e, 0, 0, SSE_ORPS, 1, 3);
+	}
+	
+	if (inst->cond & CondEQ) {
+		EmitRR(e, 0, 0, SSE_MOVAPS, 3, 0);
+		EmitSseImm(e, 0, SSE_CMPPS, 3, 2, CMP_EQ);
+		EmitRR(e, 0, 0, SSE_ORPS, 1, 3);
+	}
+	
+	if (inst->cond & CondGT) {
+		EmitRR(e, 0, 0, SSE_MOVAPS, 3, 2);
+		EmitSseImm(e, 0, SSE_CMPPS, 3, 0, CMP_LT);
+		EmitRR(e, 0, 0, SSE_ORPS, 1, 3);
+	}
+	
+	EmitRR(e, 0, 0, SSE_MOVMSKPS, RAX, 1);
+	EmitRR(e, 0, 0, X86_TEST, RAX, RAX);
+}
+
+/**
+ * Start code that is only executed if the condition of the instruction
+ * holds.
+ * 
+ * @return	the position of the jump to patch, or -1 if the instruction is 
+ * 			unconditional
+ */
+static GLsizeiptr EmitBeginCond(Emitter * e, const InterpInst * inst) {
+	if (inst->cond == CondT) {
+		return -1;
+	}
+	
+	EmitTestCond(e, inst);
+	return EmitLocalJump(e, JCC_Z);
+}
+
+static void EmitEndCond(Emitter * e, GLsizeiptr position) {
+	if (position >= 0) {
+		EmitLocalTarget(e, position);
+	}
+}
+
+/**
+ * Emit the function prologue: save callee-saved registers, allocate the
+ * frame and load the segment base addresses from the execution context.
+ */
+static void EmitPrologue(Emitter * e) {
+	static const GLuint saved[] = { RBP, RBX, R12, R13, R14, R15 };
+	GLsizeiptr offsets[InterpSegCount];
+	GLsizeiptr units;
+	GLuint index;
+	
+	for (index = 0; index < GLES_ELEMENTSOF(saved); ++index) {
+		EmitPush(e, saved[index]);
+	}
+	
+	EmitRR(e, 0, 1, X86_ALU_IMM32, 5, RSP);
+	EmitInt32(e, FRAME_SIZE);
+	EmitRR(e, 0, 1, X86_LOAD, RBX, RSP);
+	
+	if (e->type == GL_VERTEX_SHADER) {
+		offsets[InterpSegConstant]	= offsetof(VertexContext, constant);
+		offsets[InterpSegUniform]	= offsetof(VertexContext, uniform);
+		offsets[InterpSegAttrib]	= offsetof(VertexContext, attrib);
+		offsets[InterpSegVarying]	= offsetof(VertexContext, varying);
+		offsets[InterpSegTemp]		= offsetof(VertexContext, temp);
+		offsets[InterpSegResult]	= offsetof(VertexContext, geometry);
+		units = offsetof(VertexContext, textureImageUnit);
+	} else {
+		offsets[InterpSegConstant]	= offsetof(FragContext, constant);
+		offsets[InterpSegUniform]	= offsetof(FragContext, uniform);
+		offsets[InterpSegAttrib]	= -1;
+		offsets[InterpSegVarying]	= offsetof(FragContext, varying);
+		offsets[InterpSegTemp]		= offsetof(FragContext, temp);
+		offsets[InterpSegResult]	= offsetof(FragContext, result);
+		units = offsetof(FragContext, textureImageUnit);
+	}
+	
+	for (index = 0; index < InterpSegSpecial; ++index) {
+		if (offsets[index] >= 0) {
+			EmitRM(e, 0, 1, X86_LOAD, RAX, RDI, offsets[index]);
+		} else {
+			EmitRR(e, 0, 0, X86_XOR, RAX, RAX);
+		}
+		
+		EmitRM(e, 0, 1, X86_STORE, RAX, RBX, FRAME_SEGMENT + index * sizeof(void *));
+	}
+	
+	/* special variables are addressed relative to the context */
+	EmitRM(e, 0, 1, X86_STORE, RDI, RBX, FRAME_SEGMENT + InterpSegSpecial * sizeof(void *));
+	
+	EmitRM(e, 0, 1, X86_LOAD, RAX, RDI, units);
+	EmitRM(e, 0, 1, X86_STORE, RAX, RBX, FRAME_UNITS);
+	
+	EmitRM(e, 0, 1, X86_LOAD, R12, RBX, FRAME_SEGMENT + InterpSegTemp * sizeof(void *));
+	EmitRM(e, 0, 1, X86_LOAD, R13, RBX, FRAME_SEGMENT + InterpSegConstant * sizeof(void *));
+	EmitRM(e, 0, 1, X86_LOAD, R14, RBX, FRAME_SEGMENT + InterpSegUniform * sizeof(void *));
+	EmitRM(e, 0, 1, X86_LOAD, R15, RBX, FRAME_SEGMENT + 
+		   (e->type == GL_VERTEX_SHADER ? InterpSegAttrib : InterpSegVarying) * sizeof(void *));
+}
+
+/**
+ * Emit the common exit code; EAX holds the return value.
+ */
+static void EmitEpilogue(Emitter * e, GLsizei exitTrue, GLsizei exitFalse) {
+	static const GLuint saved[] = { R15, R14, R13, R12, RBX, RBP };
+	GLuint index;
+	
+	e->labels[exitTrue] = e->size;
+	EmitByte(e, 0xb8 + RAX);
+	EmitInt32(e, GL_TRUE);
+	EmitByte(e, 0xeb);								/* jmp rel8 over xor */
+	EmitByte(e, 2);
+	
+	e->labels[exitFalse] = e->size;
+	EmitRR(e, 0, 0, X86_XOR, RAX, RAX);
+	
+	EmitRM(e, 0, 1, X86_LEA, RSP, RBX, FRAME_SIZE);
+	
+	for (index = 0; index < GLES_ELEMENTSOF(saved); ++index) {
+		EmitPop(e, saved[index]);
+	}
+	
+	EmitByte(e, 0xc3);
+}
+
+static void EmitConstantPool(Emitter * e) {
+	GLuint mask, index;
+	
+	for (mask = 0; mask < 16; ++mask) {
+		for (index = 0; index < 4; ++index) {
+			EmitInt32(e, (mask & (1 << index)) ? ~0 : 0);
+		}
+	}
+	
+	for (index = 0; index < 4; ++index) EmitInt32(e, 0x80000000);
+	for (index = 0; index < 4; ++index) EmitInt32(e, 0x7fffffff);
+	for (index = 0; index < 4; ++index) EmitInt32(e, 0x3f800000);
+	for (index = 0; index < 4; ++index) EmitInt32(e, 0);
+}
+
+/**
+ * Translate a single interpreter instruction into native code.
+ * 
+ * @param	e			the code emitter
+ * @param	inst		the instruction to translate
+ * @param	inMain		GL_TRUE if the instruction is part of the main function
+ * @param	loopDepth	number of loop counters pushed onto the stack
+ * @param	exitTrue	label of exit code returning GL_TRUE
+ * @param	exitFalse	label of exit code returning GL_FALSE
+ */
+static void EmitInst(Emitter * e, const InterpInst * inst, GLboolean inMain, 
+					 GLsizei loopDepth, GLsizei exitTrue, GLsizei exitFalse) {
+	GLsizeiptr skip;
+	
+	switch (inst->op) {
+	case InterpOpABS:
+		EmitLoadArgs(e, inst, 1);
+		EmitRM(e, 0, 0, SSE_ANDPS, 0, RIP, POOL_ABS);
+		break;
+		
+	case InterpOpADD:
+		EmitLoadArgs(e, inst, 2);
+		EmitRR(e, 0, 0, SSE_ADDPS, 0, 1);
+		break;
+		
+	case InterpOpARL:
+		EmitLoadArgs(e, inst, 1);
+		EmitFloor(e);
+		EmitRR(e, 0xf3, 0, SSE_CVTTSS2SI, RAX, 0);
+		EmitRM(e, 0, 0, X86_STORE, RAX, RBX, FRAME_ADDR + inst->target * sizeof(GLint));
+		return;
+		
+	case InterpOpCMP:
+		EmitLoadArgs(e, inst, 3);
+		EmitRR(e, 0, 0, SSE_XORPS, 3, 3);
+		EmitSseImm(e, 0, SSE_CMPPS, 0, 3, CMP_LT);
+		EmitRR(e, 0, 0, SSE_ANDPS, 1, 0);
+		EmitRR(e, 0, 0, SSE_ANDNPS, 0, 2);
+		EmitRR(e, 0, 0, SSE_ORPS, 0, 1);
+		break;
+		
+	case InterpOpCOS:	EmitHelper(e, inst, 1, HelperCOS, inst->precision);	break;
+	case InterpOpSIN:	EmitHelper(e, inst, 1, HelperSIN, inst->precision);	break;
+	case InterpOpSCS:	EmitHelper(e, inst, 1, HelperSCS, inst->precision);	break;
+	case InterpOpEX2:	EmitHelper(e, inst, 1, HelperEX2, inst->precision);	break;
+	case InterpOpLG2:	EmitHelper(e, inst, 1, HelperLG2, inst->precision);	break;
+	case InterpOpEXP:	EmitHelper(e, inst, 1, HelperEXP, inst->precision);	break;
+	case InterpOpLOG:	EmitHelper(e, inst, 1, HelperLOG, inst->precision);	break;
+	case InterpOpPOW:	EmitHelper(e, inst, 2, HelperPOW, inst->precision);	break;
+	case InterpOpDST:	EmitHelper(e, inst, 2, HelperDST, 0);	break;
+	
+	case InterpOpSWZ:
+		EmitHelper(e, inst, 1, HelperSWZ, inst->target);
+		break;
+		
+	case InterpOpDP2:
+	case InterpOpDP3:
+	case InterpOpDP4:
+		EmitLoadArgs(e, inst, 2);
+		EmitRR(e, 0, 0, SSE_MULPS, 0, 1);
+		
+		if (inst->op != InterpOpDP4) {
+			EmitRM(e, 0, 0, SSE_ANDPS, 0, RIP, 
+				   POOL_MASK + (inst->op == InterpOpDP2 ? 3 : 7) * sizeof(Vec4f));
+		}
+		
+		EmitHorizontalAdd(e);
+		break;
+		
+	case InterpOpDPH:
+		EmitLoadArgs(e, inst, 2);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 2, 1);
+		EmitRR(e, 0, 0, SSE_MULPS, 0, 1);
+		EmitRM(e, 0, 0, SSE_ANDPS, 0, RIP, POOL_MASK + 7 * sizeof(Vec4f));
+		EmitRM(e, 0, 0, SSE_ANDPS, 2, RIP, POOL_MASK + 8 * sizeof(Vec4f));
+		EmitRR(e, 0, 0, SSE_ADDPS, 0, 2);
+		EmitHorizontalAdd(e);
+		break;
+		
+	case InterpOpFLR:
+		EmitLoadArgs(e, inst, 1);
+		EmitFloor(e);
+		break;
+		
+	case InterpOpFRC:
+		EmitLoadArgs(e, inst, 1);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 3, 0);
+		EmitFloor(e);
+		EmitRR(e, 0, 0, SSE_SUBPS, 3, 0);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 0, 3);
+		break;
+		
+	case InterpOpLRP:
+		/* a * b + (1 - a) * c = a * (b - c) + c */
+		EmitLoadArgs(e, inst, 3);
+		EmitRR(e, 0, 0, SSE_SUBPS, 1, 2);
+		EmitRR(e, 0, 0, SSE_MULPS, 0, 1);
+		EmitRR(e, 0, 0, SSE_ADDPS, 0, 2);
+		break;
+		
+	case InterpOpMAD:
+		EmitLoadArgs(e, inst, 3);
+		EmitRR(e, 0, 0, SSE_MULPS, 0, 1);
+		EmitRR(e, 0, 0, SSE_ADDPS, 0, 2);
+		break;
+		
+	case InterpOpMAX:
+		EmitLoadArgs(e, inst, 2);
+		EmitRR(e, 0, 0, SSE_MAXPS, 0, 1);
+		break;
+		
+	case InterpOpMIN:
+		EmitLoadArgs(e, inst, 2);
+		EmitRR(e, 0, 0, SSE_MINPS, 0, 1);
+		break;
+		
+	case InterpOpMOV:
+		EmitLoadArgs(e, inst, 1);
+		break;
+		
+	case InterpOpMUL:
+		EmitLoadArgs(e, inst, 2);
+		EmitRR(e, 0, 0, SSE_MULPS, 0, 1);
+		break;
+		
+	case InterpOpRCP:
+		EmitLoadArgs(e, inst, 1);
+		EmitRM(e, 0xf3, 0, SSE_MOVUPS_LOAD, 1, RIP, POOL_ONE);
+		EmitRR(e, 0xf3, 0, SSE_DIVPS, 1, 0);
+		EmitSseImm(e, 0, SSE_SHUFPS, 1, 1, 0);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 0, 1);
+		break;
+		
+	case InterpOpRSQ:
+		EmitLoadArgs(e, inst, 1);
+		EmitRM(e, 0, 0, SSE_ANDPS, 0, RIP, POOL_ABS);
+
+		if (inst->precision == PrecisionLow || inst->precision == PrecisionMedium) {
+			/* the hardware estimate is sufficient for reduced precision	*/
+			EmitRR(e, 0xf3, 0, SSE_RSQRTSS, 0, 0);
+			EmitSseImm(e, 0, SSE_SHUFPS, 0, 0, 0);
+			break;
+		}
+
+		EmitRR(e, 0xf3, 0, SSE_SQRTSS, 0, 0);
+		EmitRM(e, 0xf3, 0, SSE_MOVUPS_LOAD, 1, RIP, POOL_ONE);
+		EmitRR(e, 0xf3, 0, SSE_DIVPS, 1, 0);
+		EmitSseImm(e, 0, SSE_SHUFPS, 1, 1, 0);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 0, 1);
+		break;
+		
+	case InterpOpSEQ:	EmitCompare(e, inst, CMP_EQ, GL_FALSE);		break;
+	case InterpOpSNE:	EmitCompare(e, inst, CMP_NEQ, GL_FALSE);	break;
+	case InterpOpSLT:	EmitCompare(e, inst, CMP_LT, GL_FALSE);		break;
+	case InterpOpSLE:	EmitCompare(e, inst, CMP_LE, GL_FALSE);		break;
+	case InterpOpSGT:	EmitCompare(e, inst, CMP_LT, GL_TRUE);		break;
+	case InterpOpSGE:	EmitCompare(e, inst, CMP_LE, GL_TRUE);		break;
+	
+	case InterpOpDDX:
+	case InterpOpDDY:
+		/* single pixels have no neighbors to take differences with */
+	case InterpOpSFL:
+		EmitRR(e, 0, 0, SSE_XORPS, 0, 0);
+		break;
+		
+	case InterpOpSTR:
+		EmitRM(e, 0, 0, SSE_MOVUPS_LOAD, 0, RIP, POOL_ONE);
+		break;
+		
+	case InterpOpSSG:
+		/* (0 < a) - (a < 0) */
+		EmitLoadArgs(e, inst, 1);
+		EmitRR(e, 0, 0, SSE_XORPS, 1, 1);
+		EmitRR(e, 0, 0, SSE_XORPS, 2, 2);
+		EmitSseImm(e, 0, SSE_CMPPS, 1, 0, CMP_LT);
+		EmitRM(e, 0, 0, SSE_ANDPS, 1, RIP, POOL_ONE);
+		EmitSseImm(e, 0, SSE_CMPPS, 0, 2, CMP_LT);
+		EmitRM(e, 0, 0, SSE_ANDPS, 0, RIP, POOL_ONE);
+		EmitRR(e, 0, 0, SSE_SUBPS, 1, 0);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 0, 1);
+		break;
+		
+	case InterpOpSUB:
+		EmitLoadArgs(e, inst, 2);
+		EmitRR(e, 0, 0, SSE_SUBPS, 0, 1);
+		break;
+		
+	case InterpOpXPD:
+		/* a.yzx * b.zxy - a.zxy * b.yzx */
+		EmitLoadArgs(e, inst, 2);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 2, 0);
+		EmitSseImm(e, 0, SSE_SHUFPS, 2, 2, 0xc9);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 3, 1);
+		EmitSseImm(e, 0, SSE_SHUFPS, 3, 3, 0xd2);
+		EmitRR(e, 0, 0, SSE_MULPS, 2, 3);
+		EmitSseImm(e, 0, SSE_SHUFPS, 0, 0, 0xd2);
+		EmitSseImm(e, 0, SSE_SHUFPS, 1, 1, 0xc9);
+		EmitRR(e, 0, 0, SSE_MULPS, 0, 1);
+		EmitRR(e, 0, 0, SSE_SUBPS, 2, 0);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 0, 2);
+		EmitRM(e, 0, 0, SSE_ANDPS, 0, RIP, POOL_MASK + 7 * sizeof(Vec4f));
+		break;
+		
+	case InterpOpTEX:
+		EmitLoadArgs(e, inst, 1);
+		EmitRM(e, 0, 0, SSE_ANDPS, 0, RIP, POOL_MASK + 7 * sizeof(Vec4f));
+		EmitSample(e, inst);
+		break;
+		
+	case InterpOpTXB:
+	case InterpOpTXL:
+		/* coordinate w-component carries the lod (bias) */
+		EmitLoadArgs(e, inst, 1);
+		EmitSample(e, inst);
+		break;
+		
+	case InterpOpTXP:
+		EmitLoadArgs(e, inst, 1);
+		EmitRR(e, 0, 0, SSE_MOVAPS, 1, 0);
+		EmitSseImm(e, 0, SSE_SHUFPS, 1, 1, 0xff);
+		EmitRR(e, 0, 0, SSE_DIVPS, 0, 1);
+		EmitRM(e, 0, 0, SSE_ANDPS, 0, RIP, POOL_MASK + 7 * sizeof(Vec4f));
+		EmitSample(e, inst);
+		break;
+		
+	case InterpOpSCC:
+		EmitLoadArgs(e, inst, 1);
+		EmitRM(e, 0, 0, SSE_MOVUPS_STORE, 0, RBX, FRAME_CC);
+		return;
+		
+	case InterpOpIF:
+		if (inst->cond == CondT) {
+			return;
+		} else if (inst->cond == CondF) {
+			EmitJump(e, 0xe9, inst->target);
+		} else {
+			EmitTestCond(e, inst);
+			EmitJump(e, 0x0f00 | JCC_Z, inst->target);
+		}
+		
+		return;
+		
+	case InterpOpJMP:
+		EmitJump(e, 0xe9, inst->target);
+		return;
+		
+	case InterpOpREP:
+		EmitLoadArgs(e, inst, 1);
+		EmitRR(e, 0xf3, 0, SSE_CVTTSS2SI, RAX, 0);
+		EmitRR(e, 0, 0, X86_TEST, RAX, RAX);
+		EmitJump(e, 0x0f00 | JCC_LE, inst->target);
+		EmitPush(e, RAX);
+		return;
+		
+	case InterpOpENDREP:
+		EmitRM(e, 0, 1, X86_GROUP5, 1, RSP, 0);
+		EmitJump(e, 0x0f00 | JCC_NZ, inst->target);
+		EmitAddRsp(e, sizeof(void *));
+		return;
+		
+	case InterpOpBRK:
+		if (inst->cond != CondF) {
+			skip = EmitBeginCond(e, inst);
+			EmitAddRsp(e, sizeof(void *));
+			EmitJump(e, 0xe9, inst->target);
+			EmitEndCond(e, skip);
+		}
+		
+		return;
+		
+	case InterpOpCAL:
+		if (inst->cond != CondF) {
+			skip = EmitBeginCond(e, inst);
+			EmitJump(e, 0xe8, inst->target);
+			EmitEndCond(e, skip);
+		}
+		
+		return;
+		
+	case InterpOpRET:
+		if (inst->cond != CondF) {
+			skip = EmitBeginCond(e, inst);
+			
+			if (inMain) {
+				EmitJump(e, 0xe9, exitTrue);
+			} else {
+				EmitAddRsp(e, loopDepth * sizeof(void *));
+				EmitByte(e, 0xc3);
+			}
+			
+			EmitEndCond(e, skip);
+		}
+		
+		return;
+		
+	case InterpOpKIL:
+		if (inst->cond != CondF) {
+			skip = EmitBeginCond(e, inst);
+			EmitJump(e, 0xe9, exitFalse);
+			EmitEndCond(e, skip);
+		}
+		
+		return;
+		
+	case InterpOpEND:
+		EmitJump(e, 0xe9, exitTrue);
+		return;
+		
+	default:
+		GLES_ASSERT(GL_FALSE);
+		return;
+	}
+	
+	EmitStore(e, inst);
+}
+
+/*
+** --------------------------------------------------------------------------
+** Internal functions
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Translate the interpreter code of a shader binary into native x86-64 code
+ * using SSE2 instructions. On success, the entry point of the binary is
+ * replaced by the generated function; otherwise the binary continues to use
+ * the interpreter.
+ *
+ * Subroutines are executed using native call and return instructions, 
+ * loop counters are kept on the machine stack. Transcendental functions and
+ * texture accesses are delegated to C helper functions.
+ *
+ * @param	linker	reference to linker object
+ * @param	binary	the shader binary holding the interpreter code
+ * @param	type	GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ *
+ * @return	GL_TRUE if native code has been generated
+ */
+GLboolean GlesX86Generate(Linker * linker, ShaderBinary * binary, GLenum type) {
+	const InterpInst * code = (const InterpInst *) binary->code.base;
+	GLsizei numInsts = binary->code.size;
+	GLsizei exitTrue = numInsts, exitFalse = numInsts + 1;
+	GLsizei mainEnd = numInsts, loopDepth = 0, index;
+	GLubyte * native;
+	Emitter e;
+
+	GlesMemset(&e, 0, sizeof e);
+	e.type = type;
+	e.capacity = POOL_SIZE + 256 + numInsts * 64;
+	e.code = GlesMalloc(e.capacity);
+	e.labels = GlesMemoryPoolAllocate(linker->tempMemory,
+									  sizeof(GLsizeiptr) * (numInsts + 2));
+	e.fixups = GlesMemoryPoolAllocate(linker->tempMemory,
+									  sizeof(Fixup) * numInsts);
+
+	if (!e.code) {
+		return GL_FALSE;
+	}
+
+	/* subroutines follow the main function */
+	
+	for (index = 0; index < numInsts; ++index) {
+		if (code[index].op == InterpOpCAL && code[index].target < mainEnd) {
+			mainEnd = code[index].target;
+		}
+	}
+	
+	EmitConstantPool(&e);
+	EmitPrologue(&e);
+
+	for (index = 0; index < numInsts; ++index) {
+		e.labels[index] = e.size;
+		EmitInst(&e, &code[index], index < mainEnd, loopDepth, exitTrue, exitFalse);
+		
+		if (code[index].op == InterpOpREP) {
+			++loopDepth;
+		} else if (code[index].op == InterpOpENDREP) {
+			--loopDepth;
+		}
+	}
+	
+	EmitEpilogue(&e, exitTrue, exitFalse);
+	
+	for (index = 0; index < e.numFixups; ++index) {
+		Patch32(&e, e.fixups[index].position, 
+				e.labels[e.fixups[index].target] - (e.fixups[index].position + 4));
+	}
+	
+	if (e.error || !(native = GlesMallocExecutable(e.size))) {
+		GlesFree(e.code);
+		return GL_FALSE;
+	}
+	
+	GlesMemcpy(native, e.code, e.size);
+	GlesFree(e.code);
+	
+	if (!GlesProtectExecutable(native, e.size)) {
+		GlesFreeExecutable(native, e.size);
+		return GL_FALSE;
+	}
+	
+	binary->native = native;
+	binary->nativeSize = e.size;
+	binary->entry = native + POOL_SIZE;
+	
+	return GL_TRUE;
+}
+
+#endif /* GLES_JIT_X86_64 */
@@ -101,8 +101,17 @@
 #define GLES_MAX_VERTEX_QUEUE	12		/* size of processed vertices queue	*/
 										/* should be multiple of 2 and 3	*/
 
+#define GLES_MAX_TRANSFORM_VERTICES	64	/* size of post-transform buffer	*/
+										/* should be a power of 2			*/
+
 #define GLES_RASTER_BLOCK_SIZE	8		/* block size used in rasterizer	*/
 
+#define GLES_GUARD_BAND			512		/* pixels beyond viewport before	*/
+										/* primitives are clipped; the		*/
+										/* rasterizer sets up edges in 64	*/
+										/* bits, as products of 28.4 window	*/
+										/* coordinates exceed 32 bits		*/
+
 #define GLES_LOG_BLOCK_SIZE		1024	/* number of characters per log blk	*/
 
 #define GLES_MAX_PREPROC_MACROS 128		/* storage for 100 macros			*/
@@ -112,10 +121,73 @@
 #define GLES_PREPROC_SYMBOL_HASH 		123	/* preprocessor hash table size	*/
 #define GLES_MAX_PREPROC_PARAMS			16	/* max. macro parameters		*/
 
-#define GLES_SYMBOL_HASH 23				/* scope hash table size			*/
-#define GLES_CONSTANT_HASH 23			/* const. table hash table size		*/
+#define GLES_SYMBOL_HASH 23				/* initial scope hash table size	*/
+#define GLES_CONSTANT_HASH 23			/* initial const. table index size	*/
+#define GLES_NAME_HASH	127				/* initial identifier table size	*/
 
 #define GLES_MAX_FUNCTION_DEPTH	16		/* nesting limit for function calls	*/
+
+#define GLES_MAX_OPTIMIZER_ROUNDS	4	/* repetitions of IL optimizer steps	*/
+#define GLES_MAX_EXPANDED_SIZE	512		/* IL size limit for inline/unroll		*/
+
+#define GLES_MAX_PROGRAM_VARIANTS	4	/* specialized executables per program	*/
+#define GLES_PROGRAM_VARIANT_COST	64	/* churn added per specialized link		*/
+#define GLES_PROGRAM_VARIANT_CHURN	256	/* churn limit for specialized links	*/
+
+#ifndef GLES_COMPILE_THREADS			/* background compile and link		*/
+										/* threads, limited by processor	*/
+#	define GLES_COMPILE_THREADS	4		/* count; 0 for calling thread only	*/
+#endif
+
+#define GLES_TILE_SIZE			64		/* edge length of rasterizer tiles	*/
+#define GLES_MAX_BINNED_TRIANGLES	256	/* triangles binned before flush	*/
+										/* must not exceed 65536			*/
+
+#ifndef GLES_RASTER_THREADS				/* tile rasterization threads incl.	*/
+										/* calling thread, limited by proc.	*/
+#	define GLES_RASTER_THREADS	4		/* count; 0 to rasterize unbinned	*/
+#endif
+
+/*
+** --------------------------------------------------------------------------
+** Shader Execution
+** --------------------------------------------------------------------------
+*/
+
+#define GLES_MAX_ADDRESS_REGISTERS	16	/* address registers per shader		*/
+#define GLES_MAX_LOOP_DEPTH			8	/* nesting limit for REP blocks		*/
+#define GLES_MAX_IF_DEPTH			16	/* nesting limit for batched IFs	*/
+#define GLES_SHADER_BATCH			4	/* SoA batch size, multiple of 2x2 quad */
+
+#ifndef GLES_INTERP_THREADED
+#	ifdef __GNUC__
+#		define GLES_INTERP_THREADED	1	/* use computed goto for dispatch	*/
+#	else
+#		define GLES_INTERP_THREADED	0	/* use switch statement for dispatch*/
+#	endif
+#endif
+
+#ifndef GLES_JIT_X86_64
+#	if defined(__GNUC__) && defined(__x86_64__) && !defined(_WIN32)
+#		define GLES_JIT_X86_64		1	/* generate native x86-64 code		*/
+#	else
+#		define GLES_JIT_X86_64		0	/* interpret shader code only		*/
+#	endif
+#endif
+
+#ifndef GLES_MATH_SSE2
+#	if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#		define GLES_MATH_SSE2		1	/* SSE2 math and color packing		*/
+#	else
+#		define GLES_MATH_SSE2		0	/* portable C implementation		*/
+#	endif
+#endif
+
+#ifndef GLES_PROGRAM_CACHE_VARIABLE		/* environment variable naming the	*/
+										/* program binary cache directory	*/
+#	define GLES_PROGRAM_CACHE_VARIABLE	"GLES_PROGRAM_CACHE"
+#endif
+
 /*
 ** --------------------------------------------------------------------------
 ** Internal Precision Formats
@@ -161,6 +233,7 @@
 								"OES_stencil1 OES_stencil4 OES_stencil8" \
 								"OES_shader_source OES_mapbuffer "\
 								"OES_texture_3D "\
+								"OES_get_program_binary "\
 								"VIN_shader_intermediate"
 
 #endif /* ndef GLES_CONFIG_H */
@@ -110,3 +110,58 @@ vec4 textureCube (samplerCube sampler, vec3 coord, float bias) {
 }
 
 
+/*
+** --------------------------------------------------------------------------
+** 8.8 Fragment Processing Functions (OES_standard_derivatives)
+** --------------------------------------------------------------------------
+*/
+
+float dFdx(float p) {
+	__ddx	__retval, p
+}
+
+vec2  dFdx(vec2  p) {
+	__ddx	__retval, p
+}
+
+vec3  dFdx(vec3  p) {
+	__ddx	__retval, p
+}
+
+vec4  dFdx(vec4  p) {
+	__ddx	__retval, p
+}
+
+float dFdy(float p) {
+	__ddy	__retval, p
+}
+
+vec2  dFdy(vec2  p) {
+	__ddy	__retval, p
+}
+
+vec3  dFdy(vec3  p) {
+	__ddy	__retval, p
+}
+
+vec4  dFdy(vec4  p) {
+	__ddy	__retval, p
+}
+
+float fwidth(float p) {
+	return abs(dFdx(p)) + abs(dFdy(p));
+}
+
+vec2  fwidth(vec2  p) {
+	return abs(dFdx(p)) + abs(dFdy(p));
+}
+
+vec3  fwidth(vec3  p) {
+	return abs(dFdx(p)) + abs(dFdy(p));
+}
+
+vec4  fwidth(vec4  p) {
+	return abs(dFdx(p)) + abs(dFdy(p));
+}
+
+
@@ -173,20 +173,63 @@ const char BuiltinInitFragment[] =
 ** --------------------------------------------------------------------------
 */
 
-static GLboolean PrepareCompiler(Compiler * compiler, Shader * shader) {
+/**
+ * Initialize the parser state for a new translation unit.
+ * 
+ * @param	compiler	reference to compiler object
+ * @param	scope		the global scope of the translation unit
+ * @param	program		the IL program receiving the generated code
+ */
+static void PrepareParser(Compiler * compiler, Scope * scope, 
+						  ShaderProgram * program) {
+	compiler->globalScope = 
+	compiler->currentScope = scope;
 	
+	compiler->generator.result = program;
+	compiler->generator.currentList = &program->blocks;
+	compiler->generator.instructionCount = 0;
+	GlesCreateBlock(&compiler->generator);
+	
+	compiler->constExpression = GL_FALSE;
+	compiler->currentLoop = NULL;
+	compiler->structSpecifier = GL_FALSE;
+}
+
+/**
+ * Compile the builtin functions and variables for the type of shader being
+ * compiled, unless this has happened before. Symbols, types and IL of the
+ * builtins are allocated from a memory pool that is retained until the 
+ * compiler is destroyed.
+ * 
+ * In case of an error the tokenizer remains prepared and the memory pool
+ * of the incomplete builtins is released by CleanupCompiler().
+ * 
+ * @param	compiler	reference to compiler object
+ * @param	builtins	the builtins for the type of shader being compiled
+ * 
+ * @return	GL_TRUE if the builtins are available
+ */
+static GLboolean PrepareBuiltins(Compiler * compiler, Builtins * builtins) {
+	
+	static char noSource[] = "";
 	const char * initStrings[4];
 	GLsizei initArgs;
+	Shader source;
 	
-	compiler->shader = shader;
+	if (builtins->scope) {
+		return GL_TRUE;
+	}
 	
-	compiler->exprMemory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &compiler->allocationHandler);
-	compiler->moduleMemory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &compiler->allocationHandler);
-	compiler->resultMemory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &compiler->allocationHandler);
+	builtins->memory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &compiler->allocationHandler);
+	
+	if (!builtins->memory) {
+		GlesCompileError(compiler, ErrI0001);
+		return GL_FALSE;
+	}
 	
 	initArgs = 0;
 	
-	switch (shader->type) {
+	switch (compiler->shader->type) {
 	case GL_VERTEX_SHADER:	 initStrings[initArgs++] = BuiltinInitVertex;	break;
 	case GL_FRAGMENT_SHADER: initStrings[initArgs++] = BuiltinInitFragment;	break;
 	default:				 ;
@@ -194,7 +237,7 @@ static GLboolean PrepareCompiler(Compiler * compiler, Shader * shader) {
 	
 	initStrings[initArgs++] = BuiltinCommon;
 
-	switch (shader->type) {
+	switch (compiler->shader->type) {
 	case GL_VERTEX_SHADER:	 initStrings[initArgs++] = BuiltinVertex;	break;
 	case GL_FRAGMENT_SHADER: initStrings[initArgs++] = BuiltinFragment;	break;
 	default:				 ;
@@ -202,36 +245,135 @@ static GLboolean PrepareCompiler(Compiler * compiler, Shader * shader) {
 	
 	initStrings[initArgs] = NULL;
 
-	GlesPrepareTokenizer(compiler->tokenizer, shader, compiler->moduleMemory,
-		initArgs, initStrings);
+	/* the builtin sources form the complete translation unit */
+	GlesMemset(&source, 0, sizeof(Shader));
+	source.type = compiler->shader->type;
+	source.text = noSource;
 	
-	compiler->globalScope = 
-	compiler->currentScope = GlesMemoryPoolAllocate(compiler->moduleMemory, sizeof(Scope));
+	/* anything but expression storage becomes part of the builtins */
+	compiler->moduleMemory = builtins->memory;
+	compiler->resultMemory = builtins->memory;
+	compiler->names = builtins->names = 
+		GlesNameTableCreate(builtins->memory, NULL);
+	
+	GlesPrepareTokenizer(compiler->tokenizer, &source, builtins->memory,
+		initArgs, initStrings);
 	
+	PrepareParser(compiler, 
+				  GlesMemoryPoolAllocate(builtins->memory, sizeof(Scope)),
+				  GlesCreateShaderProgram(builtins->memory));
 	compiler->nextTempId = 0;
 	
-	compiler->generator.result = GlesCreateShaderProgram(compiler->resultMemory);
-	compiler->generator.currentList = &compiler->generator.result->blocks;
-	compiler->generator.instructionCount = 0;
-	GlesCreateBlock(&compiler->generator);
+	if (!GlesParseTranslationUnit(compiler)) {
+		return GL_FALSE;
+	}
 	
-	compiler->constExpression = GL_FALSE;
-	compiler->currentLoop = NULL;
-	compiler->structSpecifier = GL_FALSE;
+	GlesCleanupTokenizer(compiler->tokenizer);
+	
+	compiler->moduleMemory = NULL;
+	compiler->resultMemory = NULL;
+	
+	builtins->scope = compiler->globalScope;
+	builtins->program = compiler->generator.result;
+	builtins->nextTempId = compiler->nextTempId;
+	
+	return GL_TRUE;
+}
+
+/**
+ * Release the memory of builtins whose compilation has failed.
+ * 
+ * @param	compiler	reference to compiler object
+ * @param	builtins	the builtins to check
+ */
+static void ReleaseIncompleteBuiltins(Compiler * compiler, Builtins * builtins) {
+	
+	if (!builtins->memory || builtins->scope) {
+		return;
+	}
+	
+	if (compiler->moduleMemory == builtins->memory) {
+		compiler->moduleMemory = NULL;
+	}
+	
+	if (compiler->resultMemory == builtins->memory) {
+		compiler->resultMemory = NULL;
+	}
+	
+	GlesMemoryPoolDestroy(builtins->memory);
+	builtins->memory = NULL;
+	builtins->names = NULL;
+}
+
+/**
+ * Determine the builtins for a type of shader.
+ * 
+ * @param	compiler	reference to compiler object
+ * @param	type		GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ * 
+ * @return	the builtins for the shader type
+ */
+static Builtins * GetBuiltins(Compiler * compiler, GLenum type) {
+	return type == GL_VERTEX_SHADER ? 
+		&compiler->vertexBuiltins : &compiler->fragmentBuiltins;
+}
+
+/**
+ * Obtain a working memory pool of the compiler. Pools are retained across
+ * compilations and cleared in between, such that compiling a sequence of
+ * shaders does not return memory to the heap only to request it again.
+ * 
+ * @param	compiler	the compiler requiring the pool
+ * @param	pool		reference to the retained pool
+ * 
+ * @return	the memory pool to use
+ */
+static MemoryPool * ReusePool(Compiler * compiler, MemoryPool ** pool) {
+	if (!*pool) {
+		*pool = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &compiler->allocationHandler);
+	}
+	
+	return *pool;
+}
+
+static GLboolean PrepareCompiler(Compiler * compiler, Shader * shader) {
+	
+	Builtins * builtins = GetBuiltins(compiler, shader->type);
+	
+	compiler->shader = shader;
 	
+	compiler->exprMemory = ReusePool(compiler, &compiler->exprPool);
+
 #if GLES_DEBUG			
 	GlesLogInit(&compiler->preprocLog);
 #endif /* GLES_DEBUG */
 
 	GlesLogInit(&compiler->ilLog);
 
-	if (shader->il) {
-		shader->il = NULL;
-		shader->size = 0;
+	GLES_ASSERT(!shader->il && !shader->binary);
+	
+	if (!PrepareBuiltins(compiler, builtins)) {
+		return GL_FALSE;
 	}
 	
+	compiler->moduleMemory = ReusePool(compiler, &compiler->modulePool);
+	compiler->resultMemory = ReusePool(compiler, &compiler->resultPool);
+	
+	/* identifiers of the builtins are shared, all others released */
+	compiler->names = GlesNameTableCreate(compiler->moduleMemory, builtins->names);
+	
+	GlesPrepareTokenizer(compiler->tokenizer, shader, compiler->moduleMemory,
+		0, NULL);
+	
+	/* the shader is nested within the builtin scope and program */
+	PrepareParser(compiler, 
+				  GlesScopeCreate(compiler->moduleMemory, builtins->scope),
+				  GlesExtendShaderProgram(compiler->resultMemory, builtins->program));
+	compiler->nextTempId = builtins->nextTempId;
+	
 	compiler->pragmaDebug = GL_FALSE;
-	compiler->pragmaOptimize = GL_TRUE;
+	compiler->pragmaOptimize = OptimizeAll;
+	compiler->pragmaSpecialize = NULL;
 	
 	return GL_TRUE;
 }
@@ -240,10 +382,15 @@ static void SetSymbolFunctionFlags(Compiler * compiler, GLuint flags) {
 	GLsizei index;
 	Symbol * symbol;
 
-	for (index = 0; index < GLES_SYMBOL_HASH; ++index) {
-		for (symbol = compiler->globalScope->buckets[index]; symbol; symbol = symbol->base.next) {
-			if (symbol->base.qualifier == QualifierFunction) {
-				symbol->base.flags = flags;
+	Scope * scope;
+
+	/* builtin functions are part of the enclosing scope */
+	for (scope = compiler->globalScope; scope; scope = scope->parent) {
+		for (index = 0; index < scope->numBuckets; ++index) {
+			for (symbol = scope->buckets[index]; symbol; symbol = symbol->base.next) {
+				if (symbol->base.qualifier == QualifierFunction) {
+					symbol->base.flags = flags;
+				}
 			}
 		}
 	}
@@ -295,7 +442,7 @@ static GLboolean ProcessFunction(Compiler * compiler, Symbol * function,
 
 		block = function->function.body.head;
 		last = function->function.body.tail;
-		GlesInsertBlockList(&compiler->generator, &function->function.body);
+		GlesAppendBlockList(&compiler->generator, &function->function.body);
 		
 		/* scan for called functions and call recursively */
 		
@@ -342,7 +489,9 @@ static GLboolean AppendUsedFunctions(Compiler * compiler, Symbol * symbolMain) {
 }
 
 static GLboolean AllFunctionsDefined(Compiler * compiler) {
-	Symbol * symbolMain = GlesSymbolFind(compiler->globalScope, "main", 4, ~0);
+	const char * nameMain = GlesNameFind(compiler->names, "main", 4, ~0);
+	Symbol * symbolMain = 
+		nameMain ? GlesSymbolFind(compiler->globalScope, nameMain, ~0) : NULL;
 	
 	if (!symbolMain 													||
 		symbolMain->base.qualifier != QualifierFunction 				||
@@ -357,6 +506,31 @@ static GLboolean AllFunctionsDefined(Compiler * compiler) {
 	return AppendUsedFunctions(compiler, symbolMain);
 }
 
+/**
+ * Flag the uniform variables named by #pragma specialize, such that the
+ * linker can fold their values into specialized executables. Names that
+ * do not denote a uniform declared by the shader itself are ignored.
+ * 
+ * @param	compiler	reference to compiler object
+ */
+static void MarkSpecializedUniforms(Compiler * compiler) {
+	/* the builtin variables form the tail of the parameter list */
+	ProgVar * builtinParams = 
+		GetBuiltins(compiler, compiler->shader->type)->program->param;
+	PragmaName * pragma;
+	ProgVar * var;
+	
+	for (pragma = compiler->pragmaSpecialize; pragma; pragma = pragma->next) {
+		for (var = compiler->generator.result->param; var != builtinParams; 
+			 var = var->base.next) {
+			if (var->named.length == pragma->length &&
+				!GlesStrncmp(var->named.name, pragma->name, pragma->length)) {
+				var->base.specialize = GL_TRUE;
+			}
+		}
+	}
+}
+
 static GLboolean Compile(Compiler * compiler) {
 	
 	if (!GlesParseTranslationUnit(compiler)) {
@@ -368,13 +542,20 @@ static GLboolean Compile(Compiler * compiler) {
 		return GL_FALSE;
 	}
 	
-	/* generate the IL program text and attach to shader */
+	MarkSpecializedUniforms(compiler);
+	
+#if GLES_DEBUG
+	/* the IL program text is appended to the info log */
 	GlesWriteShaderProgram(&compiler->ilLog, compiler->generator.result);
-	compiler->shader->il = GlesMalloc(compiler->ilLog.logSize);
+#endif /* GLES_DEBUG */
+
+	/* generate the binary IL image and attach to shader */
+	compiler->shader->binary = 
+		GlesSaveShaderProgram(compiler->generator.result, compiler->exprMemory,
+							  &compiler->shader->binarySize);
 	
-	if (compiler->shader->il) {
-		compiler->shader->size = compiler->ilLog.logSize;
-		GlesLogExtract(&compiler->ilLog, compiler->ilLog.logSize, compiler->shader->il, NULL);
+	if (compiler->shader->binary) {
+		compiler->shader->optimize = compiler->pragmaOptimize;
 	} else {
 		/* out of memory error */
 		GlesCompileError(compiler, ErrI0001);
@@ -389,9 +570,26 @@ static void CleanupCompiler(Compiler * compiler) {
 	/* free up any working storage */
 	GlesCleanupTokenizer(compiler->tokenizer);
 
-	GlesMemoryPoolDestroy(compiler->exprMemory);
-	GlesMemoryPoolDestroy(compiler->moduleMemory);
-	GlesMemoryPoolDestroy(compiler->resultMemory);
+	ReleaseIncompleteBuiltins(compiler, &compiler->vertexBuiltins);
+	ReleaseIncompleteBuiltins(compiler, &compiler->fragmentBuiltins);
+	
+	/* retain the pages of the working pools for the next compilation */
+	if (compiler->exprPool) {
+		GlesMemoryPoolClear(compiler->exprPool);
+	}
+	
+	if (compiler->modulePool) {
+		GlesMemoryPoolClear(compiler->modulePool);
+	}
+	
+	if (compiler->resultPool) {
+		GlesMemoryPoolClear(compiler->resultPool);
+	}
+	
+	compiler->exprMemory = NULL;
+	compiler->moduleMemory = NULL;
+	compiler->resultMemory = NULL;
+	compiler->names = NULL;
 
 #if GLES_DEBUG				
 	/* merge the log files into the info log attached to the shader */
@@ -414,14 +612,30 @@ static void CleanupCompiler(Compiler * compiler) {
 ** --------------------------------------------------------------------------
 */
 
-void GlesPragmaOptimize(Compiler * compiler, GLboolean enable) {
-	compiler->pragmaOptimize = enable;
+void GlesPragmaOptimize(Compiler * compiler, GLbitfield passes, GLboolean enable) {
+	if (enable) {
+		compiler->pragmaOptimize |= passes;
+	} else {
+		compiler->pragmaOptimize &= ~passes;
+	}
 }
 
 void GlesPragmaDebug(Compiler * compiler, GLboolean enable) {
 	compiler->pragmaDebug = enable;
 }
 
+void GlesPragmaSpecialize(Compiler * compiler, const char * name, GLsizeiptr length) {
+	PragmaName * pragma = 
+		GlesMemoryPoolAllocate(compiler->moduleMemory, sizeof(PragmaName));
+	
+	pragma->name = GlesMemoryPoolAllocate(compiler->moduleMemory, length);
+	pragma->length = length;
+	GlesMemcpy(pragma->name, name, length);
+	
+	pragma->next = compiler->pragmaSpecialize;
+	compiler->pragmaSpecialize = pragma;
+}
+
 Compiler * GlesCompilerCreate(State * state) {
 	Compiler * compiler = GlesMalloc(sizeof(Compiler));
 	
@@ -453,6 +667,26 @@ void GlesCompilerDestroy(Compiler * compiler) {
 	GLES_ASSERT(compiler->resultMemory == NULL);
 	GLES_ASSERT(compiler->tokenizer);
 	
+	if (compiler->vertexBuiltins.memory) {
+		GlesMemoryPoolDestroy(compiler->vertexBuiltins.memory);
+	}
+	
+	if (compiler->fragmentBuiltins.memory) {
+		GlesMemoryPoolDestroy(compiler->fragmentBuiltins.memory);
+	}
+	
+	if (compiler->exprPool) {
+		GlesMemoryPoolDestroy(compiler->exprPool);
+	}
+	
+	if (compiler->modulePool) {
+		GlesMemoryPoolDestroy(compiler->modulePool);
+	}
+	
+	if (compiler->resultPool) {
+		GlesMemoryPoolDestroy(compiler->resultPool);
+	}
+	
 	GlesDestroyTokenizer(compiler->tokenizer);
 	GlesLogDeInit(&compiler->preprocLog);
 	GlesLogDeInit(&compiler->ilLog);
@@ -479,6 +713,52 @@ GLboolean GlesCompileShader(Compiler * compiler, Shader * shader) {
 	return result;
 }
 
+/**
+ * Generate the textual form of the intermediate code of a compiled shader,
+ * as returned by glGetShaderIntermediateVIN. The text is created from the
+ * binary image upon first request and retained with the shader object.
+ * 
+ * @param	shader	the shader object
+ * 
+ * @return	GL_FALSE if out of memory
+ */
+GLboolean GlesShaderIntermediateText(Shader * shader) {
+	MemoryPool * pool;
+	ShaderProgram * program;
+	GLboolean result = GL_FALSE;
+	Log log;
+	
+	if (shader->il || !shader->binary) {
+		return GL_TRUE;
+	}
+	
+	pool = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, NULL);
+	
+	if (!pool) {
+		return GL_FALSE;
+	}
+	
+	program = GlesLoadShaderProgram(shader->binary, shader->binarySize, pool);
+	
+	if (program) {
+		GlesLogInit(&log);
+		GlesWriteShaderProgram(&log, program);
+		shader->il = GlesMalloc(log.logSize);
+		
+		if (shader->il) {
+			shader->size = log.logSize;
+			GlesLogExtract(&log, log.logSize, shader->il, NULL);
+			result = GL_TRUE;
+		}
+		
+		GlesLogDeInit(&log);
+	}
+	
+	GlesMemoryPoolDestroy(pool);
+	
+	return result;
+}
+
 /**
  * Append an error message to the compile log.
  * 
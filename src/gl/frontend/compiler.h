@@ -207,6 +207,29 @@ struct ShaderProgram;
 struct InitializerList;
 struct ForLoop;
 
+/**
+ * Name given as argument to a #pragma directive.
+ */
+typedef struct PragmaName {
+	struct PragmaName *		next;			/**< next name in list */
+	char *					name;			/**< copy of the name */
+	GLsizeiptr				length;			/**< length of the name */
+} PragmaName;
+
+/**
+ * The builtin functions and variables for one type of shader. They are 
+ * compiled once, upon first use, and then shared read-only by all shaders
+ * of that type: the global scope of each shader is nested within the 
+ * builtin scope, and its IL program extends the builtin IL program.
+ */
+typedef struct Builtins {
+	struct MemoryPool *		memory;		/**< storage for builtin scope and IL */
+	struct Scope *			scope;		/**< builtin scope, NULL until complete */
+	struct NameTable *		names;		/**< identifiers of builtins */
+	struct ShaderProgram *	program;	/**< IL of builtin functions and variables */
+	GLuint					nextTempId;	/**< sequence for temporary variables */
+} Builtins;
+
 /**
  * Shading language compiler.
  * 
@@ -225,8 +248,16 @@ typedef struct Compiler {
 	struct MemoryPool *		moduleMemory;	/**< any storage only needed during compilation: module scope */
 	struct MemoryPool *		resultMemory;	/**< any storage to be persisteted as compilation result */
 	
+	struct MemoryPool *		exprPool;		/**< retained pool backing exprMemory */
+	struct MemoryPool *		modulePool;		/**< retained pool backing moduleMemory */
+	struct MemoryPool *		resultPool;		/**< retained pool backing resultMemory */
+	
 	struct Tokenizer *		tokenizer;		/**< tokenizer to use by compiler */
 	
+	Builtins				vertexBuiltins;		/**< builtins for vertex shaders */
+	Builtins				fragmentBuiltins;	/**< builtins for fragment shaders */
+	
+	struct NameTable *		names;			/**< interned identifiers */
 	struct Scope *			globalScope;	/**< global scope */
 	struct Scope *			currentScope;	/**< current scope for nested blocks */
 	
@@ -250,8 +281,9 @@ typedef struct Compiler {
 	Log						preprocLog;		/**< preprocessor log */
 #endif /* GLES_DEBUG */
 
-	GLboolean				pragmaOptimize;	/**< compiler pragma setting */
+	GLbitfield				pragmaOptimize;	/**< compiler pragma setting */
 	GLboolean				pragmaDebug;	/**< compiler pragma setting */
+	PragmaName *			pragmaSpecialize;	/**< uniforms to specialize on */
 } Compiler;
 
 /*
@@ -264,6 +296,7 @@ Compiler * GlesCompilerCreate(State * state);
 void GlesCompilerDestroy(Compiler * compiler);
 
 GLboolean GlesCompileShader(Compiler * compiler, Shader * shader);
+GLboolean GlesShaderIntermediateText(Shader * shader);
 void GlesCompileError(Compiler * compiler, CompileError error);
 void GlesCompileErrorSymbol(Compiler * compiler, CompileError error, 
 	const char * name, GLsizeiptr length);
@@ -273,7 +306,8 @@ void GlesCompileErrorMessage(Compiler * compiler, const char * first,
 /* parser entry point is also here */
 GLboolean GlesParseTranslationUnit(Compiler * compiler);
 
-void GlesPragmaOptimize(Compiler * compiler, GLboolean enable);
+void GlesPragmaOptimize(Compiler * compiler, GLbitfield passes, GLboolean enable);
 void GlesPragmaDebug(Compiler * compiler, GLboolean enable);
+void GlesPragmaSpecialize(Compiler * compiler, const char * name, GLsizeiptr length);
 
 #endif /* GLES_FRONTEND_COMPILER_H */
\ No newline at end of file
@@ -72,11 +72,11 @@ GLboolean GlesDeclareStructField(Compiler * compiler, Type * structure,
 						  		 const char * name, GLsizei length,
 					  	  		 Type * type) {
 	Symbol * symbol;
-	GLsizei hash = GlesSymbolHash(name, length);
+	GLsizei hash = GlesNameHash(name);
 	
 	GLES_ASSERT(structure->base.kind == TypeStruct);
 	
-	if (GlesSymbolFind(structure->structure.symbols, name, length, hash)) {
+	if (GlesSymbolFind(structure->structure.symbols, name, hash)) {
 		return GL_FALSE;
 	}
 	
@@ -93,11 +93,11 @@ GLboolean GlesDeclareStructField(Compiler * compiler, Type * structure,
 GLboolean GlesDeclareStruct(Compiler * compiler, 
 						  	const char * name, GLsizei length, Type * type) {
 	Symbol * symbol;
-	GLsizei hash = GlesSymbolHash(name, length);
+	GLsizei hash = GlesNameHash(name);
 	
 	GLES_ASSERT(type->base.kind == TypeStruct);
 	
-	if (GlesSymbolFind(compiler->currentScope, name, length, hash)) {
+	if (GlesSymbolFind(compiler->currentScope, name, hash)) {
 		/* S0024: Redefinition of name in same scope */
 				
 		GlesCompileError(compiler, ErrS0024);
@@ -112,11 +112,12 @@ GLboolean GlesDeclareStruct(Compiler * compiler,
 
 Symbol * GlesDeclareTempVariable(Compiler * compiler, Type * type) {
 	char buffer[20];
+	GLsizei length = GlesSprintf(buffer, "$$%d", compiler->nextTempId++);
 	
 	return
 		GlesSymbolCreate(compiler->moduleMemory, 
 						 compiler->currentScope, 
-						 buffer, GlesSprintf(buffer, "$$%d", compiler->nextTempId++), ~0, 
+						 GlesNameIntern(compiler->names, buffer, length, ~0), length, ~0, 
 						 type, QualifierVariable);
 }
 
@@ -151,8 +152,10 @@ static void ExpandArraysAndStructures(Compiler * compiler,
 			Field * field = type->structure.fields + index;
 			GLsizeiptr length = baseLength + field->symbol->base.length + 1;
 			char * name = 
-				GlesCompoundName(compiler->moduleMemory, baseName, baseLength,
-								 field->symbol->base.name, field->symbol->base.length);
+				GlesNameIntern(compiler->names,
+					GlesCompoundName(compiler->exprMemory, baseName, baseLength,
+									 field->symbol->base.name, field->symbol->base.length),
+					length, ~0);
 								 
 			Symbol * symbol;
 			Type * fieldType = field->type;
@@ -183,11 +186,11 @@ GLboolean GlesDeclareVariable(Compiler * compiler,
 						  	  Qualifier qualifier, Type * type, GLboolean invariant,
 						  	  union Expression * initializer) {
 	Symbol * symbol;
-	GLsizei hash = GlesSymbolHash(name, length);
+	GLsizei hash = GlesNameHash(name);
 	
 	//GLES_ASSERT(type->base.kind != TypeStruct);
 	
-	if (GlesSymbolFind(compiler->currentScope, name, length, hash)) {
+	if (GlesSymbolFind(compiler->currentScope, name, hash)) {
 		/* S0024: Redefinition of name in same scope */
 				
 		GlesCompileError(compiler, ErrS0024);
@@ -364,14 +367,14 @@ GLboolean GlesDeclareParameter(Compiler * compiler,
 						  	   Qualifier qualifier, Type * type, 
 							   GLsizei index, GLboolean constant) {
 	Symbol * symbol;
-	GLsizei hash = GlesSymbolHash(name, length);
+	GLsizei hash = GlesNameHash(name);
 	
 	GLES_ASSERT(type->base.kind != TypeStruct);
 	GLES_ASSERT(qualifier == QualifierParameterIn 	||
 				qualifier == QualifierParameterOut 	||
 				qualifier == QualifierParameterInOut);
 	
-	if (GlesSymbolFind(compiler->currentScope, name, length, hash)) {
+	if (GlesSymbolFind(compiler->currentScope, name, hash)) {
 		/* S0024: Redefinition of name in same scope */
 				
 		GlesCompileError(compiler, ErrS0024);
@@ -390,13 +393,12 @@ GLboolean GlesDeclareParameter(Compiler * compiler,
 	return GL_TRUE;
 }
 
-GLboolean GlesDeclareInvariant(Compiler * compiler, 
-							   const char * name, GLsizei length) {
+GLboolean GlesDeclareInvariant(Compiler * compiler, const char * name) {
 	Symbol * symbol;
 	
 	GLES_ASSERT(compiler->currentScope == compiler->globalScope);
 	
-	symbol = GlesSymbolFind(compiler->currentScope, name, length, ~0);
+	symbol = GlesSymbolFind(compiler->currentScope, name, ~0);
 	
 	if (symbol == NULL) {
 		/* L0002: Undefined identifier */
@@ -433,7 +435,7 @@ Symbol * GlesDeclareFunction(Compiler * compiler,
 							 const char * name, GLsizei length, 
 							 Type * returnType, 
 							 GLsizei numParameters, Scope * parameters) {
-	GLsizei hash = GlesSymbolHash(name, length);
+	GLsizei hash = GlesNameHash(name);
 	GLsizei index;
 	Type * type;
 	Symbol * function;
@@ -447,7 +449,7 @@ Symbol * GlesDeclareFunction(Compiler * compiler,
 	
 	type = GlesTypeFunctionCreate(compiler->moduleMemory, returnType, numParameters);
 	
-	for (index = 0; index < GLES_ELEMENTSOF(parameters->buckets); ++index) {
+	for (index = 0; index < parameters->numBuckets; ++index) {
 		Symbol * symbol;
 		
 		for (symbol = parameters->buckets[index]; symbol; symbol = symbol->base.next) {
@@ -493,7 +495,7 @@ Symbol * GlesDeclareFunction(Compiler * compiler,
 	 * given type in the current scope.
 	 */
 	
-	function = GlesSymbolFind(compiler->currentScope, name, length, hash);
+	function = GlesSymbolFind(compiler->currentScope, name, hash);
 	
 	if (function != NULL) {
 		Symbol * overload;
@@ -564,7 +566,7 @@ GLboolean GlesFinishStructDeclaration(Compiler * compiler, Type * type) {
 	type->structure.fields = (Field *) 
 		GlesMemoryPoolAllocate(compiler->resultMemory, type->structure.numFields * sizeof(struct Field));
 	
-	for (index = 0; index < GLES_ELEMENTSOF(fields->buckets); ++index) {
+	for (index = 0; index < fields->numBuckets; ++index) {
 		Symbol * symbol;
 		
 		for (symbol = fields->buckets[index]; symbol; symbol = symbol->base.next) {
@@ -588,8 +590,12 @@ Symbol * GlesSymbolFindExpansion(Compiler * compiler,
 						 
 	GLsizei length = base->base.length + field->base.length + 1;
 	
-	Symbol * expansion =
-		GlesSymbolFindNested(compiler->currentScope, name, length, ~0);
+	Symbol * expansion;
+	
+	/* expansions have been interned when the variable was declared */
+	name = GlesNameFind(compiler->names, name, length, ~0);
+	expansion = name ? 
+		GlesSymbolFindNested(compiler->currentScope, name, ~0) : NULL;
 		
 	GLES_ASSERT(expansion);
 	
@@ -88,8 +88,7 @@ GLboolean GlesDeclareParameter(Compiler * compiler,
 						  	  
 Symbol * GlesDeclareTempVariable(Compiler * compiler, Type * type);
 						  	   
-GLboolean GlesDeclareInvariant(Compiler * compiler, 
-							   const char * name, GLsizei length);
+GLboolean GlesDeclareInvariant(Compiler * compiler, const char * name);
 							   						  	   
 Symbol * GlesDeclareFunction(Compiler * compiler,
 							 const char * name, GLsizei length, 
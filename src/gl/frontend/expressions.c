@@ -1301,7 +1301,7 @@ Expression * GlesCreateExprField(Compiler * compiler, Expression * expr, struct
 		{	
 			Symbol * member = 
 				GlesSymbolFind(type->structure.symbols, 
-							   field->first, field->length, ~0);
+							   field->first, ~0);
 							   
 			if (!member) {
 				GlesCompileError(compiler, ErrS0026);
@@ -1701,7 +1701,7 @@ Expression * GlesCreateExprCall(Compiler * compiler, union Symbol * func, GLsize
 	
 	/* copy all in and inout argument values into parameter variables */
 	
-	for (index = 0; index < GLES_ELEMENTSOF(func->function.parameterScope->buckets); ++index) {
+	for (index = 0; index < func->function.parameterScope->numBuckets; ++index) {
 		for (symbol = func->function.parameterScope->buckets[index]; symbol; symbol = symbol->base.next) {
 			if (symbol->base.qualifier == QualifierParameterIn ||
 				symbol->base.qualifier == QualifierParameterInOut) {
@@ -1720,7 +1720,7 @@ Expression * GlesCreateExprCall(Compiler * compiler, union Symbol * func, GLsize
 	
 	/* copy all inout and out values back into argument values */
 
-	for (index = 0; index < GLES_ELEMENTSOF(func->function.parameterScope->buckets); ++index) {
+	for (index = 0; index < func->function.parameterScope->numBuckets; ++index) {
 		for (symbol = func->function.parameterScope->buckets[index]; symbol; symbol = symbol->base.next) {
 			if (symbol->base.qualifier == QualifierParameterOut ||
 				symbol->base.qualifier == QualifierParameterInOut) {
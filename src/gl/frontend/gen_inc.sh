@@ -1,7 +1,57 @@
 # !/bin/sh
+#
+# Regenerate the C string literal versions (*.inc) of the built-in shader
+# declarations. Comments and blank lines are dropped, runs of spaces are
+# collapsed, and each remaining line becomes one "...\n" literal; the
+# list is terminated by "". Run from this directory after editing any of
+# the builtin.* sources.
 
-../../tools/syn_to_c builtin.common >builtin.common.inc
-../../tools/syn_to_c builtin.frag >builtin.frag.inc
-../../tools/syn_to_c builtin.init.frag >builtin.init.frag.inc
-../../tools/syn_to_c builtin.vert >builtin.vert.inc
-../../tools/syn_to_c builtin.init.vert >builtin.init.vert.inc
+syn_to_c() {
+	awk '
+	BEGIN {
+		print ""
+		print "/* DO NOT EDIT - THIS FILE IS AUTOMATICALLY GENERATED */"
+		print ""
+		comment = 0
+	}
+	{
+		line = $0
+		out = ""
+
+		while (line != "") {
+			if (comment) {
+				i = index(line, "*/")
+				if (!i) break
+				line = substr(line, i + 2)
+				comment = 0
+			} else {
+				i = index(line, "/*")
+				if (!i) {
+					out = out line
+					break
+				}
+				out = out substr(line, 1, i - 1)
+				line = substr(line, i + 2)
+				comment = 1
+			}
+		}
+
+		gsub(/ +/, " ", out)
+		sub(/^ /, "", out)
+
+		if (out ~ /^[ \t]*$/) next
+
+		gsub(/\\/, "\\\\", out)
+		gsub(/"/, "\\\"", out)
+		print "\"" out "\\n\""
+	}
+	END {
+		print "\"\""
+	}' "$1"
+}
+
+syn_to_c builtin.common >builtin.common.inc
+syn_to_c builtin.frag >builtin.frag.inc
+syn_to_c builtin.init.frag >builtin.init.frag.inc
+syn_to_c builtin.vert >builtin.vert.inc
+syn_to_c builtin.init.vert >builtin.init.vert.inc
@@ -723,6 +723,36 @@ void GlesInsertBlockList(struct ShaderProgramGenerator * gen, BlockList * list)
 	list->tail = NULL;
 }
 
+/**
+ * Append the given list of instruction blocks at the current point in the
+ * overall instruction sequence. Other than GlesInsertBlockList(), the list
+ * itself is retained, such that blocks shared between programs, e.g. 
+ * the bodies of builtin functions, can be linked into each of them.
+ * 
+ * @param	gen		reference to compiler object
+ * @param	list	reference to list of blocks to append
+ */
+void GlesAppendBlockList(struct ShaderProgramGenerator * gen, const BlockList * list) {
+	Block * block, * next;
+	
+	GLES_ASSERT(gen->currentList != list);
+	
+	for (block = list->head; block; block = next) {
+		next = block != list->tail ? block->next : NULL;
+		
+		block->next = NULL;
+		block->prev = gen->currentList->tail;
+		
+		if (gen->currentList->tail) {
+			gen->currentList->tail->next = block;
+		} else {
+			gen->currentList->head = block;
+		}
+		
+		gen->currentList->tail = block;
+	}
+}
+
 /*
 ** --------------------------------------------------------------------------
 ** Functions to create higher-level objects in IL programs
@@ -737,11 +767,96 @@ ShaderProgram *	GlesCreateShaderProgram(MemoryPool * pool) {
 	return result;
 }
 
+/**
+ * Create a new shader program that builds upon the variables, constants and
+ * labels of an existing program, such as the builtin function library. New
+ * objects are prepended to the lists shared with the base program, which
+ * therefore remains unchanged. The block list of the new program starts out
+ * empty.
+ * 
+ * @param	pool	memory pool for the new program
+ * @param	base	the program providing the initial set of objects
+ * 
+ * @return	the new shader program
+ */
+ShaderProgram *	GlesExtendShaderProgram(MemoryPool * pool, const ShaderProgram * base) {
+	ShaderProgram * result = GlesMemoryPoolAllocate(pool, sizeof(ShaderProgram));
+	
+	*result = *base;
+	result->memory = pool;
+	result->blocks.head = result->blocks.tail = NULL;
+	
+	/* the index of the base program is not updated with new constants */
+	if (base->constantIndex) {
+		result->constantIndex = 
+			GlesMemoryPoolAllocate(pool, base->indexSize * sizeof(ProgVar *));
+		GlesMemcpy(result->constantIndex, base->constantIndex, 
+				   base->indexSize * sizeof(ProgVar *));
+	}
+	
+	return result;
+}
+
+/**
+ * Enter a constant into the hash index of its program. The index is 
+ * probed linearly, and kept at most half full.
+ * 
+ * @param	program	the program
+ * @param	var		the constant to add
+ */
+static void IndexConstant(ShaderProgram * program, ProgVar * var) {
+	GLsizei slot = 
+		GlesHashConstant(var->constant.values, var->base.type) % program->indexSize;
+	
+	while (program->constantIndex[slot]) {
+		slot = (slot + 1) % program->indexSize;
+	}
+	
+	program->constantIndex[slot] = var;
+	++program->numConstants;
+}
+
+/**
+ * (Re-)create the hash index of the constants of a program, such that it
+ * can take at least one additional constant.
+ * 
+ * @param	program	the program
+ */
+static void BuildConstantIndex(ShaderProgram * program) {
+	GLsizei numConstants = 0, indexSize = GLES_CONSTANT_HASH;
+	ProgVar * var;
+	
+	for (var = program->constants; var; var = var->base.next) {
+		++numConstants;
+	}
+	
+	while (indexSize < 2 * (numConstants + 1)) {
+		indexSize = 2 * indexSize + 1;
+	}
+	
+	program->constantIndex = 
+		GlesMemoryPoolAllocate(program->memory, indexSize * sizeof(ProgVar *));
+	program->indexSize = indexSize;
+	program->numConstants = 0;
+	
+	for (var = program->constants; var; var = var->base.next) {
+		IndexConstant(program, var);
+	}
+}
+
 ProgVar * GlesCreateProgVarConst(ShaderProgram * program, Constant * constant, Type * type) {
-	GLsizei hash = GlesHashConstant(constant, type) % GLES_CONSTANT_HASH;
+	GLsizei slot;
 	ProgVar * var;
 	
-	for (var = program->constants[hash]; var; var = var->base.next) {
+	if (!program->constantIndex || 
+		2 * (program->numConstants + 1) > program->indexSize) {
+		BuildConstantIndex(program);
+	}
+	
+	slot = GlesHashConstant(constant, type) % program->indexSize;
+	
+	for (; (var = program->constantIndex[slot]) != NULL; 
+		 slot = (slot + 1) % program->indexSize) {
 		if (GlesCompareConstant(var->constant.values, constant, type)) {
 			return var;
 		}
@@ -756,8 +871,9 @@ ProgVar * GlesCreateProgVarConst(ShaderProgram * program, Constant * constant, T
 	var->constant.values = GlesMemoryPoolAllocate(program->memory, sizeof(Constant) * type->base.size);
 	
 	GlesMemcpy(var->constant.values, constant, sizeof(Constant) * type->base.size);
-	var->base.next = program->constants[hash];
-	program->constants[hash] = var;
+	var->base.next = program->constants;
+	program->constants = var;
+	IndexConstant(program, var);
 	
 	return var;
 }
@@ -57,6 +57,9 @@
 ** --------------------------------------------------------------------------
 */
 
+#define GLES_IL_IMAGE_MAGIC		0x4c495356	/* 'VSIL' in little endian order	*/
+#define GLES_IL_IMAGE_VERSION	3			/* layout version of binary image	*/
+
 typedef enum InstKind {
 	InstKindBase,
 	InstKindUnary,
@@ -86,6 +89,10 @@ typedef enum Opcode {
 	OpcodeCMP_SAT,	  /* v,v,v   v        compare with saturate						*/
 	OpcodeCOS,	      /* s       ssss     cosine with reduction to [-PI,PI]			*/
 	OpcodeCOS_SAT,    /* s       ssss     cosine with reduction to [-PI,PI] (sat)	*/
+	OpcodeDDX,	      /* v       v        partial derivative relative to x			*/
+	OpcodeDDX_SAT,	  /* v       v        partial derivative relative to x (sat)	*/
+	OpcodeDDY,	      /* v       v        partial derivative relative to y			*/
+	OpcodeDDY_SAT,	  /* v       v        partial derivative relative to y (sat)	*/
 	OpcodeDP2,	      /* v,v     ssss     2-component dot product					*/
 	OpcodeDP2_SAT,	  /* v,v     ssss     2-component dot product	(sat)			*/
 	OpcodeDP3,	      /* v,v     ssss     3-component dot product					*/
@@ -307,6 +314,9 @@ typedef enum ProgVarSegment {
 	ProgVarSegAttrib,					/**< attrib data segment			*/
 	ProgVarSegVarying,					/**< varying data segment			*/
 	ProgVarSegLocal,					/**< local/temp data segment		*/
+	ProgVarSegUniform,					/**< program uniform data segment	*/
+	ProgVarSegResult,					/**< shader result segment			*/
+	ProgVarSegSpecial,					/**< special built-in input values	*/
 } ProgVarSegment;
 
 /**
@@ -333,6 +343,7 @@ typedef struct ProgVarBase {
 	GLuint			location: GLES_MAX_ADDRESS_BITS;	
 	GLuint			shift: 2;			/**< index with vec4				*/		
 										/**< offset within segment in words	*/
+	GLboolean		specialize: 1;		/**< value may be folded into code	*/
 	 
 	/* transient data fields */
 	GLboolean		special: 1;			/**< special built-in value			*/
@@ -402,10 +413,33 @@ typedef struct ShaderProgram {
 	ProgVar *			in;				/**< input values					*/
 	ProgVarAddr *		addr;			/**< address registers				*/
 	
-	/** Hash table for words of constant data								*/ 
-	ProgVar *			constants[GLES_CONSTANT_HASH];
+	ProgVar *			constants;		/**< List of constants				*/
+	
+	/** Open hash index into the list of constants, NULL until needed		*/ 
+	ProgVar **			constantIndex;
+	GLsizei				indexSize;		/**< number of slots in index		*/
+	GLsizei				numConstants;	/**< number of indexed constants	*/
 } ShaderProgram;
 
+/**
+ * Header of the binary image of a shader program. The image contains the
+ * data structures of the program in their in-memory layout, with all
+ * pointers stored as byte offsets from the start of the image. The offsets
+ * of all pointer fields are listed in a relocation table, followed by a
+ * table of fields referring to basic types, which are stored as
+ * (kind << 2 | precision).
+ */
+typedef struct ShaderProgramImage {
+	GLuint				magic;			/**< GLES_IL_IMAGE_MAGIC			*/
+	GLuint				version;		/**< GLES_IL_IMAGE_VERSION			*/
+	GLsizeiptr			size;			/**< total size of image in bytes	*/
+	GLsizeiptr			program;		/**< offset of ShaderProgram		*/
+	GLsizeiptr			relocs;			/**< offset of relocation table		*/
+	GLsizeiptr			numRelocs;		/**< number of pointers to relocate	*/
+	GLsizeiptr			types;			/**< offset of basic type table		*/
+	GLsizeiptr			numTypes;		/**< number of basic type fields	*/
+} ShaderProgramImage;
+
 /**
  * Data structure used while constructing a low level shading language program.
  */
@@ -760,8 +794,10 @@ void GlesGenInstMemory(struct ShaderProgramGenerator *gen,
 
 Block * GlesCreateBlock(struct ShaderProgramGenerator * gen);
 void GlesInsertBlockList(struct ShaderProgramGenerator * gen, BlockList * list);
+void GlesAppendBlockList(struct ShaderProgramGenerator * gen, const BlockList * list);
 
 ShaderProgram *	GlesCreateShaderProgram(MemoryPool * pool);
+ShaderProgram *	GlesExtendShaderProgram(MemoryPool * pool, const ShaderProgram * base);
 
 ProgVar * 	GlesCreateProgVarConst(ShaderProgram * program, Constant * constant, Type * type);
 ProgVar * 	GlesCreateProgVarTemp(ShaderProgram * program, Type * type);
@@ -774,4 +810,7 @@ ProgVarAddr * 	GlesCreateProgVarAddr(ShaderProgram * program);
 void GlesWriteShaderProgram(struct Log * log, const ShaderProgram * program);
 ShaderProgram * GlesParseShaderProgram(const char * text, GLsizeiptr length, MemoryPool * pool, MemoryPool * temp);
 
+void * GlesSaveShaderProgram(const ShaderProgram * program, MemoryPool * temp, GLsizeiptr * size);
+ShaderProgram * GlesLoadShaderProgram(const void * image, GLsizeiptr size, MemoryPool * pool);
+
 #endif /* GLES_FRONTEND_IL_H */
@@ -115,7 +115,7 @@ static void InitSymbolTable(SymbolTable * table, MemoryPool * pool) {
  */
 static void DefineSymbol(SymbolTable * table, const char * name, 
 	GLsizeiptr length, void * data) {
-	GLsizei hash = GlesSymbolHash(name, length);
+	GLsizei hash = GlesSymbolHash(name, length) % GLES_SYMBOL_HASH;
 	Bucket * bucket = GlesMemoryPoolAllocate(table->pool, sizeof(Bucket));
 
 	GLES_ASSERT(data);
@@ -142,7 +142,7 @@ static void DefineSymbol(SymbolTable * table, const char * name,
  */
 static void * LookupSymbol(SymbolTable * table, const char * name, 
 	GLsizeiptr length) {
-	GLsizei hash = GlesSymbolHash(name, length);
+	GLsizei hash = GlesSymbolHash(name, length) % GLES_SYMBOL_HASH;
 	Bucket * bucket = table->buckets[hash], *prev = NULL;
 	
 	while (bucket) {
@@ -433,7 +433,7 @@ const char * GlesParseType(MemoryPool * pool, const char * text, const char * en
 		if (*text == '[') {
 			GLsizeiptr elements = 0;
 			
-			text = Number(SkipSpace(text, end), end, &elements);
+			text = Number(SkipSpace(text + 1, end), end, &elements);
 			
 			if (!text) {
 				return NULL;
@@ -510,13 +510,13 @@ static const char * ParseVariableDeclaration(ShaderProgramParser * parser,
 		GLsizeiptr segmentLength;
 		GLuint location;
 		
-		text = SkipSpaceIdentifier(text, end, &segment);
+		text = SkipSpaceIdentifier(text + 1, end, &segment);
 		
 		if (!text) {
 			return NULL;
 		}
 		
-		segmentLength = text - name;
+		segmentLength = text - segment;
 		
 		if (segmentLength == 5 && !GlesMemcmp(segment, "CONST", 5)) {
 			*pSegment = ProgVarSegParam;
@@ -528,6 +528,12 @@ static const char * ParseVariableDeclaration(ShaderProgramParser * parser,
 			*pSegment = ProgVarSegVarying;
 		} else if (segmentLength == 5 && !GlesMemcmp(segment, "LOCAL", 5)) {
 			*pSegment = ProgVarSegLocal;
+		} else if (segmentLength == 7 && !GlesMemcmp(segment, "UNIFORM", 7)) {
+			*pSegment = ProgVarSegUniform;
+		} else if (segmentLength == 6 && !GlesMemcmp(segment, "RESULT", 6)) {
+			*pSegment = ProgVarSegResult;
+		} else if (segmentLength == 7 && !GlesMemcmp(segment, "SPECIAL", 7)) {
+			*pSegment = ProgVarSegSpecial;
 		} else {
 			return NULL;
 		}
@@ -809,6 +815,10 @@ static const char * ParseParamDeclaration(ShaderProgramParser * parser,
 	
 	text = ParseVariableDeclaration(parser, text, end, &name, &length, &type, &segment, &location);
 	
+	if (!text) {
+		return NULL;
+	}
+	
 	if (LookupSymbol(&parser->variables, name, length)) {
 		return NULL;
 	}
@@ -1038,13 +1048,15 @@ static const char * ParseProgVar(ShaderProgramParser * parser,
 		}
 		
 		if (isalpha(*text) || *text == '$' || *text == '_') {
+			const char * addrName = text;
+			
 			text = Identifier(text, end);
 			
 			if (!text) {
 				return NULL;
 			}
 			
-			*pAddr = LookupSymbol(&parser->addresses, name, text - name);
+			*pAddr = LookupSymbol(&parser->addresses, addrName, text - addrName);
 			
 			if (!*pAddr) {
 				/* undefined variable name */
@@ -1891,6 +1903,10 @@ ShaderProgram * GlesParseShaderProgram(const char * text, GLsizeiptr length,
 				case OpcodeABS_SAT:
 				case OpcodeCOS:
 				case OpcodeCOS_SAT:
+				case OpcodeDDX:
+				case OpcodeDDX_SAT:
+				case OpcodeDDY:
+				case OpcodeDDY_SAT:
 				case OpcodeEX2:
 				case OpcodeEX2_SAT:
 				case OpcodeEXP:
@@ -2085,3 +2101,86 @@ ShaderProgram * GlesParseShaderProgram(const char * text, GLsizeiptr length,
 	return program;
 }
 
+
+/**
+ * Load a shader program from a binary image created by GlesSaveShaderProgram.
+ * The image is copied into the memory pool as a whole and its pointers are
+ * relocated in place; no parsing or symbol table construction takes place.
+ * 
+ * @param	image	the binary image
+ * @param	size	size of the image in bytes
+ * @param	pool	memory pool for the program data structures
+ * 
+ * @return	the shader program, or NULL if the image is not valid
+ */
+ShaderProgram * GlesLoadShaderProgram(const void * image, GLsizeiptr size, 
+									  MemoryPool * pool) {
+	const ShaderProgramImage * header = (const ShaderProgramImage *) image;
+	const GLsizeiptr * relocs, * types;
+	ShaderProgram * program;
+	GLsizeiptr index, offset;
+	GLubyte * base;
+	void ** slot;
+	Type * type;
+	
+	if (!image || size < (GLsizeiptr) sizeof(ShaderProgramImage) ||
+		header->magic != GLES_IL_IMAGE_MAGIC ||
+		header->version != GLES_IL_IMAGE_VERSION ||
+		header->size != size ||
+		header->program < (GLsizeiptr) sizeof(ShaderProgramImage) ||
+		header->program > size - (GLsizeiptr) sizeof(ShaderProgram) ||
+		header->relocs < 0 || header->relocs > size || header->numRelocs < 0 ||
+		header->numRelocs > (size - header->relocs) / (GLsizeiptr) sizeof(GLsizeiptr) ||
+		header->types < 0 || header->types > size || header->numTypes < 0 ||
+		header->numTypes > (size - header->types) / (GLsizeiptr) sizeof(GLsizeiptr)) {
+		return NULL;
+	}
+	
+	base = GlesMemoryPoolAllocate(pool, size);
+	
+	if (!base) {
+		return NULL;
+	}
+	
+	GlesMemcpy(base, image, size);
+	relocs = (const GLsizeiptr *) (base + header->relocs);
+	types = (const GLsizeiptr *) (base + header->types);
+	
+	for (index = 0; index < header->numTypes; ++index) {
+		if (types[index] < 0 || types[index] > size - (GLsizeiptr) sizeof(void *) ||
+			types[index] % sizeof(void *)) {
+			return NULL;
+		}
+		
+		slot = (void **) (base + types[index]);
+		offset = (GLsizeiptr) (size_t) *slot;
+		type = GlesBasicType((TypeValue) (offset >> 2), (Precision) (offset & 3));
+		
+		if (!type) {
+			return NULL;
+		}
+		
+		*slot = type;
+	}
+	
+	for (index = 0; index < header->numRelocs; ++index) {
+		if (relocs[index] < 0 || relocs[index] > size - (GLsizeiptr) sizeof(void *) ||
+			relocs[index] % sizeof(void *)) {
+			return NULL;
+		}
+		
+		slot = (void **) (base + relocs[index]);
+		offset = (GLsizeiptr) (size_t) *slot;
+		
+		if (offset <= 0 || offset >= size) {
+			return NULL;
+		}
+		
+		*slot = base + offset;
+	}
+	
+	program = (ShaderProgram *) (base + header->program);
+	program->memory = pool;
+	
+	return program;
+}
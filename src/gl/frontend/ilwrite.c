@@ -66,6 +66,10 @@ static const char *OpcodeNames[] = {
 	"CMP_SAT",	  /* v,v,v   v        compare	(sat)							*/
 	"COS",	      /* s       ssss     cosine with reduction to [-PI,PI]			*/
 	"COS_SAT",	  /* s       ssss     cosine with reduction to [-PI,PI]	(sat)	*/
+	"DDX",	      /* v       v        partial derivative relative to x			*/
+	"DDX_SAT",	  /* v       v        partial derivative relative to x	(sat)	*/
+	"DDY",	      /* v       v        partial derivative relative to y			*/
+	"DDY_SAT",	  /* v       v        partial derivative relative to y	(sat)	*/
 	"DP2",	      /* v,v     ssss     2-component dot product					*/
 	"DP2_SAT",	  /* v,v     ssss     2-component dot product	(sat)			*/
 	"DP3",	      /* v,v     ssss     3-component dot product					*/
@@ -537,6 +541,18 @@ static void WriteOptLocation(Log * log, const ProgVarBase * base) {
 			GlesLogAppend(log, buffer, GlesSprintf(buffer, "@LOCAL[%d]", base->location));
 			break;
 			
+		case ProgVarSegUniform:
+			GlesLogAppend(log, buffer, GlesSprintf(buffer, "@UNIFORM[%d]", base->location));
+			break;
+			
+		case ProgVarSegResult:
+			GlesLogAppend(log, buffer, GlesSprintf(buffer, "@RESULT[%d]", base->location));
+			break;
+			
+		case ProgVarSegSpecial:
+			GlesLogAppend(log, buffer, GlesSprintf(buffer, "@SPECIAL[%d]", base->location));
+			break;
+			
 		default:
 			GLES_ASSERT(GL_FALSE);
 			return;
@@ -834,29 +850,23 @@ static void WriteConstant(Log * log, const Constant * value, const Type * type,
 
 static void WriteConstants(Log * log, const ShaderProgram * program) {
 	ProgVar * var;
-	GLsizei index;
 	
-	for (index = 0; index < GLES_CONSTANT_HASH; ++index) {
-		for (var = program->constants[index]; var; var = var->base.next) {
-			if (var->base.used) {
-				GlesLogAppend(log, "PARAM ", ~0);
-				WriteProgVar(log, &var->base, 0);
-				WriteType(log, var->base.type);
-				WriteConstant(log, var->constant.values, var->constant.base.type, "="); 
-				GlesLogAppend(log, ";\n", 2);
-			}
+	for (var = program->constants; var; var = var->base.next) {
+		if (var->base.used) {
+			GlesLogAppend(log, "PARAM ", ~0);
+			WriteProgVar(log, &var->base, 0);
+			WriteType(log, var->base.type);
+			WriteConstant(log, var->constant.values, var->constant.base.type, "="); 
+			GlesLogAppend(log, ";\n", 2);
 		}
 	}
 }
 
 static void ClearUsedConstants(const ShaderProgram * program) {
 	ProgVar * var;
-	GLsizei index;
 	
-	for (index = 0; index < GLES_CONSTANT_HASH; ++index) {
-		for (var = program->constants[index]; var; var = var->base.next) {
-			var->base.used = GL_FALSE;
-		}
+	for (var = program->constants; var; var = var->base.next) {
+		var->base.used = GL_FALSE;
 	}
 }
 
@@ -878,6 +888,292 @@ static void MarkUsedVariables(const ShaderProgram * program) {
 	}
 }
 
+/*
+ * The binary image of a program is generated in two passes: the first pass
+ * determines the layout of the image and the number of relocations, the
+ * second pass fills in the actual contents.
+ */
+
+#define IMAGE_ALIGNMENT	sizeof(void *)		/* alignment of image objects		*/
+#define IMAGE_NULL		(-1)				/* image offset of NULL pointer		*/
+
+/**
+ * State of the binary image writer.
+ */
+typedef struct ImageWriter {
+	GLubyte *		base;				/**< image memory, NULL during layout	*/
+	GLsizeiptr		size;				/**< current size of image			*/
+	GLsizeiptr *	relocs;				/**< pointer relocation table		*/
+	GLsizeiptr		numRelocs;			/**< number of pointer relocations	*/
+	GLsizeiptr *	types;				/**< basic type table				*/
+	GLsizeiptr		numTypes;			/**< number of basic type fields	*/
+	GLsizeiptr *	vars;				/**< image offset of variable by id	*/
+	GLsizeiptr *	addrs;				/**< image offset of address var.	*/
+	GLsizeiptr *	blocks;				/**< image offset of block by id	*/
+	GLboolean		error;				/**< program cannot be stored		*/
+} ImageWriter;
+
+static GLsizeiptr EmitData(ImageWriter * writer, const void * data, GLsizeiptr size) {
+	GLsizeiptr offset = 
+		(writer->size + IMAGE_ALIGNMENT - 1) & ~(GLsizeiptr) (IMAGE_ALIGNMENT - 1);
+	
+	if (writer->base) {
+		GlesMemcpy(writer->base + offset, data, size);
+	}
+	
+	writer->size = offset + size;
+	
+	return offset;
+}
+
+static void EmitPointer(ImageWriter * writer, GLsizeiptr slot, GLsizeiptr target) {
+	if (writer->base) {
+		*(void **) (writer->base + slot) = 
+			target == IMAGE_NULL ? NULL : (void *) (size_t) target;
+	}
+	
+	if (target != IMAGE_NULL) {
+		if (writer->base) {
+			writer->relocs[writer->numRelocs] = slot;
+		}
+		
+		++writer->numRelocs;
+	}
+}
+
+static void EmitType(ImageWriter * writer, GLsizeiptr slot, const Type * type) {
+	if (type->base.kind == TypeArray) {
+		GLsizeiptr offset = EmitData(writer, type, sizeof(struct TypeArray));
+		
+		EmitType(writer, offset + offsetof(struct TypeArray, elementType), 
+				 type->array.elementType);
+		EmitPointer(writer, slot, offset);
+	} else if (GlesBasicType(type->base.kind, type->base.prec) == type) {
+		if (writer->base) {
+			*(void **) (writer->base + slot) = 
+				(void *) (size_t) ((type->base.kind << 2) | type->base.prec);
+			writer->types[writer->numTypes] = slot;
+		}
+		
+		++writer->numTypes;
+	} else {
+		/* structures are not part of the IL */
+		writer->error = GL_TRUE;
+	}
+}
+
+static void EmitProgVars(ImageWriter * writer, GLsizeiptr slot, const ProgVar * var) {
+	GLsizeiptr offset;
+	
+	for (; var; var = var->base.next) {
+		if (!var->base.used) {
+			continue;
+		}
+		
+		switch (var->base.kind) {
+		case ProgVarKindConst:
+			offset = EmitData(writer, var, sizeof(ProgVarConst));
+			EmitPointer(writer, offset + offsetof(ProgVarConst, values),
+						EmitData(writer, var->constant.values, 
+								 sizeof(Constant) * var->base.type->base.size));
+			break;
+			
+		case ProgVarKindTemp:
+			offset = EmitData(writer, var, sizeof(ProgVarTemp));
+			break;
+			
+		default:
+			offset = EmitData(writer, var, sizeof(ProgVarNamed));
+			EmitPointer(writer, offset + offsetof(ProgVarNamed, name),
+						EmitData(writer, var->named.name, var->named.length));
+			break;
+		}
+		
+		writer->vars[var->base.id] = offset;
+		EmitType(writer, offset + offsetof(ProgVarBase, type), var->base.type);
+		EmitPointer(writer, slot, offset);
+		slot = offset + offsetof(ProgVarBase, next);
+	}
+	
+	EmitPointer(writer, slot, IMAGE_NULL);
+}
+
+static void EmitProgVarAddrs(ImageWriter * writer, GLsizeiptr slot, const ProgVarAddr * var) {
+	GLsizeiptr offset;
+	
+	for (; var; var = var->next) {
+		if (var->used) {
+			offset = EmitData(writer, var, sizeof(ProgVarAddr));
+			writer->addrs[var->id] = offset;
+			EmitPointer(writer, slot, offset);
+			slot = offset + offsetof(ProgVarAddr, next);
+		}
+	}
+	
+	EmitPointer(writer, slot, IMAGE_NULL);
+}
+
+static void EmitSrcReg(ImageWriter * writer, GLsizeiptr slot, const SrcReg * reg) {
+	EmitPointer(writer, slot + offsetof(SrcReg, reference), 
+				writer->vars[reg->reference.base->id]);
+	EmitPointer(writer, slot + offsetof(SrcReg, index), 
+				reg->index ? writer->addrs[reg->index->id] : IMAGE_NULL);
+}
+
+static void EmitDstReg(ImageWriter * writer, GLsizeiptr slot, const DstReg * reg) {
+	EmitPointer(writer, slot + offsetof(DstReg, reference), 
+				writer->vars[reg->reference.base->id]);
+}
+
+static void EmitLabel(ImageWriter * writer, GLsizeiptr slot, const Label * label) {
+	GLsizeiptr offset;
+	
+	if (!label || !label->target) {
+		writer->error = GL_TRUE;
+		return;
+	}
+	
+	/* labels are stored with each reference, without source symbol */
+	offset = EmitData(writer, label, sizeof(Label));
+	EmitPointer(writer, offset + offsetof(Label, next), IMAGE_NULL);
+	EmitPointer(writer, offset + offsetof(Label, target), 
+				writer->blocks[label->target->id]);
+	EmitPointer(writer, offset + offsetof(Label, symbol), IMAGE_NULL);
+	EmitPointer(writer, slot, offset);
+}
+
+static GLsizeiptr EmitInst(ImageWriter * writer, const Inst * inst) {
+	GLsizeiptr offset;
+	
+	switch (inst->base.kind) {
+	case InstKindBase:
+		return EmitData(writer, inst, sizeof(InstBase));
+		
+	case InstKindSrc:
+		offset = EmitData(writer, inst, sizeof(InstSrc));
+		EmitSrcReg(writer, offset + offsetof(InstSrc, arg), &inst->src.arg);
+		return offset;
+		
+	case InstKindUnary:
+		offset = EmitData(writer, inst, sizeof(InstUnary));
+		EmitDstReg(writer, offset + offsetof(InstAlu, dst), &inst->alu.dst);
+		EmitSrcReg(writer, offset + offsetof(InstUnary, arg), &inst->unary.arg);
+		return offset;
+		
+	case InstKindBinary:
+		offset = EmitData(writer, inst, sizeof(InstBinary));
+		EmitDstReg(writer, offset + offsetof(InstAlu, dst), &inst->alu.dst);
+		EmitSrcReg(writer, offset + offsetof(InstBinary, left), &inst->binary.left);
+		EmitSrcReg(writer, offset + offsetof(InstBinary, right), &inst->binary.right);
+		return offset;
+		
+	case InstKindTernary:
+		offset = EmitData(writer, inst, sizeof(InstTernary));
+		EmitDstReg(writer, offset + offsetof(InstAlu, dst), &inst->alu.dst);
+		EmitSrcReg(writer, offset + offsetof(InstTernary, arg0), &inst->ternary.arg0);
+		EmitSrcReg(writer, offset + offsetof(InstTernary, arg1), &inst->ternary.arg1);
+		EmitSrcReg(writer, offset + offsetof(InstTernary, arg2), &inst->ternary.arg2);
+		return offset;
+		
+	case InstKindArl:
+		offset = EmitData(writer, inst, sizeof(InstArl));
+		EmitPointer(writer, offset + offsetof(InstArl, dst), 
+					writer->addrs[inst->arl.dst->id]);
+		EmitSrcReg(writer, offset + offsetof(InstArl, arg), &inst->arl.arg);
+		return offset;
+		
+	case InstKindBranch:
+		offset = EmitData(writer, inst, sizeof(InstBranch));
+		EmitLabel(writer, offset + offsetof(InstBranch, target), inst->branch.target);
+		return offset;
+		
+	case InstKindCond:
+		return EmitData(writer, inst, sizeof(InstCond));
+		
+	case InstKindSwizzle:
+		offset = EmitData(writer, inst, sizeof(InstSwizzle));
+		EmitDstReg(writer, offset + offsetof(InstAlu, dst), &inst->alu.dst);
+		EmitPointer(writer, offset + offsetof(InstSwizzle, arg), 
+					writer->vars[inst->swizzle.arg.base->id]);
+		return offset;
+		
+	case InstKindTex:
+		offset = EmitData(writer, inst, sizeof(InstTex));
+		EmitDstReg(writer, offset + offsetof(InstAlu, dst), &inst->alu.dst);
+		EmitSrcReg(writer, offset + offsetof(InstTex, coords), &inst->tex.coords);
+		EmitPointer(writer, offset + offsetof(InstTex, sampler), 
+					writer->vars[inst->tex.sampler->base.id]);
+		return offset;
+		
+	/*InstKindMemory*/
+	case InstKindPhi:
+	default:
+		writer->error = GL_TRUE;
+		return EmitData(writer, inst, sizeof(InstBase));
+	}
+}
+
+static void EmitBlocks(ImageWriter * writer, GLsizeiptr listSlot, const BlockList * list) {
+	const Block * block;
+	const Inst * inst;
+	GLsizeiptr slot = listSlot + offsetof(BlockList, head);
+	GLsizeiptr offset, instSlot, instOffset, prevInst, prevBlock = IMAGE_NULL;
+	
+	for (block = list->head; block; block = block->next) {
+		offset = EmitData(writer, block, sizeof(Block));
+		writer->blocks[block->id] = offset;
+		EmitPointer(writer, slot, offset);
+		EmitPointer(writer, offset + offsetof(Block, prev), prevBlock);
+		
+		instSlot = offset + offsetof(Block, first);
+		prevInst = IMAGE_NULL;
+		
+		for (inst = block->first; inst; inst = inst->base.next) {
+			instOffset = EmitInst(writer, inst);
+			EmitPointer(writer, instSlot, instOffset);
+			EmitPointer(writer, instOffset + offsetof(InstBase, prev), prevInst);
+			instSlot = instOffset + offsetof(InstBase, next);
+			prevInst = instOffset;
+		}
+		
+		EmitPointer(writer, instSlot, IMAGE_NULL);
+		EmitPointer(writer, offset + offsetof(Block, last), prevInst);
+		
+		slot = offset + offsetof(Block, next);
+		prevBlock = offset;
+	}
+	
+	EmitPointer(writer, slot, IMAGE_NULL);
+	EmitPointer(writer, listSlot + offsetof(BlockList, tail), prevBlock);
+}
+
+static GLsizeiptr EmitShaderProgram(ImageWriter * writer, const ShaderProgram * program) {
+	ShaderProgramImage header;
+	GLsizeiptr offset;
+	
+	GlesMemset(&header, 0, sizeof(header));
+	EmitData(writer, &header, sizeof(header));
+	
+	offset = EmitData(writer, program, sizeof(ShaderProgram));
+	EmitPointer(writer, offset + offsetof(ShaderProgram, memory), IMAGE_NULL);
+	EmitPointer(writer, offset + offsetof(ShaderProgram, labels), IMAGE_NULL);
+	EmitPointer(writer, offset + offsetof(ShaderProgram, main), IMAGE_NULL);
+	
+	/* variables precede the instructions referring to them */
+	EmitProgVarAddrs(writer, offset + offsetof(ShaderProgram, addr), program->addr);
+	EmitProgVars(writer, offset + offsetof(ShaderProgram, param), program->param);
+	EmitProgVars(writer, offset + offsetof(ShaderProgram, temp), program->temp);
+	EmitProgVars(writer, offset + offsetof(ShaderProgram, out), program->out);
+	EmitProgVars(writer, offset + offsetof(ShaderProgram, in), program->in);
+	
+	EmitProgVars(writer, offset + offsetof(ShaderProgram, constants), program->constants);
+	EmitPointer(writer, offset + offsetof(ShaderProgram, constantIndex), IMAGE_NULL);
+	
+	EmitBlocks(writer, offset + offsetof(ShaderProgram, blocks), &program->blocks);
+	
+	return offset;
+}
+
 /**
  * Write the shader program to the log stream in human readable form.
  * 
@@ -909,3 +1205,66 @@ void GlesWriteShaderProgram(Log * log, const ShaderProgram * program) {
 	}
 }
 
+
+/**
+ * Create the binary image of a shader program. Only variables that are
+ * referenced by instructions are included, as in the textual form.
+ * 
+ * @param	program	the shader program to store
+ * @param	temp	memory pool for temporary data
+ * @param	size	out: size of the image in bytes
+ * 
+ * @return	the image, which needs to be released using GlesFree, or NULL if
+ * 			out of memory
+ */
+void * GlesSaveShaderProgram(const ShaderProgram * program, MemoryPool * temp, 
+							 GLsizeiptr * size) {
+	ImageWriter writer;
+	ShaderProgramImage * header;
+	GLsizeiptr dataSize, programOffset;
+	
+	GlesMemset(&writer, 0, sizeof(writer));
+	writer.vars = 
+		GlesMemoryPoolAllocate(temp, sizeof(GLsizeiptr) * (program->numVars + 1));
+	writer.addrs = 
+		GlesMemoryPoolAllocate(temp, sizeof(GLsizeiptr) * (program->numAddrVars + 1));
+	writer.blocks = 
+		GlesMemoryPoolAllocate(temp, sizeof(GLsizeiptr) * (program->numBlocks + 1));
+	
+	MarkUsedVariables(program);
+	
+	/* first pass: determine layout of image */
+	EmitShaderProgram(&writer, program);
+	
+	if (writer.error) {
+		return NULL;
+	}
+	
+	dataSize = (writer.size + IMAGE_ALIGNMENT - 1) & ~(GLsizeiptr) (IMAGE_ALIGNMENT - 1);
+	*size = dataSize + sizeof(GLsizeiptr) * (writer.numRelocs + writer.numTypes);
+	writer.base = GlesMalloc(*size);
+	
+	if (!writer.base) {
+		return NULL;
+	}
+	
+	/* second pass: fill in image contents */
+	GlesMemset(writer.base, 0, *size);
+	writer.relocs = (GLsizeiptr *) (writer.base + dataSize);
+	writer.types = writer.relocs + writer.numRelocs;
+	writer.size = writer.numRelocs = writer.numTypes = 0;
+	
+	programOffset = EmitShaderProgram(&writer, program);
+	
+	header = (ShaderProgramImage *) writer.base;
+	header->magic = GLES_IL_IMAGE_MAGIC;
+	header->version = GLES_IL_IMAGE_VERSION;
+	header->size = *size;
+	header->program = programOffset;
+	header->relocs = dataSize;
+	header->numRelocs = writer.numRelocs;
+	header->types = dataSize + sizeof(GLsizeiptr) * writer.numRelocs;
+	header->numTypes = writer.numTypes;
+	
+	return writer.base;
+}
@@ -47,6 +47,9 @@
 #include "frontend/memory.h"
 #include "frontend/types.h"
 #include "frontend/il.h"
+#include "backend/interp.h"
+#include "backend/optimize.h"
+#include "backend/x86.h"
 
 /*
 ** --------------------------------------------------------------------------
@@ -57,6 +60,7 @@
 static const char * ErrorMessages[] = {
 	"I0000: Internal compiler error",
 	"I0001: Out of memory error",
+	"I0002: Invalid program binary",
 	"L0001: Globals must have the same type (including the same names for"
 			" structure and field names) and precision.", 
 	"L0004: Too many attribute values.", 
@@ -87,11 +91,22 @@ static GLboolean PrepareLinker(Linker * linker, Program * program) {
 	
 	linker->program = program;	
 	
-	linker->tempMemory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &linker->allocationHandler);
-	linker->workMemory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &linker->allocationHandler);
-	linker->resultMemory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &linker->allocationHandler);
+	/* working pools are retained across links and cleared by CleanupLinker */
+	if (!linker->tempMemory) {
+		linker->tempMemory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &linker->allocationHandler);
+	}
+	
+	if (!linker->workMemory) {
+		linker->workMemory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &linker->allocationHandler);
+	}
+	
+	if (!linker->resultMemory) {
+		linker->resultMemory = GlesMemoryPoolCreate(GLES_DEFAULT_PAGE_SIZE, &linker->allocationHandler);
+	}
 	
 	linker->uniforms = NULL;
+	linker->attribs = NULL;
+	linker->numUniforms = linker->sizeUniforms = linker->numAttribs = 0;
 	
 	return GL_TRUE;
 }
@@ -104,10 +119,26 @@ static GLboolean PrepareLinker(Linker * linker, Program * program) {
  * @return	GL_TRUE if the operation was successful
  */
 static GLboolean LoadShaders(Linker * linker) {
-	Shader * fragmentShader = 
+	Shader * fragmentShader, * vertexShader;
+	
+	if (linker->specialize) {
+		/* variants are linked from the IL retained with the executable */
+		linker->fragment = 
+			GlesLoadShaderProgram(linker->specialize->fragmentIL.binary, 
+								  linker->specialize->fragmentIL.binarySize,
+								  linker->workMemory);
+		linker->vertex = 
+			GlesLoadShaderProgram(linker->specialize->vertexIL.binary, 
+								  linker->specialize->vertexIL.binarySize,
+								  linker->workMemory);
+
+		return linker->fragment != NULL && linker->vertex != NULL;
+	}
+	
+	fragmentShader = 
 		GlesGetShaderObject(linker->state, linker->program->fragmentShader);
 		
-	Shader * vertexShader = 
+	vertexShader = 
 		GlesGetShaderObject(linker->state, linker->program->vertexShader);
 
 	if (!fragmentShader || !vertexShader) {
@@ -117,12 +148,12 @@ static GLboolean LoadShaders(Linker * linker) {
 	}
 	
 	linker->fragment = 
-		GlesParseShaderProgram(fragmentShader->il, fragmentShader->size, 
-							   linker->workMemory, linker->tempMemory);
+		GlesLoadShaderProgram(fragmentShader->binary, fragmentShader->binarySize, 
+							  linker->workMemory);
 
 	linker->vertex = 
-		GlesParseShaderProgram(vertexShader->il, vertexShader->size, 
-							   linker->workMemory, linker->tempMemory);
+		GlesLoadShaderProgram(vertexShader->binary, vertexShader->binarySize, 
+							  linker->workMemory);
 							   
 	return linker->fragment != NULL && linker->vertex != NULL;
 }
@@ -133,7 +164,20 @@ typedef struct String {
 } String;
 
 /**
- * Mark all special variables within the given list of variables.
+ * Special variable and the storage location it is bound to.
+ */
+typedef struct SpecialVariable {
+	String					name;			/* variable name */
+	ProgVarSegment			segment;		/* segment containing the value */
+	GLsizeiptr				location;		/* location within segment in words */
+} SpecialVariable;
+
+#define SPECIAL_NAME(name)	{ name, sizeof(name) - 1 }
+#define WORD_OFFSETOF(T, member) (offsetof(T, member) / sizeof(GLfloat))
+
+/**
+ * Mark all special variables within the given list of variables, and bind 
+ * them to their storage location.
  * 
  * @param list
  * 		pointer to linked list of variables
@@ -145,14 +189,18 @@ typedef struct String {
  * 		number of elements in special variable names array
  */
 static void MarkSpecialVariableList(ProgVar * list, 
-									const String * specials, GLsizei numSpecials) {
+									const SpecialVariable * specials, 
+									GLsizei numSpecials) {
 	for (; list; list = list->base.next) {
 		GLsizei index;
 		
 		for (index = 0; index < numSpecials; ++index) {
-			if (list->named.length == specials[index].length &&
-				!GlesMemcmp(list->named.name, specials[index].name, specials[index].length)) {
+			if (list->named.length == specials[index].name.length &&
+				!GlesMemcmp(list->named.name, specials[index].name.name, 
+							specials[index].name.length)) {
 				list->base.special = GL_TRUE;
+				list->base.segment = specials[index].segment;
+				list->base.location = specials[index].location;
 			}
 		}
 	}
@@ -167,22 +215,22 @@ static void MarkSpecialVariableList(ProgVar * list,
  */
 static GLboolean MarkSpecialVariables(Linker * linker) {
 	/* Special input variables to the fragment shader that are not varyings */
-	static const String specialFragmentInputs[] = {
-		{ "gl_FragCoord", sizeof("gl_FragCoord") },
-		{ "gl_FrontFacing", sizeof("gl_FrontFacing") },
-		{ "gl_PointCoord", sizeof("gl_PointCoord") }
+	static const SpecialVariable specialFragmentInputs[] = {
+		{ SPECIAL_NAME("gl_FragCoord"), 	ProgVarSegSpecial, 	WORD_OFFSETOF(FragContext, fragCoord) 	},
+		{ SPECIAL_NAME("gl_FrontFacing"), 	ProgVarSegSpecial, 	WORD_OFFSETOF(FragContext, frontFacing) },
+		{ SPECIAL_NAME("gl_PointCoord"), 	ProgVarSegSpecial, 	WORD_OFFSETOF(FragContext, pointCoord) 	}
 	};
 	
 	/* Special output variables of the fragment shader */
-	static const String specialFragmentOutputs[] = {
-		{ "gl_FragColor", sizeof("gl_FragColor") },
-		{ "gl_FragData", sizeof("gl_FragData") },
+	static const SpecialVariable specialFragmentOutputs[] = {
+		{ SPECIAL_NAME("gl_FragColor"), 	ProgVarSegResult, 	0 },
+		{ SPECIAL_NAME("gl_FragData"), 		ProgVarSegResult, 	0 },
 	};
 	
 	/* Special output variables of the vertex shader that are not varyings */
-	static const String specialVertexOutputs[] = {
-		{ "gl_Position", sizeof("gl_Position") },
-		{ "gl_PointSize", sizeof("gl_PointSize") },
+	static const SpecialVariable specialVertexOutputs[] = {
+		{ SPECIAL_NAME("gl_Position"), 		ProgVarSegResult, 	WORD_OFFSETOF(VertexGeometry, position)  },
+		{ SPECIAL_NAME("gl_PointSize"), 	ProgVarSegResult, 	WORD_OFFSETOF(VertexGeometry, pointSize) },
 	};
 	
 	MarkSpecialVariableList(linker->vertex->out, 
@@ -283,7 +331,7 @@ static GLboolean AllocateVariables(Linker * linker, AllocationMap * map,
 		} else if (map->columnLength[2] + type->base.size + map->rowsUsed2 <= map->rows) {
 			map->rowsUsed2 += type->base.size;
 			variable->offset = map->rows - map->rowsUsed2;
-			variable->shift = 3;
+			variable->shift = 2;
 			
 			for (index = 0; index < type->base.elements; ++index) {
 				map->columnLength[index + 2] = map->rowsUsed2;
@@ -488,12 +536,49 @@ static GLboolean MapVaryings(Linker * linker) {
 	return success;
 }
 
+/**
+ * Allocate the vertex attribute variables of the vertex shader to attribute
+ * slots, and create the attribute table exposed through the API.
+ * 
+ * @param	linker	reference to linker object
+ * 
+ * @return	GL_TRUE if the operation was successful
+ */
 static GLboolean AllocateAttribs(Linker * linker) {
 	/* 
-		TODO: allocate attrib variables; take calls to glBindAttribLocation
-		into consideration
+		TODO: take calls to glBindAttribLocation into consideration
 	*/
 	
+	ProgVar * var;
+	GLsizeiptr numAttribs = 0, location = 0, index = 0;
+	
+	for (var = linker->vertex->in; var; var = var->base.next) {
+		++numAttribs;
+	}
+	
+	linker->numAttribs = numAttribs;
+	linker->attribs = 
+		GlesMemoryPoolAllocate(linker->resultMemory, 
+							   sizeof(ShaderVariable) * numAttribs);
+	
+	for (var = linker->vertex->in; var; var = var->base.next, ++index) {
+		if (location + var->base.type->base.size > GLES_MAX_VERTEX_ATTRIBS) {
+			GlesLinkError(linker, LinkL0004);
+			return GL_FALSE;
+		}
+		
+		var->base.segment = ProgVarSegAttrib;
+		var->base.location = location * 4;
+		
+		linker->attribs[index].name = var->named.name;
+		linker->attribs[index].length = var->named.length;
+		linker->attribs[index].location = location;
+		linker->attribs[index].size = var->base.type->base.size;
+		linker->attribs[index].type = var->base.type->base.kind;
+		
+		location += var->base.type->base.size;
+	}
+	
 	return GL_TRUE;
 }
 
@@ -600,6 +685,8 @@ static GLboolean CreateGlobalUniformTable(Linker * linker) {
 		location += linker->uniforms[index].size;
 	}
 	
+	linker->sizeUniforms = location;
+	
 	return GL_TRUE;
 }
 
@@ -618,7 +705,7 @@ static GLboolean PackUniforms(Linker * linker, ShaderProgram * shader,
 	AllocationMap 		allocationMap;
 	VariableInfo *		variables;
 	GLsizei				numUniforms = 0;
-	GLsizei				hash, index;
+	GLsizei				index;
 	ProgVar *			var;
 	GLboolean			success;
 						
@@ -628,11 +715,9 @@ static GLboolean PackUniforms(Linker * linker, ShaderProgram * shader,
 		++numUniforms;
 	}	
 	
-	for (hash = 0; hash < GLES_CONSTANT_HASH; ++hash) {
-		for (var = shader->constants[hash]; var; var = var->base.next) {
-			++numUniforms;
-		}	
-	}
+	for (var = shader->constants; var; var = var->base.next) {
+		++numUniforms;
+	}	
 	
 	/* Create a map of all variables and constants */
 	
@@ -647,12 +732,10 @@ static GLboolean PackUniforms(Linker * linker, ShaderProgram * shader,
 		variables[index].variable[1] = var;
 	}	
 
-	for (hash = 0; hash < GLES_CONSTANT_HASH; ++hash) {
-		for (var = shader->constants[hash]; var; var = var->base.next, ++index) {
-			variables[index].variable[0] = var;
-			variables[index].variable[1] = var;
-		}	
-	}
+	for (var = shader->constants; var; var = var->base.next, ++index) {
+		variables[index].variable[0] = var;
+		variables[index].variable[1] = var;
+	}	
 
 	InitAllocationMap(linker, &allocationMap, components);	
 	SortVariables(variables, numUniforms);
@@ -694,7 +777,6 @@ static void MapConstants(Linker * linker, ShaderProgram * shader,
 						 Segment * segment, GLsizei storage) {
 
 	Vec4f * 	base;
-	GLsizei		hash, index;
 	ProgVar *	var;
 	
 	segment->size = storage;
@@ -702,69 +784,91 @@ static void MapConstants(Linker * linker, ShaderProgram * shader,
 	
 	base = (Vec4f *) segment->base;
 	
-	for (hash = 0; hash < GLES_CONSTANT_HASH; ++hash) {
-		for (var = shader->constants[hash]; var; var = var->base.next, ++index) {
-			GLES_ASSERT(var->base.segment == ProgVarSegParam);
-			GLfloat * start = base[var->base.location].v + var->base.shift;
-			GLsizei elements = var->base.type->base.elements;
-			GLsizei words = var->base.type->base.size;
-			GLsizei index;
-			Constant * constant = var->constant.values;
+	for (var = shader->constants; var; var = var->base.next) {
+		GLES_ASSERT(var->base.segment == ProgVarSegParam);
+		/* location is given in words, including the component shift */
+		GLfloat * start = base->v + var->base.location;
+		GLsizei elements = var->base.type->base.elements;
+		GLsizei words = var->base.type->base.size;
+		GLsizei index;
+		Constant * constant = var->constant.values;
+		
+		/* need to discriminate based on type */
+		while (words--) {
+			switch (var->base.type->base.kind) {
+			case TypeBool:
+			case TypeBoolVec2:
+			case TypeBoolVec3:
+			case TypeBoolVec4:
+				for (index = 0; index < elements; ++index) {
+					start[index] = constant->boolValue[index];
+				}
 			
-			/* need to discriminate based on type */
-			while (words--) {
-				switch (var->base.type->base.kind) {
-				case TypeBool:
-				case TypeBoolVec2:
-				case TypeBoolVec3:
-				case TypeBoolVec4:
-					for (index = 0; index < elements; ++index) {
-						start[index] = constant->boolValue[index];
-					}
+				break;
 				
-					break;
-					
-				case TypeInt:	
-				case TypeIntVec2:
-				case TypeIntVec3:
-				case TypeIntVec4:
-					for (index = 0; index < elements; ++index) {
-						start[index] = constant->intValue[index];
-					}
+			case TypeInt:	
+			case TypeIntVec2:
+			case TypeIntVec3:
+			case TypeIntVec4:
+				for (index = 0; index < elements; ++index) {
+					start[index] = constant->intValue[index];
+				}
+		
+				break;
 			
-					break;
-				
-				
-				case TypeFloat:	
-				case TypeFloatVec2:
-				case TypeFloatVec3:
-				case TypeFloatVec4:
-				case TypeFloatMat2:
-				case TypeFloatMat3:
-				case TypeFloatMat4:
-					for (index = 0; index < elements; ++index) {
-						start[index] = constant->floatValue[index];
-					}
 			
-					break;
-				
-				
-				case TypeSampler2D:
-				case TypeSampler3D:
-				case TypeSamplerCube:
-					/* at this point, we do not support constant samplers */
-					
-				default:
-					GLES_ASSERT(GL_FALSE);
+			case TypeFloat:	
+			case TypeFloatVec2:
+			case TypeFloatVec3:
+			case TypeFloatVec4:
+			case TypeFloatMat2:
+			case TypeFloatMat3:
+			case TypeFloatMat4:
+				for (index = 0; index < elements; ++index) {
+					start[index] = constant->floatValue[index];
 				}
-								
-				start += 4;
-				constant += 1;
+		
+				break;
+			
+			
+			case TypeSampler2D:
+			case TypeSampler3D:
+			case TypeSamplerCube:
+				/* at this point, we do not support constant samplers */
+				
+			default:
+				GLES_ASSERT(GL_FALSE);
 			}
-		}	
+							
+			start += 4;
+			constant += 1;
+		}
 	}	
 }
 
+/**
+ * Bind the uniform variables of a shader to their location within the
+ * program-wide uniform storage, which is the storage area that is
+ * modified through the glUniform*() API functions.
+ *
+ * @param	linker	reference to linker object
+ * @param	shader	reference to shader object
+ */
+static void MapUniforms(Linker * linker, ShaderProgram * shader) {
+	ProgVar * var;
+	
+	for (var = shader->param; var; var = var->base.next) {
+		ShaderVariable * uniform = 
+			GlesFindShaderVariable(linker->uniforms, linker->numUniforms,
+								   var->named.name, var->named.length);
+								   
+		GLES_ASSERT(uniform);
+		
+		var->base.segment = ProgVarSegUniform;
+		var->base.location = uniform->location * 4;
+	}
+}
+
 static GLboolean MergeUniforms(Linker * linker) {
 	
 	GLsizei	vertexUniformWords = 0;
@@ -777,12 +881,11 @@ static GLboolean MergeUniforms(Linker * linker) {
 
 	2.	Create a variable/memory location map for the union of the
 		PARAM variables. This map is based on vec4 memory model.
+		
+		Both steps are performed by CreateGlobalUniformTable before the
+		shaders are optimized.
 	*/
 	
-	if (!CreateGlobalUniformTable(linker)) {
-		return GL_FALSE;
-	}
-	
 	/*		
 	3.	Pack the variables and constants for the vertex shader
 	*/
@@ -831,134 +934,1219 @@ static GLboolean MergeUniforms(Linker * linker) {
 
 	/*
 	9.	Rewrite vertex program to reflect new variable allocations
+	*/
+	MapUniforms(linker, linker->vertex);
 	
+	/*
 	10.	Rewrite fragment program to reflect new variable allocations
 	*/
+	MapUniforms(linker, linker->fragment);
 
 	return GL_TRUE;
 }
 
-static Executable * GenerateExecutable(Linker * linker) {
-	return NULL;
+/**
+ * Determine if the value of a uniform variable of the given type can be
+ * folded into the code of a shader.
+ *
+ * @param	type	the type of the uniform variable
+ *
+ * @return	GL_TRUE for scalar, vector and matrix types
+ */
+static GLboolean IsSpecializable(const Type * type) {
+	switch (type->base.kind) {
+	case TypeBool:
+	case TypeBoolVec2:
+	case TypeBoolVec3:
+	case TypeBoolVec4:
+	case TypeInt:
+	case TypeIntVec2:
+	case TypeIntVec3:
+	case TypeIntVec4:
+	case TypeFloat:
+	case TypeFloatVec2:
+	case TypeFloatVec3:
+	case TypeFloatVec4:
+	case TypeFloatMat2:
+	case TypeFloatMat3:
+	case TypeFloatMat4:
+		return GL_TRUE;
+		
+	default:
+		return GL_FALSE;
+	}
 }
 
-static Executable * Link(Linker * linker) {
-
-	GLES_ASSERT(linker);
-	
-	if (LoadShaders(linker) 			&&
-		MarkSpecialVariables(linker)	&&
-		MapVaryings(linker)				&&
-		AllocateAttribs(linker)			&&
-		MergeUniforms(linker)) {
-		return GenerateExecutable(linker);
-	} else {
-		return NULL;
+/**
+ * Replace the uniform variables of a shader that have been selected using
+ * #pragma specialize by constants holding their current values.
+ *
+ * @param	linker	reference to linker object
+ * @param	shader	reference to shader object
+ */
+static void SpecializeShaderUniforms(Linker * linker, ShaderProgram * shader) {
+	ProgVar ** link = &shader->param, * var;
+	
+	while ((var = *link) != NULL) {
+		const ShaderVariable * uniform = NULL;
+		const Vec4f * data;
+		Constant * values;
+		GLsizei row, index;
+		
+		if (var->base.specialize && IsSpecializable(var->base.type)) {
+			uniform = 
+				GlesFindShaderVariable(linker->uniforms, linker->numUniforms,
+									   var->named.name, var->named.length);
+		}
+		
+		if (!uniform) {
+			link = &var->base.next;
+			continue;
+		}
+		
+		data = linker->program->uniformData + uniform->location;
+		values = 
+			GlesMemoryPoolAllocate(linker->workMemory, 
+								   sizeof(Constant) * var->base.type->base.size);
+		
+		for (row = 0; row < var->base.type->base.size; ++row) {
+			for (index = 0; index < 4; ++index) {
+				switch (var->base.type->base.kind) {
+				case TypeBool:
+				case TypeBoolVec2:
+				case TypeBoolVec3:
+				case TypeBoolVec4:
+					values[row].boolValue[index] = data[row].v[index] != 0.0f;
+					break;
+					
+				case TypeInt:
+				case TypeIntVec2:
+				case TypeIntVec3:
+				case TypeIntVec4:
+					values[row].intValue[index] = (GLint) data[row].v[index];
+					break;
+					
+				default:
+					values[row].floatValue[index] = data[row].v[index];
+					break;
+				}
+			}
+		}
+		
+		/* turn the variable into a constant */
+		*link = var->base.next;
+		var->base.kind = ProgVarKindConst;
+		var->constant.values = values;
+		
+		var->base.next = shader->constants;
+		shader->constants = var;
+		shader->constantIndex = NULL;
 	}
 }
 
-static void CleanupLinker(Linker * linker) {
-	linker->program = NULL;
-	
-	if (linker->tempMemory) {
-		GlesMemoryPoolDestroy(linker->tempMemory);
-	}
-	
-	if (linker->workMemory) {
-		GlesMemoryPoolDestroy(linker->workMemory);
+/**
+ * When linking a specialized variant of an executable, replace the uniform
+ * variables that have been selected using #pragma specialize by constants
+ * holding their current values, such that the optimizer can fold them into
+ * the code. The variables remain part of the global uniform table, so the
+ * variant shares the uniform storage layout of the generic executable.
+ *
+ * @param	linker	reference to linker object
+ *
+ * @return	GL_TRUE if the operation was successful
+ */
+static GLboolean SpecializeUniforms(Linker * linker) {
+	if (linker->specialize) {
+		SpecializeShaderUniforms(linker, linker->vertex);
+		SpecializeShaderUniforms(linker, linker->fragment);
 	}
 	
-	if (linker->resultMemory) {
-		GlesMemoryPoolDestroy(linker->resultMemory);
-	}
-} 
-
-/*
-** --------------------------------------------------------------------------
-** Internal functions
-** --------------------------------------------------------------------------
-*/
+	return GL_TRUE;
+}
 
-Linker * GlesLinkerCreate(State * state) {
-	Linker * linker = GlesMalloc(sizeof (Linker));
-	
-	if (linker) {
-		linker->state = state;
+/**
+ * Determine the optimization passes to apply to a shader of the program,
+ * as selected by #pragma optimize within the shader.
+ *
+ * @param	linker	reference to linker object
+ * @param	type	GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ *
+ * @return	the set of OptimizePass values to apply
+ */
+static GLbitfield GetOptimizePasses(Linker * linker, GLenum type) {
+	if (linker->specialize) {
+		return type == GL_VERTEX_SHADER ?
+			linker->specialize->vertexIL.optimize :
+			linker->specialize->fragmentIL.optimize;
+	} else {
+		return GlesGetShaderObject(linker->state, 
+			type == GL_VERTEX_SHADER ? 
+				linker->program->vertexShader :
+				linker->program->fragmentShader)->optimize;
 	}
-	
-	return linker;
 }
 
-void GlesLinkerDestroy(Linker * linker) {
-	GLES_ASSERT(linker);
+/**
+ * Run the IL optimizer on the vertex and fragment shader, using the set of
+ * passes selected by #pragma optimize within each shader.
+ *
+ * Varyings that are not used by the fragment shader have been converted
+ * into temporaries by MapVaryings, so the instructions computing them are
+ * removed as dead code.
+ *
+ * @param	linker	reference to linker object
+ *
+ * @return	GL_TRUE if the operation was successful
+ */
+static GLboolean OptimizeShaders(Linker * linker) {
+	GlesOptimizeShaderProgram(linker, linker->vertex, 
+							  GetOptimizePasses(linker, GL_VERTEX_SHADER));
+	GlesOptimizeShaderProgram(linker, linker->fragment, 
+							  GetOptimizePasses(linker, GL_FRAGMENT_SHADER));
 	
-	GlesFree(linker);
+	return GL_TRUE;
 }
 
 /**
- * Append an error message to the linker log.
- * 
+ * Split the computations that depend only on constants and uniforms off
+ * a shader into a pre-shader, and extend the data segment of the shader
+ * by the rows receiving the values computed by the pre-shader.
+ *
  * @param	linker	reference to linker object
- * @param	error	error message code
+ * @param	shader	reference to shader object
+ * @param	type	GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ * @param	data	the data segment created by MergeUniforms
+ *
+ * @return	the pre-shader, or NULL if there is nothing to hoist
  */
-void GlesLinkError(Linker * linker, LinkError error) {
-	GLES_ASSERT(linker);
-	GLES_ASSERT(linker->program);
+static ShaderProgram * HoistShader(Linker * linker, ShaderProgram * shader,
+								   GLenum type, Segment * data) {
+	ShaderProgram * pre;
+	GLsizeiptr rows;
+	Vec4f * base;
 	
-	GlesLogAppend(&linker->program->log, ErrorMessages[error], GlesStrlen(ErrorMessages[error]));
+	if (!(GetOptimizePasses(linker, type) & OptimizeHoist)) {
+		return NULL;
+	}
+	
+	pre = GlesHoistShaderProgram(linker, shader, data->size, &rows);
+	
+	if (pre && rows) {
+		base = GlesMemoryPoolAllocate(linker->workMemory, 
+									  (data->size + rows) * sizeof(Vec4f));
+		GlesMemcpy(base, data->base, data->size * sizeof(Vec4f));
+		
+		data->base = base;
+		data->size += rows;
+	}
+	
+	return pre;
 }
 
 /**
- * Append an error message to the linker log.
- * 
+ * Split the computations that depend only on constants and uniforms off
+ * the vertex and fragment shader, such that they are evaluated once per
+ * draw call instead of once per vertex or fragment.
+ *
  * @param	linker	reference to linker object
- * @param	error	error message code
- * @param	name		name of offending symbol
- * @param	length		string length of symbol name
+ *
+ * @return	GL_TRUE if the operation was successful
  */
-void GlesLinkErrorSymbol(Linker * linker, LinkError error, 
-	const char * name, GLsizeiptr length) {
-	GLES_ASSERT(linker);
-	GLES_ASSERT(linker->program);
-
-	GlesLogAppend(&linker->program->log, ErrorMessages[error], GlesStrlen(ErrorMessages[error]));
-	GlesLogAppend(&linker->program->log, name, length);
+static GLboolean HoistShaders(Linker * linker) {
+	linker->vertexPre = 
+		HoistShader(linker, linker->vertex, GL_VERTEX_SHADER, 
+					&linker->vertexData);
+	linker->fragmentPre = 
+		HoistShader(linker, linker->fragment, GL_FRAGMENT_SHADER, 
+					&linker->fragmentData);
+	
+	return GL_TRUE;
 }
 
 /**
- * Link the vertex shader with the fragment shader for the given program,
- * and create a binary executable that can be executed later-on.
- * 
+ * Allocate all temporary variables of a shader into the local data segment.
+ * Temporaries with disjoint live ranges share storage; if the control flow
+ * of the shader cannot be analyzed, each temporary gets its own location.
+ *
  * @param	linker	reference to linker object
- * @param	program	reference to the program to link
- * 
- * @return	reference to a newly created executable for the program, or NULL
- * 			in case an error occurred.
+ * @param	shader	reference to shader object
+ *
+ * @return	number of vec4 words needed for temporary storage
  */
-Executable * GlesLinkProgram(Linker * linker, Program * program) {
-
-	Executable * result = NULL;
-		
-	GLES_ASSERT(program);
-	GLES_ASSERT(linker->state);
+static GLsizeiptr AllocateTemps(Linker * linker, ShaderProgram * shader) {
+	ProgVar * var;
+	GLsizeiptr location = 0;
 	
-	if (!GlesSetjmp(linker->allocationHandler)) {
-		if (PrepareLinker(linker, program)) {
-			result = Link(linker);
-		}
-	} else {
-		GlesLinkError(linker, LinkI0001);
+	if (GlesAllocateShaderTemps(linker, shader, &location)) {
+		return location;
 	}
-		
-	CleanupLinker(linker);
 	
-	return result;
+	for (var = shader->temp; var; var = var->base.next) {
+		var->base.segment = ProgVarSegLocal;
+		var->base.location = location * 4;
+		location += var->base.type->base.size;
+	}
+	
+	return location;
 }
 
 /**
- * Destructor for shader binary object.
+ * Create a copy of a table of shader variables, including their names, as
+ * a single memory block.
  *
- * @param	binary	the binary to destroy
+ * @param	variables	the variable table to copy
+ * @param	count		number of entries in the table
+ *
+ * @return	the newly allocated copy, or NULL if out of memory
+ */
+static ShaderVariable * CopyShaderVariables(const ShaderVariable * variables, 
+											GLsizeiptr count) {
+	GLsizeiptr size = sizeof(ShaderVariable) * count, index;
+	ShaderVariable * result;
+	char * names;
+	
+	for (index = 0; index < count; ++index) {
+		size += variables[index].length + 1;
+	}
+	
+	result = GlesMalloc(size ? size : 1);
+	
+	if (!result) {
+		return NULL;
+	}
+	
+	names = (char *) (result + count);
+	
+	for (index = 0; index < count; ++index) {
+		result[index] = variables[index];
+		result[index].name = names;
+		GlesMemcpy(names, variables[index].name, variables[index].length);
+		names[variables[index].length] = '\0';
+		names += variables[index].length + 1;
+	}
+	
+	return result;
+}
+
+/**
+ * Generate the binary for a single shader.
+ *
+ * @param	linker	reference to linker object
+ * @param	shader	reference to shader object
+ * @param	pre		the pre-shader split off the shader, or NULL
+ * @param	data	the data segment created by MergeUniforms
+ * @param	type	GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ * @param	binary	the binary to generate
+ *
+ * @return	GL_TRUE if the operation was successful
+ */
+static GLboolean GenerateShaderBinary(Linker * linker, ShaderProgram * shader,
+									  ShaderProgram * pre, const Segment * data, 
+									  GLenum type, ShaderBinary * binary) {
+	binary->bssSize = AllocateTemps(linker, shader);
+	binary->data.size = data->size;
+	
+	if (pre) {
+		/* the pre-shader runs ahead of the shader, so they can share temps */
+		binary->bssSize = GlesMaxi(binary->bssSize, AllocateTemps(linker, pre));
+		
+		if (!GlesInterpGeneratePre(linker, pre, binary, type)) {
+			return GL_FALSE;
+		}
+	}
+	
+	if (data->size) {
+		binary->data.base = GlesMalloc(data->size * sizeof(Vec4f));
+		
+		if (!binary->data.base) {
+			GlesLinkError(linker, LinkI0001);
+			return GL_FALSE;
+		}
+		
+		GlesMemcpy(binary->data.base, data->base, data->size * sizeof(Vec4f));
+	}
+	
+	if (!GlesInterpGenerate(linker, shader, binary, type)) {
+		return GL_FALSE;
+	}
+	
+#if GLES_JIT_X86_64
+	/* 
+	 * If no native code can be generated we stay with the interpreter.
+	 * Native code outperforms batched interpretation, unless a fragment
+	 * shader needs 2x2 quads for derivatives or the level of detail of
+	 * texture accesses, which only batched execution provides.
+	 */
+	if (GlesX86Generate(linker, binary, type) &&
+		(type == GL_VERTEX_SHADER || !GlesInterpNeedsQuads(binary))) {
+		binary->batchEntry = NULL;
+	}
+#endif
+
+	return GL_TRUE;
+}
+
+/**
+ * Determine if the depth and stencil tests can be performed before the
+ * fragment program runs. This requires that the program neither discards
+ * fragments nor writes a depth value of its own; the latter is not
+ * possible in this implementation, so only KIL needs to be checked.
+ *
+ * @param	shader	the optimized fragment shader program
+ *
+ * @return	GL_TRUE if fragments can be tested before shading
+ */
+static GLboolean CanTestEarly(const ShaderProgram * shader) {
+	const Block * block;
+	const Inst * inst;
+	
+	for (block = shader->blocks.head; block; block = block->next) {
+		for (inst = block->first; inst; inst = inst->base.next) {
+			if (inst->base.op == OpcodeKIL && inst->cond.cond != CondF) {
+				return GL_FALSE;
+			}
+		}
+	}
+	
+	return GL_TRUE;
+}
+
+/**
+ * Create the executable for the linked program.
+ *
+ * @param	linker	reference to linker object
+ *
+ * @return	the new executable, or NULL in case of an error
+ */
+static Executable * GenerateExecutable(Linker * linker) {
+	Executable * executable = GlesMalloc(sizeof(Executable));
+	
+	if (!executable) {
+		GlesLinkError(linker, LinkI0001);
+		return NULL;
+	}
+	
+	executable->numUniforms = linker->numUniforms;
+	executable->uniforms = CopyShaderVariables(linker->uniforms, linker->numUniforms);
+	executable->sizeUniforms = linker->sizeUniforms;
+	executable->numVertexAttribs = linker->numAttribs;
+	executable->attribs = CopyShaderVariables(linker->attribs, linker->numAttribs);
+	executable->numVarying = linker->numVarying;
+	executable->earlyTests = CanTestEarly(linker->fragment);
+	executable->varyingMask = 
+		GlesShaderInputMask(linker->fragment, ProgVarSegVarying, 0);
+	executable->specialMask = 
+		GlesShaderInputMask(linker->fragment, ProgVarSegSpecial, 
+							WORD_OFFSETOF(FragContext, fragCoord));
+	
+	if (!executable->uniforms || !executable->attribs) {
+		GlesLinkError(linker, LinkI0001);
+		GlesDeleteExecutable(linker->state, executable);
+		return NULL;
+	}
+
+	if (!GenerateShaderBinary(linker, linker->vertex, linker->vertexPre,
+							  &linker->vertexData, GL_VERTEX_SHADER, 
+							  &executable->vertex) ||
+		!GenerateShaderBinary(linker, linker->fragment, linker->fragmentPre,
+							  &linker->fragmentData, GL_FRAGMENT_SHADER, 
+							  &executable->fragment)) {
+		GlesDeleteExecutable(linker->state, executable);
+		return NULL;
+	}
+	
+	return executable;
+}
+
+static Executable * Link(Linker * linker) {
+
+	GLES_ASSERT(linker);
+	
+	if (LoadShaders(linker) 			&&
+		MarkSpecialVariables(linker)	&&
+		MapVaryings(linker)				&&
+		AllocateAttribs(linker)			&&
+		CreateGlobalUniformTable(linker)&&
+		SpecializeUniforms(linker)		&&
+		OptimizeShaders(linker)			&&
+		MergeUniforms(linker)			&&
+		HoistShaders(linker)) {
+		return GenerateExecutable(linker);
+	} else {
+		return NULL;
+	}
+}
+
+/**
+ * Determine the uniform variables that an executable can be specialized
+ * on, which are the uniforms selected using #pragma specialize in either
+ * shader. If there are any, the IL of both shaders is retained with the
+ * executable for linking specialized variants later on.
+ *
+ * @param	linker		reference to linker object
+ * @param	executable	the executable created for the program
+ *
+ * @return	GL_TRUE if the operation was successful
+ */
+static GLboolean PrepareSpecialization(Linker * linker, Executable * executable) {
+	ShaderProgram * shaders[2];
+	Shader * vertexShader, * fragmentShader;
+	GLsizei shader, index;
+	ProgVar * var;
+	
+	if (!linker->vertex && !LoadShaders(linker)) {
+		return GL_FALSE;
+	}
+	
+	shaders[0] = linker->vertex;
+	shaders[1] = linker->fragment;
+	
+	for (shader = 0; shader < 2; ++shader) {
+		for (var = shaders[shader]->param; var; var = var->base.next) {
+			ShaderVariable * uniform;
+			
+			if (!var->base.specialize || !IsSpecializable(var->base.type)) {
+				continue;
+			}
+			
+			uniform = 
+				GlesFindShaderVariable(executable->uniforms, executable->numUniforms,
+									   var->named.name, var->named.length);
+			
+			if (!uniform) {
+				continue;
+			}
+			
+			if (!executable->specialized) {
+				executable->specialized = 
+					GlesMalloc(sizeof(GLuint) * executable->numUniforms);
+				
+				if (!executable->specialized) {
+					GlesLinkError(linker, LinkI0001);
+					return GL_FALSE;
+				}
+			}
+			
+			for (index = 0; index < executable->numSpecialized; ++index) {
+				if (executable->specialized[index] == uniform - executable->uniforms) {
+					break;
+				}
+			}
+			
+			if (index == executable->numSpecialized) {
+				executable->specialized[executable->numSpecialized++] = 
+					uniform - executable->uniforms;
+				executable->sizeSpecialized += uniform->size;
+			}
+		}
+	}
+	
+	if (!executable->numSpecialized) {
+		return GL_TRUE;
+	}
+	
+	vertexShader = GlesGetShaderObject(linker->state, linker->program->vertexShader);
+	fragmentShader = GlesGetShaderObject(linker->state, linker->program->fragmentShader);
+	
+	executable->vertexIL.binary = GlesMalloc(vertexShader->binarySize);
+	executable->fragmentIL.binary = GlesMalloc(fragmentShader->binarySize);
+	
+	if (!executable->vertexIL.binary || !executable->fragmentIL.binary) {
+		GlesLinkError(linker, LinkI0001);
+		return GL_FALSE;
+	}
+	
+	GlesMemcpy(executable->vertexIL.binary, vertexShader->binary, 
+			   vertexShader->binarySize);
+	executable->vertexIL.binarySize = vertexShader->binarySize;
+	executable->vertexIL.optimize = vertexShader->optimize;
+	
+	GlesMemcpy(executable->fragmentIL.binary, fragmentShader->binary, 
+			   fragmentShader->binarySize);
+	executable->fragmentIL.binarySize = fragmentShader->binarySize;
+	executable->fragmentIL.optimize = fragmentShader->optimize;
+	
+	return GL_TRUE;
+}
+
+static void CleanupLinker(Linker * linker) {
+	linker->program = NULL;
+	linker->specialize = NULL;
+	linker->vertex = NULL;
+	linker->fragment = NULL;
+	linker->vertexPre = NULL;
+	linker->fragmentPre = NULL;
+	
+	if (linker->tempMemory) {
+		GlesMemoryPoolClear(linker->tempMemory);
+	}
+	
+	if (linker->workMemory) {
+		GlesMemoryPoolClear(linker->workMemory);
+	}
+	
+	if (linker->resultMemory) {
+		GlesMemoryPoolClear(linker->resultMemory);
+	}
+} 
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: executable images
+** --------------------------------------------------------------------------
+*/
+
+#define IMAGE_ALIGNMENT	((GLsizeiptr) sizeof(Vec4f))
+
+static GLES_INLINE GLsizeiptr AlignImage(GLsizeiptr offset) {
+	return (offset + IMAGE_ALIGNMENT - 1) & ~(IMAGE_ALIGNMENT - 1);
+}
+
+/**
+ * Determine the placement of the segments of a shader binary within an
+ * executable image.
+ *
+ * @param	binary	the shader binary to store
+ * @param	image	out: the location of the segments within the image
+ * @param	offset	the first free offset within the image
+ *
+ * @return	the first free offset following the shader binary
+ */
+static GLsizeiptr LayoutShaderBinary(const ShaderBinary * binary,
+									 ShaderBinaryImage * image,
+									 GLsizeiptr offset) {
+	image->codeSize = binary->code.size;
+	image->batchSize = binary->batch.base ? binary->batch.size : 0;
+	image->preSize = binary->pre.base ? binary->pre.size : 0;
+	image->dataSize = binary->data.base ? binary->data.size : 0;
+	image->bssSize = binary->bssSize;
+
+	image->code = offset = AlignImage(offset);
+	offset += image->codeSize * sizeof(InterpInst);
+	image->batch = offset = AlignImage(offset);
+	offset += image->batchSize * sizeof(InterpInst);
+	image->pre = offset = AlignImage(offset);
+	offset += image->preSize * sizeof(InterpInst);
+	image->data = offset = AlignImage(offset);
+	offset += image->dataSize * sizeof(Vec4f);
+
+	return offset;
+}
+
+/**
+ * Calculate the checksum stored in the header of an executable image, which
+ * covers all bytes following the header. This is an FNV-1a hash.
+ *
+ * @param	bytes	the executable image
+ * @param	size	the size of the image in bytes
+ *
+ * @return	the checksum of the image
+ */
+static GLuint ChecksumImage(const GLubyte * bytes, GLsizeiptr size) {
+	GLuint checksum = 2166136261u;
+	GLsizeiptr index;
+
+	for (index = sizeof(ExecutableImage); index < size; ++index) {
+		checksum = (checksum ^ bytes[index]) * 16777619u;
+	}
+
+	return checksum;
+}
+
+/**
+ * Determine the layout of the binary image of an executable.
+ *
+ * @param	executable	the executable to store
+ * @param	header		out: the image header describing the layout
+ *
+ * @return	the total size of the image in bytes
+ */
+static GLsizeiptr LayoutExecutable(const Executable * executable,
+								   ExecutableImage * header) {
+	GLsizeiptr offset, index;
+
+	GlesMemset(header, 0, sizeof(ExecutableImage));
+	header->magic = GLES_EXEC_IMAGE_MAGIC;
+	header->version = GLES_EXEC_IMAGE_VERSION;
+	GlesMemcpy(header->build, GLES_BUILD_NUMBER,
+			   GlesMini(sizeof(GLES_BUILD_NUMBER), GLES_EXEC_IMAGE_BUILD));
+	header->instSize = sizeof(InterpInst);
+	header->numUniforms = executable->numUniforms;
+	header->numVertexAttribs = executable->numVertexAttribs;
+	header->numVarying = executable->numVarying;
+	header->sizeUniforms = executable->sizeUniforms;
+	header->earlyTests = executable->earlyTests;
+	header->varyingMask = executable->varyingMask;
+	header->specialMask = executable->specialMask;
+
+	offset = AlignImage(sizeof(ExecutableImage));
+	header->uniforms = offset;
+	offset += executable->numUniforms * sizeof(ShaderVariable);
+	header->attribs = offset;
+	offset += executable->numVertexAttribs * sizeof(ShaderVariable);
+
+	for (index = 0; index < executable->numUniforms; ++index) {
+		offset += executable->uniforms[index].length + 1;
+	}
+
+	for (index = 0; index < executable->numVertexAttribs; ++index) {
+		offset += executable->attribs[index].length + 1;
+	}
+
+	offset = LayoutShaderBinary(&executable->vertex, &header->vertex, offset);
+	offset = LayoutShaderBinary(&executable->fragment, &header->fragment, offset);
+	header->size = offset;
+
+	return offset;
+}
+
+/**
+ * Store a table of shader variables into an executable image.
+ *
+ * @param	image		the executable image
+ * @param	variables	the variables to store
+ * @param	count		the number of variables
+ * @param	offset		the offset of the variable table within the image
+ * @param	names		the offset of the next free name within the image
+ *
+ * @return	the offset following the names of the stored variables
+ */
+static GLsizeiptr SaveShaderVariables(GLubyte * image,
+									  const ShaderVariable * variables,
+									  GLsizei count, GLsizeiptr offset,
+									  GLsizeiptr names) {
+	ShaderVariable * target = (ShaderVariable *) (image + offset);
+	GLsizei index;
+
+	for (index = 0; index < count; ++index) {
+		target[index] = variables[index];
+		target[index].name = (char *) (size_t) names;
+		GlesMemcpy(image + names, variables[index].name, variables[index].length);
+		names += variables[index].length + 1;
+	}
+
+	return names;
+}
+
+/**
+ * Store the segments of a shader binary into an executable image.
+ *
+ * @param	image	the executable image
+ * @param	binary	the shader binary to store
+ * @param	layout	the location of the segments within the image
+ */
+static void SaveShaderBinary(GLubyte * image, const ShaderBinary * binary,
+							 const ShaderBinaryImage * layout) {
+	GlesMemcpy(image + layout->code, binary->code.base,
+			   layout->codeSize * sizeof(InterpInst));
+
+	if (layout->batchSize) {
+		GlesMemcpy(image + layout->batch, binary->batch.base,
+				   layout->batchSize * sizeof(InterpInst));
+	}
+
+	if (layout->preSize) {
+		GlesMemcpy(image + layout->pre, binary->pre.base,
+				   layout->preSize * sizeof(InterpInst));
+	}
+
+	if (layout->dataSize) {
+		GlesMemcpy(image + layout->data, binary->data.base,
+				   layout->dataSize * sizeof(Vec4f));
+	}
+}
+
+/**
+ * Verify that an array of elements lies completely within an image.
+ *
+ * @param	offset		the offset of the first element
+ * @param	count		the number of elements
+ * @param	elementSize	the size of a single element in bytes
+ * @param	size		the size of the image in bytes
+ *
+ * @return	GL_TRUE if the array is contained in the image
+ */
+static GLboolean InImage(GLsizeiptr offset, GLsizeiptr count,
+						 GLsizeiptr elementSize, GLsizeiptr size) {
+	return offset >= 0 && offset <= size && count >= 0 &&
+		count <= (size - offset) / elementSize;
+}
+
+/**
+ * Read a table of shader variables from an executable image.
+ *
+ * @param	linker	reference to linker object
+ * @param	image	the executable image
+ * @param	size	the size of the image in bytes
+ * @param	offset	the offset of the variable table within the image
+ * @param	count	the number of variables
+ * @param	limit	upper bound for the locations occupied by the variables
+ *
+ * @return	the variables in the layout of CopyShaderVariables, or NULL
+ */
+static ShaderVariable * LoadShaderVariables(Linker * linker,
+											const GLubyte * image,
+											GLsizeiptr size, GLsizeiptr offset,
+											GLsizei count, GLsizei limit) {
+	ShaderVariable * variables;
+	GLsizei index;
+
+	if (!InImage(offset, count, sizeof(ShaderVariable), size)) {
+		return NULL;
+	}
+
+	variables =
+		GlesMemoryPoolAllocate(linker->tempMemory,
+							   sizeof(ShaderVariable) * (count ? count : 1));
+	GlesMemcpy(variables, image + offset, sizeof(ShaderVariable) * count);
+
+	for (index = 0; index < count; ++index) {
+		ShaderVariable * variable = &variables[index];
+		GLsizeiptr name = (GLsizeiptr) (size_t) variable->name;
+
+		if (!InImage(name, variable->length + 1, 1, size) ||
+			image[name + variable->length] != '\0' ||
+			variable->location < 0 || variable->size < 0 ||
+			variable->location > limit - variable->size) {
+			return NULL;
+		}
+
+		variable->name = (char *) image + name;
+	}
+
+	return CopyShaderVariables(variables, count);
+}
+
+/**
+ * Read the segments of a shader binary from an executable image and
+ * prepare the code for execution.
+ *
+ * @param	linker	reference to linker object
+ * @param	image	the executable image
+ * @param	size	the size of the image in bytes
+ * @param	layout	the location of the segments within the image
+ * @param	type	GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+ * @param	binary	out: the shader binary
+ *
+ * @return	GL_TRUE if the shader binary has been read successfully
+ */
+static GLboolean LoadShaderBinary(Linker * linker, const GLubyte * image,
+								  GLsizeiptr size,
+								  const ShaderBinaryImage * layout,
+								  GLenum type, ShaderBinary * binary) {
+	if (layout->codeSize < 1 || layout->bssSize < 0 ||
+		!InImage(layout->code, layout->codeSize, sizeof(InterpInst), size) ||
+		!InImage(layout->batch, layout->batchSize, sizeof(InterpInst), size) ||
+		!InImage(layout->pre, layout->preSize, sizeof(InterpInst), size) ||
+		!InImage(layout->data, layout->dataSize, sizeof(Vec4f), size)) {
+		return GL_FALSE;
+	}
+
+	binary->bssSize = layout->bssSize;
+	binary->code.size = layout->codeSize;
+	binary->code.base = GlesMalloc(layout->codeSize * sizeof(InterpInst));
+
+	if (!binary->code.base) {
+		return GL_FALSE;
+	}
+
+	GlesMemcpy(binary->code.base, image + layout->code,
+			   layout->codeSize * sizeof(InterpInst));
+
+	if (layout->batchSize) {
+		binary->batch.size = layout->batchSize;
+		binary->batch.base = GlesMalloc(layout->batchSize * sizeof(InterpInst));
+
+		if (!binary->batch.base) {
+			return GL_FALSE;
+		}
+
+		GlesMemcpy(binary->batch.base, image + layout->batch,
+				   layout->batchSize * sizeof(InterpInst));
+	}
+
+	if (layout->preSize) {
+		binary->pre.size = layout->preSize;
+		binary->pre.base = GlesMalloc(layout->preSize * sizeof(InterpInst));
+
+		if (!binary->pre.base) {
+			return GL_FALSE;
+		}
+
+		GlesMemcpy(binary->pre.base, image + layout->pre,
+				   layout->preSize * sizeof(InterpInst));
+	}
+
+	if (layout->dataSize) {
+		binary->data.size = layout->dataSize;
+		binary->data.base = GlesMalloc(layout->dataSize * sizeof(Vec4f));
+
+		if (!binary->data.base) {
+			return GL_FALSE;
+		}
+
+		GlesMemcpy(binary->data.base, image + layout->data,
+				   layout->dataSize * sizeof(Vec4f));
+	}
+
+	if (!GlesInterpRelocate(binary, type)) {
+		return GL_FALSE;
+	}
+
+#if GLES_JIT_X86_64
+	/* native code is not part of the image and is generated anew */
+	if (GlesX86Generate(linker, binary, type) &&
+		(type == GL_VERTEX_SHADER || !GlesInterpNeedsQuads(binary))) {
+		binary->batchEntry = NULL;
+	}
+#endif
+
+	return GL_TRUE;
+}
+
+/**
+ * Re-create an executable from its binary image.
+ *
+ * @param	linker	reference to linker object
+ * @param	image	the executable image
+ * @param	size	the size of the image in bytes
+ *
+ * @return	the new executable, or NULL if the image is not valid for this
+ * 			build of the library
+ */
+static Executable * LoadExecutable(Linker * linker, const void * image,
+								   GLsizeiptr size) {
+	const GLubyte * bytes = (const GLubyte *) image;
+	ExecutableImage header;
+	Executable * executable;
+
+	if (size < (GLsizeiptr) sizeof(ExecutableImage)) {
+		return NULL;
+	}
+
+	GlesMemcpy(&header, image, sizeof(ExecutableImage));
+
+	if (header.magic != GLES_EXEC_IMAGE_MAGIC ||
+		header.version != GLES_EXEC_IMAGE_VERSION ||
+		header.instSize != sizeof(InterpInst) ||
+		header.size != size ||
+		GlesStrncmp(header.build, GLES_BUILD_NUMBER, GLES_EXEC_IMAGE_BUILD) ||
+		header.numVarying < 0 || header.sizeUniforms < 0 ||
+		header.checksum != ChecksumImage(bytes, size)) {
+		return NULL;
+	}
+
+	executable = GlesMalloc(sizeof(Executable));
+
+	if (!executable) {
+		return NULL;
+	}
+
+	executable->numUniforms = header.numUniforms;
+	executable->sizeUniforms = header.sizeUniforms;
+	executable->numVertexAttribs = header.numVertexAttribs;
+	executable->numVarying = header.numVarying;
+	executable->earlyTests = header.earlyTests != GL_FALSE;
+	executable->varyingMask = header.varyingMask;
+	executable->specialMask = header.specialMask;
+
+	if (!(executable->uniforms =
+			LoadShaderVariables(linker, bytes, size, header.uniforms,
+								header.numUniforms, header.sizeUniforms)) ||
+		!(executable->attribs =
+			LoadShaderVariables(linker, bytes, size, header.attribs,
+								header.numVertexAttribs, GLES_MAX_VERTEX_ATTRIBS)) ||
+		!LoadShaderBinary(linker, bytes, size, &header.vertex,
+						  GL_VERTEX_SHADER, &executable->vertex) ||
+		!LoadShaderBinary(linker, bytes, size, &header.fragment,
+						  GL_FRAGMENT_SHADER, &executable->fragment)) {
+		GlesDeleteExecutable(linker->state, executable);
+		return NULL;
+	}
+
+	return executable;
+}
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions: program binary cache
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Add a sequence of bytes to the key of a program binary cache entry. The
+ * key combines an FNV-1a hash and a djb2 hash of the data.
+ *
+ * @param	key		the cache key to update
+ * @param	data	the bytes to add
+ * @param	size	the number of bytes
+ */
+static void HashBytes(GLuint key[2], const void * data, GLsizeiptr size) {
+	const GLubyte * bytes = (const GLubyte *) data;
+
+	while (size--) {
+		key[0] = (key[0] ^ *bytes) * 16777619u;
+		key[1] = key[1] * 33 + *bytes++;
+	}
+}
+
+/**
+ * Add the source text and link options of a shader to the key of a
+ * program binary cache entry.
+ *
+ * @param	key		the cache key to update
+ * @param	shader	the shader to add
+ */
+static void HashShader(GLuint key[2], const Shader * shader) {
+	HashBytes(key, &shader->type, sizeof(shader->type));
+	HashBytes(key, &shader->optimize, sizeof(shader->optimize));
+	HashBytes(key, &shader->length, sizeof(shader->length));
+	HashBytes(key, shader->text, shader->length);
+}
+
+/**
+ * Determine the file name of the program binary cache entry for the
+ * program currently being linked. The cache is keyed by the shader sources 
+ * and the library build, and is located in the directory named by the 
+ * environment variable GLES_PROGRAM_CACHE_VARIABLE.
+ *
+ * @param	linker	reference to linker object
+ *
+ * @return	the path name of the cache entry, or NULL if the cache is disabled
+ */
+static const char * ProgramCachePath(Linker * linker) {
+	const char * directory = GlesGetenv(GLES_PROGRAM_CACHE_VARIABLE);
+	Shader * vertexShader, * fragmentShader;
+	GLuint key[2] = { 2166136261u, 5381 };
+	char * path;
+
+	if (!directory || !*directory) {
+		return NULL;
+	}
+
+	vertexShader = GlesGetShaderObject(linker->state, linker->program->vertexShader);
+	fragmentShader = GlesGetShaderObject(linker->state, linker->program->fragmentShader);
+
+	if (!vertexShader || !fragmentShader) {
+		return NULL;
+	}
+
+	HashBytes(key, GLES_BUILD_NUMBER, sizeof(GLES_BUILD_NUMBER));
+	HashShader(key, vertexShader);
+	HashShader(key, fragmentShader);
+
+	path = GlesMemoryPoolAllocate(linker->tempMemory, GlesStrlen(directory) + 32);
+	GlesSprintf(path, "%s/%08x%08x.vsx", directory, key[0], key[1]);
+
+	return path;
+}
+
+/**
+ * Retrieve the executable for the program currently being linked from
+ * the program binary cache.
+ *
+ * @param	linker	reference to linker object
+ * @param	path	the path name of the cache entry
+ *
+ * @return	the cached executable, or NULL if there is no valid entry
+ */
+static Executable * LoadCachedExecutable(Linker * linker, const char * path) {
+	GLsizeiptr size;
+	void * image = GlesReadFile(path, &size);
+	Executable * executable;
+
+	if (!image) {
+		return NULL;
+	}
+
+	executable = LoadExecutable(linker, image, size);
+	GlesFree(image);
+
+	return executable;
+}
+
+/**
+ * Store a newly linked executable in the program binary cache. Failure to
+ * do so is not an error.
+ *
+ * @param	executable	the executable to store
+ * @param	path		the path name of the cache entry
+ */
+static void StoreCachedExecutable(const Executable * executable, const char * path) {
+	GLsizeiptr size = GlesExecutableImageSize(executable);
+	void * image = GlesMalloc(size);
+
+	if (image) {
+		GlesSaveExecutable(executable, image);
+		GlesWriteFile(path, image, size);
+		GlesFree(image);
+	}
+}
+
+/*
+** --------------------------------------------------------------------------
+** Internal functions
+** --------------------------------------------------------------------------
+*/
+
+Linker * GlesLinkerCreate(State * state) {
+	Linker * linker = GlesMalloc(sizeof (Linker));
+	
+	if (linker) {
+		linker->state = state;
+	}
+	
+	return linker;
+}
+
+void GlesLinkerDestroy(Linker * linker) {
+	GLES_ASSERT(linker);
+	
+	if (linker->tempMemory) {
+		GlesMemoryPoolDestroy(linker->tempMemory);
+	}
+	
+	if (linker->workMemory) {
+		GlesMemoryPoolDestroy(linker->workMemory);
+	}
+	
+	if (linker->resultMemory) {
+		GlesMemoryPoolDestroy(linker->resultMemory);
+	}
+	
+	GlesFree(linker);
+}
+
+/**
+ * Append an error message to the linker log.
+ * 
+ * @param	linker	reference to linker object
+ * @param	error	error message code
+ */
+void GlesLinkError(Linker * linker, LinkError error) {
+	GLES_ASSERT(linker);
+	GLES_ASSERT(linker->program);
+	
+	if (linker->specialize) {
+		/* failing variants fall back to the generic executable */
+		return;
+	}
+	
+	GlesLogAppend(&linker->program->log, ErrorMessages[error], GlesStrlen(ErrorMessages[error]));
+}
+
+/**
+ * Append an error message to the linker log.
+ * 
+ * @param	linker	reference to linker object
+ * @param	error	error message code
+ * @param	name		name of offending symbol
+ * @param	length		string length of symbol name
+ */
+void GlesLinkErrorSymbol(Linker * linker, LinkError error, 
+	const char * name, GLsizeiptr length) {
+	GLES_ASSERT(linker);
+	GLES_ASSERT(linker->program);
+
+	if (linker->specialize) {
+		return;
+	}
+	
+	GlesLogAppend(&linker->program->log, ErrorMessages[error], GlesStrlen(ErrorMessages[error]));
+	GlesLogAppend(&linker->program->log, name, length);
+}
+
+/**
+ * Link the vertex shader with the fragment shader for the given program,
+ * and create a binary executable that can be executed later-on.
+ * 
+ * @param	linker	reference to linker object
+ * @param	program	reference to the program to link
+ * 
+ * @return	reference to a newly created executable for the program, or NULL
+ * 			in case an error occurred.
+ */
+Executable * GlesLinkProgram(Linker * linker, Program * program) {
+
+	Executable * result = NULL;
+		
+	GLES_ASSERT(program);
+	GLES_ASSERT(linker->state);
+	
+	if (!GlesSetjmp(linker->allocationHandler)) {
+		if (PrepareLinker(linker, program)) {
+			const char * path = ProgramCachePath(linker);
+			
+			if (!path || !(result = LoadCachedExecutable(linker, path))) {
+				result = Link(linker);
+				
+				if (result && path) {
+					StoreCachedExecutable(result, path);
+				}
+			}
+			
+			if (result && !PrepareSpecialization(linker, result)) {
+				GlesDeleteExecutable(linker->state, result);
+				result = NULL;
+			}
+		}
+	} else {
+		GlesLinkError(linker, LinkI0001);
+	}
+		
+	CleanupLinker(linker);
+	
+	return result;
+}
+
+/**
+ * Link a variant of an executable that is specialized on the current 
+ * values of the uniform variables selected using #pragma specialize. The
+ * variant is linked from the intermediate code retained with the 
+ * executable, and has the same uniform, attribute and varying layout.
+ * 
+ * Errors are not reported in the program log; the caller continues to use
+ * the generic executable instead.
+ * 
+ * @param	linker		reference to linker object
+ * @param	program		the program whose uniform values are used
+ * @param	executable	the generic executable of the program
+ * 
+ * @return	the specialized executable, or NULL in case an error occurred
+ */
+Executable * GlesSpecializeProgram(Linker * linker, Program * program,
+	const Executable * executable) {
+
+	Executable * result = NULL;
+	
+	GLES_ASSERT(program);
+	GLES_ASSERT(executable->numSpecialized);
+	
+	if (!GlesSetjmp(linker->allocationHandler)) {
+		if (PrepareLinker(linker, program)) {
+			linker->specialize = executable;
+			result = Link(linker);
+		}
+	}
+	
+	CleanupLinker(linker);
+	
+	if (result &&
+		(result->numUniforms != executable->numUniforms ||
+		 result->sizeUniforms != executable->sizeUniforms ||
+		 result->numVertexAttribs != executable->numVertexAttribs ||
+		 result->numVarying != executable->numVarying)) {
+		GlesDeleteExecutable(linker->state, result);
+		result = NULL;
+	}
+	
+	return result;
+}
+
+/**
+ * Destructor for shader binary object.
+ *
+ * @param	binary	the binary to destroy
  */
 static void DestroyShaderBinary(ShaderBinary * binary) {
 	
@@ -968,9 +2156,21 @@ static void DestroyShaderBinary(ShaderBinary * binary) {
 		GlesFree(binary->code.base);
 	}
 	
+	if (binary->batch.base) {
+		GlesFree(binary->batch.base);
+	}
+	
+	if (binary->pre.base) {
+		GlesFree(binary->pre.base);
+	}
+	
 	if (binary->data.base) {
 		GlesFree(binary->data.base);
 	}
+	
+	if (binary->native) {
+		GlesFreeExecutable(binary->native, binary->nativeSize);
+	}
 }
 
 /**
@@ -991,8 +2191,99 @@ void GlesDeleteExecutable(State * state, Executable * executable) {
 		GlesFree(executable->attribs);
 	}
 	
+	if (executable->specialized) {
+		GlesFree(executable->specialized);
+	}
+	
+	if (executable->vertexIL.binary) {
+		GlesFree(executable->vertexIL.binary);
+	}
+	
+	if (executable->fragmentIL.binary) {
+		GlesFree(executable->fragmentIL.binary);
+	}
+	
 	DestroyShaderBinary(&executable->vertex);
 	DestroyShaderBinary(&executable->fragment);
 	
 	GlesFree(executable);
 }
+
+/**
+ * Determine the size of the binary image of an executable.
+ *
+ * @param	executable	the executable
+ *
+ * @return	the size of the image in bytes
+ */
+GLsizeiptr GlesExecutableImageSize(const Executable * executable) {
+	ExecutableImage header;
+
+	return LayoutExecutable(executable, &header);
+}
+
+/**
+ * Create the binary image of an executable, which can be passed to
+ * GlesLoadExecutable() later-on, possibly by a different process.
+ *
+ * @param	executable	the executable
+ * @param	image		the memory area receiving the image, which needs to 
+ * 						provide GlesExecutableImageSize() bytes
+ */
+void GlesSaveExecutable(const Executable * executable, void * image) {
+	GLubyte * bytes = (GLubyte *) image;
+	ExecutableImage header;
+	GLsizeiptr size = LayoutExecutable(executable, &header), names;
+
+	GlesMemset(image, 0, size);
+	GlesMemcpy(image, &header, sizeof(ExecutableImage));
+
+	names = header.attribs + executable->numVertexAttribs * sizeof(ShaderVariable);
+	names = SaveShaderVariables(bytes, executable->uniforms, 
+								executable->numUniforms, header.uniforms, names);
+	SaveShaderVariables(bytes, executable->attribs, 
+						executable->numVertexAttribs, header.attribs, names);
+	
+	SaveShaderBinary(bytes, &executable->vertex, &header.vertex);
+	SaveShaderBinary(bytes, &executable->fragment, &header.fragment);
+	
+	header.checksum = ChecksumImage(bytes, size);
+	GlesMemcpy(image, &header, sizeof(ExecutableImage));
+}
+
+/**
+ * Re-create an executable from a binary image created by 
+ * GlesSaveExecutable().
+ * 
+ * @param	linker	reference to linker object
+ * @param	program	the program receiving the executable
+ * @param	image	the executable image
+ * @param	size	the size of the image in bytes
+ * 
+ * @return	reference to a newly created executable for the program, or NULL
+ * 			if the image is not valid for this build of the library.
+ */
+Executable * GlesLoadExecutable(Linker * linker, Program * program,
+								const void * image, GLsizeiptr size) {
+
+	Executable * result = NULL;
+		
+	GLES_ASSERT(program);
+	GLES_ASSERT(linker->state);
+	
+	if (!GlesSetjmp(linker->allocationHandler)) {
+		if (PrepareLinker(linker, program)) {
+			result = LoadExecutable(linker, image, size);
+			
+			if (!result) {
+				GlesLinkError(linker, LinkI0002);
+			}
+		}
+	} else {
+		GlesLinkError(linker, LinkI0001);
+	}
+		
+	CleanupLinker(linker);
+	
+	return result;
+}
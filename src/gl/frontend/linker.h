@@ -52,6 +52,22 @@
 ** --------------------------------------------------------------------------
 */
 
+#define GLES_EXEC_IMAGE_MAGIC	0x58455356	/* 'VSEX' in little endian order	*/
+#define GLES_EXEC_IMAGE_VERSION	7			/* layout version of binary image	*/
+#define GLES_EXEC_IMAGE_BUILD	32			/* space for GLES_BUILD_NUMBER		*/
+
+/**
+ * Words of the special fragment shader inputs in Executable.specialMask;
+ * bit 0 corresponds to the first word of FragContext.fragCoord.
+ */
+#define GLES_SPECIAL_FRAG_COORD		0x00f	/* gl_FragCoord						*/
+#define GLES_SPECIAL_FRONT_FACING	0x0f0	/* gl_FrontFacing					*/
+#define GLES_SPECIAL_POINT_COORD	0xf00	/* gl_PointCoord					*/
+
+#if GLES_MAX_VARYING_FLOATS > 32
+#	error "Executable.varyingMask holds one bit per varying word"
+#endif
+
 /**
  * Error codes that can occur during linking. Very conveniently :-(, the
  * specifications uses error codes for compilers and linkers, so we cannot
@@ -61,6 +77,7 @@ typedef enum LinkError {
 	
 	LinkI0000,		/* Internal compiler error						*/
 	LinkI0001,		/* Out of memory error							*/
+	LinkI0002,		/* Invalid program binary						*/
 	
 	LinkL0001, 		/* Globals must have the same type 				*/
 	LinkL0004, 		/* Too many attribute values.					*/ 
@@ -94,10 +111,26 @@ typedef struct Segment {
  */
 typedef struct ShaderBinary {
 	Segment		code;					/**< shader code segment			*/
+	Segment		batch;					/**< batched shader code, or empty	*/
 	Segment		data;					/**< shader data segment (uniform)	*/
+	Segment		pre;					/**< per-draw pre-shader, or empty	*/
 	GLsizeiptr	bssSize;				/**< size of temporary segment		*/
+	void *		entry;					/**< entry point function			*/
+	void *		batchEntry;				/**< batched entry point, or NULL	*/
+	void *		native;					/**< native code area, or NULL		*/
+	GLsizeiptr	nativeSize;				/**< size of native code in bytes	*/
 } ShaderBinary;
 
+/**
+ * Intermediate code of a shader retained with an executable, such that
+ * variants of the executable can be linked later on.
+ */
+typedef struct ShaderIL {
+	void *			binary;				/**< binary image of IL				*/
+	GLsizeiptr		binarySize;			/**< size of binary image in bytes	*/
+	GLbitfield		optimize;			/**< OptimizePass set for linking	*/
+} ShaderIL;
+
 typedef struct Executable {
 
 	/* meta-data */	
@@ -110,28 +143,89 @@ typedef struct Executable {
 	/* working storage */
 	GLsizei			numVarying;			/**< number of varying vectors		*/
 	GLsizei			sizeUniforms;		/**< number of uniform vectors		*/
+	GLboolean		earlyTests;			/**< depth/stencil before shading	*/
+	GLuint			varyingMask;		/**< varying words read by fragment	*/
+	GLuint			specialMask;		/**< special inputs read, see above	*/
 
 	/* actual shader code */
 	ShaderBinary	vertex;				/**< vertex shader binary			*/
 	ShaderBinary	fragment;			/**< fragment shader binary			*/
+	
+	/* specialization on uniform values */
+	GLsizei			numSpecialized;		/**< number of specialized uniforms	*/
+	GLuint *		specialized;		/**< uniform indices, or NULL		*/
+	GLsizei			sizeSpecialized;	/**< number of specialized vectors	*/
+	ShaderIL		vertexIL;			/**< IL of vertex shader			*/
+	ShaderIL		fragmentIL;			/**< IL of fragment shader			*/
 } Executable;
 
+/**
+ * Location of a shader binary within the binary image of an executable.
+ * Segment sizes are counted in the units of the corresponding Segment,
+ * i.e. in instructions for code and in vec4 for data.
+ */
+typedef struct ShaderBinaryImage {
+	GLsizeiptr		code;				/**< offset of code segment			*/
+	GLsizeiptr		codeSize;			/**< number of instructions			*/
+	GLsizeiptr		batch;				/**< offset of batched code segment	*/
+	GLsizeiptr		batchSize;			/**< number of batched instructions	*/
+	GLsizeiptr		pre;				/**< offset of pre-shader code		*/
+	GLsizeiptr		preSize;			/**< number of pre-shader insts.	*/
+	GLsizeiptr		data;				/**< offset of data segment			*/
+	GLsizeiptr		dataSize;			/**< size of data segment			*/
+	GLsizeiptr		bssSize;			/**< size of temporary segment		*/
+} ShaderBinaryImage;
+
+/**
+ * Header of the binary image of an executable, as returned by 
+ * glGetProgramBinaryOES and kept in the program binary cache. Variable
+ * tables are stored as arrays of ShaderVariable, whose name fields hold
+ * byte offsets from the start of the image. Images are only accepted by 
+ * the build that created them, and only if the checksum over the bytes
+ * following the header matches.
+ */
+typedef struct ExecutableImage {
+	GLuint			magic;				/**< GLES_EXEC_IMAGE_MAGIC			*/
+	GLuint			version;			/**< GLES_EXEC_IMAGE_VERSION		*/
+	char			build[GLES_EXEC_IMAGE_BUILD];	/**< GLES_BUILD_NUMBER	*/
+	GLsizeiptr		instSize;			/**< size of instruction in bytes	*/
+	GLsizeiptr		size;				/**< total size of image in bytes	*/
+	GLuint			checksum;			/**< checksum of data after header	*/
+	GLsizei			numUniforms;		/**< number of uniform entries		*/
+	GLsizeiptr		uniforms;			/**< offset of uniform table		*/
+	GLsizei			numVertexAttribs;	/**< number of vertex attributes	*/
+	GLsizeiptr		attribs;			/**< offset of attribute table		*/
+	GLsizei			numVarying;			/**< number of varying vectors		*/
+	GLsizei			sizeUniforms;		/**< number of uniform vectors		*/
+	GLboolean		earlyTests;			/**< depth/stencil before shading	*/
+	GLuint			varyingMask;		/**< varying words read by fragment	*/
+	GLuint			specialMask;		/**< special inputs read			*/
+	ShaderBinaryImage	vertex;			/**< vertex shader binary			*/
+	ShaderBinaryImage	fragment;		/**< fragment shader binary			*/
+} ExecutableImage;
+
 /**
  * Linker object.
  */
 typedef struct Linker {
 	State *					state;		/**< reference to GL state			*/
 	Program *				program;	/**< currently processed program	*/
+	const Executable *		specialize;	/**< executable being specialized	*/
 	
 	struct ShaderProgram *	vertex;		/**< IL vertex program				*/
 	struct ShaderProgram *	fragment;	/**< IL fragment program			*/
+	struct ShaderProgram *	vertexPre;	/**< IL vertex pre-shader, or NULL	*/
+	struct ShaderProgram *	fragmentPre;/**< IL fragment pre-shader, or NULL*/
 	
 	JumpBuffer				allocationHandler;	/**< handler to use for pool allocation failures */
 
 	GLsizeiptr				numVarying;	/**< number of varying vectors		*/
 	GLsizeiptr				numUniforms;/**< number of all uniform vars		*/
+	GLsizeiptr				sizeUniforms;/**< number of all uniform vectors	*/
+	GLsizeiptr				numAttribs;	/**< number of attribute variables	*/
 	
 	ShaderVariable *		uniforms;	/**< all uniform variables			*/
+	ShaderVariable *		attribs;	/**< all attribute variables		*/
 	
 	Segment					vertexData;		/**< uniform storage for VS		*/
 	Segment					fragmentData;	/**< uniform storage for FS		*/
@@ -151,19 +245,55 @@ Linker * GlesLinkerCreate(State * state);
 void GlesLinkerDestroy(Linker * linker);
 
 Executable * GlesLinkProgram(Linker * linker, Program * program);
+Executable * GlesSpecializeProgram(Linker * linker, Program * program,
+	const Executable * executable);
 void GlesLinkError(Linker * linker, LinkError error);
 void GlesLinkErrorSymbol(Linker * linker, LinkError error,
 	const char * name, GLsizeiptr length);
 void GlesDeleteExecutable(State * state, Executable * executable);
 
+GLsizeiptr GlesExecutableImageSize(const Executable * executable);
+void GlesSaveExecutable(const Executable * executable, void * image);
+Executable * GlesLoadExecutable(Linker * linker, Program * program,
+	const void * image, GLsizeiptr size);
+
 GLES_INLINE static FragmentProgram GlesFragmentProgram(Executable * executable) {
-	GLubyte * address = (GLubyte *) executable->fragment.code.base;
-	return (FragmentProgram) address;
+	return (FragmentProgram) executable->fragment.entry;
+}
+
+GLES_INLINE static FragmentBatchProgram GlesFragmentBatchProgram(Executable * executable) {
+	return (FragmentBatchProgram) executable->fragment.batchEntry;
 }
 
 GLES_INLINE static VertexProgram GlesVertexProgram(Executable * executable) {
-	GLubyte * address = (GLubyte *) executable->vertex.code.base;
-	return (VertexProgram) address;
+	return (VertexProgram) executable->vertex.entry;
+}
+
+GLES_INLINE static VertexBatchProgram GlesVertexBatchProgram(Executable * executable) {
+	return (VertexBatchProgram) executable->vertex.batchEntry;
+}
+
+/**
+ * Collect the indices of the varying words read by the fragment shader, in
+ * ascending order. Rasterizers set up and interpolate only these words.
+ * 
+ * @param	executable	the current executable
+ * @param	live		out: the word indices, GLES_MAX_VARYING_FLOATS entries
+ * 
+ * @return	the number of varying words read
+ */
+GLES_INLINE static GLsizei GlesLiveVaryings(const Executable * executable, 
+											GLubyte * live) {
+	GLuint mask = executable->varyingMask;
+	GLsizei count = 0, index;
+	
+	for (index = 0; mask; ++index, mask >>= 1) {
+		if (mask & 1) {
+			live[count++] = (GLubyte) index;
+		}
+	}
+	
+	return count;
 }
 
 
@@ -53,19 +53,27 @@
 */
 
 #define HEAP_ALIGNMENT	8
+#define SIZE_CLASSES	7				/* free lists for 8 .. 512 bytes	*/
 
 typedef struct MemoryPage {
 	struct MemoryPage * 	next;			/* next page in pool		*/
 	GLubyte * 				base;			/* memory base address		*/
 	GLsizeiptr 				total;			/* total memory in page		*/
+	GLsizeiptr				used;			/* memory handed out		*/
 } MemoryPage;
 
+typedef struct FreeBlock {
+	struct FreeBlock *		next;			/* next block of same class	*/
+} FreeBlock;
 
 struct MemoryPool {
 	JumpBuffer * 		handler;			/* exception handler		*/
-	MemoryPage *		pages;				/* list of pages			*/
+	MemoryPage *		pages;				/* list of pages in use		*/
+	MemoryPage *		free;				/* recycled, cleared pages	*/
 	GLsizeiptr 			defaultPageSize;	/* standard page size		*/
+	GLsizeiptr			pageSize;			/* size of next new page	*/
 	GLsizeiptr 			current;			/* used memory in page		*/
+	FreeBlock *			blocks[SIZE_CLASSES];	/* released blocks		*/
 };
 
 /*
@@ -81,13 +89,93 @@ static MemoryPage * CreatePage(GLsizeiptr pageSize) {
 	if (result) {
 		result->base = (GLubyte *) GlesMalloc(pageSize);
 		result->total = pageSize;
+		result->used = 0;
 		result->next = (MemoryPage *) 0;
+		
+		if (!result->base) {
+			GlesFree(result);
+			result = (MemoryPage *) 0;
+		}
 	}
 	
 	return result;
 
 }
 
+static void DestroyPages(MemoryPage * pages) {
+	MemoryPage * current, *next;
+
+	for (current = pages; current != (MemoryPage *) 0; current = next) {
+		next = current->next;
+		GlesFree(current->base);
+		GlesFree(current);
+	}
+}
+
+/**
+ * Obtain a page for an allocation that does not fit into the current page.
+ * Recycled pages are used first; new pages grow in size up to
+ * GLES_MAX_PAGE_SIZE, such that pools needing a lot of memory end up with
+ * few large pages.
+ * 
+ * @param pool
+ * 		the pool needing a new page
+ * @param amount
+ * 		the minimum size of the page
+ * @return
+ * 		a cleared page, or NULL if out of memory
+ */
+static MemoryPage * NextPage(MemoryPool * pool, GLsizeiptr amount) {
+	MemoryPage ** link, * page;
+	
+	for (link = &pool->free; (page = *link) != (MemoryPage *) 0; link = &page->next) {
+		if (page->total >= amount) {
+			*link = page->next;
+			page->next = (MemoryPage *) 0;
+			return page;
+		}
+	}
+	
+	if (amount > pool->pageSize) { 
+		return CreatePage(amount);
+	}
+	
+	page = CreatePage(pool->pageSize);
+
+	if (page && pool->pageSize < GLES_MAX_PAGE_SIZE) {
+		pool->pageSize *= 2;
+	}
+	
+	return page;
+}
+
+/**
+ * Determine the free list for blocks of a given size.
+ * 
+ * @param amount
+ * 		the aligned block size
+ * @param allocate
+ * 		if true, find the smallest class whose blocks hold amount bytes,
+ * 		otherwise the largest class whose blocks fit into amount bytes
+ * @return
+ * 		the index of the size class, or SIZE_CLASSES if none applies
+ */
+static GLsizei SizeClass(GLsizeiptr amount, GLboolean allocate) {
+	GLsizei sizeClass = 0;
+	GLsizeiptr size = HEAP_ALIGNMENT;
+	
+	while (sizeClass < SIZE_CLASSES && size < amount) {
+		++sizeClass;
+		size *= 2;
+	}
+	
+	if (!allocate && size > amount) {
+		--sizeClass;
+	}
+	
+	return sizeClass;
+}
+
 /*
 ** --------------------------------------------------------------------------
 ** Internal functions
@@ -112,7 +200,10 @@ MemoryPool * GlesMemoryPoolCreate(GLsizeiptr defaultPageSize, JumpBuffer * handl
 	if (pool) {
 		pool->handler = handler;
 		pool->defaultPageSize = defaultPageSize;
+		pool->pageSize = defaultPageSize;
 		pool->current = 0;
+		pool->free = NULL;
+		GlesMemset(pool->blocks, 0, sizeof(pool->blocks));
 		pool->pages = CreatePage(defaultPageSize);
 		
 		if (!pool->pages) {
@@ -143,34 +234,66 @@ void GlesMemoryPoolHandler(MemoryPool * pool, JumpBuffer * handler) {
  * 		the pool to destroy
  */
 void GlesMemoryPoolDestroy(MemoryPool * pool) {
-	MemoryPage * current, *next;
-
-	for (current = pool->pages; current != (MemoryPage *) 0; current = next) {
-		next = current->next;
-		GlesFree(current->base);
-		GlesFree(current);
-	}
-
+	DestroyPages(pool->pages);
+	DestroyPages(pool->free);
 	GlesFree(pool);
 }
 
 /**
- * Clear the given memory pool and reset to initial size.
+ * Clear the given memory pool for reuse. All memory allocated from the
+ * pool is released at once, but the pages are retained for subsequent
+ * allocations, such that a pool that is cleared repeatedly settles at the
+ * largest amount of memory used in between. Released memory is zeroed,
+ * as is any memory newly allocated from the pool.
  *
  * @param pool
- * 		the pool to destroy
+ * 		the pool to clear
  */
 void GlesMemoryPoolClear(MemoryPool * pool) {
 	MemoryPage * current, *next;
 
+	if (pool->pages) {
+		pool->pages->used = pool->current;
+	}
+	
 	for (current = pool->pages; current != (MemoryPage *) 0; current = next) {
 		next = current->next;
-		GlesFree(current->base);
-		GlesFree(current);
+		GlesMemset(current->base, 0, current->used);
+		current->used = 0;
+		current->next = pool->free;
+		pool->free = current;
 	}
 	
 	pool->pages = NULL;
 	pool->current = 0;
+	GlesMemset(pool->blocks, 0, sizeof(pool->blocks));
+}
+
+/**
+ * Return a block of memory to the pool for reuse by subsequent allocations
+ * of a similar size. This is useful for long-lived blocks that are 
+ * replaced by larger copies, such as growing arrays.
+ * 
+ * @param pool
+ * 		the pool from which the block had been allocated
+ * @param ptr
+ * 		the block to release; may be NULL
+ * @param amount
+ * 		the size of the block as requested from GlesMemoryPoolAllocate
+ */
+void GlesMemoryPoolFree(MemoryPool * pool, void * ptr, GLsizeiptr amount) {
+	GLsizei sizeClass;
+	FreeBlock * block = (FreeBlock *) ptr;
+	
+	amount = (amount + HEAP_ALIGNMENT - 1) & ~(HEAP_ALIGNMENT - 1);
+
+	if (!block || amount < HEAP_ALIGNMENT ||
+		(sizeClass = SizeClass(amount, GL_FALSE)) >= SIZE_CLASSES) {
+		return;
+	}
+	
+	block->next = pool->blocks[sizeClass];
+	pool->blocks[sizeClass] = block;
 }
 
 /**
@@ -183,17 +306,21 @@ void GlesMemoryPoolClear(MemoryPool * pool) {
  */
 void * GlesMemoryPoolAllocate(MemoryPool * pool, GLsizeiptr amount) {
 	void * result;
+	GLsizei sizeClass;
 
 	amount = (amount + HEAP_ALIGNMENT - 1) & ~(HEAP_ALIGNMENT - 1);
+	sizeClass = SizeClass(amount, GL_TRUE);
 
+	if (sizeClass < SIZE_CLASSES && pool->blocks[sizeClass]) {
+		FreeBlock * block = pool->blocks[sizeClass];
+		
+		pool->blocks[sizeClass] = block->next;
+		GlesMemset(block, 0, HEAP_ALIGNMENT << sizeClass);
+		return block;
+	}
+	
 	if (!pool->pages || pool->pages->total - pool->current < amount) {
-		MemoryPage * newPage;
-
-		if (amount > pool->defaultPageSize) { 
-			newPage = CreatePage(amount);
-		} else {
-			newPage = CreatePage(pool->defaultPageSize);
-		}
+		MemoryPage * newPage = NextPage(pool, amount);
 
 		if (!newPage) {
 			if (pool->handler) {
@@ -203,6 +330,10 @@ void * GlesMemoryPoolAllocate(MemoryPool * pool, GLsizeiptr amount) {
 			}
 		}
 		
+		if (pool->pages) {
+			pool->pages->used = pool->current;
+		}
+		
 		newPage->next = pool->pages;
 		pool->pages = newPage;
 		pool->current = 0;
@@ -50,6 +50,7 @@
 */
 
 #define GLES_DEFAULT_PAGE_SIZE 	8192
+#define GLES_MAX_PAGE_SIZE		(16 * GLES_DEFAULT_PAGE_SIZE)
 
 /*
 ** --------------------------------------------------------------------------
@@ -70,6 +71,7 @@ void GlesMemoryPoolHandler(MemoryPool * pool, JumpBuffer * handler);
 void GlesMemoryPoolClear(MemoryPool * pool);
 void GlesMemoryPoolDestroy(MemoryPool * pool);
 void * GlesMemoryPoolAllocate(MemoryPool * pool, GLsizeiptr amount);
+void GlesMemoryPoolFree(MemoryPool * pool, void * ptr, GLsizeiptr amount);
 
 
 #endif /* GLES_FRONTEND_MEMORY_H */
\ No newline at end of file
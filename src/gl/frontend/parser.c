@@ -394,7 +394,6 @@ static GLboolean ParseTypeSpecifierNoPrec(Compiler * compiler, Precision precisi
  			Symbol * symbol = 
  				GlesSymbolFindNested(compiler->currentScope,
  									 compiler->tokenizer->token.s.first,
- 									 compiler->tokenizer->token.s.length,
  									 ~0);
  									 
  			if (!symbol || symbol->base.qualifier != QualifierTypeName) {
@@ -538,6 +537,7 @@ static GLboolean ParseArguments(Compiler * compiler, GLsizei * numArgs, Expressi
 				Expression ** oldArgs = *args;
 				*args = GlesMemoryPoolAllocate(compiler->exprMemory, 2 * allocated * sizeof(Expression *));
 				GlesMemcpy(*args, oldArgs, allocated * sizeof(Expression *));
+				GlesMemoryPoolFree(compiler->exprMemory, oldArgs, allocated * sizeof(Expression *));
 				allocated *= 2;				
 			}
 
@@ -591,7 +591,6 @@ static GLboolean ParsePrimaryExpression(Compiler * compiler, Expression ** expre
  			Symbol * symbol = 
  				GlesSymbolFindNested(compiler->currentScope,
  									 compiler->tokenizer->token.s.first,
- 									 compiler->tokenizer->token.s.length,
  									 ~0);
  						
  			if (!symbol) {
@@ -1288,7 +1287,6 @@ static GLboolean ParseExpressionOrDeclaration(Compiler * compiler) {
  			Symbol * symbol = 
  				GlesSymbolFindNested(compiler->currentScope,
  									 compiler->tokenizer->token.s.first,
- 									 compiler->tokenizer->token.s.length,
  									 ~0);
  						
  			if (symbol && symbol->base.qualifier == QualifierTypeName) {
@@ -1482,7 +1480,6 @@ static GLboolean ParseForCondition(Compiler * compiler, Symbol ** loopIndex,
 	*loopIndex =
 		GlesSymbolFindNested(compiler->currentScope,
 							 compiler->tokenizer->token.s.first,
-							 compiler->tokenizer->token.s.length,
 							 ~0);
 		
 	if (!*loopIndex) {
@@ -1849,6 +1846,10 @@ static GLboolean ParseAsmUnary(Compiler * compiler, GLuint * continuationMask) {
 	case TokenTypeAsmABS_SAT:	opcode = OpcodeABS_SAT;		break;
 	case TokenTypeAsmCOS:		opcode = OpcodeCOS;			break;
 	case TokenTypeAsmCOS_SAT:	opcode = OpcodeCOS_SAT;		break;
+	case TokenTypeAsmDDX:		opcode = OpcodeDDX;			break;
+	case TokenTypeAsmDDX_SAT:	opcode = OpcodeDDX_SAT;		break;
+	case TokenTypeAsmDDY:		opcode = OpcodeDDY;			break;
+	case TokenTypeAsmDDY_SAT:	opcode = OpcodeDDY_SAT;		break;
 	case TokenTypeAsmEX2:		opcode = OpcodeEX2;			break;
 	case TokenTypeAsmEX2_SAT:	opcode = OpcodeEX2_SAT;		break;
 	case TokenTypeAsmEXP:		opcode = OpcodeEXP;			break;
@@ -2158,6 +2159,10 @@ static GLboolean ParseStatement(Compiler * compiler, ForLoop ** continuation, GL
 	case TokenTypeAsmABS_SAT:
 	case TokenTypeAsmCOS:	
 	case TokenTypeAsmCOS_SAT:	
+	case TokenTypeAsmDDX:
+	case TokenTypeAsmDDX_SAT:
+	case TokenTypeAsmDDY:
+	case TokenTypeAsmDDY_SAT:
 	case TokenTypeAsmEX2:	
 	case TokenTypeAsmEX2_SAT:	
 	case TokenTypeAsmEXP:	
@@ -2431,8 +2436,8 @@ static GLboolean ParseParameter(Compiler * compiler, GLsizei index, GLboolean *
 		ADVANCE(compiler);
 	} else {
 		/* fake a name for an abstract parameter */
-		name.first = buffer;
 		name.length = GlesSprintf(buffer, "$%d", index + 1);
+		name.first = GlesNameIntern(compiler->names, buffer, name.length, ~0);
 		*isAbstract = GL_TRUE;
 	}
 	
@@ -2752,8 +2757,7 @@ static GLboolean ParseExternalDeclaration(Compiler * compiler) {
 			// invariant declaration of previously defined variables
 			
 			if (!GlesDeclareInvariant(compiler, 
-								 	  compiler->tokenizer->token.s.first,
-								 	  compiler->tokenizer->token.s.length)) {
+								 	  compiler->tokenizer->token.s.first)) {
 				return GL_FALSE;
 			}
 								 	  
@@ -2764,8 +2768,7 @@ static GLboolean ParseExternalDeclaration(Compiler * compiler) {
 
 				if (compiler->tokenizer->token.tokenType == TokenTypeIdentifier) {
 					if (!GlesDeclareInvariant(compiler, 
-										 	  compiler->tokenizer->token.s.first,
-										 	  compiler->tokenizer->token.s.length)) {
+										 	  compiler->tokenizer->token.s.first)) {
 						return GL_FALSE;
 					}
 					
@@ -61,33 +61,184 @@
 ** --------------------------------------------------------------------------
 */
 
+/**
+ * Enlarge the hash table of a scope, or create it for the first symbol.
+ * Symbols are distributed using the hash values of their interned names.
+ * 
+ * @param	pool	memory pool to allocate the new table from
+ * @param	scope	the scope to enlarge
+ */
+static void GrowScope(struct MemoryPool * pool, Scope * scope) {
+	GLsizei numBuckets = 
+		scope->numBuckets ? 2 * scope->numBuckets + 1 : GLES_SYMBOL_HASH;
+	Symbol ** buckets = GlesMemoryPoolAllocate(pool, numBuckets * sizeof(Symbol *));
+	Symbol * symbol, * next;
+	GLsizei index;
+	
+	/* reverse each chain twice, such that shadowing declarations stay first */
+	for (index = 0; index < scope->numBuckets; ++index) {
+		Symbol * reversed = NULL;
+		
+		for (symbol = scope->buckets[index]; symbol; symbol = next) {
+			next = symbol->base.next;
+			symbol->base.next = reversed;
+			reversed = symbol;
+		}
+		
+		for (symbol = reversed; symbol; symbol = next) {
+			GLsizei bucket = GlesNameHash(symbol->base.name) % numBuckets;
+			
+			next = symbol->base.next;
+			symbol->base.next = buckets[bucket];
+			buckets[bucket] = symbol;
+		}
+	}
+	
+	scope->buckets = buckets;
+	scope->numBuckets = numBuckets;
+}
+
 /*
 ** --------------------------------------------------------------------------
 ** Internal functions
 ** --------------------------------------------------------------------------
 */
 
+/**
+ * Calculate the hash value of an identifier. The value is not reduced to
+ * the size of any particular table, and is never equal to ~0, which callers
+ * use to request hashing by the function receiving the name.
+ * 
+ * @param	name	pointer to first character of name
+ * @param	length	number of characters in name
+ * 
+ * @return	the hash value of the name
+ */
 GLsizei GlesSymbolHash(const char * name, GLsizeiptr length) {
-  	GLsizei hval = length;
+	GLuint hval = 2166136261u;
+	
+	while (length--) {
+		hval = (hval ^ (GLubyte) *name++) * 16777619u;
+	}
+	
+	return (GLsizei) (hval & 0x7fffffffu);
+}
+
+/**
+ * Create a table of interned identifiers. Names not found in the table
+ * are searched in its parent table, which allows the identifiers of a 
+ * shader to be released with the shader while those of the builtins are
+ * retained.
+ * 
+ * @param	pool	memory pool providing storage for the table
+ * @param	parent	optional table to search before adding new names
+ * 
+ * @return	the new name table
+ */
+NameTable * GlesNameTableCreate(struct MemoryPool * pool, NameTable * parent) {
+	NameTable * table = GlesMemoryPoolAllocate(pool, sizeof(NameTable));
+	
+	table->parent = parent;
+	table->pool = pool;
+	table->numBuckets = GLES_NAME_HASH;
+	table->buckets = GlesMemoryPoolAllocate(pool, GLES_NAME_HASH * sizeof(Name *));
+	
+	return table;
+}
 
-  	switch (hval) {
-    default:
-    	hval +=  name[7];
+/**
+ * Look up an identifier without adding it to the table.
+ * 
+ * @param	table	the name table to search, including its parents
+ * @param	name	pointer to first character of name
+ * @param	length	number of characters in name
+ * @param	hash	hash value of name, or ~0 to calculate it
+ * 
+ * @return	the interned name, or NULL if the name has not been interned
+ */
+char * GlesNameFind(const NameTable * table, 
+					const char * name, GLsizeiptr length, GLsizei hash) {
+	if (hash == ~0) {
+		hash = GlesSymbolHash(name, length);
+	}
+	
+	for (; table; table = table->parent) {
+		Name * entry = table->buckets[hash % table->numBuckets];
+		
+		for (; entry; entry = entry->next) {
+			if (entry->hash == hash && entry->length == length &&
+				!GlesMemcmp(entry->text, name, length)) {
+				return entry->text;
+			}
+		}
+	}
+	
+	return NULL;
+}
 
-	case 7:
-	case 6:
-	case 5:
-	case 4:
-	case 3:
-		hval += name[2];
+/**
+ * Intern an identifier. The table is enlarged once it holds twice as many
+ * names as it has buckets.
+ * 
+ * @param	table	the name table to add the name to
+ * @param	name	pointer to first character of name
+ * @param	length	number of characters in name
+ * @param	hash	hash value of name, or ~0 to calculate it
+ * 
+ * @return	the interned name
+ */
+char * GlesNameIntern(NameTable * table, 
+					  const char * name, GLsizeiptr length, GLsizei hash) {
+	char * result;
+	Name * entry;
+	
+	if (hash == ~0) {
+		hash = GlesSymbolHash(name, length);
+	}
+	
+	if ((result = GlesNameFind(table, name, length, hash)) != NULL) {
+		return result;
+	}
+	
+	if (table->numNames >= 2 * table->numBuckets) {
+		GLsizei numBuckets = 2 * table->numBuckets + 1, index;
+		Name ** buckets = GlesMemoryPoolAllocate(table->pool, numBuckets * sizeof(Name *));
+		Name * next;
 		
-	case 2:
-	case 1:
-	    hval += name[0];
-	    break;
+		for (index = 0; index < table->numBuckets; ++index) {
+			for (entry = table->buckets[index]; entry; entry = next) {
+				next = entry->next;
+				entry->next = buckets[entry->hash % numBuckets];
+				buckets[entry->hash % numBuckets] = entry;
+			}
+		}
+		
+		GlesMemoryPoolFree(table->pool, table->buckets, table->numBuckets * sizeof(Name *));
+		table->buckets = buckets;
+		table->numBuckets = numBuckets;
 	}
-  
-  	return (hval + name[length - 1]) % GLES_SYMBOL_HASH;
+	
+	entry = GlesMemoryPoolAllocate(table->pool, sizeof(Name) + length + 1);
+	entry->hash = hash;
+	entry->length = length;
+	GlesMemcpy(entry->text, name, length);
+	
+	entry->next = table->buckets[hash % table->numBuckets];
+	table->buckets[hash % table->numBuckets] = entry;
+	++table->numNames;
+	
+	return entry->text;
+}
+
+/**
+ * Retrieve the hash value of an interned name.
+ * 
+ * @param	name	the interned name
+ * 
+ * @return	the hash value calculated when the name was interned
+ */
+GLsizei GlesNameHash(const char * name) {
+	return ((const Name *) (name - offsetof(Name, text)))->hash;
 }
 
 Scope * GlesScopeCreate(struct MemoryPool * pool, Scope * parent) {
@@ -193,8 +344,7 @@ Symbol * GlesSymbolCreate(struct MemoryPool * pool, Scope * scope,
 	}
 	
 	symbol = (Symbol *) GlesMemoryPoolAllocate(pool, size);
-	symbol->base.name = (char *) GlesMemoryPoolAllocate(pool, length);
-	GlesMemcpy(symbol->base.name, name, length);
+	symbol->base.name = (char *) name;
 	symbol->base.length = length;
 	symbol->base.type = type;
 	symbol->base.qualifier = qualifier;
@@ -202,11 +352,16 @@ Symbol * GlesSymbolCreate(struct MemoryPool * pool, Scope * scope,
 	/*implied: symbol->base.next = NULL;*/
 	
 	if (hash == ~0) {
-		hash = GlesSymbolHash(name, length);
+		hash = GlesNameHash(name);
+	}
+	
+	if (scope->numSymbols >= 2 * scope->numBuckets) {
+		GrowScope(pool, scope);
 	}
 	
-	symbol->base.next = scope->buckets[hash];
-	scope->buckets[hash] = symbol;
+	symbol->base.next = scope->buckets[hash % scope->numBuckets];
+	scope->buckets[hash % scope->numBuckets] = symbol;
+	++scope->numSymbols;
 	
 	return symbol;
 }
@@ -223,19 +378,21 @@ Symbol * GlesVariableCreate(struct MemoryPool * pool, Scope * scope,
 	return symbol;
 }
 
-Symbol * GlesSymbolFind(Scope * scope, 
-						const char * name, GLsizei length, GLsizei hash) {
+Symbol * GlesSymbolFind(Scope * scope, const char * name, GLsizei hash) {
 	Symbol * symbol;
 	
+	if (!scope->numBuckets) {
+		return NULL;
+	}
+	
 	if (hash == ~0) {
-		hash = GlesSymbolHash(name, length);
+		hash = GlesNameHash(name);
 	}
 	
-	symbol = scope->buckets[hash];
+	symbol = scope->buckets[hash % scope->numBuckets];
 	
 	while (symbol) {
-		if (length == symbol->base.length && 
-			!GlesMemcmp(symbol->base.name, name, length)) {
+		if (symbol->base.name == name) {
 			return symbol;
 		}
 		
@@ -245,14 +402,14 @@ Symbol * GlesSymbolFind(Scope * scope,
 	return NULL;
 }
 
-Symbol * GlesSymbolFindNested(Scope * scope, 
-							  const char * name, GLsizei length, GLsizei hash) {
+Symbol * GlesSymbolFindNested(Scope * scope, const char * name, 
+							  GLsizei hash) {
 	if (hash == ~0) {
-		hash = GlesSymbolHash(name, length);
+		hash = GlesNameHash(name);
 	}
 	
 	while (scope) {
-		Symbol * symbol = GlesSymbolFind(scope, name, length, hash);
+		Symbol * symbol = GlesSymbolFind(scope, name, hash);
 		
 		if (symbol) {
 			return symbol;
@@ -302,6 +459,8 @@ SymbolArray * GlesSymbolArrayGrow(struct MemoryPool * pool, SymbolArray * old) {
 		array->allocated = newSize;
 		array->used = old->used;
 		GlesMemcpy(array->values, old->values, old->used * sizeof(Symbol *));
+		GlesMemoryPoolFree(pool, old, sizeof(struct SymbolArray) + 
+			sizeof(Symbol *) * old->allocated);
 	}
 	
 	return array;
@@ -91,6 +91,7 @@ typedef enum Qualifier {
 
 typedef union Symbol Symbol;
 typedef struct Scope Scope;
+typedef struct NameTable NameTable;
 
 struct MemoryPool;
 union Constant;
@@ -151,7 +152,28 @@ struct Scope {
 	Precision		defaultS2DPrec;		/* default precision for this scope */
 	Precision		defaultS3DPrec;		/* default precision for this scope */
 	Precision		defaultSCubPrec;	/* default precision for this scope */
-	Symbol *		buckets[GLES_SYMBOL_HASH];	/* symbols in this scope	*/
+	Symbol **		buckets;			/* symbols in this scope			*/
+	GLsizei			numBuckets;			/* size of hash table; 0 if empty	*/
+	GLsizei			numSymbols;			/* number of symbols in scope		*/
+};
+
+/*
+ * Interned identifier. Equal names are represented by the same Name,
+ * such that names can be compared by address.
+ */
+typedef struct Name {
+	struct Name *	next;				/* next name in collision chain		*/
+	GLsizei			hash;				/* hash value of name				*/
+	GLsizeiptr		length;				/* length of name					*/
+	char			text[0];			/* zero-terminated characters		*/
+} Name;
+
+struct NameTable {
+	NameTable *		parent;				/* names shared with enclosing unit	*/
+	struct MemoryPool * pool;			/* storage for names and buckets	*/
+	Name **			buckets;			/* hash table of names				*/
+	GLsizei			numBuckets;			/* size of hash table				*/
+	GLsizei			numNames;			/* number of names in table			*/
 };
 
 typedef struct SymbolArray {
@@ -167,6 +189,13 @@ typedef struct SymbolArray {
 ** --------------------------------------------------------------------------
 */
 
+NameTable * GlesNameTableCreate(struct MemoryPool * pool, NameTable * parent);
+char * GlesNameFind(const NameTable * table, 
+					const char * name, GLsizeiptr length, GLsizei hash);
+char * GlesNameIntern(NameTable * table, 
+					  const char * name, GLsizeiptr length, GLsizei hash);
+GLsizei GlesNameHash(const char * name);
+
 Scope * GlesScopeCreate(struct MemoryPool * pool, Scope * parent);
 Precision GlesDefaultPrecisionForType(Scope * scope, TypeValue typeValue);
 
@@ -178,11 +207,10 @@ Symbol * GlesVariableCreate(struct MemoryPool * pool, Scope * scope,
 						  const char * name, GLsizei length, GLsizei hash,
 					  	  Type * type, Qualifier qualifier, GLboolean invariant);
 
-Symbol * GlesSymbolFind(Scope * scope, 
-						const char * name, GLsizei length, GLsizei hash);
+Symbol * GlesSymbolFind(Scope * scope, const char * name, GLsizei hash);
 
-Symbol * GlesSymbolFindNested(Scope * scope, 
-							  const char * name, GLsizei length, GLsizei hash);
+Symbol * GlesSymbolFindNested(Scope * scope, const char * name, 
+							  GLsizei hash);
 
 GLsizei GlesSymbolHash(const char * name, GLsizei length);
 
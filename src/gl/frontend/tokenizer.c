@@ -725,7 +725,8 @@ static GLboolean DefineMacro(Tokenizer * tokenizer, const TokenString * name,
 	const TokenString * text, GLsizei numParameters,
 	const TokenString * parameters);
 	
-static Macro * FindDefinition(Tokenizer * tokenizer, const TokenString * name);
+static Macro * FindDefinition(Tokenizer * tokenizer, const TokenString * name,
+							   GLsizei hash);
 
 static GLboolean PushString(Tokenizer * tokenizer, const char * string);
 
@@ -769,8 +770,8 @@ void GlesPrepareTokenizer(Tokenizer * tokenizer,
 	macroDef.first = tokenizer->lineMacroText;
 	macroDef.length = sizeof(tokenizer->lineMacroText);
 
-	DefineMacro(tokenizer, &macroName, &macroDef, 0, NULL);
-	tokenizer->lineMacro = FindDefinition(tokenizer, &macroName);
+	DefineMacro(tokenizer, &macroName, &macroDef, ~0, NULL);
+	tokenizer->lineMacro = FindDefinition(tokenizer, &macroName, ~0);
 	
 	UpdateLineMacro(tokenizer);
 
@@ -780,8 +781,8 @@ void GlesPrepareTokenizer(Tokenizer * tokenizer,
 	macroDef.first = tokenizer->fileMacroText;
 	macroDef.length = sizeof(tokenizer->fileMacroText);
 
-	DefineMacro(tokenizer, &macroName, &macroDef, 0, NULL);
-	tokenizer->fileMacro = FindDefinition(tokenizer, &macroName);
+	DefineMacro(tokenizer, &macroName, &macroDef, ~0, NULL);
+	tokenizer->fileMacro = FindDefinition(tokenizer, &macroName, ~0);
 	
 	UpdateFileMacro(tokenizer);
 	
@@ -883,12 +884,27 @@ static GLboolean PushExpansion(Tokenizer * tokenizer,
 	return GL_TRUE;
 }
 
-static Macro * FindDefinition(Tokenizer * tokenizer, const TokenString * name) {
-	GLsizei hash = GlesSymbolHash(name->first, name->length);
-	Macro * macro = tokenizer->macroHash[hash % GLES_PREPROC_SYMBOL_HASH];
+/**
+ * Look up the active definition of a macro.
+ * 
+ * @param	tokenizer	reference to tokenizer object
+ * @param	name		the name to look up
+ * @param	hash		hash value of name, or ~0 to calculate it
+ * 
+ * @return	the macro, or NULL if not defined or currently being expanded
+ */
+static Macro * FindDefinition(Tokenizer * tokenizer, const TokenString * name,
+							  GLsizei hash) {
+	Macro * macro;
+	
+	if (hash == ~0) {
+		hash = GlesSymbolHash(name->first, name->length);
+	}
+	
+	macro = tokenizer->macroHash[hash % GLES_PREPROC_SYMBOL_HASH];
 	
 	while (macro) {
-		if (macro->name.length == name->length &&
+		if (macro->hash == hash && macro->name.length == name->length &&
 			!GlesStrncmp(macro->name.first, name->first, name->length)) {
 			if (!macro->disabled) {
 				return macro;
@@ -1179,7 +1195,7 @@ static GLboolean ExpandString(Tokenizer * tokenizer, const TokenString * in,
 			} else if (tokenizer->token.tokenType == TokenTypeSpace) {
 				GlesLogAppend(&tokenizer->macroExpand, " ", 1);
 			} else if (tokenizer->token.tokenType == TokenTypeIdentifier &&
-				(macro = FindDefinition(tokenizer, &tokenizer->token.s)) != NULL) {
+				(macro = FindDefinition(tokenizer, &tokenizer->token.s, ~0)) != NULL) {
 				/* this is a macro expansion */
 				if (!ProcessMacro(tokenizer, macro)) {
 					goto error;
@@ -1246,7 +1262,7 @@ static GLboolean IsDefined(Tokenizer * tokenizer, const TokenString * name) {
 	Macro * macro = tokenizer->macroHash[hash % GLES_PREPROC_SYMBOL_HASH];
 	
 	while (macro) {
-		if (macro->name.length == name->length &&
+		if (macro->hash == hash && macro->name.length == name->length &&
 			!GlesStrncmp(macro->name.first, name->first, name->length)) {
 			return GL_TRUE;
 		}
@@ -1289,6 +1305,7 @@ static GLboolean DefineMacro(Tokenizer * tokenizer, const TokenString * name,
 	macro->next = tokenizer->macroHash[bucket];
 	tokenizer->macroHash[bucket] = macro;
 	macro->name = *name;
+	macro->hash = hash;
 	macro->text = *text;
 	macro->numParameters = numParameters;
 	macro->disabled = GL_FALSE;
@@ -1306,7 +1323,7 @@ static GLboolean UndefineMacro(Tokenizer * tokenizer, const TokenString * name)
 	Macro * macro = tokenizer->macroHash[bucket], *prevMacro = NULL;
 	
 	while (macro) {
-		if (macro->name.length == name->length &&
+		if (macro->hash == hash && macro->name.length == name->length &&
 			!GlesStrncmp(macro->name.first, name->first, name->length)) {
 			if (prevMacro == NULL) {
 				tokenizer->macroHash[bucket] = macro->next;
@@ -1538,13 +1555,13 @@ static GLboolean EvaluatePrimaryExpression(Tokenizer * tokenizer, GLint *result)
 				
 				return PreprocSkipSpace1(tokenizer);
 
-			} else if ((macro = FindDefinition(tokenizer, &tokenizer->token.s)) != NULL) {
+			} else if ((macro = FindDefinition(tokenizer, &tokenizer->token.s, ~0)) != NULL) {
 				if (!ProcessMacro(tokenizer, macro) ||
-					!PreprocSkipSpace0(tokenizer)) {
+					!PreprocSkipSpace1(tokenizer)) {
 					return GL_FALSE;
 				}
 
-				/* start over */
+				/* start over with the first token of the expansion */
 				break;
 			} else {
 				*result = 0;
@@ -1905,7 +1922,8 @@ static GLboolean PreprocElif(Tokenizer * tokenizer) {
 	
 	GLES_ASSERT(tokenizer->token.tokenType == TokenTypeIdentifier);
 	
-	if (!Evaluate(tokenizer, &condition)) {
+	if (!PreprocSkipSpace1(tokenizer) ||
+		!Evaluate(tokenizer, &condition)) {
 		return GL_FALSE;
 	}
 		
@@ -1915,12 +1933,14 @@ static GLboolean PreprocElif(Tokenizer * tokenizer) {
 		return GL_FALSE;
 	}
 	
-	tokenizer->conditionals[tokenizer->nest].elsePart = GL_FALSE;
-	tokenizer->conditionals[tokenizer->nest].wasTrue = 
+	/* only the first true branch of a conditional is taken */
 	tokenizer->conditionals[tokenizer->nest].isTrue = 
 		condition &&
+		!tokenizer->conditionals[tokenizer->nest].wasTrue &&
 		(tokenizer->nest == 0 ||
 		 tokenizer->conditionals[tokenizer->nest-1].isTrue);
+	tokenizer->conditionals[tokenizer->nest].wasTrue |= 
+		tokenizer->conditionals[tokenizer->nest].isTrue;
 
 	return PreprocSkipToEol(tokenizer);
 }
@@ -2016,6 +2036,43 @@ static GLboolean PreprocError(Tokenizer * tokenizer) {
 	return GL_FALSE;
 }
 
+/**
+ * Names of the optimization passes that can be selected individually
+ * using #pragma optimize(<pass>, on|off).
+ */
+static const struct {
+	const char *	name;
+	GLsizei			length;
+	OptimizePass	pass;
+} OptimizePasses[] = {
+	{ "deadcode", 	8,	OptimizeDeadCode 	},
+	{ "constprop",	9,	OptimizeConstants	},
+	{ "copyprop",	8,	OptimizeCopies		},
+	{ "hoist",		5,	OptimizeHoist		},
+	{ "inline",		6,	OptimizeInline		},
+	{ "unroll",		6,	OptimizeUnroll		},
+};
+
+static GLboolean GetOnOff(Tokenizer * tokenizer, GLboolean * enable) {
+	if (tokenizer->token.tokenType != TokenTypeIdentifier) {
+		GlesCompileError(tokenizer->compiler, ErrP0001);
+		return GL_FALSE;
+	}
+
+	if (tokenizer->token.s.length == 2 &&
+		!GlesStrncmp(tokenizer->token.s.first, "on", 2)) {
+		*enable = GL_TRUE;
+	} else if (tokenizer->token.s.length == 3 &&
+		!GlesStrncmp(tokenizer->token.s.first, "off", 3)) {
+		*enable = GL_FALSE;
+	} else {
+		GlesCompileError(tokenizer->compiler, ErrP0001);
+		return GL_FALSE;
+	}
+	
+	return GL_TRUE;
+}
+
 static GLboolean GetEnable(Tokenizer * tokenizer, GLboolean * enable) {
 	if (!PreprocSkipSpace1(tokenizer)) {
 		return GL_FALSE;
@@ -2030,22 +2087,122 @@ static GLboolean GetEnable(Tokenizer * tokenizer, GLboolean * enable) {
 		return GL_FALSE;
 	}
 
-	if (tokenizer->token.tokenType != TokenTypeIdentifier) {
+	if (!GetOnOff(tokenizer, enable)) {
+		return GL_FALSE;
+	}
+	
+	if (!PreprocSkipSpace1(tokenizer)) {
+		return GL_FALSE;
+	}
+
+	if (tokenizer->token.tokenType != TokenTypeRightParen) {
 		GlesCompileError(tokenizer->compiler, ErrP0001);
 		return GL_FALSE;
 	}
+	
+	return GL_TRUE;
+}
 
-	if (tokenizer->token.s.length == 2 &&
-		!GlesStrncmp(tokenizer->token.s.first, "on", 2)) {
-		*enable = GL_TRUE;
-	} else if (tokenizer->token.s.length == 3 &&
-		!GlesStrncmp(tokenizer->token.s.first, "off", 3)) {
-		*enable = GL_FALSE;
+/**
+ * Parse the arguments of #pragma optimize, which are either (on|off) to
+ * select all optimization passes, or (<pass>, on|off) to select a single
+ * pass.
+ */
+static GLboolean GetOptimize(Tokenizer * tokenizer, GLbitfield * passes,
+							 GLboolean * enable) {
+	GLsizei index;
+	
+	if (!PreprocSkipSpace1(tokenizer)) {
+		return GL_FALSE;
+	}
+	
+	if (tokenizer->token.tokenType != TokenTypeLeftParen) {
+		GlesCompileError(tokenizer->compiler, ErrP0001);
+		return GL_FALSE;
+	}
+
+	if (!PreprocSkipSpace1(tokenizer)) {
+		return GL_FALSE;
+	}
+
+	if (tokenizer->token.tokenType != TokenTypeIdentifier) {
+		GlesCompileError(tokenizer->compiler, ErrP0001);
+		return GL_FALSE;
+	}
+	
+	*passes = 0;
+	
+	for (index = 0; index < (GLsizei) GLES_ELEMENTSOF(OptimizePasses); ++index) {
+		if (tokenizer->token.s.length == OptimizePasses[index].length &&
+			!GlesStrncmp(tokenizer->token.s.first, OptimizePasses[index].name, 
+						 OptimizePasses[index].length)) {
+			*passes = OptimizePasses[index].pass;
+			break;
+		}
+	}
+	
+	if (index == GLES_ELEMENTSOF(OptimizePasses)) {
+		if (!GetOnOff(tokenizer, enable)) {
+			return GL_FALSE;
+		}
+		
+		*passes = OptimizeAll;
 	} else {
+		if (!PreprocSkipSpace1(tokenizer)) {
+			return GL_FALSE;
+		}
+		
+		if (tokenizer->token.tokenType != TokenTypeComma) {
+			GlesCompileError(tokenizer->compiler, ErrP0001);
+			return GL_FALSE;
+		}
+
+		if (!PreprocSkipSpace1(tokenizer)) {
+			return GL_FALSE;
+		}
+
+		if (!GetOnOff(tokenizer, enable)) {
+			return GL_FALSE;
+		}
+	}
+	
+	if (!PreprocSkipSpace1(tokenizer)) {
+		return GL_FALSE;
+	}
+
+	if (tokenizer->token.tokenType != TokenTypeRightParen) {
+		GlesCompileError(tokenizer->compiler, ErrP0001);
+		return GL_FALSE;
+	}
+	
+	return GL_TRUE;
+}
+
+/**
+ * Parse the argument of #pragma specialize(<uniform>), which names a
+ * uniform variable whose value may be folded into specialized code.
+ */
+static GLboolean GetSpecialize(Tokenizer * tokenizer, TokenString * name) {
+	if (!PreprocSkipSpace1(tokenizer)) {
+		return GL_FALSE;
+	}
+	
+	if (tokenizer->token.tokenType != TokenTypeLeftParen) {
+		GlesCompileError(tokenizer->compiler, ErrP0001);
+		return GL_FALSE;
+	}
+
+	if (!PreprocSkipSpace1(tokenizer)) {
+		return GL_FALSE;
+	}
+
+	if (tokenizer->token.tokenType != TokenTypeIdentifier) {
 		GlesCompileError(tokenizer->compiler, ErrP0001);
 		return GL_FALSE;
 	}
 	
+	*name = tokenizer->token.s;
+	
 	if (!PreprocSkipSpace1(tokenizer)) {
 		return GL_FALSE;
 	}
@@ -2060,6 +2217,8 @@ static GLboolean GetEnable(Tokenizer * tokenizer, GLboolean * enable) {
 
 static GLboolean PreprocPragma(Tokenizer * tokenizer) {
 	GLboolean enable;
+	GLbitfield passes;
+	TokenString name;
 	
 	GLES_ASSERT(tokenizer->token.tokenType == TokenTypeIdentifier);
 	
@@ -2085,11 +2244,18 @@ static GLboolean PreprocPragma(Tokenizer * tokenizer) {
 		GlesPragmaDebug(tokenizer->compiler, enable);
 	} else if (tokenizer->token.s.length == 8 &&
 		!GlesStrncmp(tokenizer->token.s.first, "optimize", 8)) {
-		if (!GetEnable(tokenizer, &enable)) {
+		if (!GetOptimize(tokenizer, &passes, &enable)) {
+			return GL_FALSE;
+		}
+
+		GlesPragmaOptimize(tokenizer->compiler, passes, enable);			
+	} else if (tokenizer->token.s.length == 10 &&
+		!GlesStrncmp(tokenizer->token.s.first, "specialize", 10)) {
+		if (!GetSpecialize(tokenizer, &name)) {
 			return GL_FALSE;
 		}
 
-		GlesPragmaOptimize(tokenizer->compiler, enable);			
+		GlesPragmaSpecialize(tokenizer->compiler, name.first, name.length);
 	}
 	
 	/* all unknown pragmas are ignored */
@@ -2276,6 +2442,111 @@ static GLboolean PreprocLine(Tokenizer * tokenizer) {
  * @return	GL_TRUE if parse was successful. Current token will be
  *			TokenTypeEol or TokenTypeEof.
  */
+static GLboolean IsDirective(const char * name, GLsizeiptr length,
+							 const char * directive) {
+	return length == GlesStrlen(directive) && 
+		!GlesStrncmp(name, directive, length);
+}
+
+/**
+ * Skip the lines of a conditional group that is not included, without
+ * tokenizing them or expanding macros. Only the nesting of conditional
+ * directives and comments is tracked. Scanning stops at the beginning of
+ * an #elif, #else or #endif line that continues the current conditional,
+ * which is then processed by PreprocStatement, or at the end of the 
+ * current input string.
+ * 
+ * @param	tokenizer	reference to tokenizer object, positioned at the
+ * 						beginning of a line
+ */
+static void PreprocSkipGroup(Tokenizer * tokenizer) {
+	char * current = tokenizer->input.current;
+	char * last = tokenizer->input.last;
+	GLboolean inComment = tokenizer->inComment;
+	GLsizei depth = 0;
+	
+	while (current != last) {
+		char * line = current;
+		
+		/* leading white space and comments */
+		while (current != last && *current != '\r' && *current != '\n') {
+			if (inComment) {
+				if (*current++ == '*' && current != last && *current == '/') {
+					++current;
+					inComment = GL_FALSE;
+				}
+			} else if (*current == ' ' || *current == '\t') {
+				++current;
+			} else if (*current == '/' && current + 1 != last && current[1] == '*') {
+				current += 2;
+				inComment = GL_TRUE;
+			} else {
+				break;
+			}
+		}
+		
+		if (!inComment && current != last && *current == '#') {
+			char * name;
+			
+			do {
+				++current;
+			} while (current != last && (*current == ' ' || *current == '\t'));
+			
+			for (name = current; current != last && 
+				 ((*current >= 'a' && *current <= 'z') ||
+				  (*current >= 'A' && *current <= 'Z') ||
+				  (*current >= '0' && *current <= '9') ||
+				  *current == '_'); ++current) 
+				;
+			
+			if (IsDirective(name, current - name, "if") ||
+				IsDirective(name, current - name, "ifdef") ||
+				IsDirective(name, current - name, "ifndef")) {
+				++depth;
+			} else if (IsDirective(name, current - name, "endif") && depth) {
+				--depth;
+			} else if (!depth &&
+					   (IsDirective(name, current - name, "endif") ||
+						IsDirective(name, current - name, "else") ||
+						IsDirective(name, current - name, "elif"))) {
+				current = line;
+				break;
+			}
+		}
+		
+		/* remainder of line */
+		while (current != last && *current != '\r' && *current != '\n') {
+			if (inComment) {
+				if (*current++ == '*' && current != last && *current == '/') {
+					++current;
+					inComment = GL_FALSE;
+				}
+			} else if (*current++ == '/' && current != last) {
+				if (*current == '*') {
+					++current;
+					inComment = GL_TRUE;
+				} else if (*current == '/') {
+					while (current != last && *current != '\r' && *current != '\n') {
+						++current;
+					}
+				}
+			}
+		}
+		
+		if (current != last) {
+			if (*current++ == '\r' && current != last && *current == '\n') {
+				++current;
+			}
+			
+			++tokenizer->lineno;
+		}
+	}
+	
+	tokenizer->input.current = current;
+	tokenizer->inComment = inComment;
+	UpdateLineMacro(tokenizer);
+}
+
 static GLboolean PreprocStatement(Tokenizer * tokenizer) {
 	GLboolean result;
 	
@@ -2373,8 +2644,19 @@ static GLboolean PreprocStatement(Tokenizer * tokenizer) {
 
 GLboolean GlesNextToken(Tokenizer * tokenizer) {
 	
+	GLsizei hash = ~0;
+	
 	for (;;) {
-		GLboolean result = FetchNextToken(tokenizer);
+		GLboolean result;
+		GLboolean active = tokenizer->nest < 0 ||
+			tokenizer->conditionals[tokenizer->nest].isTrue;
+		
+		if (!active && tokenizer->beginLine) {
+			/* excluded lines are not tokenized at all */
+			PreprocSkipGroup(tokenizer);
+		}
+		
+		result = FetchNextToken(tokenizer);
 		
 		if (!result) {
 			return GL_FALSE;
@@ -2390,11 +2672,14 @@ GLboolean GlesNextToken(Tokenizer * tokenizer) {
 							tokenizer->token.tokenType == TokenTypeEof);
 							
 				continue;
-			} else if (tokenizer->token.tokenType == TokenTypeIdentifier) {
+			} else if (tokenizer->token.tokenType == TokenTypeIdentifier && active) {
 				Macro * macro;
 				const struct Keyword * keyword;
 				
-				if ((macro = FindDefinition(tokenizer, &tokenizer->token.s)) != NULL) {
+				hash = GlesSymbolHash(tokenizer->token.s.first, 
+									  tokenizer->token.s.length);
+				
+				if ((macro = FindDefinition(tokenizer, &tokenizer->token.s, hash)) != NULL) {
 					if (!ProcessMacro(tokenizer, macro) ||
 						!PreprocSkipSpace0(tokenizer)) {
 						GlesCompileError(tokenizer->compiler, ErrI0001);
@@ -2431,12 +2716,19 @@ GLboolean GlesNextToken(Tokenizer * tokenizer) {
 				if (tokenizer->token.tokenType != TokenTypeSpace) {
 					tokenizer->beginLine = GL_FALSE;
 					
-					if (tokenizer->nest < 0 ||
-						tokenizer->conditionals[tokenizer->nest].isTrue) {
+					if (active || tokenizer->token.tokenType == TokenTypeEof) {
 						if (!tokenizer->hadResult && tokenizer->input.sp >= 0) {
 							tokenizer->hadResult = GL_TRUE;
 						}
 						
+						if (tokenizer->token.tokenType == TokenTypeIdentifier) {
+							/* the parser compares identifiers by address */
+							tokenizer->token.s.first = 
+								GlesNameIntern(tokenizer->compiler->names,
+											   tokenizer->token.s.first,
+											   tokenizer->token.s.length, hash);
+						}
+						
 						return GL_TRUE;		
 					}
 				}
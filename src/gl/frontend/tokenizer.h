@@ -122,6 +122,8 @@ typedef enum TokenType {
 	TokenTypeAsmCAL,	
 	TokenTypeAsmCMP,		TokenTypeAsmCMP_SAT,	
 	TokenTypeAsmCOS,		TokenTypeAsmCOS_SAT,	
+	TokenTypeAsmDDX,		TokenTypeAsmDDX_SAT,	
+	TokenTypeAsmDDY,		TokenTypeAsmDDY_SAT,	
 	TokenTypeAsmDP2,		TokenTypeAsmDP2_SAT,	
 	TokenTypeAsmDP3,		TokenTypeAsmDP3_SAT,
 	TokenTypeAsmDP4,		TokenTypeAsmDP4_SAT,	
@@ -187,6 +189,7 @@ typedef struct TokenString {
 typedef struct Macro {
 	struct Macro *			next;			/**< next definition in list */
 	TokenString				name;			/**< macro name */
+	GLsizei					hash;			/**< hash value of macro name */
 	TokenString 			text;			/**< replacement text */
 	GLsizei					numParameters;	/**< ~0 for no arguments */
 	GLboolean				disabled;		/**< macro is currently disabled */
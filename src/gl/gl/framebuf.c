@@ -45,6 +45,13 @@
 #include "platform/platform.h"
 #include "gl/state.h"
 
+#if GLES_MATH_SSE2 && (GLES_SHADER_BATCH % 4) == 0
+#	include <emmintrin.h>
+#	define PACK_SSE2	1
+#else
+#	define PACK_SSE2	0
+#endif
+
 
 /*
 ** --------------------------------------------------------------------------
@@ -84,6 +91,20 @@ static GLES_INLINE GLubyte ColorValue(GLfloat color, GLsizei bits) {
 	return (GLubyte) (((1 << bits) - 1) * color);
 }
 
+#if PACK_SSE2
+/**
+ * Scale four color components to [0, 255] and convert them to integers.
+ * Clamping happens in floating point, because the conversion turns values
+ * beyond the integer range into negative numbers.
+ */
+static GLES_INLINE __m128i ScaleColors(const GLfloat * color, __m128 scale) {
+	__m128 value = _mm_mul_ps(_mm_loadu_ps(color), scale);
+	
+	value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), scale);
+	return _mm_cvttps_epi32(value);
+}
+#endif
+
 static GLES_INLINE GLuint ColorWord(GLenum colorFormat, GLubyte r,
 									GLubyte g, GLubyte b, GLubyte a) {
 	switch (colorFormat) {
@@ -510,38 +531,37 @@ void GlesWriteStencil(const SurfaceLoc * loc, GLuint writeMask, GLuint value) {
 }
 
 /**
- * Write a pixel to the write surface, including depth test, stencil test,
- * and any necessary blending.
+ * Perform the depth and stencil tests for a pixel of the write surface,
+ * including the resulting stencil operation and depth buffer update.
+ * 
+ * Because the color of the fragment does not enter the tests, they can be
+ * performed before the fragment program runs, as long as the program can
+ * neither discard the fragment nor modify its depth value.
  * 
  * @param state
  * 		the current GL state
  * @param loc
  * 		pointers into color, depth and stencil buffers for current pixel
- * @param color
- * 		color value to write
  * @param depth
  * 		depth value to write, in range 0 .. 1.0f
  * @param front
  * 		GL_TRUE if front-facing
+ * 
+ * @return
+ * 		GL_TRUE if the fragment passed both tests and its color is to be
+ * 		written
  */
-void GlesWritePixel(State * state, const SurfaceLoc * loc, const Color * color, GLfloat depth, GLboolean front) {
+GLboolean GlesTestPixel(State * state, const SurfaceLoc * loc, GLfloat depth, GLboolean front) {
 
 	const StencilParams * stencilParams = front ? &state->stencilFront : &state->stencilBack;
 	
-	Colorub srcColor, dstColor;	
 	GLuint 	srcDepth, dstDepth = 0;
 	GLuint 	dstStencil = 0;
 
 	GLboolean depthTestPassed = GL_TRUE;
 		
-	srcColor.red 	= ColorValue(color->red, 	GLES_BITS_PER_BYTE); 
-	srcColor.green 	= ColorValue(color->green, 	GLES_BITS_PER_BYTE); 
-	srcColor.blue 	= ColorValue(color->blue, 	GLES_BITS_PER_BYTE); 
-	srcColor.alpha 	= ColorValue(color->alpha, 	GLES_BITS_PER_BYTE); 
-	
 	srcDepth = GlesClampf(depth) * ((1u << loc->surface->depthBits) - 1);
 	
-	GlesReadColorub(loc, &dstColor);
 	dstDepth = GlesReadDepth(loc);
 	dstStencil = GlesReadStencil(loc);
 		
@@ -591,7 +611,7 @@ void GlesWritePixel(State * state, const SurfaceLoc * loc, const Color * color,
 			}
 			
 			GlesWriteStencil(loc, stencilParams->writeMask, stencil);			
-			return;
+			return GL_FALSE;
 		} else if (depthTestPassed) {
 			switch (stencilParams->zpass) {
 			case GL_KEEP:													break;
@@ -620,13 +640,107 @@ void GlesWritePixel(State * state, const SurfaceLoc * loc, const Color * color,
 			}
 			
 			GlesWriteStencil(loc, stencilParams->writeMask, stencil);			
-			return;
+			return GL_FALSE;
 		}
 	} else if (!depthTestPassed) {
-		return;
+		return GL_FALSE;
 	}
 
 	GlesWriteDepth(loc, state->depthMask, srcDepth);
+	return GL_TRUE;
+}
+
+/**
+ * Convert a batch of fragment colors into unsigned byte colors. The input
+ * is stored as structure of arrays, i.e. GLES_SHADER_BATCH red values are
+ * followed by the green, blue and alpha values of the same fragments.
+ * 
+ * Colors are narrowed to 16-bit fixed point, eight values per SSE register,
+ * and saturated to bytes, such that the framebuffer path does not need to
+ * clamp or convert individual float components.
+ * 
+ * Only batched fragment shading produces colors in this layout. Where native
+ * code is generated, that is limited to fragment shaders that need 2x2 quads
+ * for texture accesses or derivatives; all other fragments are converted one
+ * at a time by GlesWriteColor.
+ * 
+ * @param result
+ * 		array of GLES_SHADER_BATCH colors receiving the converted values
+ * @param color
+ * 		the color values to convert, clamped to [0, 1] during conversion
+ */
+void GlesPackColors(Colorub * result, const GLfloat * color) {
+	GLsizei lane;
+	
+#if PACK_SSE2
+	const __m128 scale = _mm_set1_ps((GLfloat) GLES_UBYTE_MAX);
+	
+	for (lane = 0; lane < GLES_SHADER_BATCH; lane += 4) {
+		const GLfloat * base = color + lane;
+		__m128i r = ScaleColors(base, scale);
+		__m128i g = ScaleColors(base + GLES_SHADER_BATCH, scale);
+		__m128i b = ScaleColors(base + 2 * GLES_SHADER_BATCH, scale);
+		__m128i a = ScaleColors(base + 3 * GLES_SHADER_BATCH, scale);
+		
+		/* bytes r0..r3 b0..b3 g0..g3 a0..a3, then interleave into rgba	*/
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(r, b), _mm_packs_epi32(g, a));
+		packed = _mm_unpacklo_epi8(packed, _mm_srli_si128(packed, 8));
+		packed = _mm_unpacklo_epi16(packed, _mm_srli_si128(packed, 8));
+		
+		_mm_storeu_si128((__m128i *) (result + lane), packed);
+	}
+#else
+	GLsizei index;
+	
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		for (index = 0; index < 4; ++index) {
+			result[lane].rgba[index] = 
+				ColorValue(GlesClampf(color[index * GLES_SHADER_BATCH + lane]), 
+						   GLES_BITS_PER_BYTE);
+		}
+	}
+#endif
+}
+
+/**
+ * Write the color of a pixel that has passed the depth and stencil tests
+ * to the write surface, including any necessary blending.
+ * 
+ * @param state
+ * 		the current GL state
+ * @param loc
+ * 		pointers into color, depth and stencil buffers for current pixel
+ * @param color
+ * 		color value to write
+ */
+void GlesWriteColor(State * state, const SurfaceLoc * loc, const Color * color) {
+
+	Colorub srcColor;	
+		
+	srcColor.red 	= ColorValue(GlesClampf(color->red), 	GLES_BITS_PER_BYTE); 
+	srcColor.green 	= ColorValue(GlesClampf(color->green), 	GLES_BITS_PER_BYTE); 
+	srcColor.blue 	= ColorValue(GlesClampf(color->blue), 	GLES_BITS_PER_BYTE); 
+	srcColor.alpha 	= ColorValue(GlesClampf(color->alpha), 	GLES_BITS_PER_BYTE); 
+	
+	GlesWriteColorBlend(state, loc, &srcColor);
+}
+
+/**
+ * Write an unsigned byte color of a pixel that has passed the depth and
+ * stencil tests to the write surface, including any necessary blending.
+ * 
+ * @param state
+ * 		the current GL state
+ * @param loc
+ * 		pointers into color, depth and stencil buffers for current pixel
+ * @param color
+ * 		color value to write
+ */
+void GlesWriteColorBlend(State * state, const SurfaceLoc * loc, const Colorub * color) {
+
+	Colorub srcColor = *color, dstColor;	
+		
+	GlesReadColorub(loc, &dstColor);
 		
 	if (state->blendEnabled) {
 		Colorub	srcFactor, dstFactor;
@@ -963,6 +1077,27 @@ void GlesWritePixel(State * state, const SurfaceLoc * loc, const Color * color,
 	GlesWriteColorub(loc, &state->colorMask, &srcColor);
 }
 
+/**
+ * Write a pixel to the write surface, including depth test, stencil test,
+ * and any necessary blending.
+ * 
+ * @param state
+ * 		the current GL state
+ * @param loc
+ * 		pointers into color, depth and stencil buffers for current pixel
+ * @param color
+ * 		color value to write
+ * @param depth
+ * 		depth value to write, in range 0 .. 1.0f
+ * @param front
+ * 		GL_TRUE if front-facing
+ */
+void GlesWritePixel(State * state, const SurfaceLoc * loc, const Color * color, GLfloat depth, GLboolean front) {
+	if (GlesTestPixel(state, loc, depth, front)) {
+		GlesWriteColor(state, loc, color);
+	}
+}
+
 /*
 ** --------------------------------------------------------------------------
 ** Public API entry points
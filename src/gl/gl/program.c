@@ -68,8 +68,21 @@ void GlesInitProgram(Program * program) {
 	program->uniformData 	= NULL;
 	program->uniformTypes 	= NULL;
 	program->executable 	= NULL;
+	program->current		= NULL;
+	
+	/* specialized variants */
+	
+	GlesMemset(program->variants, 0, sizeof(program->variants));
+	program->variantClock	= 0;
+	program->variantChurn	= 0;
+	
+	/* background linking */
+	
+	program->linkTask		= NULL;
 }
 
+static void InstallExecutable(State * state, Program * program, Executable * executable);
+
 Program * GlesGetProgramObject(State * state, GLuint program) {
 	if (!program ||
 		!GlesIsBoundObject(state->programFreeList, GLES_MAX_PROGRAMS, program)) {
@@ -77,13 +90,42 @@ Program * GlesGetProgramObject(State * state, GLuint program) {
 		return NULL;
 	}
 	
+	if (state->programs[program].linkTask) {
+		/* complete a background link before the program is used */
+		Executable * executable = GlesWaitProgram(state, state->programs + program);
+		
+		if (executable) {
+			InstallExecutable(state, state->programs + program, executable);
+		}
+	}
+	
 	return state->programs + program;
 }
 
 static void FreeProgramData(State * state, Program * program) {
 	
+	GLsizei index;
+	
 	GlesLogDeInit(&program->log);
 
+	for (index = 0; index < GLES_MAX_PROGRAM_VARIANTS; ++index) {
+		ProgramVariant * variant = &program->variants[index];
+		
+		if (variant->executable) {
+			GlesDeleteExecutable(state, variant->executable);
+			variant->executable = NULL;
+		}
+		
+		if (variant->values) {
+			GlesFree(variant->values);
+			variant->values = NULL;
+		}
+	}
+	
+	program->variantClock = 0;
+	program->variantChurn = 0;
+	program->current = NULL;
+
 	if (program->uniformData) {
 		GlesFree(program->uniformData);
 		program->uniformData = NULL;
@@ -146,8 +188,186 @@ GLboolean GlesValidateProgram(State * state, Program * program, Log * log) {
 	return GL_TRUE;
 }
 
+/**
+ * Ensure that a temporary storage area for shader execution can hold at
+ * least the given number of vectors.
+ * 
+ * @param	temp	pointer to the base address of the temporary area
+ * @param	tempSize	pointer to the current size of the area in vec4
+ * @param	size	required size of the temporary area in vec4
+ * 
+ * @return	GL_TRUE if the storage area is large enough
+ */
+static GLboolean AllocateTemp(Vec4f ** temp, GLsizeiptr * tempSize, GLsizeiptr size) {
+	Vec4f * newTemp;
+	
+	if (size <= *tempSize) {
+		return GL_TRUE;
+	}
+	
+	newTemp = GlesMalloc(size * sizeof(Vec4f));
+	
+	if (!newTemp) {
+		return GL_FALSE;
+	}
+	
+	if (*temp) {
+		GlesFree(*temp);
+	}
+	
+	*temp = newTemp;
+	*tempSize = size;
+	
+	return GL_TRUE;
+}
+
+/**
+ * Copy the current values of the uniform variables an executable is
+ * specialized on into a contiguous array, and calculate a hash value
+ * over them.
+ * 
+ * @param	program		the program providing the uniform values
+ * @param	values		array receiving sizeSpecialized vectors, or NULL
+ * 
+ * @return	the hash value of the uniform values
+ */
+static GLuint HashSpecializedUniforms(const Program * program, Vec4f * values) {
+	const Executable * executable = program->executable;
+	GLuint hash = 2166136261u;
+	GLsizei index, row, count = 0;
+	
+	for (index = 0; index < executable->numSpecialized; ++index) {
+		const ShaderVariable * uniform = 
+			&executable->uniforms[executable->specialized[index]];
+		
+		for (row = 0; row < uniform->size; ++row) {
+			const GLubyte * bytes = 
+				(const GLubyte *) &program->uniformData[uniform->location + row];
+			GLsizei byte;
+			
+			for (byte = 0; byte < (GLsizei) sizeof(Vec4f); ++byte) {
+				hash = (hash ^ bytes[byte]) * 16777619u;
+			}
+			
+			if (values) {
+				values[count++] = program->uniformData[uniform->location + row];
+			}
+		}
+	}
+	
+	return hash;
+}
+
+/**
+ * Determine if a variant has been specialized on the current uniform
+ * values of a program.
+ * 
+ * @param	program		the program providing the uniform values
+ * @param	variant		the variant to compare against
+ * 
+ * @return	GL_TRUE if the values coincide
+ */
+static GLboolean MatchVariant(const Program * program, const ProgramVariant * variant) {
+	const Executable * executable = program->executable;
+	GLsizei index, count = 0;
+	
+	for (index = 0; index < executable->numSpecialized; ++index) {
+		const ShaderVariable * uniform = 
+			&executable->uniforms[executable->specialized[index]];
+		
+		if (GlesMemcmp((const char *) (variant->values + count), 
+					   (const char *) (program->uniformData + uniform->location), 
+					   uniform->size * sizeof(Vec4f))) {
+			return GL_FALSE;
+		}
+		
+		count += uniform->size;
+	}
+	
+	return GL_TRUE;
+}
+
+/**
+ * Select the executable to use for rendering with a program. If the
+ * program declares uniforms using #pragma specialize, a variant linked
+ * for the current values of those uniforms is taken from the variant cache
+ * of the program, or created if needed. Programs whose specialized uniforms
+ * keep changing fall back to the generic executable, which avoids linking
+ * a new variant for every draw call.
+ * 
+ * @param	state		reference to GL state
+ * @param	program		the program to render with
+ * 
+ * @return	the executable to use for rendering
+ */
+static Executable * SelectExecutable(State * state, Program * program) {
+	ProgramVariant * variant, * victim = NULL;
+	Executable * executable;
+	GLuint hash;
+	GLsizei index;
+	
+	if (!program->executable->numSpecialized || !state->linker) {
+		return program->executable;
+	}
+	
+	if (program->variantChurn) {
+		--program->variantChurn;
+	}
+	
+	hash = HashSpecializedUniforms(program, NULL);
+	
+	for (index = 0; index < GLES_MAX_PROGRAM_VARIANTS; ++index) {
+		variant = &program->variants[index];
+		
+		if (!variant->executable) {
+			if (!victim || victim->executable) {
+				victim = variant;
+			}
+		} else if (variant->hash == hash && MatchVariant(program, variant)) {
+			variant->lastUse = ++program->variantClock;
+			return variant->executable;
+		} else if (!victim || 
+				   (victim->executable && variant->lastUse < victim->lastUse)) {
+			victim = variant;
+		}
+	}
+	
+	if (program->variantChurn >= GLES_PROGRAM_VARIANT_CHURN) {
+		/* values change too often to amortize linking of variants */
+		return program->executable;
+	}
+	
+	program->variantChurn += GLES_PROGRAM_VARIANT_COST;
+
+	if (!victim->values) {
+		victim->values = 
+			GlesMalloc(program->executable->sizeSpecialized * sizeof(Vec4f));
+		
+		if (!victim->values) {
+			return program->executable;
+		}
+	}
+	
+	executable = GlesSpecializeProgram(state->linker, program, program->executable);
+	
+	if (!executable) {
+		return program->executable;
+	}
+	
+	if (victim->executable) {
+		GlesDeleteExecutable(state, victim->executable);
+	}
+	
+	victim->executable = executable;
+	victim->hash = HashSpecializedUniforms(program, victim->values);
+	victim->lastUse = ++program->variantClock;
+	
+	return executable;
+}
+
 GLboolean GlesPrepareProgram(State * state) {
 	Program * programObject = GlesGetProgramObject(state, state->program);
+	Executable * executable;
 	
 	if (!programObject) {
 		/* no current program or program not defined */
@@ -160,17 +380,91 @@ GLboolean GlesPrepareProgram(State * state) {
 		return GL_FALSE;
 	}
 
-	/* TODO: This whole block needs to be modified */
+	executable = SelectExecutable(state, programObject);
+	programObject->current = executable;
+	
+	if (!AllocateTemp(&state->vertexContext.temp, &state->vertexContext.tempSize,
+					  executable->vertex.bssSize) ||
+		!AllocateTemp(&state->vertexContext.batchTemp, &state->vertexContext.batchTempSize,
+					  executable->vertex.bssSize * GLES_SHADER_BATCH) ||
+		!AllocateTemp(&state->fragContext.temp, &state->fragContext.tempSize,
+					  executable->fragment.bssSize) ||
+		!AllocateTemp(&state->fragContext.batchTemp, &state->fragContext.batchTempSize,
+					  executable->fragment.bssSize * GLES_SHADER_BATCH)) {
+		GlesRecordOutOfMemory(state);
+		return GL_FALSE;
+	}
+	
+	/* pre-shader results are written into a per-draw copy of the constants */
+	
+	if ((executable->vertex.pre.base &&
+		 !AllocateTemp(&state->vertexContext.data, &state->vertexContext.dataSize,
+					   executable->vertex.data.size)) ||
+		(executable->fragment.pre.base &&
+		 !AllocateTemp(&state->fragContext.data, &state->fragContext.dataSize,
+					   executable->fragment.data.size))) {
+		GlesRecordOutOfMemory(state);
+		return GL_FALSE;
+	}
+	
 	state->vertexContext.state = state;
+	state->vertexContext.code = executable->vertex.code.base;
+	state->vertexContext.batchCode = executable->vertex.batch.base;
+	state->vertexContext.constant = executable->vertex.pre.base ? 
+		state->vertexContext.data : (const Vec4f *) executable->vertex.data.base;
+	state->vertexContext.uniform = programObject->uniformData;
 	state->vertexContext.attrib = &state->currentAttrib[0];
 	state->vertexContext.textureImageUnit = state->textureUnits;
 	
 	state->fragContext.state = state;
+	state->fragContext.code = executable->fragment.code.base;
+	state->fragContext.batchCode = executable->fragment.batch.base;
+	state->fragContext.constant = executable->fragment.pre.base ? 
+		state->fragContext.data : (const Vec4f *) executable->fragment.data.base;
+	state->fragContext.uniform = programObject->uniformData;
 	state->fragContext.textureImageUnit = state->textureUnits;
 	
 	return GL_TRUE;
 }
 
+/**
+ * Make a newly created executable the executable of a program, and set up
+ * the uniform storage of the program accordingly.
+ * 
+ * @param	state		reference to GL state
+ * @param	program		the program receiving the executable
+ * @param	executable	the executable created by the linker
+ */
+static void InstallExecutable(State * state, Program * program, Executable * executable) {
+	GLuint index, count;
+	
+	program->executable = executable;
+	program->current = executable;
+	program->uniformData = (Vec4f *) GlesMalloc(executable->sizeUniforms * sizeof(Vec4f));
+	program->uniformTypes = (GLuint *) GlesMalloc(executable->sizeUniforms * sizeof(GLuint));
+
+	if (!program->uniformData || !program->uniformTypes) {
+		GlesRecordOutOfMemory(state);
+		FreeProgramData(state, program);
+		return;
+	}
+	
+	for (index = 0; index < executable->numUniforms; ++index) {
+		const ShaderVariable * uniform = &executable->uniforms[index];
+		/* size is already expressed in vec4 rows, including matrix columns */
+		GLuint elements = uniform->size;
+		
+		GLES_ASSERT(uniform->location + uniform->size <= executable->sizeUniforms);
+		
+		for (count = 0; count < elements; ++count) {
+			/* create indices from actual values back to meta-data */
+			program->uniformTypes[uniform->location + count] = index;
+		}
+	}
+
+	program->isLinked = GL_TRUE;
+}
+
 /*
 ** --------------------------------------------------------------------------
 ** Public API entry points
@@ -539,6 +833,11 @@ GL_API void GL_APIENTRY glGetProgramiv (GLuint program, GLenum pname, GLint *par
 		*params = result;
 		break;
 		
+	case GL_PROGRAM_BINARY_LENGTH_OES:
+		*params = programObject->isLinked ? 
+			GlesExecutableImageSize(programObject->executable) : 0;
+		break;
+		
 	default:
 		GlesRecordInvalidEnum(state);
 		return; 
@@ -555,7 +854,6 @@ GL_API void GL_APIENTRY glLinkProgram (GLuint program) {
 	State * state = GLES_GET_STATE();
 	Program * programObject = GlesGetProgramObject(state, program);
 	Shader * vertexShader, * fragmentShader;
-	GLuint index, count;
 	Executable * executable;
 	
 	if (!state->linker) {
@@ -575,7 +873,9 @@ GL_API void GL_APIENTRY glLinkProgram (GLuint program) {
 	vertexShader = GlesGetShaderObject(state, programObject->vertexShader);
 	fragmentShader = GlesGetShaderObject(state, programObject->fragmentShader);
 
-	if (!vertexShader->isCompiled || !fragmentShader->isCompiled) {
+	/* shaders still compiling in the background are checked by the link */
+	if ((!vertexShader->compileTask && !vertexShader->isCompiled) || 
+		(!fragmentShader->compileTask && !fragmentShader->isCompiled)) {
 		GlesRecordInvalidOperation(state);
 		return;
 	}
@@ -583,59 +883,122 @@ GL_API void GL_APIENTRY glLinkProgram (GLuint program) {
 	FreeProgramData(state, programObject);
 	programObject->isLinked = GL_FALSE;
 
+	if (GlesLinkProgramAsync(state, programObject, vertexShader, fragmentShader)) {
+		/* results are waited for when the program is used or queried */
+		return;
+	}
+	
+	GlesWaitShader(state, vertexShader);
+	GlesWaitShader(state, fragmentShader);
+	
+	if (!vertexShader->isCompiled || !fragmentShader->isCompiled) {
+		GlesLogAppend(&programObject->log, "Shader is not compiled.\n", -1);
+		return;
+	}
+	
 	executable = GlesLinkProgram(state->linker, programObject);
 	
 	if (!executable) {
 		return;
 	}
 	
-	programObject->executable = executable;
-	programObject->uniformData = (Vec4f *) GlesMalloc(executable->sizeUniforms * sizeof(Vec4f));
-	programObject->uniformTypes = (GLuint *) GlesMalloc(executable->sizeUniforms * sizeof(GLuint));
+	InstallExecutable(state, programObject, executable);
+}
 
-	if (!programObject->uniformData || !programObject->uniformTypes) {
-		GlesRecordOutOfMemory(state);
-		FreeProgramData(state, programObject);
+GL_API void GL_APIENTRY glGetProgramBinaryOES (GLuint program, GLsizei bufsize, GLsizei *length, GLenum *binaryformat, void *binary) {
+	State * state = GLES_GET_STATE();
+	Program * programObject = GlesGetProgramObject(state, program);
+	GLsizeiptr size;
+	
+	if (!programObject) {
 		return;
 	}
 	
-	for (index = 0; index < executable->numUniforms; ++index) {
-		const ShaderVariable * uniform = &executable->uniforms[index];
-		GLuint elements = uniform->size;
-		
-		GLES_ASSERT(uniform->location + uniform->size <= executable->sizeUniforms);
-		
-		switch (uniform->type) {
-		case GL_FLOAT_MAT2:		elements *= 2;	break;
-		case GL_FLOAT_MAT3:		elements *= 3;	break;
-		case GL_FLOAT_MAT4:		elements *= 4;	break;
-		default:								break;
-		}
-		
-		for (count = 0; count < elements; ++count) {
-			/* create indices from actual values back to meta-data */
-			programObject->uniformTypes[uniform->location + count] = index;
-		}
+	if (!programObject->isLinked) {
+		GlesRecordInvalidOperation(state);
+		return;
+	}
+	
+	if (!binary || !binaryformat) {
+		GlesRecordInvalidValue(state);
+		return;
+	}
+	
+	size = GlesExecutableImageSize(programObject->executable);
+	
+	if (bufsize < size) {
+		GlesRecordInvalidOperation(state);
+		return;
+	}
+	
+	GlesSaveExecutable(programObject->executable, binary);
+	*binaryformat = GL_PROGRAM_BINARY_VIN;
+	
+	if (length) {
+		*length = size;
 	}
-
-	programObject->isLinked = GL_TRUE;
 }
 
-GL_API void GL_APIENTRY glUseProgram (GLuint program) {
+GL_API void GL_APIENTRY glProgramBinaryOES (GLuint program, GLenum binaryformat, const void *binary, GLint length) {
 	State * state = GLES_GET_STATE();
 	Program * programObject = GlesGetProgramObject(state, program);
+	Executable * executable;
 	
 	if (!programObject) {
 		return;
 	}
 	
-	if (programObject->isDeleted) {
-		GlesRecordInvalidOperation(state);
+	if (binaryformat != GL_PROGRAM_BINARY_VIN) {
+		GlesRecordInvalidEnum(state);
+		return;
+	}
+	
+	if (!binary || length < 0) {
+		GlesRecordInvalidValue(state);
+		return;
+	}
+	
+	if (!state->linker) {
+		state->linker = GlesLinkerCreate(state);
+		
+		if (!state->linker) {
+			GlesRecordOutOfMemory(state);
+			return;
+		}
+	}
+
+	FreeProgramData(state, programObject);
+	programObject->isLinked = GL_FALSE;
+
+	/* an invalid binary only results in a failed link */
+	executable = GlesLoadExecutable(state->linker, programObject, binary, length);
+	
+	if (!executable) {
 		return;
 	}
 	
-	if (state->program) {
-		Program * oldProgram = GlesGetProgramObject(state, program);
+	InstallExecutable(state, programObject, executable);
+}
+
+GL_API void GL_APIENTRY glUseProgram (GLuint program) {
+	State * state = GLES_GET_STATE();
+	
+	/* program 0 leaves no program current */
+	if (program) {
+		Program * programObject = GlesGetProgramObject(state, program);
+		
+		if (!programObject) {
+			return;
+		}
+		
+		if (programObject->isDeleted) {
+			GlesRecordInvalidOperation(state);
+			return;
+		}
+	}
+	
+	if (state->program && state->program != program) {
+		Program * oldProgram = GlesGetProgramObject(state, state->program);
 		
 		if (oldProgram->isDeleted) {
 			GlesDeleteProgram(state, oldProgram);
@@ -97,6 +97,8 @@ typedef struct Constants {
 	GLuint		maxCombinedTextureImageUnits;
 	GLuint		maxVertexTextureImageUnits;
 	GLuint		maxFragmentUnifromComponents;
+	GLuint		numProgramBinaryFormats;
+	GLuint		programBinaryFormats[1];
 } Constants;
 
 /**
@@ -121,7 +123,9 @@ static const Constants ConstantTable = {
 	GLES_MAX_VARYING_FLOATS,				/* max varying floats */
 	GLES_MAX_TEXTURE_UNITS,					/* max combined texture image units */
 	GLES_MAX_TEXTURE_UNITS,					/* max vertex texture image units */
-	GLES_MAX_FRAGMENT_UNIFORM_COMPONENTS	/* max fragment uniform components */
+	GLES_MAX_FRAGMENT_UNIFORM_COMPONENTS,	/* max fragment uniform components */
+	1,										/* # program binary formats */
+	{	GL_PROGRAM_BINARY_VIN }				/* program binary formats */
 };
 
 /**
@@ -239,6 +243,8 @@ static const Variable Variables[] = {
 	{ GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS,	VarKindConstant, VarTypeInteger, GLES_OFFSETOF(Constants, maxCombinedTextureImageUnits), 1 },
 	{ GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS,	VarKindConstant, VarTypeInteger, GLES_OFFSETOF(Constants, maxVertexTextureImageUnits), 		1 },
 	{ GL_MAX_FRAGMENT_UNIFORM_COMPONENTS,	VarKindConstant, VarTypeInteger, GLES_OFFSETOF(Constants, maxFragmentUnifromComponents),	1 },
+	{ GL_NUM_PROGRAM_BINARY_FORMATS_OES,	VarKindConstant, VarTypeInteger, GLES_OFFSETOF(Constants, numProgramBinaryFormats),		1 },
+	{ GL_PROGRAM_BINARY_FORMATS_OES,		VarKindConstant, VarTypeInteger, GLES_OFFSETOF(Constants, programBinaryFormats),		1 },
 };
 
 /**
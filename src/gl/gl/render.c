@@ -46,6 +46,7 @@
 #include "gl/state.h"
 #include "raster/raster.h"
 #include "frontend/linker.h"
+#include "backend/interp.h"
 
 
 /*
@@ -77,13 +78,13 @@ static const GLenum FrontFaceValues[] = {
 ** --------------------------------------------------------------------------
 */
 
-static void DrawPoints(State * state, GLuint index);
-static void DrawLines(State * state, GLuint index);
-static void DrawLineStrip(State * state, GLuint index);
-static void DrawLineLoop(State * state, GLuint index);
-static void DrawTriangles(State * state, GLuint index);
-static void DrawTriangleStrip(State * state, GLuint index);
-static void DrawTriangleFan(State * state, GLuint index);
+static void DrawPoints(State * state, const Vertex * vertex);
+static void DrawLines(State * state, const Vertex * vertex);
+static void DrawLineStrip(State * state, const Vertex * vertex);
+static void DrawLineLoop(State * state, const Vertex * vertex);
+static void DrawTriangles(State * state, const Vertex * vertex);
+static void DrawTriangleStrip(State * state, const Vertex * vertex);
+static void DrawTriangleFan(State * state, const Vertex * vertex);
 
 static void EndDrawLineLoop(State * state);
 
@@ -104,6 +105,7 @@ static void EndDrawLineLoop(State * state);
  * 		GL_TRUE if the preparation was successful, otherwise GL_FALSE
  */
 static GLboolean Begin(State * state, GLenum mode) {
+	Executable * executable;
 	GLsizei attr;
 	
 	switch (mode) {
@@ -153,6 +155,14 @@ static GLboolean Begin(State * state, GLenum mode) {
 		return GL_FALSE;
 	}
 	
+	/* evaluate computations that depend only on uniforms once per draw */
+	
+	executable = state->programs[state->program].current;
+	GlesInterpPreProgram(&executable->vertex, state->vertexContext.uniform,
+						 state->vertexContext.temp, state->vertexContext.data);
+	GlesInterpPreProgram(&executable->fragment, state->fragContext.uniform,
+						 state->fragContext.temp, state->fragContext.data);
+	
 	state->primitiveState = 0;
 	state->nextIndex = 0;
 	
@@ -177,6 +187,10 @@ static GLboolean Begin(State * state, GLenum mode) {
 		
 	state->writeSurface->vtbl->lock(state->writeSurface);
 	GlesInitRasterRect(state);
+	
+	/* extent of the guard band relative to the viewport in clip coordinates */
+	state->guardBand.x = 1.0f + GLES_GUARD_BAND / GlesMaxf(state->viewportScale.x, 1.0f);
+	state->guardBand.y = 1.0f + GLES_GUARD_BAND / GlesMaxf(state->viewportScale.y, 1.0f);
 		
 	return GL_TRUE;
 }
@@ -185,7 +199,8 @@ static GLboolean Begin(State * state, GLenum mode) {
  * Finish a rendering cycle.
  * 
  * In particular, this function will trigger any remaining rendering (e.g. to
- * close an open line loop) before releasing the rendering surface.
+ * close an open line loop or to rasterize binned triangles) before releasing
+ * the rendering surface.
 
  * @param state
  * 		pointer to the GL state object
@@ -196,11 +211,16 @@ static void End(State * state) {
 		state->endDrawFunction(state);
 	}
 	
+	GlesFlushTiles(state);
+	
 	state->drawFunction = NULL;
 	state->endDrawFunction = NULL;
 	state->writeSurface->vtbl->unlock(state->writeSurface);	
 }
 
+#define CC_VIEW_VOLUME	0x03f		/* outside of the view volume		*/
+#define CC_CLIP			0x3f0		/* outside of near, far or guard band	*/
+
 /**
  * Determine the clipping flags for the given vertex.
  * 
@@ -212,19 +232,33 @@ static void End(State * state) {
  * <li>bit 3: positive y
  * <li>bit 4: negative z
  * <li>bit 5: positive z
+ * <li>bit 6: negative x beyond guard band
+ * <li>bit 7: positive x beyond guard band
+ * <li>bit 8: negative y beyond guard band
+ * <li>bit 9: positive y beyond guard band
  * </ul>
  * 
+ * @param state
+ * 		the current GL state, providing the extent of the guard band
+ * 
  * @param vertex
  * 		the vertex to process
  */
-static GLES_INLINE void CalcCC(Vertex * vertex) {
+static GLES_INLINE void CalcCC(const State * state, Vertex * vertex) {
+	GLfloat w = vertex->geometry.position.w;
+	GLfloat gx = w * state->guardBand.x, gy = w * state->guardBand.y;
+	
 	vertex->geometry.cc =
-		 (vertex->geometry.position.x < -vertex->geometry.position.w)       |
-		((vertex->geometry.position.x >  vertex->geometry.position.w) << 1) |
-		((vertex->geometry.position.y < -vertex->geometry.position.w) << 2) |
-		((vertex->geometry.position.y >  vertex->geometry.position.w) << 3) |
-		((vertex->geometry.position.z < -vertex->geometry.position.w) << 4) |
-		((vertex->geometry.position.x >  vertex->geometry.position.w) << 5);
+		 (vertex->geometry.position.x < -w)        |
+		((vertex->geometry.position.x >  w)  << 1) |
+		((vertex->geometry.position.y < -w)  << 2) |
+		((vertex->geometry.position.y >  w)  << 3) |
+		((vertex->geometry.position.z < -w)  << 4) |
+		((vertex->geometry.position.z >  w)  << 5) |
+		((vertex->geometry.position.x < -gx) << 6) |
+		((vertex->geometry.position.x >  gx) << 7) |
+		((vertex->geometry.position.y < -gy) << 8) |
+		((vertex->geometry.position.y >  gy) << 9);
 }
 
 /**
@@ -257,7 +291,7 @@ static void SelectArrayElement(State * state, GLuint index, Vertex * vertex) {
 	state->vertexContext.geometry = &vertex->geometry;
 	state->vertexContext.varying = vertex->varying;
 
-	GlesVertexProgram(state->programs[state->program].executable)(&state->vertexContext);
+	GlesVertexProgram(state->programs[state->program].current)(&state->vertexContext);
 
 #if 0
 	/* pick projective half space; reportedly, this is a bug??? */
@@ -272,7 +306,185 @@ static void SelectArrayElement(State * state, GLuint index, Vertex * vertex) {
 
 	/* calculate the clipping flags */
 	
-	CalcCC(vertex);
+	CalcCC(state, vertex);
+}
+
+/**
+ * Fetch the array data for a list of vertices, and process them through the
+ * vertex shader into the post-transform buffer. This is the first phase of
+ * a draw call; primitives are assembled from the shaded vertices afterwards.
+ * 
+ * If the vertex shader supports batched execution, the attributes of
+ * GLES_SHADER_BATCH vertices are transposed into structure of arrays form
+ * and shaded together. Only the interpreter provides a batched entry point;
+ * native vertex programs shade one vertex at a time.
+ * 
+ * @param state
+ * 		the current GL state
+ * 
+ * @param indices
+ * 		array indices of the vertices to process
+ * 
+ * @param vertices
+ * 		where to store the results of the operation
+ * 
+ * @param count
+ * 		the number of vertices to process
+ */
+static void ShadeVertices(State * state, const GLuint * indices, Vertex * vertices,
+						  GLsizei count) {
+	VertexBatchProgram program = 
+		GlesVertexBatchProgram(state->programs[state->program].current);
+	
+	GLfloat attrib[GLES_MAX_VERTEX_ATTRIBS * 4 * GLES_SHADER_BATCH];
+	GLfloat geometry[sizeof(VertexGeometry) / sizeof(GLfloat) * GLES_SHADER_BATCH];
+	GLfloat varying[GLES_MAX_VARYING_FLOATS * GLES_SHADER_BATCH];
+	GLsizei base, lane, attr, index;
+	
+	if (!program) {
+		for (index = 0; index < count; ++index) {
+			SelectArrayElement(state, indices[index], &vertices[index]);
+		}
+		
+		return;
+	}
+	
+	state->vertexContext.batchAttrib = attrib;
+	state->vertexContext.batchGeometry = geometry;
+	state->vertexContext.batchVarying = varying;
+	
+	/* replicate the values of attributes not sourced from arrays */
+	
+	for (attr = 0; attr < GLES_MAX_VERTEX_ATTRIBS; ++attr) {
+		if (!state->vertexAttribArray[attr].enabled) {
+			for (index = 0; index < 4; ++index) {
+				for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+					attrib[(attr * 4 + index) * GLES_SHADER_BATCH + lane] = 
+						state->currentAttrib[attr].v[index];
+				}
+			}
+		}
+	}
+	
+	for (base = 0; base < count; base += GLES_SHADER_BATCH) {
+		GLsizei lanes = GlesMini(count - base, GLES_SHADER_BATCH);
+		
+		/* fetch the vertex attrib values */
+		
+		for (lane = 0; lane < lanes; ++lane) {
+			for (attr = 0; attr < GLES_MAX_VERTEX_ATTRIBS; ++attr) {
+				if (state->vertexAttribArray[attr].enabled) {
+					Vec4f value;
+					
+					state->vertexAttribArray[attr].fetchFunc(&state->vertexAttribArray[attr], 
+															 indices[base + lane], &value);
+					
+					for (index = 0; index < 4; ++index) {
+						attrib[(attr * 4 + index) * GLES_SHADER_BATCH + lane] = value.v[index];
+					}
+				}
+			}
+		}
+		
+		/* execute the vertex shader */
+		
+		program(&state->vertexContext, (1u << lanes) - 1);
+		
+		/* transpose the results back into the post-transform buffer */
+		
+		for (lane = 0; lane < lanes; ++lane) {
+			Vertex * vertex = &vertices[base + lane];
+			GLfloat * words = (GLfloat *) &vertex->geometry;
+			
+			for (index = 0; index < (GLsizei) (sizeof(VertexGeometry) / sizeof(GLfloat)); ++index) {
+				words[index] = geometry[index * GLES_SHADER_BATCH + lane];
+			}
+			
+			for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
+				vertex->varying[index] = varying[index * GLES_SHADER_BATCH + lane];
+			}
+			
+			CalcCC(state, vertex);
+		}
+	}
+	
+	/* the batch buffers do not outlive this call */
+	state->vertexContext.batchAttrib = NULL;
+	state->vertexContext.batchGeometry = NULL;
+	state->vertexContext.batchVarying = NULL;
+}
+
+/**
+ * Shade the vertices of a chunk of a glDrawArrays call, and pass them on to
+ * primitive assembly.
+ * 
+ * @param state
+ * 		the current GL state
+ * 
+ * @param first
+ * 		array index of the first vertex to process
+ * 
+ * @param count
+ * 		the number of vertices to process, at most GLES_MAX_TRANSFORM_VERTICES
+ */
+static void DrawArrayChunk(State * state, GLint first, GLsizei count) {
+	GLuint indices[GLES_MAX_TRANSFORM_VERTICES];
+	GLsizei index;
+	
+	for (index = 0; index < count; ++index) {
+		indices[index] = first + index;
+	}
+	
+	ShadeVertices(state, indices, state->transformedVertices, count);
+	
+	for (index = 0; index < count; ++index) {
+		state->drawFunction(state, &state->transformedVertices[index]);
+	}
+}
+
+/**
+ * Shade the vertices of a chunk of a glDrawElements call, and pass them on
+ * to primitive assembly.
+ * 
+ * A direct-mapped cache keyed by the element value ensures that vertices
+ * referenced repeatedly within the chunk are shaded only once.
+ * 
+ * @param state
+ * 		the current GL state
+ * 
+ * @param elements
+ * 		the array indices of the vertices
+ * 
+ * @param count
+ * 		the number of elements, at most GLES_MAX_TRANSFORM_VERTICES
+ */
+static void DrawElementChunk(State * state, const GLuint * elements, GLsizei count) {
+	GLuint indices[GLES_MAX_TRANSFORM_VERTICES];
+	GLuint cacheElement[GLES_MAX_TRANSFORM_VERTICES];
+	GLsizei cacheSlot[GLES_MAX_TRANSFORM_VERTICES];
+	GLsizei slots[GLES_MAX_TRANSFORM_VERTICES];
+	GLsizei numVertices = 0, index;
+	
+	GlesMemset(cacheElement, 0xff, sizeof(cacheElement));
+	
+	for (index = 0; index < count; ++index) {
+		GLuint element = elements[index];
+		GLsizei line = element & (GLES_MAX_TRANSFORM_VERTICES - 1);
+		
+		if (cacheElement[line] != element) {
+			cacheElement[line] = element;
+			cacheSlot[line] = numVertices;
+			indices[numVertices++] = element;
+		}
+		
+		slots[index] = cacheSlot[line];
+	}
+	
+	ShadeVertices(state, indices, state->transformedVertices, numVertices);
+	
+	for (index = 0; index < count; ++index) {
+		state->drawFunction(state, &state->transformedVertices[slots[index]]);
+	}
 }
 
 static GLES_INLINE GLfloat InterpolateCoord(GLfloat x0f, GLfloat x1f, GLfloat coeff) {
@@ -314,7 +526,10 @@ static void Interpolate(Vertex * newVertex, const Vertex * outside, const Vertex
 }
 
 /**
- * Clip a convex primitive at the viewing frustrum. 
+ * Clip a convex primitive at the near and far planes of the viewing frustrum
+ * and at the guard band. Primitives extending beyond the viewport but not
+ * beyond the guard band are not clipped; the rasterizer confines them to
+ * the viewport and scissor rectangle instead.
  * 
  * The primitive is defined as the convex hull of a list of vertices given as
  * array of pointers. The resulting list of pointers to vertices will be stored
@@ -343,7 +558,7 @@ static GLsizei Clip(State * state, Vertex ** input, Vertex ** temp, GLsizei numV
 
     Vertex * vprev, * vnext;
     GLsizei i, icnt = numVertices, ocnt = 0;
-	const GLsizei numVarying = GLES_MAX_VARYING_FLOATS;
+	const GLsizei numVarying = state->programs[state->program].current->numVarying;
 	Vertex * nextTemporary = state->tempVertices;
 
 	GLuint cc = 0;
@@ -352,13 +567,14 @@ static GLsizei Clip(State * state, Vertex ** input, Vertex ** temp, GLsizei numV
 		cc |= vilist[i]->geometry.cc;
 	}
 	
-	if (!cc) {
+	if (!(cc & CC_CLIP)) {
 		return numVertices;
 	}
 
-    for (plane = 0; plane < 6; plane++) {
+    for (plane = 4; plane < 10; plane++) {
 		GLuint c, p = 1 << plane;
-		GLsizei coord = plane >> 1;
+		GLsizei coord = plane < 6 ? 2 : (plane - 6) >> 1;
+		GLfloat extent = plane < 6 ? 1.0f : coord ? state->guardBand.y : state->guardBand.x;
 		GLboolean inside, prev_inside;
 
 		if (!(cc & p)) continue;
@@ -387,9 +603,9 @@ static GLsizei Clip(State * state, Vertex ** input, Vertex ** temp, GLsizei numV
 				}
 
 				GLfloat ci = vinside->geometry.position.v[coord];
-				GLfloat wi = vinside->geometry.position.w;
+				GLfloat wi = vinside->geometry.position.w * extent;
 				GLfloat co = voutside->geometry.position.v[coord];
-				GLfloat wo = voutside->geometry.position.w;
+				GLfloat wo = voutside->geometry.position.w * extent;
 
 				if (!(plane & 1)) {
 					wi = -wi; wo = -wo;
@@ -403,7 +619,7 @@ static GLsizei Clip(State * state, Vertex ** input, Vertex ** temp, GLsizei numV
 				GLfloat coeff = num / denom;
 
 				Interpolate(newVertex, voutside, vinside, coeff, numVarying);
-				CalcCC(newVertex);
+				CalcCC(state, newVertex);
 				cc |= newVertex->geometry.cc;
 
 				volist[ocnt++] = newVertex;
@@ -428,6 +644,11 @@ static GLsizei Clip(State * state, Vertex ** input, Vertex ** temp, GLsizei numV
 
     }
 
+	if (vilist != input) {
+		/* an odd number of clipped planes leaves the result in temp */
+		GlesMemcpy(input, vilist, icnt * sizeof(Vertex *));
+	}
+
 	return icnt;
 }
 
@@ -503,8 +724,8 @@ static void DrawPoint(State * state, Vertex * a) {
 	GlesRasterPointSprite(state, &ra, a->geometry.pointSize);
 }
 
-static void DrawPoints(State * state, GLuint index) {
-	SelectArrayElement(state, index, &state->vertexQueue[0]);
+static void DrawPoints(State * state, const Vertex * vertex) {
+	state->vertexQueue[0] = *vertex;
 	DrawPoint(state, &state->vertexQueue[0]);
 }
 
@@ -514,27 +735,93 @@ static void DrawPoints(State * state, GLuint index) {
 ** --------------------------------------------------------------------------
 */
 
+/**
+ * Clip a line segment against the near and far plane and the guard band.
+ * Unlike polygons, a segment is clipped parametrically, and each end-point
+ * that is clipped away is replaced by a temporary vertex.
+ * 
+ * @param state
+ * 		reference to the GL state object
+ * 
+ * @param a
+ * 		the first end-point of the segment; updated if clipped
+ * 
+ * @param b
+ * 		the second end-point of the segment; updated if clipped
+ * 
+ * @return
+ * 		GL_TRUE if a part of the segment remains visible
+ */
+static GLboolean ClipLine(State * state, Vertex ** a, Vertex ** b) {
+	const GLsizei numVarying = state->programs[state->program].current->numVarying;
+	GLuint cc = (*a)->geometry.cc | (*b)->geometry.cc;
+	GLfloat t0 = 0.0f, t1 = 1.0f;	/* visible parameter range from a to b */
+	GLuint plane;
+	
+	if (!(cc & CC_CLIP)) {
+		return GL_TRUE;
+	}
+	
+	for (plane = 4; plane < 10; ++plane) {
+		GLsizei coord = plane < 6 ? 2 : (plane - 6) >> 1;
+		GLfloat extent = plane < 6 ? 1.0f : coord ? state->guardBand.y : state->guardBand.x;
+		GLfloat ca, cb, da, db;
+		
+		if (!(cc & (1 << plane))) continue;
+		
+		ca = (*a)->geometry.position.v[coord];
+		cb = (*b)->geometry.position.v[coord];
+
+		/* signed distances to the plane, which are positive inside */
+		da = (*a)->geometry.position.w * extent + ((plane & 1) ? -ca : ca);
+		db = (*b)->geometry.position.w * extent + ((plane & 1) ? -cb : cb);
+		
+		if (da < 0.0f && db < 0.0f) {
+			return GL_FALSE;
+		} else if (da < 0.0f) {
+			t0 = GlesMaxf(t0, da / (da - db));
+		} else if (db < 0.0f) {
+			t1 = GlesMinf(t1, da / (da - db));
+		}
+	}
+	
+	if (t0 >= t1) {
+		return GL_FALSE;
+	}
+	
+	if (t1 < 1.0f) {
+		Interpolate(&state->tempVertices[1], *b, *a, t1, numVarying);
+	}
+	
+	if (t0 > 0.0f) {
+		Interpolate(&state->tempVertices[0], *b, *a, t0, numVarying);
+		*a = &state->tempVertices[0];
+	}
+	
+	if (t1 < 1.0f) {
+		*b = &state->tempVertices[1];
+	}
+	
+	return GL_TRUE;
+}
+
 static void DrawLine(State * state, Vertex * a, Vertex * b) {
-	Vertex * vertices[4], * temp[4];
+	RasterVertex ra, rb;
 	
-	if (a->geometry.cc & b->geometry.cc) {
+	if (a->geometry.cc & b->geometry.cc & CC_VIEW_VOLUME) {
 		/* outside of frustrum */
 		return;
 	}
 	
-	vertices[0] = a;
-	vertices[1] = b;
-	
-	if (Clip(state, vertices, temp, 2) >= 2) {
-		RasterVertex ra, rb;
-		
-		ProjectVertexToWindowCoords(state, vertices[0], &ra);
-		ProjectVertexToWindowCoords(state, vertices[1], &rb);
+	if (ClipLine(state, &a, &b)) {
+		ProjectVertexToWindowCoords(state, a, &ra);
+		ProjectVertexToWindowCoords(state, b, &rb);
+		GlesRasterLine(state, &ra, &rb);
 	}
 }
 
-static void DrawLines(State * state, GLuint index) {
-	SelectArrayElement(state, index, &state->vertexQueue[state->nextIndex++]);
+static void DrawLines(State * state, const Vertex * vertex) {
+	state->vertexQueue[state->nextIndex++] = *vertex;
 
 	if (state->nextIndex == 2) {
 		DrawLine(state, &state->vertexQueue[0], &state->vertexQueue[1]);
@@ -542,8 +829,8 @@ static void DrawLines(State * state, GLuint index) {
 	}
 }
 
-static void DrawLineStrip(State * state, GLuint index) {
-	SelectArrayElement(state, index, &state->vertexQueue[state->nextIndex++]);
+static void DrawLineStrip(State * state, const Vertex * vertex) {
+	state->vertexQueue[state->nextIndex++] = *vertex;
 
 	if (state->primitiveState != 0) {
 		// determine line orienation based on parity
@@ -562,8 +849,8 @@ static void DrawLineStrip(State * state, GLuint index) {
 	}
 }
 
-static void DrawLineLoop(State * state, GLuint index) {
-	SelectArrayElement(state, index, &state->vertexQueue[state->nextIndex++]);
+static void DrawLineLoop(State * state, const Vertex * vertex) {
+	state->vertexQueue[state->nextIndex++] = *vertex;
 
 	if (state->primitiveState == 2) {
 		// we have seen at least 3 vertices
@@ -604,11 +891,12 @@ static void EndDrawLineLoop(State * state) {
 */
 
 static void DrawTriangle(State * state, Vertex * a, Vertex * b, Vertex * c) {
-	Vertex * vertices[8], * temp[8];
+	/* clipping adds at most one vertex per plane */
+	Vertex * vertices[9], * temp[9];
 	GLsizei numVertices, index;
 	GLboolean cw, backFace;
 	
-	if (a->geometry.cc & b->geometry.cc & c->geometry.cc) {
+	if (a->geometry.cc & b->geometry.cc & c->geometry.cc & CC_VIEW_VOLUME) {
 		/* outside of frustrum */
 		return;
 	}
@@ -643,13 +931,16 @@ static void DrawTriangle(State * state, Vertex * a, Vertex * b, Vertex * c) {
 		for (index = 2; index < numVertices; ++index) {
 			RasterVertex rc;
 			ProjectVertexToWindowCoords(state, vertices[index], &rc);
-			GlesRasterTriangle(state, &ra, &rb, &rc, backFace);
+			GlesBinTriangle(state, &ra, &rb, &rc, backFace);
+			
+			/* the clipped polygon is rendered as a fan around its first vertex */
+			rb = rc;
 		}
 	}
 }
 
-static void DrawTriangles(State * state, GLuint index) {
-	SelectArrayElement(state, index, state->vertexQueue + state->nextIndex++);
+static void DrawTriangles(State * state, const Vertex * vertex) {
+	state->vertexQueue[state->nextIndex++] = *vertex;
 
 	if (state->nextIndex == 3) {
 		DrawTriangle(state, state->vertexQueue + 0, state->vertexQueue + 1,
@@ -658,8 +949,8 @@ static void DrawTriangles(State * state, GLuint index) {
 	}
 }
 
-static void DrawTriangleStrip(State * state, GLuint index) {
-	SelectArrayElement(state, index, state->vertexQueue + state->nextIndex);
+static void DrawTriangleStrip(State * state, const Vertex * vertex) {
+	state->vertexQueue[state->nextIndex] = *vertex;
 
 	if (state->primitiveState == 3) {
 		// even triangle
@@ -685,8 +976,8 @@ static void DrawTriangleStrip(State * state, GLuint index) {
 	}
 }
 
-static void DrawTriangleFan(State * state, GLuint index) {
-	SelectArrayElement(state, index, state->vertexQueue + state->nextIndex);
+static void DrawTriangleFan(State * state, const Vertex * vertex) {
+	state->vertexQueue[state->nextIndex] = *vertex;
 
 	if (state->primitiveState == 3) {
 		// even triangle
@@ -739,8 +1030,12 @@ GL_API void GL_APIENTRY glDrawArrays (GLenum mode, GLint first, GLsizei count) {
 	}
 
 	if (Begin(state, mode)) {
-		while (count-- > 0) {
-			(state->drawFunction)(state, first++);
+		while (count > 0) {
+			GLsizei chunk = GlesMini(count, GLES_MAX_TRANSFORM_VERTICES);
+			
+			DrawArrayChunk(state, first, chunk);
+			first += chunk;
+			count -= chunk;
 		}
 		
 		End(state);		
@@ -778,28 +1073,35 @@ GL_API void GL_APIENTRY glDrawElements (GLenum mode, GLsizei count, GLenum type,
 		return;
 	}
 
-	if (type == GL_UNSIGNED_BYTE) {
-		const GLubyte * ptr = (const GLubyte *) indices;
-
-		if (Begin(state, mode)) {
-			while (count-- > 0) {
-				state->drawFunction(state, *ptr++);
+	if (Begin(state, mode)) {
+		GLuint elements[GLES_MAX_TRANSFORM_VERTICES];
+		
+		while (count > 0) {
+			GLsizei chunk = GlesMini(count, GLES_MAX_TRANSFORM_VERTICES), index;
+			
+			if (type == GL_UNSIGNED_BYTE) {
+				const GLubyte * ptr = (const GLubyte *) indices;
+				
+				for (index = 0; index < chunk; ++index) {
+					elements[index] = *ptr++;
+				}
+				
+				indices = ptr;
+			} else {
+				const GLushort * ptr = (const GLushort *) indices;
+				
+				for (index = 0; index < chunk; ++index) {
+					elements[index] = *ptr++;
+				}
+				
+				indices = ptr;
 			}
-
-			End(state);
+			
+			DrawElementChunk(state, elements, chunk);
+			count -= chunk;
 		}
-	} else if (type == GL_UNSIGNED_SHORT) {
-		const GLushort * ptr = (const GLushort *) indices;
-
-		if (Begin(state, mode)) {
-			while (count-- > 0) {
-				state->drawFunction(state, *ptr++);
-			}
 
-			End(state);
-		}
-	} else {
-		GlesRecordInvalidEnum(state);
+		End(state);
 	}
 }
 
@@ -61,8 +61,14 @@ static void InitShader(Shader * shader, GLenum shaderType) {
 	shader->isDeleted = GL_FALSE;
 	shader->text = NULL;
 	shader->length = 0;
+	shader->binary = NULL;
+	shader->binarySize = 0;
 	shader->il = NULL;
 	shader->size = 0;
+	shader->optimize = OptimizeAll;
+	shader->isCompiled = GL_FALSE;
+	shader->compileTask = NULL;
+	shader->pendingTasks = 0;
 }
 
 static void FreeShaderSource(Shader * shaderObject) {
@@ -74,6 +80,12 @@ static void FreeShaderSource(Shader * shaderObject) {
 }
 
 static void FreeShaderIntermediate(Shader * shaderObject) {
+	if (shaderObject->binary) {
+		GlesFree(shaderObject->binary);
+		shaderObject->binary = NULL;
+		shaderObject->binarySize = 0;
+	}
+	
 	if (shaderObject->il) {
 		GlesFree(shaderObject->il);
 		shaderObject->il = NULL;
@@ -85,6 +97,7 @@ void GlesDeleteShader(State * state, Shader * shader) {
 	GLES_ASSERT(shader - state->shaders >= 0 &&
 		shader - state->shaders < GLES_MAX_SHADERS);
 		
+	GlesWaitShader(state, shader);
 	FreeShaderSource(shader);
 	FreeShaderIntermediate(shader);
 	GlesLogDeInit(&shader->log);
@@ -169,7 +182,14 @@ GL_API void GL_APIENTRY glCompileShader (GLuint shader) {
 		return;
 	}
 	
+	GlesWaitShader(state, shaderObject);
 	GlesLogClear(&shaderObject->log);
+	FreeShaderIntermediate(shaderObject);
+	
+	if (GlesCompileShaderAsync(state, shaderObject)) {
+		/* results are waited for when the shader is used or queried */
+		return;
+	}
 	
 	if (!state->compiler) {
 		state->compiler = GlesCompilerCreate(state);
@@ -182,7 +202,7 @@ GL_API void GL_APIENTRY glCompileShader (GLuint shader) {
 	
 	shaderObject->isCompiled = GlesCompileShader(state->compiler, shaderObject);
 	
-	GLES_ASSERT(shaderObject->isCompiled == (shaderObject->il != NULL));
+	GLES_ASSERT(shaderObject->isCompiled == (shaderObject->binary != NULL));
 }
 
 GL_API void GL_APIENTRY glGetShaderiv (GLuint shader, GLenum pname, GLint *params) {
@@ -193,6 +213,8 @@ GL_API void GL_APIENTRY glGetShaderiv (GLuint shader, GLenum pname, GLint *param
 		return;
 	}
 	
+	GlesWaitShader(state, shaderObject);
+	
 	switch (pname) {
 	case GL_SHADER_TYPE:
 		*params = shaderObject->type;
@@ -215,6 +237,11 @@ GL_API void GL_APIENTRY glGetShaderiv (GLuint shader, GLenum pname, GLint *param
 		break;
 		
 	case GL_SHADER_INTERMEDIATE_LENGTH_VIN:
+		if (!GlesShaderIntermediateText(shaderObject)) {
+			GlesRecordOutOfMemory(state);
+			return;
+		}
+		
 		*params = shaderObject->size + 1;
 		break;
 
@@ -237,6 +264,7 @@ GL_API void GL_APIENTRY glGetShaderInfoLog (GLuint shader, GLsizei bufsize, GLsi
 		return;
 	}
 	
+	GlesWaitShader(state, shaderObject);
 	GlesLogExtract(&shaderObject->log, bufsize, infolog, length);
 }
 
@@ -254,6 +282,13 @@ GL_API void GL_APIENTRY glGetShaderIntermediateVIN (GLuint shader, GLsizei bufsi
 		return;
 	}
 	
+	GlesWaitShader(state, shaderObject);
+	
+	if (!GlesShaderIntermediateText(shaderObject)) {
+		GlesRecordOutOfMemory(state);
+		return;
+	}
+	
 	returnedLength = shaderObject->size + 1 >= bufsize ? bufsize - 1 : shaderObject->size;
 	
 	GlesMemcpy(intermediate, shaderObject->il, returnedLength);
@@ -291,6 +326,8 @@ GL_API void GL_APIENTRY glGetShaderSource (GLuint shader, GLsizei bufsize, GLsiz
 GL_API void GL_APIENTRY glReleaseShaderCompilerOES(void) {
 	State * state = GLES_GET_STATE();
 
+	GlesDestroyWorkers(state);
+	
 	if (state->compiler) {
 		GlesCompilerDestroy(state->compiler);
 		state->compiler = NULL;
@@ -308,6 +345,7 @@ GL_API void GL_APIENTRY glShaderSource(GLuint shader, GLsizei count, const char
 		return;
 	}
 	
+	GlesWaitShader(state, shaderObject);
 	FreeShaderSource(shaderObject);
 
 	for (index = 0; index < count; ++index) {
@@ -44,6 +44,7 @@
 #include "config.h"
 #include "platform/platform.h"
 #include "gl/state.h"
+#include "raster/raster.h"
 
 
 /*
@@ -281,6 +282,44 @@ void GlesInitState(State * state) {
 
 void GlesDeInitState(State * state) {
 	/* TODO */
+	
+	GlesDestroyTiles(state);
+	
+	if (state->vertexContext.temp) {
+		GlesFree(state->vertexContext.temp);
+		state->vertexContext.temp = NULL;
+		state->vertexContext.tempSize = 0;
+	}
+	
+	if (state->vertexContext.batchTemp) {
+		GlesFree(state->vertexContext.batchTemp);
+		state->vertexContext.batchTemp = NULL;
+		state->vertexContext.batchTempSize = 0;
+	}
+	
+	if (state->vertexContext.data) {
+		GlesFree(state->vertexContext.data);
+		state->vertexContext.data = NULL;
+		state->vertexContext.dataSize = 0;
+	}
+	
+	if (state->fragContext.temp) {
+		GlesFree(state->fragContext.temp);
+		state->fragContext.temp = NULL;
+		state->fragContext.tempSize = 0;
+	}
+	
+	if (state->fragContext.batchTemp) {
+		GlesFree(state->fragContext.batchTemp);
+		state->fragContext.batchTemp = NULL;
+		state->fragContext.batchTempSize = 0;
+	}
+	
+	if (state->fragContext.data) {
+		GlesFree(state->fragContext.data);
+		state->fragContext.data = NULL;
+		state->fragContext.dataSize = 0;
+	}
 }
 
 void GlesGenObjects(State * state, GLuint * freeList, GLuint maxElements, GLsizei n, GLuint *objs) {
@@ -502,6 +502,21 @@ typedef struct ShaderVariable {
  * 		by the rendering pipeline.
  * </ul>
  */
+/**
+ * IL optimization passes applied when a shader is linked into a program.
+ * The values serve as bit masks; the set of passes for a shader is selected
+ * using #pragma optimize.
+ */
+typedef enum OptimizePass {
+	OptimizeDeadCode	= 0x01,			/**< dead code elimination			*/
+	OptimizeConstants	= 0x02,			/**< constant propagation			*/
+	OptimizeCopies		= 0x04,			/**< copy propagation				*/
+	OptimizeHoist		= 0x08,			/**< uniform-only code to pre-shader*/
+	OptimizeInline		= 0x10,			/**< subroutine inlining			*/
+	OptimizeUnroll		= 0x20,			/**< constant loop unrolling		*/
+	OptimizeAll			= 0x3f			/**< all optimization passes		*/
+} OptimizePass;
+
 typedef struct Shader {
 	GLenum		type;					/**< shader type						*/
 	
@@ -511,14 +526,21 @@ typedef struct Shader {
 	Log			log;					/**< shader compiler log			*/
 
 	/* shader IL */
-	char *		il;						/**< actual text lines of IL		*/
+	void *		binary;					/**< binary image of IL				*/
+	GLsizeiptr	binarySize;				/**< size of binary image in bytes	*/
+	char *		il;						/**< IL text, created on demand		*/
 	GLsizei		size;					/**< length of shader intermediate	*/
+	GLbitfield	optimize;				/**< OptimizePass set for linking	*/
 
 	/** # of programs this shader is attached to */
 	GLuint		attachmentCount;
 	
 	GLboolean	isCompiled;				/**< has this been compiled?		*/
 	GLboolean	isDeleted;				/**< deletion requested?			*/
+
+	/* background compilation */
+	struct WorkerTask *	compileTask;	/**< compile not yet waited for		*/
+	GLuint		pendingTasks;			/**< worker tasks using this shader	*/
 } Shader;
 
 typedef struct FragContext FragContext;
@@ -528,6 +550,13 @@ typedef struct FragContext FragContext;
  */
 typedef GLboolean (*FragmentProgram)(const FragContext * context);
 
+/**
+ * Signature of a fragment shader program function that processes a batch
+ * of GLES_SHADER_BATCH fragments at once. The mask selects the fragments
+ * to process, the return value masks the fragments not discarded.
+ */
+typedef GLuint (*FragmentBatchProgram)(const FragContext * context, GLuint mask);
+
 /**
  * Signature of a vertex shader program function.
  */
@@ -535,6 +564,13 @@ typedef struct VertexContext VertexContext;
 
 typedef GLboolean (*VertexProgram)(const VertexContext * context);
 
+/**
+ * Signature of a vertex shader program function that processes a batch
+ * of GLES_SHADER_BATCH vertices at once. The mask selects the vertices to
+ * process.
+ */
+typedef void (*VertexBatchProgram)(const VertexContext * context, GLuint mask);
+
 /*
 ** --------------------------------------------------------------------------
 ** Shader Programs
@@ -543,6 +579,17 @@ typedef GLboolean (*VertexProgram)(const VertexContext * context);
 
 struct Executable;
 
+/**
+ * An executable specialized on the values of selected uniform variables.
+ */
+typedef struct ProgramVariant {
+	struct Executable *	
+					executable;			/**< specialized executable or NULL	*/
+	Vec4f *			values;				/**< uniform values specialized on	*/
+	GLuint			hash;				/**< hash value of uniform values	*/
+	GLuint			lastUse;			/**< time stamp of last use			*/
+} ProgramVariant;
+
 /**
  * An instance of Program represents a combination of a vertex shader and a
  * fragment shader that are used together during the rendering process.
@@ -566,6 +613,15 @@ typedef struct Program {
 	/* generated executable */
 	struct Executable *	
 					executable;			/**< executable module				*/
+	struct Executable *	
+					current;			/**< executable used for rendering	*/
+	
+	/* executables specialized on uniform values, replaced in LRU order */
+	ProgramVariant	variants[GLES_MAX_PROGRAM_VARIANTS];
+	GLuint			variantClock;		/**< time stamp for variant use		*/
+	GLuint			variantChurn;		/**< cost of recent variant links	*/
+	
+	struct WorkerTask *	linkTask;		/**< background link in progress	*/
 } Program;
 
 /*
@@ -702,11 +758,34 @@ struct FragContext {
 	State *			state;				/**< current GL state					*/
 	TextureImageUnit *	
 					textureImageUnit;	/**< texture image units to use			*/
+	const void *	code;				/**< shader code to execute				*/
 	const Vec4f *	constant;			/**< base address of constant data (r/o)*/
 	const Vec4f *	uniform;			/**< Base address of uniform data (r/o)	*/
 	const GLfloat *	varying;			/**< Base address of varying data (r/o) */
 	Vec4f *			result;				/**< Base address of results (w) 		*/
 	Vec4f *			temp;				/**< Base address of temp. data (r/w)	*/
+	GLsizeiptr		tempSize;			/**< size of temp. data area in vec4	*/
+	Vec4f *			data;				/**< constants and pre-shader results	*/
+	GLsizeiptr		dataSize;			/**< size of data area in vec4			*/
+	
+	Vec4f			fragCoord;			/**< gl_FragCoord						*/
+	Vec4f			frontFacing;		/**< gl_FrontFacing in x-component		*/
+	Vec4f			pointCoord;			/**< gl_PointCoord in x, y-components	*/
+	
+	/*
+	 * Batched execution; all per-fragment data is stored as structure of
+	 * arrays, i.e. word i of fragment j is found at index
+	 * i * GLES_SHADER_BATCH + j.
+	 */
+	const void *	batchCode;			/**< batched shader code, or NULL		*/
+	const GLfloat *	batchVarying;		/**< Base address of varying data (r/o)	*/
+	GLfloat *		batchResult;		/**< Base address of results (w)		*/
+	Vec4f *			batchTemp;			/**< Base address of temp. data (r/w)	*/
+	GLsizeiptr		batchTempSize;		/**< size of temp. data area in vec4	*/
+	
+	GLfloat			batchFragCoord[4][GLES_SHADER_BATCH];	/**< gl_FragCoord	*/
+	GLfloat			batchFrontFacing[4][GLES_SHADER_BATCH];/**< gl_FrontFacing*/
+	GLfloat			batchPointCoord[4][GLES_SHADER_BATCH];/**< gl_PointCoord	*/
 };
 
 /**
@@ -719,12 +798,28 @@ struct VertexContext {
 	State *			state;				/**< current GL state					*/
 	TextureImageUnit *	
 					textureImageUnit;	/**< texture image units to use			*/
+	const void *	code;				/**< shader code to execute				*/
 	const Vec4f * 	constant;			/**< base address of constant data (r/o)*/
 	const Vec4f *	uniform;			/**< Base address of uniform data (r/o)	*/
 	const Vec4f *	attrib;				/**< Base address of attrib data (r/o) 	*/
 	VertexGeometry*	geometry;			/**< Base address of geometry data (w)	*/
 	GLfloat *		varying;			/**< Base address of results (w) 		*/
 	Vec4f *			temp;				/**< Base address of temp. data (r/w) 	*/
+	GLsizeiptr		tempSize;			/**< size of temp. data area in vec4	*/
+	Vec4f *			data;				/**< constants and pre-shader results	*/
+	GLsizeiptr		dataSize;			/**< size of data area in vec4			*/
+	
+	/*
+	 * Batched execution; all per-vertex data is stored as structure of
+	 * arrays, i.e. word i of vertex j is found at index
+	 * i * GLES_SHADER_BATCH + j.
+	 */
+	const void *	batchCode;			/**< batched shader code, or NULL		*/
+	const GLfloat *	batchAttrib;		/**< Base address of attrib data (r/o)	*/
+	GLfloat *		batchGeometry;		/**< Base address of geometry data (w)	*/
+	GLfloat *		batchVarying;		/**< Base address of results (w)		*/
+	Vec4f *			batchTemp;			/**< Base address of temp. data (r/w)	*/
+	GLsizeiptr		batchTempSize;		/**< size of temp. data area in vec4	*/
 };
 
 /*
@@ -734,10 +829,10 @@ struct VertexContext {
 */
 
 /**
- * Signature of the vertex processing function that is called for each
- * vertex during processing of DrawArray and DrawElements.
+ * Signature of the primitive assembly function that is called for each
+ * shaded vertex during processing of DrawArray and DrawElements.
  */
-typedef void (*DrawFunction)(State * state, GLuint index);
+typedef void (*DrawFunction)(State * state, const Vertex * vertex);
 
 /**
  * Signature of the vertex processing function that is called after the
@@ -898,6 +993,7 @@ struct State {
 	Vec2f			viewportScale;			/* derived state				*/
 	GLfloat			depthOrigin;			/* derived state				*/
 	GLfloat			depthScale;				/* derived state				*/
+	Vec2f			guardBand;				/* derived state				*/
 
 	/* general settings */
 	GLuint			packAlignment;			/**< image pixel packing		*/
@@ -936,6 +1032,9 @@ struct State {
 	/** temporary vertex storage */
 	Vertex			tempVertices[GLES_MAX_VERTEX_QUEUE];
 
+	/** post-transform buffer holding the shaded vertices of a draw call */
+	Vertex			transformedVertices[GLES_MAX_TRANSFORM_VERTICES];
+
 	/** function to call for each vertex within Begin/End loop */
 	DrawFunction	drawFunction;
 	
@@ -955,6 +1054,8 @@ struct State {
 	
 	struct Compiler *	compiler;		/**< shader compiler reference */
 	struct Linker *		linker;			/**< program linker reference */
+	struct WorkerPool *	workers;		/**< background compile threads */
+	struct TilePool *	tiles;			/**< binned triangles and threads */
 };
 
 /*
@@ -1024,6 +1125,19 @@ Program * GlesGetProgramObject(State * state, GLuint program);
 GLboolean GlesValidateProgram(State * state, Program * program, Log * log);
 GLboolean GlesPrepareProgram(State * state);
 
+/*
+ * --------------------------------------------------------------------------
+ * Background Compilation
+ * --------------------------------------------------------------------------
+ */
+
+GLboolean GlesCompileShaderAsync(State * state, Shader * shader);
+GLboolean GlesLinkProgramAsync(State * state, Program * program,
+							   Shader * vertexShader, Shader * fragmentShader);
+void GlesWaitShader(State * state, Shader * shader);
+struct Executable * GlesWaitProgram(State * state, Program * program);
+void GlesDestroyWorkers(State * state);
+
 /*
  * --------------------------------------------------------------------------
  * Object Management
@@ -1081,6 +1195,9 @@ void GlesTextureSample3D(const TextureImageUnit * unit, const Vec4f * coords,
 void GlesTextureSampleCube(const TextureImageUnit * unit, const Vec4f * coords,
 						   const Vec4f * dx, const Vec4f * dy,
                            Vec4f * result);
+                         
+GLfloat GlesTextureLod(const TextureImageUnit * unit, const Vec4f * coords,
+					   const Vec4f * dx, const Vec4f * dy);
 
 /*
  * --------------------------------------------------------------------------
@@ -1094,6 +1211,15 @@ void GlesStepSurfaceLoc(SurfaceLoc * loc, GLint x, GLint y);
 
 void GlesWritePixel(State * state, const SurfaceLoc * loc, const Color * color, 
 					GLfloat depth, GLboolean front);   
+
+GLboolean GlesTestPixel(State * state, const SurfaceLoc * loc, GLfloat depth,
+						GLboolean front);
+
+void GlesWriteColor(State * state, const SurfaceLoc * loc, const Color * color);
+
+void GlesWriteColorBlend(State * state, const SurfaceLoc * loc, const Colorub * color);
+
+void GlesPackColors(Colorub * result, const GLfloat * color);
 					                      
 /*
  * --------------------------------------------------------------------------
@@ -101,7 +101,20 @@ static GLES_INLINE GLfloat WrapTexCoord(GLenum mode, GLfloat value) {
 static GLES_INLINE GLfloat Hypotenuse(GLfloat a, GLfloat b) {
 	a = GlesFabsf(a);
 	b = GlesFabsf(b);
-	return GlesMaxf(a, b) + (11.0f / 32.0f) * GlesMaxf(a, b);
+	return GlesMaxf(a, b) + (11.0f / 32.0f) * GlesMinf(a, b);
+}
+
+/**
+ * Calculate the level of detail corresponding to the given scale factor
+ * between texel and pixel space.
+ * 
+ * @param rho
+ * 		the scale factor
+ * 
+ * @return log2(rho), limited to values that select magnification
+ */
+static GLES_INLINE GLfloat LevelOfDetail(GLfloat rho) {
+	return GlesLog2f(GlesMaxf(rho, 1.0f / (1 << GLES_MAX_MIPMAP_LEVELS)));
 }
 
 static Texture2D * GetCurrentTexture2D(State * state) {
@@ -326,6 +339,85 @@ static GLenum GetSampleFilter(GLenum minFilter) {
 	}
 }
 
+/**
+ * Select the mipmap level and filters to use for a given level of detail.
+ * 
+ * @param base
+ * 		texture base information
+ * @param lambda
+ * 		the level of detail, including any bias
+ * @param mipmapFilter
+ * 		on input the mipmap filter of the texture; on output GL_LINEAR if
+ * 		the selected level and the next one need to be blended
+ * @param sampleFilter
+ * 		on input the minification sample filter, on output the filter to use
+ * @return the (lower) mipmap level to sample
+ */
+static GLint SelectMipmapLevel(const TextureBase * base, GLfloat lambda,
+							   GLenum * mipmapFilter, GLenum * sampleFilter) {
+	GLint level;
+	
+	if (lambda <= (*mipmapFilter != GL_NONE && 
+				   *sampleFilter == GL_NEAREST &&
+				   base->magFilter == GL_LINEAR ? 0.5f : 0.0f)) {
+		/* magnification; use base mipmap level */
+		*mipmapFilter = GL_NONE;
+		*sampleFilter = base->magFilter;
+		return 0;
+	}
+	
+	switch (*mipmapFilter) {
+	case GL_NEAREST:
+		level = (GLint) (lambda + 0.5f);
+		return level < (GLint) base->maxMipmapLevel ? level : (GLint) base->maxMipmapLevel;
+		
+	case GL_LINEAR:
+		if (lambda >= base->maxMipmapLevel) {
+			/* clip at max level */
+			*mipmapFilter = GL_NEAREST;
+			return base->maxMipmapLevel;
+		}
+		
+		return (GLint) lambda;
+		
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Calculate the scale factor between texel and pixel space of a 2D image.
+ * 
+ * @param image
+ * 		the base level image
+ * @param dx
+ * 		the derivative of the texture coordinates with regard to x
+ * @param dy
+ * 		the derivative of the texture coordinates with regard to y
+ */
+static GLfloat Scale2D(const Image2D * image, const Vec4f * dx, const Vec4f * dy) {
+	return GlesMaxf(Hypotenuse(image->width * dx->x, image->height * dx->y),
+					Hypotenuse(image->width * dy->x, image->height * dy->y));
+}
+
+/**
+ * Calculate the scale factor between texel and pixel space of a 3D image.
+ * 
+ * @param image
+ * 		the base level image
+ * @param dx
+ * 		the derivative of the texture coordinates with regard to x
+ * @param dy
+ * 		the derivative of the texture coordinates with regard to y
+ */
+static GLfloat Scale3D(const Image3D * image, const Vec4f * dx, const Vec4f * dy) {
+	return 
+		GlesMaxf(Hypotenuse(Hypotenuse(image->width * dx->x, image->height * dx->y),
+							image->depth * dx->z),
+				 Hypotenuse(Hypotenuse(image->width * dy->x, image->height * dy->y),
+							image->depth * dy->z));
+}
+
 static Image2D * GetImage2DForTargetAndLevel(State * state, GLenum target, GLint level) {
 	if (level < 0 || level >= GLES_MAX_MIPMAP_LEVELS) {
 		GlesRecordInvalidValue(state);
@@ -376,6 +468,135 @@ static Image3D * GetImage3DForTargetAndLevel(State * state, GLenum target, GLint
 	}
 }
 
+/**
+ * Determine the last level of a complete mipmap stack of 2D images. The
+ * levels of a complete stack halve in size down to 1 by 1 pixels and share
+ * the internal format of the base level.
+ * 
+ * @param image
+ * 		the mipmap stack
+ * 
+ * @return the index of the 1 by 1 level, or -1 if the stack is incomplete
+ */
+static GLint LastMipmapLevel2D(const Image2D * image) {
+	GLint level;
+	
+	if (!image[0].data) {
+		return -1;
+	}
+	
+	for (level = 1; image[level - 1].width > 1 || image[level - 1].height > 1; ++level) {
+		if (level >= GLES_MAX_MIPMAP_LEVELS ||
+			!image[level].data ||
+			image[level].internalFormat != image[0].internalFormat ||
+			image[level].width != GlesMaxi(image[level - 1].width >> 1, 1) ||
+			image[level].height != GlesMaxi(image[level - 1].height >> 1, 1)) {
+			return -1;
+		}
+	}
+	
+	return level - 1;
+}
+
+/**
+ * Determine the last level of a complete mipmap stack of 3D images.
+ * 
+ * @param image
+ * 		the mipmap stack
+ * 
+ * @return the index of the 1 by 1 by 1 level, or -1 if the stack is incomplete
+ */
+static GLint LastMipmapLevel3D(const Image3D * image) {
+	GLint level;
+	
+	if (!image[0].data) {
+		return -1;
+	}
+	
+	for (level = 1; 
+		 image[level - 1].width > 1 || image[level - 1].height > 1 || image[level - 1].depth > 1;
+		 ++level) {
+		if (level >= GLES_MAX_MIPMAP_LEVELS ||
+			!image[level].data ||
+			image[level].internalFormat != image[0].internalFormat ||
+			image[level].width != GlesMaxi(image[level - 1].width >> 1, 1) ||
+			image[level].height != GlesMaxi(image[level - 1].height >> 1, 1) ||
+			image[level].depth != GlesMaxi(image[level - 1].depth >> 1, 1)) {
+			return -1;
+		}
+	}
+	
+	return level - 1;
+}
+
+/**
+ * Re-evaluate the mipmap completeness of the texture bound to the given 
+ * target after one of its images has been specified.
+ * 
+ * @param state
+ * 		the current GL state
+ * @param target
+ * 		the texture target whose image has been specified
+ */
+static void UpdateCompleteness(State * state, GLenum target) {
+	TextureBase * base;
+	GLint last;
+	
+	switch (target) {
+		case GL_TEXTURE_2D:
+			{
+				Texture2D * texture = GetCurrentTexture2D(state);
+				
+				base = &texture->base;
+				last = LastMipmapLevel2D(texture->image);
+			}
+			
+			break;
+			
+		case GL_TEXTURE_3D:
+			{
+				Texture3D * texture = GetCurrentTexture3D(state);
+				
+				base = &texture->base;
+				last = LastMipmapLevel3D(texture->image);
+			}
+			
+			break;
+			
+		default:
+			{
+				/* all faces need to be complete, square and of the same size */
+				TextureCube * texture = GetCurrentTextureCube(state);
+				const Image2D * faces[] = {
+					texture->positiveX, texture->negativeX,
+					texture->positiveY, texture->negativeY,
+					texture->positiveZ, texture->negativeZ
+				};
+				GLsizei face;
+				
+				base = &texture->base;
+				last = LastMipmapLevel2D(faces[0]);
+				
+				if (last >= 0 && faces[0][0].width != faces[0][0].height) {
+					last = -1;
+				}
+				
+				for (face = 1; face < 6 && last >= 0; ++face) {
+					if (LastMipmapLevel2D(faces[face]) != last ||
+						faces[face][0].width != faces[0][0].width ||
+						faces[face][0].internalFormat != faces[0][0].internalFormat) {
+						last = -1;
+					}
+				}
+			}
+			
+			break;
+	}
+	
+	base->isComplete = last >= 0;
+	base->maxMipmapLevel = last >= 0 ? last : 0;
+}
+
 /*
 ** --------------------------------------------------------------------------
 ** Bitmap copy and conversion functions
@@ -1866,6 +2087,8 @@ glCopyTexImage2D (GLenum target, GLint level, GLenum internalformat,
 			   image->data, width, height, 1, 0, 0, 0, internalformat, textureFormat, textureFormat, 1, 1);
 
 	state->readSurface->vtbl->unlock(state->readSurface);
+
+	UpdateCompleteness(state, target);
 }
 
 GL_API void GL_APIENTRY 
@@ -2096,6 +2319,8 @@ glTexImage2D (GLenum target, GLint level, GLenum internalformat,
 			   0, 0, 0, width, height, 1, 
 			   image->data, width, height, 1, 0, 0, 0,
 			   internalformat, textureFormat, textureFormat, state->packAlignment, 1);
+
+	UpdateCompleteness(state, target);
 }
 
 GL_API void GL_APIENTRY 
@@ -2170,6 +2395,8 @@ glTexImage3D (GLenum target, GLint level, GLenum internalformat,
 			   0, 0, 0, width, height, depth,
 			   image->data, width, height, depth, 0, 0, 0,
 			   internalformat, textureFormat, textureFormat, state->packAlignment, 1);
+
+	UpdateCompleteness(state, target);
 }
 
 GL_API void GL_APIENTRY 
@@ -2367,51 +2594,30 @@ void TextureSample2D(const TextureBase * base, const Image2D * image,
 		return;
 	}
 		
-	// determine mipmap level
-	GLfloat lambda_ = GlesClampf(coords->w);
+	// determine level of detail; w carries the lod or the lod bias
+	GLfloat lambda_ = coords->w;
 	GLint lambda = 0;
 	
-	// compute lambda'
-	if (mipmapFilter != GL_NONE) {
-		if (dx && dy) {
-			GLsizei width  = image[0].width;
-			GLsizei height = image[0].height;
-	
-			lambda_ +=
-				GlesLog2f(GlesMaxf(width * Hypotenuse(GlesFabsf(dx->x), GlesFabsf(dx->y)),
-						   		   height * Hypotenuse(GlesFabsf(dy->x), GlesFabsf(dy->y))));
-		}
-
-		lambda = (GLint) lambda_;
-		
-		if (lambda_ < (mipmapFilter != GL_NONE && 
-					   sampleFilter == GL_NEAREST &&
-					   base->magFilter == GL_LINEAR ? 0.5f : 0.0f)) {
-			/* magnification; use base mipmap level */
-			mipmapFilter = GL_NEAREST;
-			sampleFilter = base->magFilter;
-			lambda = 0;
-		} else if (lambda_ >= base->maxMipmapLevel) {
-			/* clip at max level */
-			lambda = base->maxMipmapLevel;
-			mipmapFilter = GL_NEAREST;
-		}
+	if (dx && dy) {
+		lambda_ += LevelOfDetail(Scale2D(&image[0], dx, dy));
 	}
+
+	lambda = SelectMipmapLevel(base, lambda_, &mipmapFilter, &sampleFilter);
 		
 	// fetch actual pixel data
-	if (mipmapFilter == GL_NONE || mipmapFilter == GL_NEAREST) {
+	if (mipmapFilter != GL_LINEAR) {
 		ImageSample2D(&image[lambda], 
 					  coords->x, base->wrapS,
 					  coords->y, base->wrapT,
 					  sampleFilter, result);
 	} else {
-		GLfloat mipmapBlend = GlesFracf(lambda_);
+		GLfloat mipmapBlend = lambda_ - lambda;
 		Vec4f lower, higher;
 		ImageSample2D(&image[lambda], 
 					  coords->x, base->wrapS,
 					  coords->y, base->wrapT, 
 					  sampleFilter, &lower);
-		ImageSample2D(&image[lambda], 
+		ImageSample2D(&image[lambda + 1], 
 					  coords->x, base->wrapS,
 					  coords->y, base->wrapT, 
 					  sampleFilter, &higher);
@@ -2490,57 +2696,32 @@ void GlesTextureSample3D(const TextureImageUnit * unit, const Vec4f * coords,
 		return;
 	}
 		
-	// determine mipmap level
-	GLfloat lambda_ = GlesClampf(coords->w);
+	// determine level of detail; w carries the lod or the lod bias
+	GLfloat lambda_ = coords->w;
 	GLint lambda = 0;
 	
-	// compute lambda'
-	if (mipmapFilter != GL_NONE) {
-		if (dx && dy) {
-			GLsizei width = texture->image[0].width;
-			GLsizei height = texture->image[0].height;
-			GLsizei depth = texture->image[0].depth;
-	
-			lambda_ +=
-				GlesLog2f(
-					GlesMaxf(
-						GlesMaxf(width * Hypotenuse(GlesFabsf(dx->x), GlesFabsf(dy->x)),
-						   		 height * Hypotenuse(GlesFabsf(dx->y), GlesFabsf(dy->y))),
-						depth * Hypotenuse(GlesFabsf(dx->z), GlesFabsf(dy->z))));
-		}
-							
-		lambda = (GLint) lambda_;
-
-		if (lambda_ < (mipmapFilter != GL_NONE && 
-					   sampleFilter == GL_NEAREST &&
-					   texture->base.magFilter == GL_LINEAR ? 0.5f : 0.0f)) {
-			/* magnification; use base mipmap level */
-			mipmapFilter = GL_NEAREST;
-			sampleFilter = texture->base.magFilter;
-			lambda = 0;
-		} else if (lambda_ >= texture->base.maxMipmapLevel) {
-			/* clip at max level */
-			lambda = texture->base.maxMipmapLevel;
-			mipmapFilter = GL_NEAREST;
-		}
+	if (dx && dy) {
+		lambda_ += LevelOfDetail(Scale3D(&texture->image[0], dx, dy));
 	}
+							
+	lambda = SelectMipmapLevel(&texture->base, lambda_, &mipmapFilter, &sampleFilter);
 		
 	// fetch actual pixel data
-	if (mipmapFilter == GL_NONE || mipmapFilter == GL_NEAREST) {
+	if (mipmapFilter != GL_LINEAR) {
 		ImageSample3D(&texture->image[lambda], 
 					  coords->x, texture->base.wrapS,
 					  coords->y, texture->base.wrapT,
 					  coords->z, texture->base.wrapR,
 					  sampleFilter, result);
 	} else {
-		GLfloat mipmapBlend = GlesFracf(lambda_);
+		GLfloat mipmapBlend = lambda_ - lambda;
 		Vec4f lower, higher;
 		ImageSample3D(&texture->image[lambda], 
 					  coords->x, texture->base.wrapS,
 					  coords->y, texture->base.wrapT, 
 					  coords->z, texture->base.wrapR,
 					  sampleFilter, &lower);
-		ImageSample3D(&texture->image[lambda], 
+		ImageSample3D(&texture->image[lambda + 1], 
 					  coords->x, texture->base.wrapS,
 					  coords->y, texture->base.wrapT, 
 					  coords->z, texture->base.wrapR,
@@ -2627,8 +2808,8 @@ void GlesTextureSampleCube(const TextureImageUnit * unit, const Vec4f * coords,
 			}
 			
 			if (dy) {
-				scaledDx.x = Derivative(-coords->z, -dy->z, coords->x, dy->x);
-				scaledDx.y = Derivative(-coords->y, -dy->y, coords->x, dy->x);
+				scaledDy.x = Derivative(-coords->z, -dy->z, coords->x, dy->x);
+				scaledDy.y = Derivative(-coords->y, -dy->y, coords->x, dy->x);
 			}			
 		} else {
 			/* GL_TEXTURE_CUBE_MAP_NEGATIVE_X */
@@ -2645,8 +2826,8 @@ void GlesTextureSampleCube(const TextureImageUnit * unit, const Vec4f * coords,
 			}
 			
 			if (dy) {
-				scaledDx.x = Derivative( coords->z,  dy->z, -coords->x, -dy->x);
-				scaledDx.y = Derivative(-coords->y, -dy->y, -coords->x, -dy->x);
+				scaledDy.x = Derivative( coords->z,  dy->z, -coords->x, -dy->x);
+				scaledDy.y = Derivative(-coords->y, -dy->y, -coords->x, -dy->x);
 			}
 		}
 	} else if (absCoords.y > absCoords.x && absCoords.y >= absCoords.z) {
@@ -2665,8 +2846,8 @@ void GlesTextureSampleCube(const TextureImageUnit * unit, const Vec4f * coords,
 			}
 			
 			if (dy) {
-				scaledDx.x = Derivative(coords->x, dy->x, coords->y, dy->y);
-				scaledDx.y = Derivative(coords->z, dy->z, coords->y, dy->y);
+				scaledDy.x = Derivative(coords->x, dy->x, coords->y, dy->y);
+				scaledDy.y = Derivative(coords->z, dy->z, coords->y, dy->y);
 			}
 		} else {
 			/* GL_TEXTURE_CUBE_MAP_NEGATIVE_Y */
@@ -2683,8 +2864,8 @@ void GlesTextureSampleCube(const TextureImageUnit * unit, const Vec4f * coords,
 			}
 			
 			if (dy) {
-				scaledDx.x = Derivative( coords->x,  dy->x, -coords->y, -dy->y);
-				scaledDx.y = Derivative(-coords->z, -dy->z, -coords->y, -dy->y);
+				scaledDy.x = Derivative( coords->x,  dy->x, -coords->y, -dy->y);
+				scaledDy.y = Derivative(-coords->z, -dy->z, -coords->y, -dy->y);
 			}
 		}
 	} else {
@@ -2703,8 +2884,8 @@ void GlesTextureSampleCube(const TextureImageUnit * unit, const Vec4f * coords,
 			}
 			
 			if (dy) {
-				scaledDx.x = Derivative( coords->x,  dy->x, coords->z, dy->z);
-				scaledDx.y = Derivative(-coords->y, -dy->y, coords->z, dy->z);
+				scaledDy.x = Derivative( coords->x,  dy->x, coords->z, dy->z);
+				scaledDy.y = Derivative(-coords->y, -dy->y, coords->z, dy->z);
 			}
 		} else {
 			/* GL_TEXTURE_CUBE_MAP_NEGATIVE_Z */
@@ -2721,8 +2902,8 @@ void GlesTextureSampleCube(const TextureImageUnit * unit, const Vec4f * coords,
 			}
 			
 			if (dy) {
-				scaledDx.x = Derivative(-coords->x, -dy->x, -coords->z, -dy->z);
-				scaledDx.y = Derivative(-coords->y, -dy->y, -coords->z, -dy->z);
+				scaledDy.x = Derivative(-coords->x, -dy->x, -coords->z, -dy->z);
+				scaledDy.y = Derivative(-coords->y, -dy->y, -coords->z, -dy->z);
 			}
 		}
 	}
@@ -2736,6 +2917,51 @@ void GlesTextureSampleCube(const TextureImageUnit * unit, const Vec4f * coords,
 
 }
 
+/**
+ * Calculate the level of detail implied by the derivatives of texture
+ * coordinates, without any bias. The result can be added to the w
+ * coordinate passed to the sampling functions without derivatives, such
+ * that a level of detail computed once can be shared by a 2x2 pixel quad.
+ * 
+ * For cube maps, the derivatives are projected onto the face selected by
+ * coords, ignoring the change of the major axis across the pixel.
+ * 
+ * @param unit
+ * 		texture image unit
+ * @param coords
+ * 		texture coordinates of a reference pixel
+ * @param dx
+ * 		the derivative of the coord vector with regard to x
+ * @param dy
+ * 		the derivative of the coord vector with regard to y
+ * @return the level of detail
+ */
+GLfloat GlesTextureLod(const TextureImageUnit * unit, const Vec4f * coords,
+					   const Vec4f * dx, const Vec4f * dy) {
+	const Texture * texture = unit->boundTexture;
+	GLfloat major, scale;
+
+	GLES_ASSERT(texture);
+	
+	switch (texture->base.textureType) {
+	case GL_TEXTURE_2D:
+		return LevelOfDetail(Scale2D(&texture->texture2D.image[0], dx, dy));
+		
+	case GL_TEXTURE_3D:
+		return LevelOfDetail(Scale3D(&texture->texture3D.image[0], dx, dy));
+		
+	default:
+		major = GlesMaxf(GlesMaxf(GlesFabsf(coords->x), GlesFabsf(coords->y)), 
+						 GlesFabsf(coords->z));
+		scale = texture->textureCube.positiveX[0].width * 0.5f / major;
+		
+		return 
+			LevelOfDetail(scale *
+				GlesMaxf(Hypotenuse(Hypotenuse(dx->x, dx->y), dx->z),
+						 Hypotenuse(Hypotenuse(dy->x, dy->y), dy->z)));
+	}
+}
+
 /*
 ** --------------------------------------------------------------------------
 ** Framebuffer-related API
@@ -0,0 +1,474 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Background compilation and linking of shader programs
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+#include <GLES/gl.h>
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "frontend/compiler.h"
+#include "frontend/linker.h"
+#include "backend/interp.h"
+
+/*
+** --------------------------------------------------------------------------
+** Module-local data structures
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * A compile or link request processed by a worker thread. Compile tasks
+ * are owned by the shader until the next GlesWaitShader(), link tasks by
+ * the program until GlesWaitProgram().
+ */
+typedef struct WorkerTask {
+	struct WorkerTask *	next;			/**< next task in queue				*/
+	Shader *			shader;			/**< shader to compile, or NULL		*/
+	Program *			program;		/**< program to link, or NULL		*/
+	Shader *			vertexShader;	/**< vertex shader of program		*/
+	Shader *			fragmentShader;	/**< fragment shader of program		*/
+	struct WorkerTask *	vertexCompile;	/**< pending vertex shader compile	*/
+	struct WorkerTask *	fragmentCompile;/**< pending fragment shader compile*/
+	Executable *		executable;		/**< result of link					*/
+	GLboolean			done;			/**< task has been processed		*/
+} WorkerTask;
+
+/**
+ * A worker thread with its private compiler and linker instance, such that
+ * the memory pools of the instances are never shared between threads.
+ */
+typedef struct Worker {
+	struct WorkerPool *	pool;			/**< pool the worker belongs to		*/
+	Thread *			thread;			/**< thread executing tasks			*/
+	Compiler *			compiler;		/**< compiler of this worker		*/
+	Linker *			linker;			/**< linker of this worker			*/
+} Worker;
+
+/**
+ * Worker threads processing a queue of tasks in FIFO order. Because tasks
+ * are dequeued in order, a link task only ever waits for compile tasks
+ * that other workers have already started.
+ */
+typedef struct WorkerPool {
+	Mutex *				mutex;			/**< protects queue and task status	*/
+	Condition *			work;			/**< tasks are available			*/
+	Condition *			done;			/**< a task has been processed		*/
+	WorkerTask *		head;			/**< first task in queue			*/
+	WorkerTask *		tail;			/**< last task in queue				*/
+	GLboolean			shutdown;		/**< terminate after queue drained	*/
+	GLsizei				numWorkers;		/**< number of running workers		*/
+	Worker *			workers;		/**< the worker threads				*/
+} WorkerPool;
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Compile a shader on a worker thread.
+ *
+ * @param	worker	the worker executing the task
+ * @param	task	the compile task
+ */
+static void RunCompile(Worker * worker, WorkerTask * task) {
+	Shader * shader = task->shader;
+
+	shader->isCompiled = GlesCompileShader(worker->compiler, shader);
+
+	GLES_ASSERT(shader->isCompiled == (shader->binary != NULL));
+}
+
+/**
+ * Link a program on a worker thread, once compilation of its shaders has
+ * completed.
+ *
+ * @param	worker	the worker executing the task
+ * @param	task	the link task
+ */
+static void RunLink(Worker * worker, WorkerTask * task) {
+	WorkerPool * pool = worker->pool;
+
+	GlesMutexLock(pool->mutex);
+
+	while ((task->vertexCompile && !task->vertexCompile->done) ||
+		   (task->fragmentCompile && !task->fragmentCompile->done)) {
+		GlesConditionWait(pool->done, pool->mutex);
+	}
+
+	GlesMutexUnlock(pool->mutex);
+
+	if (!task->vertexShader->isCompiled || !task->fragmentShader->isCompiled) {
+		GlesLogAppend(&task->program->log, "Shader is not compiled.\n", -1);
+		return;
+	}
+
+	task->executable = GlesLinkProgram(worker->linker, task->program);
+}
+
+/**
+ * Main loop of a worker thread.
+ *
+ * @param	arg		the Worker structure of the thread
+ */
+static void WorkerMain(void * arg) {
+	Worker * worker = (Worker *) arg;
+	WorkerPool * pool = worker->pool;
+	WorkerTask * task;
+
+	GlesMutexLock(pool->mutex);
+
+	for (;;) {
+		while (!pool->head && !pool->shutdown) {
+			GlesConditionWait(pool->work, pool->mutex);
+		}
+
+		if (!(task = pool->head)) {
+			break;
+		}
+
+		if (!(pool->head = task->next)) {
+			pool->tail = NULL;
+		}
+
+		GlesMutexUnlock(pool->mutex);
+
+		if (task->shader) {
+			RunCompile(worker, task);
+		} else {
+			RunLink(worker, task);
+		}
+
+		GlesMutexLock(pool->mutex);
+
+		if (task->shader) {
+			--task->shader->pendingTasks;
+		} else {
+			--task->vertexShader->pendingTasks;
+			--task->fragmentShader->pendingTasks;
+		}
+
+		task->done = GL_TRUE;
+		GlesConditionBroadcast(pool->done);
+	}
+
+	GlesMutexUnlock(pool->mutex);
+}
+
+/**
+ * Terminate all worker threads after the task queue has been drained, and
+ * release all resources of the pool.
+ *
+ * @param	pool	the pool to destroy
+ */
+static void DestroyPool(WorkerPool * pool) {
+	GLsizei index;
+
+	if (pool->numWorkers) {
+		GlesMutexLock(pool->mutex);
+		pool->shutdown = GL_TRUE;
+		GlesConditionBroadcast(pool->work);
+		GlesMutexUnlock(pool->mutex);
+	}
+
+	for (index = 0; index < pool->numWorkers; ++index) {
+		GlesThreadJoin(pool->workers[index].thread);
+	}
+
+	if (pool->workers) {
+		for (index = 0; index < GLES_COMPILE_THREADS; ++index) {
+			if (pool->workers[index].compiler) {
+				GlesCompilerDestroy(pool->workers[index].compiler);
+			}
+
+			if (pool->workers[index].linker) {
+				GlesLinkerDestroy(pool->workers[index].linker);
+			}
+		}
+
+		GlesFree(pool->workers);
+	}
+
+	if (pool->done)		GlesConditionDestroy(pool->done);
+	if (pool->work)		GlesConditionDestroy(pool->work);
+	if (pool->mutex)	GlesMutexDestroy(pool->mutex);
+
+	GlesFree(pool);
+}
+
+/**
+ * Create the worker pool of the GL state, if it does not exist yet. The
+ * number of worker threads is limited by GLES_COMPILE_THREADS and the
+ * number of available processors.
+ *
+ * @param	state	reference to GL state
+ *
+ * @return	the worker pool, or NULL if tasks need to be processed on the
+ * 			calling thread
+ */
+static WorkerPool * GetPool(State * state) {
+	WorkerPool * pool;
+	GLsizei index, count = GlesProcessorCount();
+
+	if (state->workers || GLES_COMPILE_THREADS <= 0) {
+		return state->workers;
+	}
+
+	if (count > GLES_COMPILE_THREADS) {
+		count = GLES_COMPILE_THREADS;
+	}
+
+	pool = GlesMalloc(sizeof(WorkerPool));
+
+	if (!pool) {
+		return NULL;
+	}
+
+	GlesMemset(pool, 0, sizeof(WorkerPool));
+	pool->mutex = GlesMutexCreate();
+	pool->work = GlesConditionCreate();
+	pool->done = GlesConditionCreate();
+	pool->workers = GlesMalloc(GLES_COMPILE_THREADS * sizeof(Worker));
+
+	if (!pool->mutex || !pool->work || !pool->done || !pool->workers) {
+		DestroyPool(pool);
+		return NULL;
+	}
+
+	GlesMemset(pool->workers, 0, GLES_COMPILE_THREADS * sizeof(Worker));
+
+	/* code generation must not initialize shared tables concurrently */
+	GlesInterpInitialize();
+
+	for (index = 0; index < count; ++index) {
+		Worker * worker = &pool->workers[index];
+
+		worker->pool = pool;
+		worker->compiler = GlesCompilerCreate(state);
+		worker->linker = GlesLinkerCreate(state);
+
+		if (!worker->compiler || !worker->linker ||
+			!(worker->thread = GlesThreadCreate(WorkerMain, worker))) {
+			break;
+		}
+
+		++pool->numWorkers;
+	}
+
+	if (!pool->numWorkers) {
+		DestroyPool(pool);
+		return NULL;
+	}
+
+	return state->workers = pool;
+}
+
+/**
+ * Append a task to the queue of the worker pool.
+ *
+ * @param	pool	the worker pool
+ * @param	task	the task to process
+ */
+static void Enqueue(WorkerPool * pool, WorkerTask * task) {
+	task->next = NULL;
+
+	if (pool->tail) {
+		pool->tail->next = task;
+	} else {
+		pool->head = task;
+	}
+
+	pool->tail = task;
+	GlesConditionBroadcast(pool->work);
+}
+
+/*
+** --------------------------------------------------------------------------
+** Internal functions
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Compile a shader on a worker thread. The caller needs to wait for the
+ * shader using GlesWaitShader() before accessing the compilation results.
+ *
+ * @param	state	reference to GL state
+ * @param	shader	the shader to compile; it must not be in use by any
+ * 					other task
+ *
+ * @return	GL_FALSE if the shader needs to be compiled on the calling
+ * 			thread instead
+ */
+GLboolean GlesCompileShaderAsync(State * state, Shader * shader) {
+	WorkerPool * pool = GetPool(state);
+	WorkerTask * task;
+
+	GLES_ASSERT(!shader->compileTask && !shader->pendingTasks);
+
+	if (!pool || !(task = GlesMalloc(sizeof(WorkerTask)))) {
+		return GL_FALSE;
+	}
+
+	GlesMemset(task, 0, sizeof(WorkerTask));
+	task->shader = shader;
+	shader->compileTask = task;
+	shader->isCompiled = GL_FALSE;
+
+	GlesMutexLock(pool->mutex);
+	++shader->pendingTasks;
+	Enqueue(pool, task);
+	GlesMutexUnlock(pool->mutex);
+
+	return GL_TRUE;
+}
+
+/**
+ * Link a program on a worker thread. Compilation of the shaders may still
+ * be in progress. The caller needs to obtain the result using
+ * GlesWaitProgram() before accessing the program.
+ *
+ * @param	state			reference to GL state
+ * @param	program			the program to link
+ * @param	vertexShader	the vertex shader attached to the program
+ * @param	fragmentShader	the fragment shader attached to the program
+ *
+ * @return	GL_FALSE if the program needs to be linked on the calling
+ * 			thread instead
+ */
+GLboolean GlesLinkProgramAsync(State * state, Program * program,
+							   Shader * vertexShader, Shader * fragmentShader) {
+	WorkerPool * pool = GetPool(state);
+	WorkerTask * task;
+
+	GLES_ASSERT(!program->linkTask);
+
+	if (!pool || !(task = GlesMalloc(sizeof(WorkerTask)))) {
+		return GL_FALSE;
+	}
+
+	GlesMemset(task, 0, sizeof(WorkerTask));
+	task->program = program;
+	task->vertexShader = vertexShader;
+	task->fragmentShader = fragmentShader;
+	task->vertexCompile = vertexShader->compileTask;
+	task->fragmentCompile = fragmentShader->compileTask;
+	program->linkTask = task;
+
+	GlesMutexLock(pool->mutex);
+	++vertexShader->pendingTasks;
+	++fragmentShader->pendingTasks;
+	Enqueue(pool, task);
+	GlesMutexUnlock(pool->mutex);
+
+	return GL_TRUE;
+}
+
+/**
+ * Wait until no worker thread is using a shader any longer, such that
+ * the shader can be queried or modified.
+ *
+ * @param	state	reference to GL state
+ * @param	shader	the shader to wait for
+ */
+void GlesWaitShader(State * state, Shader * shader) {
+	WorkerPool * pool = state->workers;
+
+	if (pool) {
+		GlesMutexLock(pool->mutex);
+
+		while (shader->pendingTasks) {
+			GlesConditionWait(pool->done, pool->mutex);
+		}
+
+		GlesMutexUnlock(pool->mutex);
+	}
+
+	if (shader->compileTask) {
+		GlesFree(shader->compileTask);
+		shader->compileTask = NULL;
+	}
+}
+
+/**
+ * Wait for the background link of a program to complete.
+ *
+ * @param	state	reference to GL state
+ * @param	program	the program to wait for
+ *
+ * @return	the linked executable, or NULL if linking failed
+ */
+Executable * GlesWaitProgram(State * state, Program * program) {
+	WorkerPool * pool = state->workers;
+	WorkerTask * task = program->linkTask;
+	Executable * executable;
+
+	GLES_ASSERT(task);
+
+	if (pool) {
+		GlesMutexLock(pool->mutex);
+
+		while (!task->done) {
+			GlesConditionWait(pool->done, pool->mutex);
+		}
+
+		GlesMutexUnlock(pool->mutex);
+	}
+
+	executable = task->executable;
+	program->linkTask = NULL;
+	GlesFree(task);
+
+	return executable;
+}
+
+/**
+ * Complete all pending tasks and terminate the worker threads. Results
+ * are retained until they are waited for.
+ *
+ * @param	state	reference to GL state
+ */
+void GlesDestroyWorkers(State * state) {
+	if (state->workers) {
+		DestroyPool(state->workers);
+		state->workers = NULL;
+	}
+}
@@ -49,6 +49,14 @@
 #include <string.h>
 #include <stdarg.h>
 
+#if defined(_WIN32)
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <pthread.h>
+#	include <unistd.h>
+#endif
+
 /*
 ** --------------------------------------------------------------------------
 ** String and Memory Functions
@@ -119,6 +127,52 @@ void GlesFree(void * ptr) {
 	free(ptr);
 }
 
+/**
+ * Allocate a memory area that can receive generated machine code. The
+ * memory is writable until it is passed to GlesProtectExecutable().
+ * 
+ * @param size	the size of the memory area in bytes
+ * 
+ * @return	the page aligned memory area, or NULL
+ */
+void * GlesMallocExecutable(GLsizeiptr size) {
+#if defined(_WIN32)
+	return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+	void * result = mmap(NULL, size, PROT_READ | PROT_WRITE, 
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	
+	return result != MAP_FAILED ? result : NULL;
+#endif
+}
+
+/**
+ * Make a memory area allocated using GlesMallocExecutable() executable and 
+ * read-only.
+ * 
+ * @param ptr	the memory area
+ * @param size	the size of the memory area in bytes
+ * 
+ * @return	GL_TRUE if the protection could be changed
+ */
+GLboolean GlesProtectExecutable(void * ptr, GLsizeiptr size) {
+#if defined(_WIN32)
+	DWORD oldProtect;
+	
+	return VirtualProtect(ptr, size, PAGE_EXECUTE_READ, &oldProtect) != 0;
+#else
+	return mprotect(ptr, size, PROT_READ | PROT_EXEC) == 0;
+#endif
+}
+
+void GlesFreeExecutable(void * ptr, GLsizeiptr size) {
+#if defined(_WIN32)
+	VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+	munmap(ptr, size);
+#endif
+}
+
 /*
 ** --------------------------------------------------------------------------
 ** Long Jumps
@@ -146,6 +200,333 @@ GLint GlesSetjmp(JumpBuffer env) {
 void GlesLongjmp(JumpBuffer env, GLint val) {
 	longjmp(env, val);
 }
+
+/*
+** --------------------------------------------------------------------------
+** Threads and Synchronization
+** --------------------------------------------------------------------------
+*/
+
+struct Thread {
+#if defined(_WIN32)
+	HANDLE				handle;
+#else
+	pthread_t			handle;
+#endif
+	ThreadFunction		function;		/* thread entry point				*/
+	void *				arg;			/* argument passed to entry point	*/
+};
+
+struct Mutex {
+#if defined(_WIN32)
+	CRITICAL_SECTION	section;
+#else
+	pthread_mutex_t		mutex;
+#endif
+};
+
+struct Condition {
+#if defined(_WIN32)
+	CONDITION_VARIABLE	variable;
+#else
+	pthread_cond_t		cond;
+#endif
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI ThreadEntry(LPVOID param) {
+	Thread * thread = (Thread *) param;
+	thread->function(thread->arg);
+	return 0;
+}
+#else
+static void * ThreadEntry(void * param) {
+	Thread * thread = (Thread *) param;
+	thread->function(thread->arg);
+	return NULL;
+}
+#endif
+
+/**
+ * Determine the number of processors available to the process.
+ * 
+ * @return	the number of processors, at least 1
+ */
+GLsizei GlesProcessorCount(void) {
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (GLsizei) info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (GLsizei) count : 1;
+#else
+	return 1;
+#endif
+}
+
+/**
+ * Start a new thread of execution.
+ * 
+ * @param function	the function to execute on the new thread
+ * @param arg		the argument to pass to the function
+ * 
+ * @return	the thread handle, or NULL if the thread could not be created
+ */
+Thread * GlesThreadCreate(ThreadFunction function, void * arg) {
+	Thread * thread = GlesMalloc(sizeof(Thread));
+	
+	if (!thread) {
+		return NULL;
+	}
+	
+	thread->function = function;
+	thread->arg = arg;
+	
+#if defined(_WIN32)
+	thread->handle = CreateThread(NULL, 0, ThreadEntry, thread, 0, NULL);
+	
+	if (!thread->handle) {
+#else
+	if (pthread_create(&thread->handle, NULL, ThreadEntry, thread)) {
+#endif
+		GlesFree(thread);
+		return NULL;
+	}
+	
+	return thread;
+}
+
+/**
+ * Wait for a thread to terminate and release its handle.
+ * 
+ * @param thread	the thread to wait for
+ */
+void GlesThreadJoin(Thread * thread) {
+#if defined(_WIN32)
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+	GlesFree(thread);
+}
+
+/**
+ * Create a mutual exclusion lock.
+ * 
+ * @return	the new lock, or NULL if out of resources
+ */
+Mutex * GlesMutexCreate(void) {
+	Mutex * mutex = GlesMalloc(sizeof(Mutex));
+	
+	if (!mutex) {
+		return NULL;
+	}
+	
+#if defined(_WIN32)
+	InitializeCriticalSection(&mutex->section);
+#else
+	if (pthread_mutex_init(&mutex->mutex, NULL)) {
+		GlesFree(mutex);
+		return NULL;
+	}
+#endif
+
+	return mutex;
+}
+
+void GlesMutexDestroy(Mutex * mutex) {
+#if defined(_WIN32)
+	DeleteCriticalSection(&mutex->section);
+#else
+	pthread_mutex_destroy(&mutex->mutex);
+#endif
+	GlesFree(mutex);
+}
+
+void GlesMutexLock(Mutex * mutex) {
+#if defined(_WIN32)
+	EnterCriticalSection(&mutex->section);
+#else
+	pthread_mutex_lock(&mutex->mutex);
+#endif
+}
+
+void GlesMutexUnlock(Mutex * mutex) {
+#if defined(_WIN32)
+	LeaveCriticalSection(&mutex->section);
+#else
+	pthread_mutex_unlock(&mutex->mutex);
+#endif
+}
+
+/**
+ * Create a condition variable.
+ * 
+ * @return	the new condition variable, or NULL if out of resources
+ */
+Condition * GlesConditionCreate(void) {
+	Condition * condition = GlesMalloc(sizeof(Condition));
+	
+	if (!condition) {
+		return NULL;
+	}
+	
+#if defined(_WIN32)
+	InitializeConditionVariable(&condition->variable);
+#else
+	if (pthread_cond_init(&condition->cond, NULL)) {
+		GlesFree(condition);
+		return NULL;
+	}
+#endif
+
+	return condition;
+}
+
+void GlesConditionDestroy(Condition * condition) {
+#if !defined(_WIN32)
+	pthread_cond_destroy(&condition->cond);
+#endif
+	GlesFree(condition);
+}
+
+/**
+ * Atomically release the mutex and wait for the condition to be signaled.
+ * The mutex is held again upon return; as wake-ups may be spurious, the
+ * caller needs to re-evaluate its predicate.
+ * 
+ * @param condition	the condition to wait for
+ * @param mutex		the mutex held by the caller
+ */
+void GlesConditionWait(Condition * condition, Mutex * mutex) {
+#if defined(_WIN32)
+	SleepConditionVariableCS(&condition->variable, &mutex->section, INFINITE);
+#else
+	pthread_cond_wait(&condition->cond, &mutex->mutex);
+#endif
+}
+
+void GlesConditionBroadcast(Condition * condition) {
+#if defined(_WIN32)
+	WakeAllConditionVariable(&condition->variable);
+#else
+	pthread_cond_broadcast(&condition->cond);
+#endif
+}
+
+/*
+** --------------------------------------------------------------------------
+** File Access
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Retrieve the value of an environment variable.
+ * 
+ * @param name	the name of the variable
+ * 
+ * @return	the variable value, or NULL if the variable is not set
+ */
+const char * GlesGetenv(const char * name) {
+	return getenv(name);
+}
+
+/**
+ * Read the complete contents of a file into memory.
+ * 
+ * @param path	the path name of the file
+ * @param size	out: the size of the file contents in bytes
+ * 
+ * @return	the file contents allocated using GlesMalloc(), or NULL
+ */
+void * GlesReadFile(const char * path, GLsizeiptr * size) {
+	FILE * file = fopen(path, "rb");
+	void * result = NULL;
+	long length;
+	
+	if (!file) {
+		return NULL;
+	}
+	
+	if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0 &&
+		length <= GLES_INT_MAX && fseek(file, 0, SEEK_SET) == 0 &&
+		(result = GlesMalloc(length)) != NULL) {
+		
+		if (fread(result, 1, length, file) == (size_t) length) {
+			*size = (GLsizeiptr) length;
+		} else {
+			GlesFree(result);
+			result = NULL;
+		}
+	}
+	
+	fclose(file);
+	return result;
+}
+
+/**
+ * Write a memory area to a file. The data is written to a temporary file
+ * first, which then replaces the target, such that concurrent readers 
+ * never observe a partially written file. Each writer uses a temporary file
+ * of its own, such that concurrent writers cannot interleave their data.
+ * 
+ * @param path	the path name of the file
+ * @param data	the data to write
+ * @param size	the size of the data in bytes
+ * 
+ * @return	GL_TRUE if the file has been written
+ */
+GLboolean GlesWriteFile(const char * path, const void * data, GLsizeiptr size) {
+	char * temp = GlesMalloc(GlesStrlen(path) + 32);
+	FILE * file;
+	GLboolean result = GL_FALSE;
+	
+	if (!temp) {
+		return GL_FALSE;
+	}
+	
+#if defined(_WIN32)
+	GlesSprintf(temp, "%s.%lu.%lu.tmp", path, 
+				(unsigned long) GetCurrentProcessId(), 
+				(unsigned long) GetCurrentThreadId());
+	file = fopen(temp, "wb");
+#else
+	{
+		int fd;
+		
+		GlesSprintf(temp, "%s.XXXXXX", path);
+		fd = mkstemp(temp);
+		file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+		
+		if (fd >= 0 && !file) {
+			close(fd);
+			remove(temp);
+		}
+	}
+#endif
+	
+	if (file) {
+		result = fwrite(data, 1, size, file) == (size_t) size;
+		result = fclose(file) == 0 && result;
+		
+		if (result) {
+#if defined(_WIN32)
+			/* rename does not replace an existing file */
+			remove(path);
+#endif
+			result = rename(temp, path) == 0;
+		}
+		
+		if (!result) {
+			remove(temp);
+		}
+	}
+	
+	GlesFree(temp);
+	return result;
+}
  
 /*
 ** --------------------------------------------------------------------------
@@ -102,6 +102,18 @@
 
 typedef	jmp_buf JumpBuffer;
 
+#ifdef _MSC_VER
+typedef __int64 Int64;					/* 64-bit signed integer			*/
+#else
+typedef long long Int64;				/* 64-bit signed integer			*/
+#endif
+
+typedef struct Thread Thread;			/* opaque thread handle				*/
+typedef struct Mutex Mutex;				/* opaque mutual exclusion lock		*/
+typedef struct Condition Condition;		/* opaque condition variable		*/
+
+typedef void (*ThreadFunction)(void * arg);
+
 /*
 ** --------------------------------------------------------------------------
 ** Inline number conversion functions
@@ -402,6 +414,54 @@ GLES_INLINE static GLfloat GlesPowf(GLfloat base, GLfloat exponent) {
 	return powf(base, exponent);
 }
 
+/**
+ * Exponentiation of 2 to a floating point number
+ * 
+ * @param value
+ * 		the value to use as exponent
+ * 
+ * @return 2^value
+ */
+GLES_INLINE static GLfloat GlesExp2f(GLfloat value) {
+	return powf(2.0f, value);
+}
+
+/**
+ * Square root of a floating point number
+ * 
+ * @param value
+ * 		the value whose square root should be computed
+ * 
+ * @return the square root of value
+ */
+GLES_INLINE static GLfloat GlesSqrtf(GLfloat value) {
+	return sqrtf(value);
+}
+
+/**
+ * Sine of a floating point number
+ * 
+ * @param value
+ * 		the angle in radians
+ * 
+ * @return sin(value)
+ */
+GLES_INLINE static GLfloat GlesSinf(GLfloat value) {
+	return sinf(value);
+}
+
+/**
+ * Cosine of a floating point number
+ * 
+ * @param value
+ * 		the angle in radians
+ * 
+ * @return cos(value)
+ */
+GLES_INLINE static GLfloat GlesCosf(GLfloat value) {
+	return cosf(value);
+}
+
 GLfloat GlesLog2f(GLfloat value);
 
 /*
@@ -437,6 +497,10 @@ GLsizei GlesSprintf(char * target, const char * format, ...);
 void * GlesMalloc(GLsizeiptr size);
 void GlesFree(void * ptr);
 
+void * GlesMallocExecutable(GLsizeiptr size);
+GLboolean GlesProtectExecutable(void * ptr, GLsizeiptr size);
+void GlesFreeExecutable(void * ptr, GLsizeiptr size);
+
 /*
 ** --------------------------------------------------------------------------
 ** Long Jumps
@@ -446,5 +510,36 @@ void GlesFree(void * ptr);
 GLint GlesSetjmp(JumpBuffer env);
 void GlesLongjmp(JumpBuffer env, GLint val);
 
+/*
+** --------------------------------------------------------------------------
+** Threads and Synchronization
+** --------------------------------------------------------------------------
+*/
+
+GLsizei GlesProcessorCount(void);
+
+Thread * GlesThreadCreate(ThreadFunction function, void * arg);
+void GlesThreadJoin(Thread * thread);
+
+Mutex * GlesMutexCreate(void);
+void GlesMutexDestroy(Mutex * mutex);
+void GlesMutexLock(Mutex * mutex);
+void GlesMutexUnlock(Mutex * mutex);
+
+Condition * GlesConditionCreate(void);
+void GlesConditionDestroy(Condition * condition);
+void GlesConditionWait(Condition * condition, Mutex * mutex);
+void GlesConditionBroadcast(Condition * condition);
+
+/*
+** --------------------------------------------------------------------------
+** File Access
+** --------------------------------------------------------------------------
+*/
+
+const char * GlesGetenv(const char * name);
+void * GlesReadFile(const char * path, GLsizeiptr * size);
+GLboolean GlesWriteFile(const char * path, const void * data, GLsizeiptr size);
+
 
 #endif /* ndef GLES_PLATFORM_PLATFORM_H */
\ No newline at end of file
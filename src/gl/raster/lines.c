@@ -53,7 +53,7 @@
 #define SUBPIXEL_MASK ((1 << GLES_SUBPIXEL_BITS) - 1)
 
 typedef struct Interpolation {
-	GLfloat	dx, dy, value;
+	GLfloat	delta, value;
 } Interpolation;
 
 /*
@@ -76,6 +76,29 @@ static GLES_INLINE GLint Sign(GLint value) {
 	return value > 0 ? 1 : value < 0 ? -1 : 0;
 }
 
+static GLES_INLINE Int64 Min64(Int64 a, Int64 b) {
+	return a < b ? a : b;
+}
+
+static GLES_INLINE Int64 Max64(Int64 a, Int64 b) {
+	return a > b ? a : b;
+}
+
+/**
+ * Divide and round towards negative infinity; the divisor is positive
+ */
+static GLES_INLINE Int64 FloorDiv(Int64 numerator, Int64 denominator) {
+	return numerator >= 0 ? numerator / denominator : 
+		-((denominator - 1 - numerator) / denominator);
+}
+
+/**
+ * Divide and round towards positive infinity; the divisor is positive
+ */
+static GLES_INLINE Int64 CeilDiv(Int64 numerator, Int64 denominator) {
+	return -FloorDiv(-numerator, denominator);
+}
+
 /*
 ** --------------------------------------------------------------------------
 ** Internal functions
@@ -101,195 +124,179 @@ static GLES_INLINE GLint Sign(GLint value) {
  * IEEE Computer Graphics and Applications, Vol. 10(5), pp. 45-53
  * 
  * Rogers, D. F. (1998) "Procedural Elements for Computer Graphics", 2nd ed., McGraw-Hill
+ * 
+ * The line is stepped along its major axis, producing one fragment for each 
+ * pixel whose center lies within the segment. The minor coordinate is tracked
+ * exactly in 28.4 fixed point. Before stepping, the range of steps is clipped 
+ * to the rasterization rectangle on both axes.
  */
 void GlesRasterLine(State * state, RasterVertex * a, RasterVertex * b) {
 	
-	GLint x = GlesRasterValue(a->screen.x);
-	GLint y = GlesRasterValue(a->screen.y);
+	GLint x1 = GlesRasterValue(a->screen.x);
+	GLint y1 = GlesRasterValue(a->screen.y);
 	GLint x2 = GlesRasterValue(b->screen.x);
 	GLint y2 = GlesRasterValue(b->screen.y);
 	
-	GLint deltaX = Abs(x2 - x);
-	GLint deltaY = Abs(y2 - y);
-	GLint signX = Sign(x2 - x);
-	GLint signY = Sign(y2 - y);
+	const Rect * rect = &state->rasterRect;
+	GLboolean yMajor = Abs(y2 - y1) > Abs(x2 - x1);
 	
-	GLfloat denominator = deltaX * deltaX + deltaY * deltaY;
-	GLsizei index;
+	/* end-points and raster rectangle along the major and the minor axis */
+	GLint major1 = yMajor ? y1 : x1, major2 = yMajor ? y2 : x2;
+	GLint minor1 = yMajor ? x1 : y1, minor2 = yMajor ? x2 : y2;
+	GLint majorMin = yMajor ? rect->y : rect->x;
+	GLint majorMax = majorMin + (yMajor ? rect->height : rect->width);
+	GLint minorMin = yMajor ? rect->x : rect->y;
+	GLint minorMax = minorMin + (yMajor ? rect->width : rect->height);
+	
+	GLint length = Abs(major2 - major1);
+	GLint sign = Sign(major2 - major1);
+	GLint first, count;
+	
+	if (!length) {
+		return;
+	}
+	
+	/* pixels whose centers lie within [major1, major2) */
+	if (sign > 0) {
+		GLint end = (major2 - HALF_PIXEL + SUBPIXEL_MASK) >> GLES_SUBPIXEL_BITS;
+		
+		first = (major1 - HALF_PIXEL + SUBPIXEL_MASK) >> GLES_SUBPIXEL_BITS;
+		count = GlesMini(end, majorMax) - first;
+	} else {
+		GLint end = (major2 - HALF_PIXEL) >> GLES_SUBPIXEL_BITS;
+		
+		first = (major1 - HALF_PIXEL) >> GLES_SUBPIXEL_BITS;
+		count = first - GlesMaxi(end, majorMin - 1);
+	}
+	
+	/* 
+	 * The minor coordinate at step k is numerator(k) / denominator in pixels,
+	 * where the numerator advances by step per pixel. Its integer part is
+	 * the pixel on the minor axis.
+	 */
+	GLint center = first * (1 << GLES_SUBPIXEL_BITS) + HALF_PIXEL;
+	GLint step = (minor2 - minor1) * (1 << GLES_SUBPIXEL_BITS);
+	Int64 denominator = (Int64) length << GLES_SUBPIXEL_BITS;
+	Int64 numerator = (Int64) minor1 * length + (Int64) (center - major1) * sign * (minor2 - minor1);
+	Int64 begin = 0, end = count;
+	
+	/* skip pixels before the raster rectangle on the major axis */
+	if (sign > 0) {
+		begin = GlesMaxi(majorMin - first, 0);
+	} else {
+		begin = GlesMaxi(first - (majorMax - 1), 0);
+	}
+	
+	/* confine the steps to the raster rectangle on the minor axis */
+	if (step > 0) {
+		begin = Max64(begin, CeilDiv(minorMin * denominator - numerator, step));
+		end = Min64(end, CeilDiv(minorMax * denominator - numerator, step));
+	} else if (step < 0) {
+		begin = Max64(begin, FloorDiv(numerator - minorMax * denominator, -step) + 1);
+		end = Min64(end, FloorDiv(numerator - minorMin * denominator, -step) + 1);
+	} else if (numerator < minorMin * denominator || numerator >= minorMax * denominator) {
+		return;
+	}
+	
+	if (begin >= end) {
+		return;
+	}
+	
+	/* advance to the first pixel within the raster rectangle */
+	numerator += begin * step;
+	first += (GLint) begin * sign;
+	center += (GLint) begin * sign * (1 << GLES_SUBPIXEL_BITS);
+	count = (GLint) (end - begin);
+
+	GLint minor = (GLint) FloorDiv(numerator, denominator);
+	GLint remainder = (GLint) (numerator - minor * denominator);
+	
+	/* set up interpolation along the major axis */
+	GLfloat distance = GlesLdexpf((center - major1) * sign, -GLES_SUBPIXEL_BITS);
+	GLfloat scale = 1.0f / GlesLdexpf(length, -GLES_SUBPIXEL_BITS);
 	
 	Interpolation invW, depth, varying[GLES_MAX_VARYING_FLOATS];
 	GLfloat vars[GLES_MAX_VARYING_FLOATS];
 	
 	SurfaceLoc loc;
+	GLsizei index;
 	 
 	union { Vec4f vec4f; Color color; } result;
+	Executable * executable = state->programs[state->program].current;
+	GLubyte live[GLES_MAX_VARYING_FLOATS];
+	GLsizei numLive = GlesLiveVaryings(executable, live);
+	
+	invW.delta = (b->screen.w - a->screen.w) * scale;
+	invW.value = a->screen.w + invW.delta * distance;
+	
+	depth.delta = (b->screen.z - a->screen.z) * scale;
+	depth.value = a->screen.z + depth.delta * distance;
+	
+	for (index = 0; index < numLive; ++index) {
+		GLfloat aInvW = a->varyingData[live[index]] * a->screen.w;
+		GLfloat bInvW = b->varyingData[live[index]] * b->screen.w;
+		
+		varying[index].delta = (bInvW - aInvW) * scale;
+		varying[index].value = aInvW + varying[index].delta * distance;
+	}
 
 	state->fragContext.varying = vars;
 	state->fragContext.result = &result.vec4f;
+	state->fragContext.frontFacing.x = 1.0f;
 
-	if (deltaX >= deltaY) {
-		GLint prestep = (x & SUBPIXEL_MASK) - HALF_PIXEL;
-		GLint error = deltaY * 2 - deltaX;	/* the formula assumes pixel centers */
-		GLint count = (deltaX - prestep) >> GLES_SUBPIXEL_BITS;
-		GLfloat fractionX = (GLfloat) deltaX / denominator;
-		GLfloat fractionY = 1.0f - fractionX;
-
-		/* set up interpolation */
-		
-		invW.value = a->screen.w;
-		invW.dx = (b->screen.w - a->screen.w) * fractionX;
-		invW.dy = (b->screen.w - a->screen.w) * fractionY;
-		
-		depth.value = a->screen.z;
-		depth.dx = (b->screen.z - a->screen.z) * fractionX;
-		depth.dy = (b->screen.z - a->screen.z) * fractionY;
-		
-		for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-			varying[index].value = a->varyingData[index];
-			varying[index].dx = (b->varyingData[index] * b->screen.w - a->varyingData[index] * a->screen.w) * fractionX;
-			varying[index].dy = (b->varyingData[index] * b->screen.w - a->varyingData[index] * a->screen.w) * fractionY;
-		}
-		
-		/* adjust the error for pre-step */
-		x += prestep;
-		error += (prestep * deltaY * ((1 << (GLES_SUBPIXEL_BITS + 1)) + 1)) >> GLES_SUBPIXEL_BITS;
-		
-		/* how to handle pre-stepping concerning interpolation values? */
-		
-		if (error > 0) {
-			y += (signY << GLES_SUBPIXEL_BITS);				
-			error -= deltaX * 2;
-				
-			invW.value += invW.dy;
-			depth.value += depth.dy;
-			
-			for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-				varying[index].value += varying[index].dy;
-			}
-		}
+	if (yMajor) {
+		GlesInitSurfaceLoc(state->writeSurface, &loc, minor, first);
+	} else {
+		GlesInitSurfaceLoc(state->writeSurface, &loc, first, minor);
+	}
+	
+	while (count--) {
+		GLfloat w = 1.0f / invW.value;
+		GLint minorStep = 0;
 		
-		GlesInitSurfaceLoc(state->writeSurface, &loc, 
-						   x >> GLES_SUBPIXEL_BITS, y >> GLES_SUBPIXEL_BITS);
-
-		while (--count) {
-        	GLfloat w = 1.0f / invW.value;
-        	
-        	for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-        		vars[index] = varying[index].value * w;
-        	}
-
-			// TODO: pixel onwership / scissor test
-			if (GlesFragmentProgram(state->programs[state->program].executable)(&state->fragContext)) {            	
-        		GlesWritePixel(state, &loc, &result.color, depth.value, GL_TRUE);
-			}				
-			
-			if (error > 0) {
-				y += (signY << GLES_SUBPIXEL_BITS);				
-				error -= deltaX * 2;
-				
-				invW.value += invW.dy;
-				depth.value += depth.dy;
-				
-				for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-					varying[index].value += varying[index].dy;
-				}
-				
-				GlesStepSurfaceLoc(&loc, 0, signY);
-			}
-			
-			x += (signX << GLES_SUBPIXEL_BITS);
-			error += deltaY * 2;
-
-			invW.value += invW.dx;
-			depth.value += depth.dx;
-			
-			for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-				varying[index].value += varying[index].dx;
-			}
-
-			GlesStepSurfaceLoc(&loc, signX, 0);
+		for (index = 0; index < numLive; ++index) {
+			vars[live[index]] = varying[index].value * w;
 		}
-	} else {
-		GLint prestep = (y & SUBPIXEL_MASK) - HALF_PIXEL;
-		GLint error = deltaX * 2 - deltaY;	
-		GLint count = (deltaY - prestep) >> GLES_SUBPIXEL_BITS;
-		GLfloat fractionY = (GLfloat) deltaY / denominator;
-		GLfloat fractionX = 1.0f - fractionY;
 
-		/* set up interpolation */
+		state->fragContext.fragCoord.x = (yMajor ? minor : first) + 0.5f;
+		state->fragContext.fragCoord.y = (yMajor ? first : minor) + 0.5f;
+		state->fragContext.fragCoord.z = depth.value;
+		state->fragContext.fragCoord.w = invW.value;
 		
-		invW.value = a->screen.w;
-		invW.dx = (b->screen.w - a->screen.w) * fractionX;
-		invW.dy = (b->screen.w - a->screen.w) * fractionY;
+		if (executable->earlyTests) {
+			if (GlesTestPixel(state, &loc, depth.value, GL_TRUE) &&
+				GlesFragmentProgram(executable)(&state->fragContext)) {
+				GlesWriteColor(state, &loc, &result.color);
+			}
+		} else if (GlesFragmentProgram(executable)(&state->fragContext)) {            	
+			GlesWritePixel(state, &loc, &result.color, depth.value, GL_TRUE);
+		}				
 		
-		depth.value = a->screen.z;
-		depth.dx = (b->screen.z - a->screen.z) * fractionX;
-		depth.dy = (b->screen.z - a->screen.z) * fractionY;
+		/* Bresenham step; the minor coordinate advances by at most a pixel */
+		remainder += step;
 		
-		for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-			varying[index].value = a->varyingData[index];
-			varying[index].dx = (b->varyingData[index] * b->screen.w - a->varyingData[index] * a->screen.w) * fractionX;
-			varying[index].dy = (b->varyingData[index] * b->screen.w - a->varyingData[index] * a->screen.w) * fractionY;
+		if (remainder >= denominator) {
+			remainder -= (GLint) denominator;
+			minorStep = 1;
+		} else if (remainder < 0) {
+			remainder += (GLint) denominator;
+			minorStep = -1;
 		}
 		
-		/* adjust the error for pre-step */
-		y += prestep;
-		error += (prestep * deltaX * ((1 << (GLES_SUBPIXEL_BITS + 1)) + 1)) >> GLES_SUBPIXEL_BITS;
+		first += sign;
+		minor += minorStep;
 		
-		/* how to handle pre-stepping concerning interpolation values? */
+		invW.value += invW.delta;
+		depth.value += depth.delta;
 		
-		if (error > 0) {
-			x += (signX << GLES_SUBPIXEL_BITS);
-			error -= deltaY * 2;
-
-			invW.value += invW.dx;
-			depth.value += depth.dx;
-			
-			for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-				varying[index].value += varying[index].dx;
-			}
+		for (index = 0; index < numLive; ++index) {
+			varying[index].value += varying[index].delta;
 		}
-		
-		GlesInitSurfaceLoc(state->writeSurface, &loc, 
-						   x >> GLES_SUBPIXEL_BITS, y >> GLES_SUBPIXEL_BITS);
-
-		while (--count) {
-        	GLfloat w = 1.0f / invW.value;
-        	
-        	for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-        		vars[index] = varying[index].value * w;
-        	}
-        	
-			// TODO: pixel onwership / scissor test
-			if (GlesFragmentProgram(state->programs[state->program].executable)(&state->fragContext)) {            	
-        		GlesWritePixel(state, &loc, &result.color, depth.value, GL_TRUE);
-			}				
-			
-			if (error > 0) {
-				x += (signX << GLES_SUBPIXEL_BITS);
-				error -= deltaY * 2;
-
-				invW.value += invW.dx;
-				depth.value += depth.dx;
-				
-				for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-					varying[index].value += varying[index].dx;
-				}
-				
-				GlesStepSurfaceLoc(&loc, signX, 0);
-			}
-			
-			y += (signY << GLES_SUBPIXEL_BITS);
-			error += deltaX * 2;
-
-			invW.value += invW.dy;
-			depth.value += depth.dy;
-			
-			for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-				varying[index].value += varying[index].dy;
-			}
 
-			GlesStepSurfaceLoc(&loc, 0, signY);
+		if (yMajor) {
+			GlesStepSurfaceLoc(&loc, minorStep, sign);
+		} else {
+			GlesStepSurfaceLoc(&loc, sign, minorStep);
 		}
 	}
 }
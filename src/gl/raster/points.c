@@ -77,13 +77,33 @@ void GlesRasterPointSprite(State * state, RasterVertex * center, GLfloat pointSi
 	GLfloat pDelta = 1.0f / pointSize;
 	GLfloat pxStart = (minX - centerMinX) * pDelta * GlesLdexpf(1.0f, -GLES_SUBPIXEL_BITS);
 	GLfloat pyStart = (minY - centerMinY) * pDelta * GlesLdexpf(1.0f, -GLES_SUBPIXEL_BITS);
+	
+	// confine the sprite to the rasterization rectangle
+	const Rect * rect = &state->rasterRect;
+	GLint skipX = GlesMaxi(rect->x - (centerMinX >> GLES_SUBPIXEL_BITS), 0);
+	GLint skipY = GlesMaxi(rect->y - (centerMinY >> GLES_SUBPIXEL_BITS), 0);
+	
+	centerMinX += skipX << GLES_SUBPIXEL_BITS;
+	centerMinY += skipY << GLES_SUBPIXEL_BITS;
+	pxStart += skipX * pDelta;
+	pyStart += skipY * pDelta;
+	maxX = GlesMini(maxX, (rect->x + rect->width) << GLES_SUBPIXEL_BITS);
+	maxY = GlesMini(maxY, (rect->y + rect->height) << GLES_SUBPIXEL_BITS);
+	
+	if (centerMinX >= maxX || centerMinY >= maxY) {
+		return;
+	}
 		
 	SurfaceLoc loc;
 	 
 	union { Vec4f vec4f; Color color; } result;
+	Executable * executable = state->programs[state->program].current;
 
 	state->fragContext.varying = center->varyingData;
 	state->fragContext.result = &result.vec4f;
+	state->fragContext.frontFacing.x = 1.0f;
+	state->fragContext.fragCoord.z = center->screen.z;
+	state->fragContext.fragCoord.w = center->screen.w;
 
 	GlesInitSurfaceLoc(state->writeSurface, &loc, 
 					   centerMinX >> GLES_SUBPIXEL_BITS, centerMinY >> GLES_SUBPIXEL_BITS);
@@ -91,15 +111,24 @@ void GlesRasterPointSprite(State * state, RasterVertex * center, GLfloat pointSi
 	for (y = centerMinY, py = pyStart; y < maxY; y += 1 << GLES_SUBPIXEL_BITS, py += pDelta) {
 		for (x = centerMinX, px = pxStart; x < maxX; x += 1 << GLES_SUBPIXEL_BITS, px += pDelta) {
 
-			// TODO: pixel onwership / scissor test
-			if (GlesFragmentProgram(state->programs[state->program].executable)(&state->fragContext)) {            	
+			state->fragContext.fragCoord.x = (x >> GLES_SUBPIXEL_BITS) + 0.5f;
+			state->fragContext.fragCoord.y = (y >> GLES_SUBPIXEL_BITS) + 0.5f;
+			state->fragContext.pointCoord.x = px;
+			state->fragContext.pointCoord.y = py;
+			
+			if (executable->earlyTests) {
+				if (GlesTestPixel(state, &loc, center->screen.z, GL_TRUE) &&
+					GlesFragmentProgram(executable)(&state->fragContext)) {
+					GlesWriteColor(state, &loc, &result.color);
+				}
+			} else if (GlesFragmentProgram(executable)(&state->fragContext)) {            	
         		GlesWritePixel(state, &loc, &result.color, center->screen.z, GL_TRUE);
 			}				
 			
 			GlesStepSurfaceLoc(&loc, 1, 0);
 		}
 		
-		GlesStepSurfaceLoc(&loc, -(maxX - centerMinX) >> GLES_SUBPIXEL_BITS, 1);
+		GlesStepSurfaceLoc(&loc, -((x - centerMinX) >> GLES_SUBPIXEL_BITS), 1);
 	}
 }
 
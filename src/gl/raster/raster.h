@@ -47,9 +47,15 @@ void GlesRasterPointSprite(State * state, RasterVertex * center, GLfloat pointSi
 
 void GlesRasterLine(State * state, RasterVertex * a, RasterVertex * b);
 
-void GlesRasterTriangle(State * state, RasterVertex * a, RasterVertex * b, RasterVertex * c,
+void GlesRasterTriangle(State * state, FragContext * context, const Rect * rect,
+						RasterVertex * a, RasterVertex * b, RasterVertex * c,
 						GLboolean backFacing);
 
+void GlesBinTriangle(State * state, RasterVertex * a, RasterVertex * b, RasterVertex * c,
+					 GLboolean backFacing);
+void GlesFlushTiles(State * state);
+void GlesDestroyTiles(State * state);
+
 /**
  * Convert a floating point value to fixed point with sub-pixel precision
  * as defined in GLES_SUBPIXEL_BITS.
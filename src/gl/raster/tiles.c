@@ -0,0 +1,546 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Sort-middle binning of triangles into screen tiles
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+#include <GLES/gl.h>
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "raster/raster.h"
+#include "frontend/linker.h"
+
+#define SUBPIXEL_MASK ((1 << GLES_SUBPIXEL_BITS) - 1)
+
+#if GLES_MAX_BINNED_TRIANGLES > 65536
+#	error "GLES_MAX_BINNED_TRIANGLES needs to fit the triangle indices of a tile"
+#endif
+
+/*
+** --------------------------------------------------------------------------
+** Module-local data structures
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * A triangle recorded for deferred rasterization. The varying data is
+ * copied, because the vertices of a draw call are overwritten once the 
+ * triangle has been binned.
+ */
+typedef struct BinnedTriangle {
+	RasterVertex	vertex[3];			/**< vertices in window coordinates	*/
+	GLboolean		backFacing;			/**< is triangle back facing?		*/
+	GLfloat			varying[3][GLES_MAX_VARYING_FLOATS];	/**< varyings	*/
+} BinnedTriangle;
+
+/**
+ * A tile of the write surface and the triangles overlapping it, in the
+ * order they have been submitted.
+ */
+typedef struct Tile {
+	Rect			rect;				/**< pixels covered by the tile		*/
+	GLsizei			count;				/**< number of binned triangles		*/
+	GLushort		triangles[GLES_MAX_BINNED_TRIANGLES];	/**< indices	*/
+} Tile;
+
+/**
+ * A thread rasterizing tiles, with a private fragment shader context, such
+ * that the temporary storage of the shader is never shared between threads.
+ */
+typedef struct TileWorker {
+	struct TilePool *	pool;			/**< pool the worker belongs to		*/
+	Thread *			thread;			/**< thread rasterizing tiles		*/
+	FragContext			context;		/**< fragment shader context		*/
+	GLboolean			ready;			/**< context is set up for flush	*/
+} TileWorker;
+
+/**
+ * Triangles binned since the last flush, and the threads rasterizing them.
+ * A tile is only ever processed by a single thread, such that triangles
+ * are rasterized in submission order within each tile.
+ */
+typedef struct TilePool {
+	State *				state;			/**< GL state being rendered		*/
+	Mutex *				mutex;			/**< protects queue of tiles		*/
+	Condition *			work;			/**< tiles are available			*/
+	Condition *			done;			/**< all queued tiles are processed	*/
+	BinnedTriangle *	triangles;		/**< triangles binned so far		*/
+	GLsizei				numTriangles;	/**< number of binned triangles		*/
+	Tile *				tiles;			/**< tiles of the write surface		*/
+	Tile **				queue;			/**< non-empty tiles to rasterize	*/
+	GLsizei				tilesX;			/**< number of tiles per row		*/
+	GLsizei				tilesY;			/**< number of tiles per column		*/
+	GLsizei				maxTiles;		/**< allocated number of tiles		*/
+	GLsizei				numQueued;		/**< number of queued tiles			*/
+	GLsizei				nextTile;		/**< next queued tile to rasterize	*/
+	GLsizei				pendingTiles;	/**< queued tiles not completed		*/
+	GLboolean			shutdown;		/**< terminate worker threads		*/
+	GLsizei				numWorkers;		/**< number of running workers		*/
+	TileWorker *		workers;		/**< the worker threads				*/
+} TilePool;
+
+/*
+** --------------------------------------------------------------------------
+** Module-local functions
+** --------------------------------------------------------------------------
+*/
+
+static GLES_INLINE GLint Min(GLint a, GLint b, GLint c) {
+	return a < b ? (a < c ? a : c) : (b < c ? b : c);
+}
+
+static GLES_INLINE GLint Max(GLint a, GLint b, GLint c) {
+	return a > b ? (a > c ? a : c) : (b > c ? b : c);
+}
+
+/**
+ * Rasterize all triangles binned for a tile, and empty the tile.
+ *
+ * @param	pool	the tile pool
+ * @param	context	the fragment shader context to use
+ * @param	tile	the tile to rasterize
+ */
+static void RasterTile(TilePool * pool, FragContext * context, Tile * tile) {
+	GLsizei index;
+
+	for (index = 0; index < tile->count; ++index) {
+		BinnedTriangle * triangle = &pool->triangles[tile->triangles[index]];
+
+		GlesRasterTriangle(pool->state, context, &tile->rect,
+						   &triangle->vertex[0], &triangle->vertex[1],
+						   &triangle->vertex[2], triangle->backFacing);
+	}
+
+	tile->count = 0;
+}
+
+/**
+ * Rasterize queued tiles until the queue is empty. The caller needs to hold
+ * the mutex of the pool, which is released while a tile is rasterized.
+ *
+ * @param	pool	the tile pool
+ * @param	context	the fragment shader context to use
+ */
+static void ProcessTiles(TilePool * pool, FragContext * context) {
+	while (pool->nextTile < pool->numQueued) {
+		Tile * tile = pool->queue[pool->nextTile++];
+
+		GlesMutexUnlock(pool->mutex);
+		RasterTile(pool, context, tile);
+		GlesMutexLock(pool->mutex);
+
+		if (!--pool->pendingTiles) {
+			GlesConditionBroadcast(pool->done);
+		}
+	}
+}
+
+/**
+ * Main loop of a tile rasterization thread.
+ *
+ * @param	arg		the TileWorker structure of the thread
+ */
+static void WorkerMain(void * arg) {
+	TileWorker * worker = (TileWorker *) arg;
+	TilePool * pool = worker->pool;
+
+	GlesMutexLock(pool->mutex);
+
+	for (;;) {
+		while ((pool->nextTile >= pool->numQueued || !worker->ready) && 
+			   !pool->shutdown) {
+			GlesConditionWait(pool->work, pool->mutex);
+		}
+
+		if (pool->shutdown) {
+			break;
+		}
+
+		ProcessTiles(pool, &worker->context);
+	}
+
+	GlesMutexUnlock(pool->mutex);
+}
+
+/**
+ * Set up the fragment shader context of a worker as copy of the context
+ * of the GL state, with private temporary storage.
+ *
+ * @param	worker	the worker to prepare
+ * @param	source	the fragment shader context to copy
+ *
+ * @return	GL_FALSE if the temporary storage could not be allocated
+ */
+static GLboolean PrepareWorker(TileWorker * worker, const FragContext * source) {
+	FragContext * context = &worker->context;
+	Vec4f * temp = context->temp, * batchTemp = context->batchTemp;
+	GLsizeiptr tempSize = context->tempSize, batchTempSize = context->batchTempSize;
+
+	if (tempSize < source->tempSize) {
+		if (temp) {
+			GlesFree(temp);
+		}
+
+		tempSize = source->tempSize;
+		temp = GlesMalloc(tempSize * sizeof(Vec4f));
+	}
+
+	if (batchTempSize < source->batchTempSize) {
+		if (batchTemp) {
+			GlesFree(batchTemp);
+		}
+
+		batchTempSize = source->batchTempSize;
+		batchTemp = GlesMalloc(batchTempSize * sizeof(Vec4f));
+	}
+
+	*context = *source;
+	context->temp = temp;
+	context->tempSize = temp ? tempSize : 0;
+	context->batchTemp = batchTemp;
+	context->batchTempSize = batchTemp ? batchTempSize : 0;
+
+	return (temp || !tempSize) && (batchTemp || !batchTempSize);
+}
+
+/**
+ * Terminate all worker threads and release all resources of the pool.
+ *
+ * @param	pool	the pool to destroy
+ */
+static void DestroyPool(TilePool * pool) {
+	GLsizei index;
+
+	if (pool->numWorkers) {
+		GlesMutexLock(pool->mutex);
+		pool->shutdown = GL_TRUE;
+		GlesConditionBroadcast(pool->work);
+		GlesMutexUnlock(pool->mutex);
+	}
+
+	for (index = 0; index < pool->numWorkers; ++index) {
+		TileWorker * worker = &pool->workers[index];
+
+		GlesThreadJoin(worker->thread);
+
+		if (worker->context.temp) {
+			GlesFree(worker->context.temp);
+		}
+
+		if (worker->context.batchTemp) {
+			GlesFree(worker->context.batchTemp);
+		}
+	}
+
+	if (pool->workers)		GlesFree(pool->workers);
+	if (pool->queue)		GlesFree(pool->queue);
+	if (pool->tiles)		GlesFree(pool->tiles);
+	if (pool->triangles)	GlesFree(pool->triangles);
+	if (pool->done)			GlesConditionDestroy(pool->done);
+	if (pool->work)			GlesConditionDestroy(pool->work);
+	if (pool->mutex)		GlesMutexDestroy(pool->mutex);
+
+	GlesFree(pool);
+}
+
+/**
+ * Create the tile pool of the GL state, if it does not exist yet. The
+ * number of threads is limited by GLES_RASTER_THREADS and the number of
+ * available processors; the calling thread rasterizes tiles as well.
+ *
+ * @param	state	reference to GL state
+ *
+ * @return	the tile pool, or NULL if triangles need to be rasterized
+ * 			without binning
+ */
+static TilePool * GetPool(State * state) {
+	TilePool * pool;
+	GLsizei index, count = GlesProcessorCount();
+
+	if (state->tiles || GLES_RASTER_THREADS <= 0) {
+		return state->tiles;
+	}
+
+	if (count > GLES_RASTER_THREADS) {
+		count = GLES_RASTER_THREADS;
+	}
+
+	pool = GlesMalloc(sizeof(TilePool));
+
+	if (!pool) {
+		return NULL;
+	}
+
+	GlesMemset(pool, 0, sizeof(TilePool));
+	pool->state = state;
+	pool->mutex = GlesMutexCreate();
+	pool->work = GlesConditionCreate();
+	pool->done = GlesConditionCreate();
+	pool->triangles = GlesMalloc(GLES_MAX_BINNED_TRIANGLES * sizeof(BinnedTriangle));
+	pool->workers = GlesMalloc(GLES_RASTER_THREADS * sizeof(TileWorker));
+
+	if (!pool->mutex || !pool->work || !pool->done || !pool->triangles ||
+		!pool->workers) {
+		DestroyPool(pool);
+		return NULL;
+	}
+
+	GlesMemset(pool->workers, 0, GLES_RASTER_THREADS * sizeof(TileWorker));
+
+	for (index = 0; index < count - 1; ++index) {
+		TileWorker * worker = &pool->workers[index];
+
+		worker->pool = pool;
+
+		if (!(worker->thread = GlesThreadCreate(WorkerMain, worker))) {
+			break;
+		}
+
+		++pool->numWorkers;
+	}
+
+	return state->tiles = pool;
+}
+
+/**
+ * Divide the write surface into tiles, at the beginning of a new batch
+ * of binned triangles. The pixels of each tile are limited to the
+ * rasterization rectangle of the current draw call.
+ *
+ * @param	pool	the tile pool
+ * @param	state	the GL state providing surface and rasterization rectangle
+ *
+ * @return	GL_FALSE if the tiles could not be allocated
+ */
+static GLboolean PrepareTiles(TilePool * pool, const State * state) {
+	const Surface * surface = state->writeSurface;
+	const Rect * bounds = &state->rasterRect;
+	GLsizei tilesX = (surface->size.width + GLES_TILE_SIZE - 1) / GLES_TILE_SIZE;
+	GLsizei tilesY = (surface->size.height + GLES_TILE_SIZE - 1) / GLES_TILE_SIZE;
+	GLsizei x, y;
+
+	if (tilesX * tilesY > pool->maxTiles) {
+		if (pool->tiles) {
+			GlesFree(pool->tiles);
+			GlesFree(pool->queue);
+		}
+
+		pool->tiles = GlesMalloc(tilesX * tilesY * sizeof(Tile));
+		pool->queue = GlesMalloc(tilesX * tilesY * sizeof(Tile *));
+		pool->maxTiles = tilesX * tilesY;
+
+		if (!pool->tiles || !pool->queue) {
+			if (pool->tiles) GlesFree(pool->tiles);
+			if (pool->queue) GlesFree(pool->queue);
+
+			pool->tiles = NULL;
+			pool->queue = NULL;
+			pool->maxTiles = 0;
+
+			return GL_FALSE;
+		}
+	}
+
+	pool->tilesX = tilesX;
+	pool->tilesY = tilesY;
+
+	for (y = 0; y < tilesY; ++y) {
+		for (x = 0; x < tilesX; ++x) {
+			Tile * tile = &pool->tiles[y * tilesX + x];
+			GLint right = GlesMini((x + 1) * GLES_TILE_SIZE, bounds->x + bounds->width);
+			GLint bottom = GlesMini((y + 1) * GLES_TILE_SIZE, bounds->y + bounds->height);
+
+			tile->rect.x = GlesMaxi(x * GLES_TILE_SIZE, bounds->x);
+			tile->rect.y = GlesMaxi(y * GLES_TILE_SIZE, bounds->y);
+			tile->rect.width = GlesMaxi(right - tile->rect.x, 0);
+			tile->rect.height = GlesMaxi(bottom - tile->rect.y, 0);
+			tile->count = 0;
+		}
+	}
+
+	return GL_TRUE;
+}
+
+/*
+** --------------------------------------------------------------------------
+** Internal functions
+** --------------------------------------------------------------------------
+*/
+
+/**
+ * Record a triangle in the bins of all tiles overlapped by its bounding
+ * rectangle. The triangle is rasterized by the next GlesFlushTiles(),
+ * which happens implicitly once GLES_MAX_BINNED_TRIANGLES have been
+ * binned.
+ * 
+ * @param state
+ * 		the GL state defining rasterization settings
+ * @param a
+ * 		first vertex
+ * @param b 
+ * 		second vertex
+ * @param c
+ * 		third vertex
+ * @param backFacing
+ * 		if true, this is a back facing triangle
+ */
+void GlesBinTriangle(State * state, RasterVertex * a, RasterVertex * b, RasterVertex * c,
+					 GLboolean backFacing) {
+	TilePool * pool = GetPool(state);
+	Executable * executable = state->programs[state->program].current;
+	BinnedTriangle * triangle;
+	GLint minx, maxx, miny, maxy, x, y, x1, x2, x3, y1, y2, y3;
+	GLushort index;
+	
+	if (!pool || (!pool->numTriangles && !PrepareTiles(pool, state))) {
+		GlesRasterTriangle(state, &state->fragContext, &state->rasterRect, 
+						   a, b, c, backFacing);
+		return;
+	}
+	
+	x1 = GlesRasterValue(a->screen.x);
+	x2 = GlesRasterValue(b->screen.x);
+	x3 = GlesRasterValue(c->screen.x);
+	y1 = GlesRasterValue(a->screen.y);
+	y2 = GlesRasterValue(b->screen.y);
+	y3 = GlesRasterValue(c->screen.y);
+	
+	/* tiles overlapped by the bounding rectangle as used in rasterizer */
+	minx = GlesMaxi((Min(x1, x2, x3) + SUBPIXEL_MASK) >> GLES_SUBPIXEL_BITS, 
+					state->rasterRect.x);
+	maxx = GlesMini((Max(x1, x2, x3) + SUBPIXEL_MASK) >> GLES_SUBPIXEL_BITS, 
+					state->rasterRect.x + state->rasterRect.width);
+	miny = GlesMaxi((Min(y1, y2, y3) + SUBPIXEL_MASK) >> GLES_SUBPIXEL_BITS, 
+					state->rasterRect.y);
+	maxy = GlesMini((Max(y1, y2, y3) + SUBPIXEL_MASK) >> GLES_SUBPIXEL_BITS,
+					state->rasterRect.y + state->rasterRect.height);
+	
+	if (minx >= maxx || miny >= maxy) {
+		return;
+	}
+	
+	index = (GLushort) pool->numTriangles++;
+	triangle = &pool->triangles[index];
+	triangle->vertex[0] = *a;
+	triangle->vertex[1] = *b;
+	triangle->vertex[2] = *c;
+	triangle->backFacing = backFacing;
+	
+	/* varying words beyond the rows used by the program are never read */
+	for (x = 0; x < 3; ++x) {
+		GlesMemcpy(triangle->varying[x], triangle->vertex[x].varyingData,
+				   executable->numVarying * sizeof(GLfloat));
+		triangle->vertex[x].varyingData = triangle->varying[x];
+	}
+	
+	for (y = miny / GLES_TILE_SIZE; y <= (maxy - 1) / GLES_TILE_SIZE; ++y) {
+		Tile * tile = &pool->tiles[y * pool->tilesX + minx / GLES_TILE_SIZE];
+		
+		for (x = minx / GLES_TILE_SIZE; x <= (maxx - 1) / GLES_TILE_SIZE; ++x, ++tile) {
+			tile->triangles[tile->count++] = index;
+		}
+	}
+	
+	if (pool->numTriangles == GLES_MAX_BINNED_TRIANGLES) {
+		GlesFlushTiles(state);
+	}
+}
+
+/**
+ * Rasterize all binned triangles. Tiles are distributed across the tile
+ * threads and the calling thread, and the function returns once all
+ * tiles have been completed.
+ * 
+ * @param state
+ * 		the GL state defining rasterization settings
+ */
+void GlesFlushTiles(State * state) {
+	TilePool * pool = state->tiles;
+	GLsizei index, numTiles;
+	
+	if (!pool || !pool->numTriangles) {
+		return;
+	}
+	
+	numTiles = pool->tilesX * pool->tilesY;
+	
+	GlesMutexLock(pool->mutex);
+	
+	pool->numQueued = 0;
+	
+	for (index = 0; index < numTiles; ++index) {
+		if (pool->tiles[index].count) {
+			pool->queue[pool->numQueued++] = &pool->tiles[index];
+		}
+	}
+	
+	/* workers are waiting for tiles, hence their contexts can be updated */
+	for (index = 0; index < pool->numWorkers; ++index) {
+		pool->workers[index].ready = 
+			PrepareWorker(&pool->workers[index], &state->fragContext);
+	}
+	
+	pool->nextTile = 0;
+	pool->pendingTiles = pool->numQueued;
+	GlesConditionBroadcast(pool->work);
+	
+	ProcessTiles(pool, &state->fragContext);
+	
+	while (pool->pendingTiles) {
+		GlesConditionWait(pool->done, pool->mutex);
+	}
+	
+	GlesMutexUnlock(pool->mutex);
+	
+	pool->numTriangles = 0;
+}
+
+/**
+ * Terminate the tile rasterization threads and release the storage for
+ * binned triangles. Triangles that are still binned are discarded.
+ *
+ * @param	state	reference to GL state
+ */
+void GlesDestroyTiles(State * state) {
+	if (state->tiles) {
+		DestroyPool(state->tiles);
+		state->tiles = NULL;
+	}
+}
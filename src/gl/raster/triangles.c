@@ -50,6 +50,22 @@
 
 #define SUBPIXEL_MASK ((1 << GLES_SUBPIXEL_BITS) - 1)
 #define HALF_PIXEL (1 << (GLES_SUBPIXEL_BITS - 1))
+#define EDGE_LIMIT (1 << 30)
+
+#if (GLES_SHADER_BATCH % 4) != 0
+#	error "GLES_SHADER_BATCH needs to be a multiple of the 2x2 pixel quad"
+#endif
+
+#if GLES_RASTER_BLOCK_SIZE > 32
+#	error "GLES_RASTER_BLOCK_SIZE exceeds the span coverage mask"
+#endif
+
+#if GLES_MATH_SSE2
+#	include <emmintrin.h>
+#	define RASTER_SSE2	1
+#else
+#	define RASTER_SSE2	0
+#endif
 
 static GLES_INLINE GLint Min(GLint a, GLint b, GLint c) {
 	return a < b ? (a < c ? a : c) : (b < c ? b : c);
@@ -59,15 +75,266 @@ static GLES_INLINE GLint Max(GLint a, GLint b, GLint c) {
 	return a > b ? (a > c ? a : c) : (b > c ? b : c);
 }
 
+/**
+ * Narrow an edge function value at a pixel of a block to 32 bits. Values are
+ * clamped to +/-2^30, which by far exceeds the change of an edge function 
+ * across a block for coordinates within the guard band. This preserves the
+ * sign of the edge function at all pixels of the block.
+ * 
+ * @param e
+ * 		edge function value
+ * 
+ * @return
+ * 		the clamped edge function value
+ */
+static GLES_INLINE GLint NarrowEdge(Int64 e) {
+	return (GLint) (e > EDGE_LIMIT ? EDGE_LIMIT : e < -EDGE_LIMIT ? -EDGE_LIMIT : e);
+}
+
+/**
+ * Count the corners of a rectangle of pixels that are inside of an edge.
+ * As edge functions are linear, the rectangle is completely outside of
+ * the edge if no corner is inside, and completely inside if all are.
+ * 
+ * @param e
+ * 		edge function value at the top-left pixel of the rectangle
+ * @param dx
+ * 		edge function increment across the width of the rectangle
+ * @param dy
+ * 		edge function decrement across the height of the rectangle
+ * 
+ * @return
+ * 		the number of corners inside of the edge
+ */
+static GLES_INLINE GLint Corners(GLint e, GLint dx, GLint dy) {
+	return (e > 0) + (e + dx > 0) + (e - dy > 0) + (e + dx - dy > 0);
+}
+
 typedef struct Interpolation {
 	GLfloat	dx, dy, value;
 } Interpolation;
 
 /**
- * Rasterization of a triangle defined by the 3 given vertices
+ * Edge function increments of four pixels relative to the first one, such
+ * that the three edges can be tested for four pixels at once. Increments
+ * are stored per edge, one vector lane per pixel.
+ */
+typedef struct EdgeLanes {
+	GLint	quad[3][4];			/**< pixels (0, 0), (1, 0), (0, 1), (1, 1)	*/
+	GLint	span[3][4];			/**< pixels (0, 0), (1, 0), (2, 0), (3, 0)	*/
+} EdgeLanes;
+
+static void InitEdgeLanes(EdgeLanes * lanes, GLsizei edge, GLint ex, GLint ey) {
+	lanes->quad[edge][0] = 0;
+	lanes->quad[edge][1] = ex;
+	lanes->quad[edge][2] = -ey;
+	lanes->quad[edge][3] = ex - ey;
+	
+	lanes->span[edge][0] = 0;
+	lanes->span[edge][1] = ex;
+	lanes->span[edge][2] = ex * 2;
+	lanes->span[edge][3] = ex * 3;
+}
+
+/**
+ * Test four pixels against the three edges of a triangle.
+ * 
+ * @param lanes
+ * 		edge function increments of the pixels relative to the first one
+ * @param e1
+ * 		value of the first edge function at the first pixel
+ * @param e2
+ * 		value of the second edge function at the first pixel
+ * @param e3
+ * 		value of the third edge function at the first pixel
+ * 
+ * @return
+ * 		mask of the pixels inside of all edges, bit 0 = first pixel
+ */
+static GLES_INLINE GLuint EdgeMask(const GLint lanes[3][4], 
+								   GLint e1, GLint e2, GLint e3) {
+#if RASTER_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	__m128i in1 = _mm_add_epi32(_mm_set1_epi32(e1), _mm_loadu_si128((const __m128i *) lanes[0]));
+	__m128i in2 = _mm_add_epi32(_mm_set1_epi32(e2), _mm_loadu_si128((const __m128i *) lanes[1]));
+	__m128i in3 = _mm_add_epi32(_mm_set1_epi32(e3), _mm_loadu_si128((const __m128i *) lanes[2]));
+	__m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(in1, zero), 
+												 _mm_cmpgt_epi32(in2, zero)),
+								   _mm_cmpgt_epi32(in3, zero));
+	
+	return (GLuint) _mm_movemask_ps(_mm_castsi128_ps(inside));
+#else
+	GLuint mask = 0;
+	GLsizei lane;
+	
+	for (lane = 0; lane < 4; ++lane) {
+		if (e1 + lanes[0][lane] > 0 && e2 + lanes[1][lane] > 0 && e3 + lanes[2][lane] > 0) {
+			mask |= 1u << lane;
+		}
+	}
+	
+	return mask;
+#endif
+}
+
+/**
+ * Test a horizontal span of pixels against the three edges of a triangle,
+ * four pixels at a time.
+ * 
+ * @param lanes
+ * 		edge function increments of four pixels of a span
+ * @param e1, e2, e3
+ * 		edge function values at the first pixel of the span
+ * @param ex1, ex2, ex3
+ * 		edge function increments per pixel
+ * @param count
+ * 		number of pixels in the span, at most 32
+ * 
+ * @return
+ * 		mask of the pixels inside of all edges, bit 0 = first pixel
+ */
+static GLES_INLINE GLuint SpanMask(const EdgeLanes * lanes, 
+								   GLint e1, GLint e2, GLint e3,
+								   GLint ex1, GLint ex2, GLint ex3, GLint count) {
+	GLuint mask = 0;
+	GLint index;
+	
+	for (index = 0; index < count; index += 4) {
+		mask |= EdgeMask(lanes->span, e1 + index * ex1, e2 + index * ex2, 
+						 e3 + index * ex3) << index;
+	}
+	
+	return mask & (~0u >> (32 - count));
+}
+
+/**
+ * Evaluate an interpolant at the four pixels of a 2x2 quad.
+ * 
+ * @param result
+ * 		receives the values at pixels (0, 0), (1, 0), (0, 1) and (1, 1)
+ * @param value
+ * 		the value at the origin of the block containing the quad
+ * @param ip
+ * 		the gradients of the interpolant
+ * @param fx, fy
+ * 		position of the quad relative to the block origin
+ * @param scale
+ * 		per-pixel factors to apply to the values, or NULL
+ */
+static GLES_INLINE void QuadValues(GLfloat * result, GLfloat value, 
+								   const Interpolation * ip, GLfloat fx, GLfloat fy,
+								   const GLfloat * scale) {
+#if RASTER_SSE2
+	__m128 x = _mm_add_ps(_mm_set1_ps(fx), _mm_setr_ps(0.0f, 1.0f, 0.0f, 1.0f));
+	__m128 y = _mm_add_ps(_mm_set1_ps(fy), _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f));
+	__m128 v = _mm_add_ps(_mm_add_ps(_mm_set1_ps(value), 
+									 _mm_mul_ps(x, _mm_set1_ps(ip->dx))),
+						  _mm_mul_ps(y, _mm_set1_ps(ip->dy)));
+	
+	if (scale) {
+		v = _mm_mul_ps(v, _mm_loadu_ps(scale));
+	}
+	
+	_mm_storeu_ps(result, v);
+#else
+	GLsizei lane;
+	
+	for (lane = 0; lane < 4; ++lane) {
+		result[lane] = 
+			value + (fx + (lane & 1)) * ip->dx + (fy + (lane >> 1)) * ip->dy;
+		
+		if (scale) {
+			result[lane] *= scale[lane];
+		}
+	}
+#endif
+}
+
+static GLES_INLINE void QuadReciprocal(GLfloat * result, const GLfloat * value) {
+#if RASTER_SSE2
+	_mm_storeu_ps(result, _mm_div_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(value)));
+#else
+	GLsizei lane;
+	
+	for (lane = 0; lane < 4; ++lane) {
+		result[lane] = 1.0f / value[lane];
+	}
+#endif
+}
+
+/**
+ * Fragments collected for batched execution of the fragment shader. All
+ * per-fragment shader data is stored as structure of arrays. Fragments
+ * are queued as complete 2x2 pixel quads, such that the shader can take
+ * differences between neighboring pixels; quad pixels outside of the
+ * primitive are executed as helper pixels, but never written.
+ */
+typedef struct FragmentQueue {
+	GLsizei		count;									/**< queued fragments	*/
+	GLuint		coverage;								/**< non-helper pixels	*/
+	SurfaceLoc	loc[GLES_SHADER_BATCH];				/**< surface locations	*/
+	GLfloat		depth[GLES_SHADER_BATCH];				/**< depth values		*/
+	GLfloat		varying[GLES_MAX_VARYING_FLOATS * GLES_SHADER_BATCH];
+	GLfloat		result[4 * GLES_SHADER_BATCH];		/**< fragment colors	*/
+} FragmentQueue;
+
+/**
+ * Run the fragment shader on all queued fragments and write the fragments
+ * that have not been discarded.
+ * 
+ * @param state
+ * 		the GL state defining rasterization settings
+ * @param context
+ * 		the fragment shader execution context to use
+ * @param program
+ * 		the batched fragment program to execute
+ * @param queue
+ * 		the queued fragments
+ * @param front
+ * 		if true, the fragments belong to a front facing primitive
+ * @param tested
+ * 		if true, the fragments have already passed depth and stencil tests
+ */
+static void FlushFragments(State * state, FragContext * context,
+						   FragmentBatchProgram program, 
+						   FragmentQueue * queue, GLboolean front,
+						   GLboolean tested) {
+	GLuint mask = program(context, (1u << queue->count) - 1);
+	Colorub color[GLES_SHADER_BATCH];
+	GLsizei lane;
+	
+	GlesPackColors(color, queue->result);
+	
+	for (lane = 0; lane < queue->count; ++lane) {
+		if ((mask & queue->coverage & (1u << lane)) &&
+			(tested || GlesTestPixel(state, &queue->loc[lane], queue->depth[lane], front))) {
+			GlesWriteColorBlend(state, &queue->loc[lane], &color[lane]);
+		}
+	}
+	
+	queue->count = 0;
+	queue->coverage = 0;
+}
+
+/**
+ * Rasterization of a triangle defined by the 3 given vertices. Only the
+ * pixels within the given rectangle are generated, such that different
+ * threads can rasterize disjoint parts of the same triangle. The rectangle
+ * needs to be contained in the rasterization rectangle of the state, which
+ * takes the place of clipping at the sides of the viewing frustrum. The bounding
+ * rectangle is traversed in blocks of GLES_RASTER_BLOCK_SIZE pixels;
+ * blocks outside of the triangle are skipped, and pixels of blocks inside
+ * of the triangle are generated without testing the edge functions. Only
+ * the varyings read by the fragment shader are interpolated. Edge functions
+ * and interpolants are evaluated for four pixels at a time, using SSE2
+ * where available.
  * 
  * @param state
  * 		the GL state defining rasterization settings
+ * @param context
+ * 		the fragment shader execution context to use
+ * @param rect
+ * 		the rectangle of pixels to rasterize
  * 
  * @param a
  * 		first vertex
@@ -78,7 +345,8 @@ typedef struct Interpolation {
  * @param backFacing
  * 		if true, this is a back facing triangle
  */
-void GlesRasterTriangle(State * state, RasterVertex * a, RasterVertex * b, RasterVertex * c,
+void GlesRasterTriangle(State * state, FragContext * context, const Rect * rect,
+						RasterVertex * a, RasterVertex * b, RasterVertex * c,
 						GLboolean backFacing) {
 					
 	// 28.4 fixed-point coordinates
@@ -115,7 +383,15 @@ void GlesRasterTriangle(State * state, RasterVertex * a, RasterVertex * b, Raste
     GLint miny = (Min(y1, y2, y3) + SUBPIXEL_MASK) >> GLES_SUBPIXEL_BITS;
     GLint maxy = (Max(y1, y2, y3) + SUBPIXEL_MASK) >> GLES_SUBPIXEL_BITS;
     
-    GLint span = maxx - minx;
+    if (minx < rect->x) minx = rect->x;
+    if (miny < rect->y) miny = rect->y;
+    if (maxx > rect->x + rect->width)  maxx = rect->x + rect->width;
+    if (maxy > rect->y + rect->height) maxy = rect->y + rect->height;
+    
+    if (minx >= maxx || miny >= maxy) {
+    	return;
+    }
+
 
 	// x and y coordinate of pixel center of min/min-corner of rectangle
 	GLfloat xStart = minx + 0.5f;
@@ -144,22 +420,45 @@ void GlesRasterTriangle(State * state, RasterVertex * a, RasterVertex * b, Raste
 	depth.value = a->screen.z + deltaX * depth.dx + deltaY * depth.dy + factor +
 						state->polygonOffsetUnits * GlesLdexpf(1.0f, -state->writeSurface->depthBits);
 		
-	// interpolation of varyings
+	Executable * executable = state->programs[state->program].current;
+	
+	// interpolation of the varyings read by the fragment shader
 	Interpolation varying[GLES_MAX_VARYING_FLOATS];
 	GLfloat vars[GLES_MAX_VARYING_FLOATS];
+	GLubyte live[GLES_MAX_VARYING_FLOATS];
+	GLsizei numLive = GlesLiveVaryings(executable, live);
+	GLboolean fragCoord = (executable->specialMask & GLES_SPECIAL_FRAG_COORD) != 0;
 	
 	union { Vec4f vec4f; Color color; } result;
 
-	state->fragContext.varying = vars;
-	state->fragContext.result = &result.vec4f;
+	context->varying = vars;
+	context->result = &result.vec4f;
+	context->frontFacing.x = backFacing ? 0.0f : 1.0f;
 	
 	GLsizei index;
 	
+	// depth and stencil tests ahead of the fragment shader, if it cannot
+	// discard fragments; otherwise they are performed on write
+	GLboolean earlyTests = executable->earlyTests;
+	
+	// batched execution of the fragment shader, if available
+	FragmentBatchProgram batchProgram = GlesFragmentBatchProgram(executable);
+	FragmentQueue queue;
+	
+	queue.count = 0;
+	queue.coverage = 0;
+	context->batchVarying = queue.varying;
+	context->batchResult = queue.result;
+	
+	for (index = 0; index < GLES_SHADER_BATCH; ++index) {
+		context->batchFrontFacing[0][index] = backFacing ? 0.0f : 1.0f;
+	}
+	
 	// initialize gradients for varying data
-	for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-		GLfloat aInvW = a->varyingData[index] * a->screen.w;
-		GLfloat bInvW = b->varyingData[index] * b->screen.w;
-		GLfloat cInvW = c->varyingData[index] * c->screen.w;
+	for (index = 0; index < numLive; ++index) {
+		GLfloat aInvW = a->varyingData[live[index]] * a->screen.w;
+		GLfloat bInvW = b->varyingData[live[index]] * b->screen.w;
+		GLfloat cInvW = c->varyingData[live[index]] * c->screen.w;
 
 		GLfloat dv12 = aInvW - bInvW, dv31 = cInvW - aInvW;
 		
@@ -170,10 +469,11 @@ void GlesRasterTriangle(State * state, RasterVertex * a, RasterVertex * b, Raste
 			aInvW + deltaX * varying[index].dx + deltaY * varying[index].dy; 
 	}
 	 
-    // Half-edge function values at origin
-    GLint c1 = y2 * x1 - x2 * y1;
-    GLint c2 = y3 * x2 - x3 * y2;
-    GLint c3 = y1 * x3 - x1 * y3;
+    // Half-edge function values at origin; within the guard band the 
+    // products of coordinates exceed 32 bits
+    Int64 c1 = (Int64) y2 * x1 - (Int64) x2 * y1;
+    Int64 c2 = (Int64) y3 * x2 - (Int64) x3 * y2;
+    Int64 c3 = (Int64) y1 * x3 - (Int64) x1 * y3;
     
     // Correct for fill convention
     if (dy12 < 0 || (dy12 == 0 && dx12 > 0)) c1++;
@@ -181,65 +481,208 @@ void GlesRasterTriangle(State * state, RasterVertex * a, RasterVertex * b, Raste
     if (dy31 < 0 || (dy31 == 0 && dx31 > 0)) c3++;
 
 	// determine values for pixel center of (minx, miny)
-    GLint cy1 = c1 - dx12 * ((miny << GLES_SUBPIXEL_BITS) + HALF_PIXEL)
-    			   + dy12 * ((minx << GLES_SUBPIXEL_BITS) + HALF_PIXEL);
-    GLint cy2 = c2 - dx23 * ((miny << GLES_SUBPIXEL_BITS) + HALF_PIXEL) 
-    			   + dy23 * ((minx << GLES_SUBPIXEL_BITS) + HALF_PIXEL);
-    GLint cy3 = c3 - dx31 * ((miny << GLES_SUBPIXEL_BITS) + HALF_PIXEL) 
-    			   + dy31 * ((minx << GLES_SUBPIXEL_BITS) + HALF_PIXEL);
-
-	GLint x, y;
+    Int64 cy1 = c1 - (Int64) dx12 * ((miny << GLES_SUBPIXEL_BITS) + HALF_PIXEL)
+    			   + (Int64) dy12 * ((minx << GLES_SUBPIXEL_BITS) + HALF_PIXEL);
+    Int64 cy2 = c2 - (Int64) dx23 * ((miny << GLES_SUBPIXEL_BITS) + HALF_PIXEL) 
+    			   + (Int64) dy23 * ((minx << GLES_SUBPIXEL_BITS) + HALF_PIXEL);
+    Int64 cy3 = c3 - (Int64) dx31 * ((miny << GLES_SUBPIXEL_BITS) + HALF_PIXEL) 
+    			   + (Int64) dy31 * ((minx << GLES_SUBPIXEL_BITS) + HALF_PIXEL);
+
+	// edge function increments per pixel in x and y direction
+	GLint ex1 = dy12 << GLES_SUBPIXEL_BITS, ey1 = dx12 << GLES_SUBPIXEL_BITS;
+	GLint ex2 = dy23 << GLES_SUBPIXEL_BITS, ey2 = dx23 << GLES_SUBPIXEL_BITS;
+	GLint ex3 = dy31 << GLES_SUBPIXEL_BITS, ey3 = dx31 << GLES_SUBPIXEL_BITS;
+
+	EdgeLanes lanes;
+	
+	InitEdgeLanes(&lanes, 0, ex1, ey1);
+	InitEdgeLanes(&lanes, 1, ex2, ey2);
+	InitEdgeLanes(&lanes, 2, ex3, ey3);
+
+	GLint x, y, bx, by;
 	SurfaceLoc loc;
 	
-	/* init surface location */
-	GlesInitSurfaceLoc(state->writeSurface, &loc, minx, miny);
-	
-    for (y = miny; y < maxy; y++)
-    {
-        GLint cx1 = cy1, cx2 = cy2, cx3 = cy3;
-
-        for (x = minx; x < maxx; x++)
-        {
-            if (cx1 > 0 && cx2 > 0 && cx3 > 0)
-            {
-            	/* TODO: pixel ownership & scissor test */
-            	
-            	GLfloat w = 1.0f / invW.value;
-            	
-            	for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-            		vars[index] = varying[index].value * w;
-            	}
-            	 
-				if (GlesFragmentProgram(state->programs[state->program].executable)(&state->fragContext)) {            	
-            		GlesWritePixel(state, &loc, &result.color, depth.value, !backFacing);
-				}				
-            }
-
-            cx1 += dy12 << GLES_SUBPIXEL_BITS, 
-            cx2 += dy23 << GLES_SUBPIXEL_BITS, 
-            cx3 += dy31 << GLES_SUBPIXEL_BITS;
-            
-            invW.value += invW.dx;
-            depth.value += depth.dx;
-            
-            for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-            	varying[index].value += varying[index].dx;
-            }
-            
-            GlesStepSurfaceLoc(&loc, 1, 0);
-        }
-
-        cy1 -= dx12 << GLES_SUBPIXEL_BITS, 
-        cy2 -= dx23 << GLES_SUBPIXEL_BITS, 
-        cy3 -= dx31 << GLES_SUBPIXEL_BITS;
-
-        invW.value += invW.dy - invW.dx * span;
-        depth.value += depth.dy - depth.dx * span;
-        
-        for (index = 0; index < GLES_MAX_VARYING_FLOATS; ++index) {
-        	varying[index].value += varying[index].dy - varying[index].dx * span;
-        }
-
-        GlesStepSurfaceLoc(&loc, -span, 1);
-    }
+	// traverse blocks aligned to multiples of GLES_RASTER_BLOCK_SIZE
+	for (by = miny & ~(GLES_RASTER_BLOCK_SIZE - 1); by < maxy; by += GLES_RASTER_BLOCK_SIZE) {
+		for (bx = minx & ~(GLES_RASTER_BLOCK_SIZE - 1); bx < maxx; bx += GLES_RASTER_BLOCK_SIZE) {
+			
+			// pixels of the block within the bounding rectangle
+			GLint x0 = GlesMaxi(bx, minx), x1 = GlesMini(bx + GLES_RASTER_BLOCK_SIZE, maxx) - 1;
+			GLint y0 = GlesMaxi(by, miny), y1 = GlesMini(by + GLES_RASTER_BLOCK_SIZE, maxy) - 1;
+			GLint ox = x0 - minx, oy = y0 - miny;
+			
+			// edge function values at top-left pixel of the block
+			GLint e1 = NarrowEdge(cy1 + (Int64) ox * ex1 - (Int64) oy * ey1);
+			GLint e2 = NarrowEdge(cy2 + (Int64) ox * ex2 - (Int64) oy * ey2);
+			GLint e3 = NarrowEdge(cy3 + (Int64) ox * ex3 - (Int64) oy * ey3);
+			
+			GLint in1 = Corners(e1, (x1 - x0) * ex1, (y1 - y0) * ey1);
+			GLint in2 = Corners(e2, (x1 - x0) * ex2, (y1 - y0) * ey2);
+			GLint in3 = Corners(e3, (x1 - x0) * ex3, (y1 - y0) * ey3);
+			
+			if (!in1 || !in2 || !in3) {
+				/* block is outside of the triangle */
+				continue;
+			}
+			
+			// covered blocks do not need per-pixel edge tests
+			GLboolean covered = in1 == 4 && in2 == 4 && in3 == 4;
+			
+			// interpolants at top-left pixel of the block
+			GLfloat fx = (GLfloat) ox, fy = (GLfloat) oy;
+			GLfloat blockInvW = invW.value + fx * invW.dx + fy * invW.dy;
+			GLfloat blockDepth = depth.value + fx * depth.dx + fy * depth.dy;
+			GLfloat blockVarying[GLES_MAX_VARYING_FLOATS];
+			
+			for (index = 0; index < numLive; ++index) {
+				blockVarying[index] = 
+					varying[index].value + fx * varying[index].dx + fy * varying[index].dy;
+			}
+			
+			if (batchProgram) {
+				// traverse 2x2 pixel quads aligned to even coordinates
+				for (y = y0 & ~1; y <= y1; y += 2) {
+					for (x = x0 & ~1; x <= x1; x += 2) {
+						GLsizei base = queue.count, lane;
+						GLint qx = x - x0, qy = y - y0;
+						GLfloat qfx = (GLfloat) qx, qfy = (GLfloat) qy;
+						GLfloat invWValue[4], w[4];
+						
+						// quad pixels within the block and inside of the triangle
+						GLuint coverage = 
+							((x >= x0 ? 0x5 : 0) | (x < x1 ? 0xa : 0)) &
+							((y >= y0 ? 0x3 : 0) | (y < y1 ? 0xc : 0));
+						
+						if (!covered) {
+							coverage &= EdgeMask(lanes.quad, 
+												 e1 + qx * ex1 - qy * ey1,
+												 e2 + qx * ex2 - qy * ey2,
+												 e3 + qx * ex3 - qy * ey3);
+						}
+						
+						if (!coverage) {
+							continue;
+						}
+						
+						QuadValues(queue.depth + base, blockDepth, &depth, qfx, qfy, NULL);
+						GlesInitSurfaceLoc(state->writeSurface, &loc, x, y);
+		
+						for (lane = 0; lane < 4; ++lane) {
+							queue.loc[base + lane] = loc;
+							GlesStepSurfaceLoc(&queue.loc[base + lane], lane & 1, lane >> 1);
+							
+							if (earlyTests && (coverage & (1u << lane)) &&
+								!GlesTestPixel(state, &queue.loc[base + lane], 
+											   queue.depth[base + lane], !backFacing)) {
+								coverage &= ~(1u << lane);
+							}
+						}
+		
+						if (!coverage) {
+							continue;
+						}
+						
+						QuadValues(invWValue, blockInvW, &invW, qfx, qfy, NULL);
+						QuadReciprocal(w, invWValue);
+		
+						/* helper pixels are interpolated as well to provide derivatives */
+						for (index = 0; index < numLive; ++index) {
+							QuadValues(queue.varying + live[index] * GLES_SHADER_BATCH + base,
+									   blockVarying[index], &varying[index], qfx, qfy, w);
+						}
+		
+						if (fragCoord) {
+							for (lane = 0; lane < 4; ++lane) {
+								context->batchFragCoord[0][base + lane] = x + (lane & 1) + 0.5f;
+								context->batchFragCoord[1][base + lane] = y + (lane >> 1) + 0.5f;
+								context->batchFragCoord[2][base + lane] = queue.depth[base + lane];
+								context->batchFragCoord[3][base + lane] = invWValue[lane];
+							}
+						}
+		
+						queue.coverage |= coverage << base;
+						queue.count += 4;
+		
+						if (queue.count == GLES_SHADER_BATCH) {
+							FlushFragments(state, context, batchProgram, &queue, !backFacing, earlyTests);
+						}
+					}
+				}
+				
+				continue;
+			}
+			
+			GLint span = x1 - x0 + 1;
+			GLfloat pixelVarying[GLES_MAX_VARYING_FLOATS];
+			
+			/* init surface location */
+			GlesInitSurfaceLoc(state->writeSurface, &loc, x0, y0);
+			
+			for (y = y0; y <= y1; y++)
+			{
+				GLuint mask = covered ? ~0u : SpanMask(&lanes, e1, e2, e3, ex1, ex2, ex3, span);
+				
+				if (mask) {
+					GLfloat pixelInvW = blockInvW, pixelDepth = blockDepth;
+					SurfaceLoc pixelLoc = loc;
+					
+					for (index = 0; index < numLive; ++index) {
+						pixelVarying[index] = blockVarying[index];
+					}
+					
+					for (x = x0; x <= x1; x++)
+					{
+						if ((mask & (1u << (x - x0))) &&
+							(!earlyTests || GlesTestPixel(state, &pixelLoc, pixelDepth, !backFacing)))
+						{
+							GLfloat w = 1.0f / pixelInvW;
+							
+							for (index = 0; index < numLive; ++index) {
+								vars[live[index]] = pixelVarying[index] * w;
+							}
+							
+							if (fragCoord) {
+								context->fragCoord.x = x + 0.5f;
+								context->fragCoord.y = y + 0.5f;
+								context->fragCoord.z = pixelDepth;
+								context->fragCoord.w = pixelInvW;
+							}
+							
+							if (!GlesFragmentProgram(executable)(context)) {
+								/* fragment has been discarded */
+							} else if (earlyTests) {
+								GlesWriteColor(state, &pixelLoc, &result.color);
+							} else {
+								GlesWritePixel(state, &pixelLoc, &result.color, pixelDepth, !backFacing);
+							}
+						}
+						
+						pixelInvW += invW.dx;
+						pixelDepth += depth.dx;
+						
+						for (index = 0; index < numLive; ++index) {
+							pixelVarying[index] += varying[index].dx;
+						}
+						
+						GlesStepSurfaceLoc(&pixelLoc, 1, 0);
+					}
+				}
+				
+				e1 -= ey1, e2 -= ey2, e3 -= ey3;
+				
+				blockInvW += invW.dy;
+				blockDepth += depth.dy;
+				
+				for (index = 0; index < numLive; ++index) {
+					blockVarying[index] += varying[index].dy;
+				}
+				
+				GlesStepSurfaceLoc(&loc, 0, 1);
+			}
+		}
+	}
+	
+	if (queue.count) {
+		FlushFragments(state, context, batchProgram, &queue, !backFacing, earlyTests);
+	}
 }
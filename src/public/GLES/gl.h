@@ -589,6 +589,11 @@ typedef int             GLsizeiptr;
 /* OES_shader_binary */
 #define GL_PLATFORM_BINARY_OES            0x8D63
 
+/* OES_get_program_binary */
+#define GL_PROGRAM_BINARY_LENGTH_OES      0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS_OES 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS_OES     0x87FF
+
 /* OES_texture_3D */
 #define GL_TEXTURE_WRAP_R                 0x8072
 #define GL_TEXTURE_3D                     0x806F
@@ -767,8 +772,13 @@ GL_API void GL_APIENTRY glShaderBinaryOES(GLint n, GLuint *shaders, GLenum binar
 /* OES_shader_source + OES_shader_binary */
 GL_API void GL_APIENTRY glGetShaderPrecisionFormatOES(GLenum shadertype, GLenum precisiontype, GLint *range, GLint *precision);
 
+/* OES_get_program_binary */
+GL_API void GL_APIENTRY glGetProgramBinaryOES (GLuint program, GLsizei bufsize, GLsizei *length, GLenum *binaryformat, void *binary);
+GL_API void GL_APIENTRY glProgramBinaryOES (GLuint program, GLenum binaryformat, const void *binary, GLint length);
+
 /* VIN_shader_intermediate */
 #define GL_SHADER_INTERMEDIATE_LENGTH_VIN		0x8EC0
+#define GL_PROGRAM_BINARY_VIN					0x8EC1
 
 GL_API void GL_APIENTRY glGetShaderIntermediateVIN (GLuint shader, GLsizei bufsize, GLsizei *length, char *intermediate);
 
@@ -0,0 +1,362 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Batched interpreter testing
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+
+#include <GLES/gl.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "frontend/memory.h"
+#include "frontend/il.h"
+#include "frontend/linker.h"
+#include "backend/interp.h"
+#include "backend/optimize.h"
+#include "backend.h"
+#include "utils.h"
+
+
+/** number of varying words provided to test shaders */
+#define VARYING_SIZE	4
+
+/** number of temporary vectors provided to test shaders */
+#define TEMP_SIZE		4
+
+/** linker providing the memory pools for the programs under test */
+static Linker TestLinker;
+
+/** uniform vector u of the test shaders */
+static const Vec4f TestUniform = { { -2.0f, 1.5f, 0.5f, 4.0f } };
+
+/** 
+ * varying vector v for each fragment; the batch cycles through these, such 
+ * that fragments take different branches, exit the loop after a different
+ * number of iterations and some are discarded
+ */
+static const GLfloat TestVarying[][VARYING_SIZE] = {
+	{  1.0f,   0.5f,  0.25f,  1.0f },
+	{ -1.0f,   2.0f, -0.5f,   1.0f },
+	{  0.5f,  -1.0f,  1.0f,  -1.0f },
+	{ -0.25f, -3.0f,  0.75f,  0.5f }
+};
+
+#define NUM_VARYINGS (sizeof(TestVarying) / sizeof(TestVarying[0]))
+
+static int SetupFixture() {
+	GlesMemset(&TestLinker, 0, sizeof TestLinker);
+	
+	TestLinker.resultMemory = GlesMemoryPoolCreate(0, &TestLinker.allocationHandler);
+	TestLinker.workMemory = TestLinker.tempMemory =
+		GlesMemoryPoolCreate(0, &TestLinker.allocationHandler);
+	
+	if (!TestLinker.resultMemory || !TestLinker.tempMemory) {
+		return CUE_SINIT_FAILED;
+	} else {
+		return CUE_SUCCESS;
+	}
+}
+
+static int CleanupFixture() {
+	if (TestLinker.resultMemory) {
+		GlesMemoryPoolDestroy(TestLinker.resultMemory);
+	}
+	
+	if (TestLinker.tempMemory) {
+		GlesMemoryPoolDestroy(TestLinker.tempMemory);
+	}
+	
+	return CUE_SUCCESS;
+}
+
+/**
+ * Parse a fragment shader in the textual form of the intermediate language
+ * and generate interpreter code for it.
+ * 
+ * @param	filename	file containing the program text
+ * @param	binary		receives the generated code
+ * 
+ * @return	GL_FALSE if the program could not be read or translated
+ */
+static GLboolean LoadBinary(const char * filename, ShaderBinary * binary) {
+	char * text = UtilLoadText(filename);
+	ShaderProgram * program = NULL;
+	GLboolean result = GL_FALSE;
+	
+	GlesMemset(binary, 0, sizeof(ShaderBinary));
+	
+	if (!text) {
+		return GL_FALSE;
+	}
+	
+	if (!setjmp(TestLinker.allocationHandler)) {
+		program = GlesParseShaderProgram(text, ~0, TestLinker.resultMemory, 
+										 TestLinker.tempMemory);
+		result = program && 
+			GlesInterpGenerate(&TestLinker, program, binary, GL_FRAGMENT_SHADER);
+	}
+	
+	free(text);
+	return result;
+}
+
+static void FreeBinary(ShaderBinary * binary) {
+	if (binary->code.base) {
+		GlesFree(binary->code.base);
+	}
+	
+	if (binary->batch.base) {
+		GlesFree(binary->batch.base);
+	}
+	
+	if (binary->pre.base) {
+		GlesFree(binary->pre.base);
+	}
+}
+
+/**
+ * Run a fragment shader once per fragment and once for the whole batch,
+ * and compare the results of all fragments that were not discarded.
+ * 
+ * @param	binary	the shader code to execute
+ * @param	mask	the fragments of the batch to process
+ */
+static void CompareBatch(const ShaderBinary * binary, GLuint mask) {
+	static FragContext context;
+	Vec4f temp[TEMP_SIZE], result[GLES_SHADER_BATCH];
+	Vec4f batchTemp[TEMP_SIZE * GLES_SHADER_BATCH];
+	GLfloat batchVarying[VARYING_SIZE * GLES_SHADER_BATCH];
+	GLfloat batchResult[4 * GLES_SHADER_BATCH];
+	GLuint scalarMask = 0, batchMask;
+	GLsizei lane, index;
+	
+	GlesMemset(&context, 0, sizeof context);
+	context.uniform = &TestUniform;
+	context.code = binary->code.base;
+	context.batchCode = binary->batch.base;
+	context.batchTemp = batchTemp;
+	context.batchVarying = batchVarying;
+	context.batchResult = batchResult;
+	
+	GlesMemset(batchTemp, 0, sizeof batchTemp);
+	GlesMemset(result, 0, sizeof result);
+	
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		if (!(mask & (1u << lane))) {
+			continue;
+		}
+		
+		GlesMemset(temp, 0, sizeof temp);
+		context.temp = temp;
+		context.varying = TestVarying[lane % NUM_VARYINGS];
+		context.result = &result[lane];
+		
+		if (GlesInterpFragmentProgram(&context)) {
+			scalarMask |= 1u << lane;
+		}
+		
+		for (index = 0; index < VARYING_SIZE; ++index) {
+			batchVarying[index * GLES_SHADER_BATCH + lane] = 
+				TestVarying[lane % NUM_VARYINGS][index];
+		}
+	}
+	
+	batchMask = GlesInterpFragmentBatch(&context, mask);
+	CU_ASSERT(batchMask == scalarMask);
+	
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		if (!(scalarMask & batchMask & (1u << lane))) {
+			continue;
+		}
+		
+		for (index = 0; index < 4; ++index) {
+			CU_ASSERT(result[lane].v[index] == 
+				batchResult[index * GLES_SHADER_BATCH + lane]);
+		}
+	}
+}
+
+static void BatchedExecution() {
+	ShaderBinary binary;
+	
+	CU_ASSERT_FATAL(LoadBinary("backend/batch.il", &binary));
+	CU_ASSERT_PTR_NOT_NULL(binary.batchEntry);
+	
+	if (binary.batchEntry) {
+		CompareBatch(&binary, (1u << GLES_SHADER_BATCH) - 1);
+		
+		/* fragments outside of the mask are neither shaded nor returned */
+		CompareBatch(&binary, 0xau & ((1u << GLES_SHADER_BATCH) - 1));
+	}
+	
+	FreeBinary(&binary);
+}
+
+static void ScalarExecution() {
+	static FragContext context;
+	Vec4f temp[TEMP_SIZE], result;
+	ShaderBinary binary;
+	
+	CU_ASSERT_FATAL(LoadBinary("backend/batch.il", &binary));
+	
+	GlesMemset(&context, 0, sizeof context);
+	GlesMemset(temp, 0, sizeof temp);
+	context.uniform = &TestUniform;
+	context.code = binary.code.base;
+	context.temp = temp;
+	context.result = &result;
+	
+	/* the first fragment takes the IF branch and leaves the loop after 
+	 * three iterations */
+	context.varying = TestVarying[0];
+	CU_ASSERT(GlesInterpFragmentProgram(&context));
+	CU_ASSERT(result.x == 2.5f);
+	CU_ASSERT(result.y == 0.25f);
+	CU_ASSERT(result.z == -0.875f);
+	CU_ASSERT(result.w == 2.5f);
+	
+	/* the third fragment is discarded */
+	context.varying = TestVarying[2];
+	CU_ASSERT(!GlesInterpFragmentProgram(&context));
+	
+	FreeBinary(&binary);
+}
+
+static void PreShader() {
+	static FragContext context;
+	char * text = UtilLoadText("backend/hoist.il");
+	ShaderProgram * program, * hoisted, * pre;
+	ShaderBinary binary, hoistedBinary;
+	Vec4f temp[TEMP_SIZE], result, hoistedResult;
+	Vec4f image[TEMP_SIZE], data[TEMP_SIZE];
+	GLsizeiptr rows = 0, preTemps = 0;
+	GLsizei index;
+	
+	CU_ASSERT_FATAL(text != NULL);
+	GlesMemset(&binary, 0, sizeof binary);
+	GlesMemset(&hoistedBinary, 0, sizeof hoistedBinary);
+	
+	if (setjmp(TestLinker.allocationHandler)) {
+		CU_FAIL("out of memory");
+		free(text);
+		return;
+	}
+	
+	program = GlesParseShaderProgram(text, ~0, TestLinker.resultMemory, 
+									 TestLinker.tempMemory);
+	hoisted = GlesParseShaderProgram(text, ~0, TestLinker.resultMemory, 
+									 TestLinker.tempMemory);
+	free(text);
+	CU_ASSERT_FATAL(program && hoisted);
+	
+	pre = GlesHoistShaderProgram(&TestLinker, hoisted, 0, &rows);
+	CU_ASSERT_FATAL(pre != NULL);
+	CU_ASSERT_FATAL(rows > 0 && rows <= TEMP_SIZE);
+	GlesAllocateShaderTemps(&TestLinker, pre, &preTemps);
+	
+	CU_ASSERT_FATAL(
+		GlesInterpGenerate(&TestLinker, program, &binary, GL_FRAGMENT_SHADER) &&
+		GlesInterpGenerate(&TestLinker, hoisted, &hoistedBinary, GL_FRAGMENT_SHADER) &&
+		GlesInterpGeneratePre(&TestLinker, pre, &hoistedBinary, GL_FRAGMENT_SHADER));
+	
+	/* the data segment of the binary must not receive the results */
+	for (index = 0; index < TEMP_SIZE; ++index) {
+		image[index].x = image[index].y = image[index].z = image[index].w = 
+			(GLfloat) index + 100.0f;
+	}
+	
+	hoistedBinary.data.base = image;
+	hoistedBinary.data.size = rows;
+	GlesMemset(temp, 0, sizeof temp);
+	GlesMemset(data, 0, sizeof data);
+	
+	GlesInterpPreProgram(&hoistedBinary, &TestUniform, temp, data);
+	
+	for (index = 0; index < TEMP_SIZE; ++index) {
+		CU_ASSERT(image[index].x == (GLfloat) index + 100.0f);
+		CU_ASSERT(image[index].w == (GLfloat) index + 100.0f);
+	}
+	
+	GlesMemset(&context, 0, sizeof context);
+	context.uniform = &TestUniform;
+	context.varying = TestVarying[0];
+	context.temp = temp;
+	
+	GlesMemset(temp, 0, sizeof temp);
+	context.code = binary.code.base;
+	context.result = &result;
+	CU_ASSERT(GlesInterpFragmentProgram(&context));
+	
+	GlesMemset(temp, 0, sizeof temp);
+	context.code = hoistedBinary.code.base;
+	context.constant = data;
+	context.result = &hoistedResult;
+	CU_ASSERT(GlesInterpFragmentProgram(&context));
+	
+	for (index = 0; index < 4; ++index) {
+		CU_ASSERT(result.v[index] == hoistedResult.v[index]);
+	}
+	
+	hoistedBinary.data.base = NULL;
+	FreeBinary(&binary);
+	FreeBinary(&hoistedBinary);
+}
+
+/**
+ * Register all batched interpreter tests
+ */
+GLboolean TestRegisterInterpreter() {
+	CU_pSuite pSuite = CU_add_suite("Interpreter", SetupFixture, CleanupFixture);
+	
+	if (!pSuite) {
+		return GL_FALSE;
+	}
+	
+	if (!CU_add_test(pSuite, "Scalar Execution", 	ScalarExecution) 	||
+		!CU_add_test(pSuite, "Batched Execution", 	BatchedExecution) 	||
+		!CU_add_test(pSuite, "Pre-Shader", 			PreShader)) {
+		return GL_FALSE;
+	}
+	
+	return GL_TRUE;
+}
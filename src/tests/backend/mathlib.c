@@ -0,0 +1,231 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Shader math library testing
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+
+#include <GLES/gl.h>
+#include <math.h>
+#include "CUnit/Basic.h"
+#include "config.h"
+#include "platform/platform.h"
+#include "frontend/types.h"
+#include "backend/mathlib.h"
+#include "backend.h"
+
+
+/** number of sample points per function and precision tier */
+#define NUM_SAMPLES 20000
+
+/**
+ * Maximum error permitted for each precision tier, indexed by Precision;
+ * absolute for sin, cos and log2, relative for exp2 and pow
+ */
+static const double Tolerance[] = {
+	2.0e-6,			/* PrecisionUndefined	*/
+	3.0e-3,			/* PrecisionLow			*/
+	2.0e-4,			/* PrecisionMedium		*/
+	2.0e-6			/* PrecisionHigh		*/
+};
+
+/**
+ * Fill a batch with equally spaced samples starting at a given sample
+ * index.
+ */
+static void Samples(GLfloat * value, GLsizei start, double lo, double hi) {
+	GLsizei lane;
+
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		value[lane] = (GLfloat) (lo + (hi - lo) * (start + lane) / NUM_SAMPLES);
+	}
+}
+
+static void PrecisionTiers() {
+	GLfloat value[GLES_SHADER_BATCH], exponent[GLES_SHADER_BATCH];
+	GLfloat result[GLES_SHADER_BATCH];
+	GLsizei lane, index;
+	Precision prec;
+
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		exponent[lane] = 2.5f;
+	}
+
+	for (prec = PrecisionUndefined; prec <= PrecisionHigh; ++prec) {
+		double tolerance = Tolerance[prec];
+		double sinError = 0, cosError = 0, expError = 0, logError = 0;
+		double powError = 0;
+
+		for (index = 0; index < NUM_SAMPLES; index += GLES_SHADER_BATCH) {
+			Samples(value, index, -100.0, 100.0);
+			GlesMathSin(result, value, prec);
+
+			for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+				sinError = fmax(sinError, fabs(result[lane] - sin(value[lane])));
+			}
+
+			GlesMathCos(result, value, prec);
+
+			for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+				cosError = fmax(cosError, fabs(result[lane] - cos(value[lane])));
+			}
+
+			Samples(value, index, -60.0, 60.0);
+			GlesMathExp2(result, value, prec);
+
+			for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+				double expected = exp2(value[lane]);
+				expError = fmax(expError, fabs(result[lane] - expected) / expected);
+			}
+
+			Samples(value, index, -40.0, 40.0);
+
+			for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+				value[lane] = expf(value[lane]);
+			}
+
+			GlesMathLog2(result, value, prec);
+
+			for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+				logError = fmax(logError, fabs(result[lane] - log2(value[lane])));
+			}
+
+			Samples(value, index, 0.01, 10.01);
+			GlesMathPow(result, value, exponent, prec);
+
+			for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+				double expected = pow(value[lane], 2.5);
+				powError = fmax(powError, fabs(result[lane] - expected) / expected);
+			}
+		}
+
+		CU_ASSERT(sinError <= tolerance);
+		CU_ASSERT(cosError <= tolerance);
+		CU_ASSERT(expError <= tolerance);
+		CU_ASSERT(logError <= tolerance);
+		CU_ASSERT(powError <= tolerance);
+
+		CU_ASSERT(fabs(GlesMathSinf(1.0f, prec) - sin(1.0)) <= tolerance);
+		CU_ASSERT(fabs(GlesMathCosf(1.0f, prec) - cos(1.0)) <= tolerance);
+		CU_ASSERT(fabs(GlesMathExp2f(0.3f, prec) - exp2(0.3f)) <= 
+			tolerance * exp2(0.3f));
+		CU_ASSERT(fabs(GlesMathLog2f(3.0f, prec) - log2(3.0)) <= tolerance);
+		CU_ASSERT(fabs(GlesMathRsqf(2.0f, prec) - 1.0 / sqrt(2.0)) <= 
+			4.0e-4 / sqrt(2.0));
+	}
+}
+
+static void LargeAngles() {
+	static const GLfloat angles[] = {
+		1.0e4f, -1.0e6f, 1.0e7f, 16777216.0f, 1.0e9f, 4.0e9f
+	};
+
+	GLsizei index;
+	Precision prec;
+
+	for (prec = PrecisionLow; prec <= PrecisionHigh; ++prec) {
+		double tolerance = Tolerance[prec];
+
+		for (index = 0; index < (GLsizei) (sizeof(angles) / sizeof(angles[0])); ++index) {
+			GLfloat angle = angles[index];
+			
+			CU_ASSERT(fabs(GlesMathSinf(angle, prec) - sin(angle)) <= tolerance);
+			CU_ASSERT(fabs(GlesMathCosf(angle, prec) - cos(angle)) <= tolerance);
+		}
+
+		/* beyond 2^32 the results stay bounded */
+		CU_ASSERT(GlesMathSinf(1.0e10f, prec) == 0.0f);
+		CU_ASSERT(GlesMathCosf(-1.0e20f, prec) == 1.0f);
+		CU_ASSERT(isnan(GlesMathSinf(HUGE_VALF, prec)));
+		CU_ASSERT(isnan(GlesMathCosf(-HUGE_VALF, prec)));
+		CU_ASSERT(isnan(GlesMathSinf(NAN, prec)));
+	}
+}
+
+static void Exp2Limits() {
+	Precision prec;
+
+	for (prec = PrecisionLow; prec <= PrecisionHigh; ++prec) {
+		CU_ASSERT(GlesMathExp2f(128.0f, prec) == HUGE_VALF);
+		CU_ASSERT(GlesMathExp2f(HUGE_VALF, prec) == HUGE_VALF);
+		CU_ASSERT(GlesMathExp2f(-200.0f, prec) == 0.0f);
+		CU_ASSERT(GlesMathExp2f(-HUGE_VALF, prec) == 0.0f);
+		CU_ASSERT(isnan(GlesMathExp2f(NAN, prec)));
+		CU_ASSERT(fabs(GlesMathExp2f(127.5f, prec) - exp2(127.5)) <= 
+			Tolerance[prec] * exp2(127.5));
+	}
+}
+
+static void Log2SpecialValues() {
+	Precision prec;
+
+	for (prec = PrecisionLow; prec <= PrecisionHigh; ++prec) {
+		CU_ASSERT(GlesMathLog2f(0.0f, prec) == -HUGE_VALF);
+		CU_ASSERT(GlesMathLog2f(-0.0f, prec) == -HUGE_VALF);
+		CU_ASSERT(GlesMathLog2f(HUGE_VALF, prec) == HUGE_VALF);
+		CU_ASSERT(isnan(GlesMathLog2f(-1.0f, prec)));
+		CU_ASSERT(isnan(GlesMathLog2f(NAN, prec)));
+
+		/* denormals; the result itself is only exact to a float ulp */
+		CU_ASSERT(fabs(GlesMathLog2f(1.0e-40f, prec) - log2(1.0e-40f)) <= 
+			Tolerance[prec] + 133.0 * FLT_EPSILON);
+		CU_ASSERT(fabs(GlesMathLog2f(1.4e-45f, prec) + 149.0) <= 
+			Tolerance[prec]);
+	}
+}
+
+/**
+ * Register all math library tests
+ */
+GLboolean TestRegisterMathlib() {
+	CU_pSuite pSuite = CU_add_suite("Math Library", NULL, NULL);
+	
+	if (!pSuite) {
+		return GL_FALSE;
+	}
+	
+	if (!CU_add_test(pSuite, "Precision Tiers",		PrecisionTiers)		||
+		!CU_add_test(pSuite, "Large Angles",		LargeAngles)		||
+		!CU_add_test(pSuite, "Exp2 Limits",			Exp2Limits)			||
+		!CU_add_test(pSuite, "Log2 Special Values",	Log2SpecialValues)) {
+		return GL_FALSE;
+	}
+	
+	return GL_TRUE;
+}
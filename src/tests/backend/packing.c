@@ -0,0 +1,117 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Fragment color packing testing
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+
+#include <GLES/gl.h>
+#include <math.h>
+#include "CUnit/Basic.h"
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "backend.h"
+
+
+/** 
+ * color values for each fragment; the batch cycles through these, which
+ * cover values inside [0, 1], values just outside and values that do not
+ * fit into an integer after scaling
+ */
+static const GLfloat TestColors[][4] = {
+	{ 0.0f,			0.5f,			1.0f,			1.0f / 255.0f	},
+	{ -0.001f,		1.001f,			0.999f,			0.25f			},
+	{ 2.0f,			-3.0f,			1.0e9f,			-1.0e9f			},
+	{ HUGE_VALF,	-HUGE_VALF,		0.75f,			0.3f			}
+};
+
+#define NUM_COLORS (sizeof(TestColors) / sizeof(TestColors[0]))
+
+/**
+ * Reference conversion of a single color component
+ */
+static GLubyte ColorValue(GLfloat value) {
+	if (value <= 0.0f) {
+		return 0;
+	} else if (value >= 1.0f) {
+		return GLES_UBYTE_MAX;
+	} else {
+		return (GLubyte) (GLES_UBYTE_MAX * value);
+	}
+}
+
+static void PackColors() {
+	GLfloat color[4 * GLES_SHADER_BATCH];
+	Colorub result[GLES_SHADER_BATCH];
+	GLsizei lane, index;
+	
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		for (index = 0; index < 4; ++index) {
+			color[index * GLES_SHADER_BATCH + lane] = 
+				TestColors[lane % NUM_COLORS][index];
+		}
+	}
+	
+	GlesPackColors(result, color);
+	
+	for (lane = 0; lane < GLES_SHADER_BATCH; ++lane) {
+		for (index = 0; index < 4; ++index) {
+			CU_ASSERT(result[lane].rgba[index] == 
+				ColorValue(TestColors[lane % NUM_COLORS][index]));
+		}
+	}
+}
+
+/**
+ * Register all color packing tests
+ */
+GLboolean TestRegisterPacking() {
+	CU_pSuite pSuite = CU_add_suite("Color Packing", NULL, NULL);
+	
+	if (!pSuite) {
+		return GL_FALSE;
+	}
+	
+	if (!CU_add_test(pSuite, "Pack Colors", PackColors)) {
+		return GL_FALSE;
+	}
+	
+	return GL_TRUE;
+}
@@ -0,0 +1,25 @@
+#define TWO 2
+#if TWO == 1
+skipped
+#elif TWO == 2
+first
+#elif TWO > 1
+skipped
+#else
+skipped
+#endif
+#ifndef TWO
+skipped
+#elif defined(TWO)
+second
+#elif 1
+skipped
+#endif
+#if 0
+skipped
+#elif 0
+skipped
+#else
+third
+#endif
+__LINE__
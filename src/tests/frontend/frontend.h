@@ -44,5 +44,7 @@
 */
 
 GLboolean TestRegisterFrontend();
+GLboolean TestRegisterIntermediate();
+GLboolean TestRegisterPreprocessor();
 
 #endif /*TESTS_FRONTEND_H*/
@@ -0,0 +1,417 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Intermediate language and optimizer testing
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+
+#include <GLES/gl.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "frontend/memory.h"
+#include "frontend/il.h"
+#include "frontend/linker.h"
+#include "backend/optimize.h"
+#include "frontend.h"
+#include "utils.h"
+
+
+/** linker providing the memory pools for the programs under test */
+static Linker TestLinker;
+
+static int SetupFixture() {
+	GlesMemset(&TestLinker, 0, sizeof TestLinker);
+	
+	TestLinker.resultMemory = GlesMemoryPoolCreate(0, &TestLinker.allocationHandler);
+	TestLinker.workMemory = TestLinker.tempMemory =
+		GlesMemoryPoolCreate(0, &TestLinker.allocationHandler);
+	
+	if (!TestLinker.resultMemory || !TestLinker.tempMemory) {
+		return CUE_SINIT_FAILED;
+	} else {
+		return CUE_SUCCESS;
+	}
+}
+
+static int CleanupFixture() {
+	if (TestLinker.resultMemory) {
+		GlesMemoryPoolDestroy(TestLinker.resultMemory);
+	}
+	
+	if (TestLinker.tempMemory) {
+		GlesMemoryPoolDestroy(TestLinker.tempMemory);
+	}
+	
+	return CUE_SUCCESS;
+}
+
+/**
+ * Parse a shader program in the textual form of the intermediate language.
+ * 
+ * @param	filename	file containing the program text
+ * 
+ * @return	the program, or NULL if it could not be read or parsed
+ */
+static ShaderProgram * LoadProgram(const char * filename) {
+	char * text = UtilLoadText(filename);
+	ShaderProgram * program = NULL;
+	
+	if (!text) {
+		return NULL;
+	}
+	
+	if (!setjmp(TestLinker.allocationHandler)) {
+		program = GlesParseShaderProgram(text, ~0, TestLinker.resultMemory, 
+										 TestLinker.tempMemory);
+	}
+	
+	free(text);
+	return program;
+}
+
+/**
+ * Apply a set of optimization passes to a program.
+ * 
+ * @param	program	the program to optimize
+ * @param	passes	set of OptimizePass values to apply
+ * 
+ * @return	GL_FALSE if the optimizer ran out of memory
+ */
+static GLboolean Optimize(ShaderProgram * program, GLbitfield passes) {
+	if (setjmp(TestLinker.allocationHandler)) {
+		return GL_FALSE;
+	}
+	
+	GlesOptimizeShaderProgram(&TestLinker, program, passes);
+	return GL_TRUE;
+}
+
+/**
+ * Assign storage locations to the temporaries of a program.
+ * 
+ * @param	program	the program whose temporaries are allocated
+ * @param	rows	out: number of vec4 rows of temporary storage
+ * 
+ * @return	GL_FALSE if the allocation failed
+ */
+static GLboolean AllocateTemps(ShaderProgram * program, GLsizeiptr * rows) {
+	if (setjmp(TestLinker.allocationHandler)) {
+		return GL_FALSE;
+	}
+	
+	return GlesAllocateShaderTemps(&TestLinker, program, rows);
+}
+
+/**
+ * Create the binary image of a program and load it again.
+ * 
+ * @param	program		the program to copy
+ * @param	truncate	number of bytes to cut off the end of the image
+ * 
+ * @return	the program loaded from the image, or NULL if it was rejected
+ */
+static ShaderProgram * CopyProgram(const ShaderProgram * program, 
+								   GLsizeiptr truncate) {
+	ShaderProgram * result;
+	GLsizeiptr size;
+	void * image;
+	
+	if (setjmp(TestLinker.allocationHandler)) {
+		return NULL;
+	}
+	
+	image = GlesSaveShaderProgram(program, TestLinker.tempMemory, &size);
+	
+	if (!image) {
+		return NULL;
+	}
+	
+	result = GlesLoadShaderProgram(image, size - truncate, TestLinker.resultMemory);
+	
+	/* nothing of the copy may refer to the image */
+	GlesMemset(image, 0xcd, size);
+	GlesFree(image);
+	
+	return result;
+}
+
+/**
+ * Create the textual form of a program.
+ * 
+ * @param	program	the program to write
+ * 
+ * @return	the program text, which needs to be released using free
+ */
+static char * WriteProgram(const ShaderProgram * program) {
+	char * text;
+	Log log;
+	
+	GlesLogInit(&log);
+	GlesWriteShaderProgram(&log, program);
+	text = calloc(log.logSize + 1, 1);
+	
+	if (text) {
+		GlesLogExtract(&log, log.logSize + 1, text, NULL);
+	}
+	
+	GlesLogDeInit(&log);
+	return text;
+}
+
+/**
+ * Count the instructions of a program.
+ * 
+ * @param	program	the program to inspect
+ * 
+ * @return	the number of instructions
+ */
+static GLsizei CountInsts(const ShaderProgram * program) {
+	GLsizei count = 0;
+	Block * block;
+	Inst * inst;
+	
+	for (block = program->blocks.head; block; block = block->next) {
+		for (inst = block->first; inst; inst = inst->base.next) {
+			++count;
+		}
+	}
+	
+	return count;
+}
+
+/**
+ * Count the instructions of a program that use a given opcode.
+ * 
+ * @param	program	the program to inspect
+ * @param	op		the opcode to look for
+ * 
+ * @return	the number of matching instructions
+ */
+static GLsizei CountOps(const ShaderProgram * program, Opcode op) {
+	GLsizei count = 0;
+	Block * block;
+	Inst * inst;
+	
+	for (block = program->blocks.head; block; block = block->next) {
+		for (inst = block->first; inst; inst = inst->base.next) {
+			count += (inst->base.op == op);
+		}
+	}
+	
+	return count;
+}
+
+/**
+ * Count the distinct storage locations assigned to the temporaries of a
+ * program.
+ * 
+ * @param	program	the program to inspect
+ * 
+ * @return	the number of locations in use
+ */
+static GLsizei CountTempLocations(const ShaderProgram * program) {
+	GLsizei count = 0;
+	const ProgVar * var, * other;
+	
+	for (var = program->temp; var; var = var->base.next) {
+		for (other = program->temp; other != var; other = other->base.next) {
+			if (other->base.location == var->base.location) {
+				break;
+			}
+		}
+		
+		count += (other == var);
+	}
+	
+	return count;
+}
+
+static void DeadCode() {
+	ShaderProgram * program = LoadProgram("frontend/optimize.il");
+	
+	CU_ASSERT_PTR_NOT_NULL_FATAL(program);
+	CU_ASSERT_FATAL(Optimize(program, OptimizeDeadCode));
+	
+	/* the unused sum is gone, the copy is still read */
+	CU_ASSERT(CountInsts(program) == 4);
+	CU_ASSERT(CountOps(program, OpcodeADD) == 1);
+	CU_ASSERT(CountOps(program, OpcodeMOV) == 1);
+}
+
+static void CopyPropagation() {
+	ShaderProgram * program = LoadProgram("frontend/optimize.il");
+	
+	CU_ASSERT_PTR_NOT_NULL_FATAL(program);
+	CU_ASSERT_FATAL(Optimize(program, OptimizeCopies));
+	
+	/* reading the original makes the copy dead, but it is only removed
+	 * once dead code elimination is enabled as well */
+	CU_ASSERT(CountInsts(program) == 5);
+	CU_ASSERT_FATAL(Optimize(program, OptimizeCopies | OptimizeDeadCode));
+	CU_ASSERT(CountInsts(program) == 3);
+	CU_ASSERT(CountOps(program, OpcodeMOV) == 0);
+}
+
+static void ConstantPropagation() {
+	ShaderProgram * program = LoadProgram("frontend/constants.il");
+	
+	CU_ASSERT_PTR_NOT_NULL_FATAL(program);
+	CU_ASSERT_FATAL(Optimize(program, OptimizeConstants | OptimizeDeadCode));
+	
+	/* the sum is folded, and the branch reading the input is never taken */
+	CU_ASSERT(CountOps(program, OpcodeADD) == 0);
+	CU_ASSERT(CountOps(program, OpcodeSCC) == 0);
+	CU_ASSERT(CountOps(program, OpcodeMOV) == 0);
+	CU_ASSERT(CountOps(program, OpcodeMUL) == 1);
+}
+
+static void TempSharing() {
+	ShaderProgram * program = LoadProgram("frontend/temps.il");
+	GLsizeiptr rows = 0;
+	
+	CU_ASSERT_PTR_NOT_NULL_FATAL(program);
+	CU_ASSERT_FATAL(AllocateTemps(program, &rows));
+	
+	/* the first and the last value do not overlap */
+	CU_ASSERT(rows == 2);
+	CU_ASSERT(CountTempLocations(program) == 2);
+}
+
+static void TempSharingLoop() {
+	ShaderProgram * program = LoadProgram("frontend/loop.il");
+	GLsizeiptr rows = 0;
+	
+	CU_ASSERT_PTR_NOT_NULL_FATAL(program);
+	CU_ASSERT_FATAL(AllocateTemps(program, &rows));
+	
+	/* the value read in the loop is live across its back edge */
+	CU_ASSERT(rows == 3);
+	CU_ASSERT(CountTempLocations(program) == 3);
+}
+
+static void ImageRoundTrip() {
+	ShaderProgram * program = LoadProgram("frontend/constants.il");
+	ShaderProgram * copy;
+	char * text, * copyText;
+	
+	CU_ASSERT_PTR_NOT_NULL_FATAL(program);
+	copy = CopyProgram(program, 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(copy);
+	
+	text = WriteProgram(program);
+	copyText = WriteProgram(copy);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(text);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(copyText);
+	CU_ASSERT(strcmp(text, copyText) == 0);
+	free(text);
+	free(copyText);
+	
+	/* the copy is optimized like the original */
+	CU_ASSERT_FATAL(Optimize(program, OptimizeAll));
+	CU_ASSERT_FATAL(Optimize(copy, OptimizeAll));
+	
+	text = WriteProgram(program);
+	copyText = WriteProgram(copy);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(text);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(copyText);
+	CU_ASSERT(strcmp(text, copyText) == 0);
+	free(text);
+	free(copyText);
+}
+
+static void TruncatedImage() {
+	ShaderProgram * program = LoadProgram("frontend/constants.il");
+	
+	CU_ASSERT_PTR_NOT_NULL_FATAL(program);
+	CU_ASSERT(CopyProgram(program, sizeof(GLsizeiptr)) == NULL);
+}
+
+static void Inlining() {
+	ShaderProgram * program = LoadProgram("frontend/inline.il");
+	
+	CU_ASSERT_PTR_NOT_NULL_FATAL(program);
+	CU_ASSERT_FATAL(Optimize(program, OptimizeInline));
+	
+	/* both calls are replaced, and the subroutine is dropped */
+	CU_ASSERT(CountOps(program, OpcodeCAL) == 0);
+	CU_ASSERT(CountOps(program, OpcodeMUL) == 2);
+	CU_ASSERT(CountOps(program, OpcodeRET) == 1);
+}
+
+static void Unrolling() {
+	ShaderProgram * program = LoadProgram("frontend/unroll.il");
+	
+	CU_ASSERT_PTR_NOT_NULL_FATAL(program);
+	CU_ASSERT_FATAL(Optimize(program, OptimizeUnroll));
+	
+	/* one copy of the body for each of the three iterations, while the
+	 * loop depending on the input is kept */
+	CU_ASSERT(CountOps(program, OpcodeREP) == 1);
+	CU_ASSERT(CountOps(program, OpcodeENDREP) == 1);
+	CU_ASSERT(CountOps(program, OpcodeADD) == 4);
+}
+
+/**
+ * Register all intermediate language tests
+ */
+GLboolean TestRegisterIntermediate() {
+	CU_pSuite pSuite = CU_add_suite("Intermediate Language", SetupFixture, CleanupFixture);
+	
+	if (!pSuite) {
+		return GL_FALSE;
+	}
+	
+	if (!CU_add_test(pSuite, "Dead Code",				DeadCode)				||
+		!CU_add_test(pSuite, "Copy Propagation",		CopyPropagation)		||
+		!CU_add_test(pSuite, "Constant Propagation",	ConstantPropagation)	||
+		!CU_add_test(pSuite, "Temporary Sharing",		TempSharing)			||
+		!CU_add_test(pSuite, "Temporaries in Loops",	TempSharingLoop)		||
+		!CU_add_test(pSuite, "Image Round Trip",		ImageRoundTrip)			||
+		!CU_add_test(pSuite, "Truncated Image",			TruncatedImage)			||
+		!CU_add_test(pSuite, "Inlining",				Inlining)				||
+		!CU_add_test(pSuite, "Unrolling",				Unrolling)) {
+		return GL_FALSE;
+	}
+	
+	return GL_TRUE;
+}
@@ -0,0 +1,173 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Preprocessor testing
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+
+#include <GLES/gl.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Basic.h"
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "frontend/compiler.h"
+#include "frontend/memory.h"
+#include "frontend/symbols.h"
+#include "frontend/tokenizer.h"
+#include "frontend.h"
+#include "utils.h"
+
+
+/**
+ * Run the preprocessor over a source file and collect the tokens passed
+ * on to the parser. Identifiers and integer constants are written out,
+ * separated by single spaces; other tokens are not expected in the test
+ * sources.
+ * 
+ * @param	filename	file containing the shader source
+ * 
+ * @return	the token text, which needs to be released using free, or NULL
+ * 			if the source could not be read or preprocessing failed
+ */
+static char * Preprocess(const char * filename) {
+	char * text = UtilLoadText(filename);
+	Compiler * compiler = GlesCompilerCreate(NULL);
+	MemoryPool * pool = NULL;
+	char * result = NULL;
+	Tokenizer * tokenizer;
+	Shader shader;
+	Log tokens;
+	
+	GlesMemset(&shader, 0, sizeof shader);
+	GlesLogInit(&tokens);
+	
+	if (!text || !compiler) {
+		goto cleanup;
+	}
+	
+	if (setjmp(compiler->allocationHandler)) {
+		goto cleanup;
+	}
+	
+	pool = GlesMemoryPoolCreate(0, &compiler->allocationHandler);
+	shader.type = GL_VERTEX_SHADER;
+	shader.text = text;
+	shader.length = strlen(text);
+	GlesLogInit(&shader.log);
+	
+	tokenizer = compiler->tokenizer;
+	compiler->shader = &shader;
+	compiler->names = GlesNameTableCreate(pool, NULL);
+	GlesPrepareTokenizer(tokenizer, &shader, pool, 0, NULL);
+	
+	while (tokenizer->token.tokenType == TokenTypeIdentifier ||
+		   tokenizer->token.tokenType == TokenTypeIntConstant) {
+		if (tokens.logSize) {
+			GlesLogAppend(&tokens, " ", 1);
+		}
+		
+		GlesLogAppend(&tokens, tokenizer->token.s.first, 
+					  tokenizer->token.s.length);
+		
+		if (!GlesNextToken(tokenizer)) {
+			break;
+		}
+	}
+	
+	if (tokenizer->token.tokenType == TokenTypeEof && !shader.log.logSize) {
+		result = calloc(tokens.logSize + 1, 1);
+		
+		if (result) {
+			GlesLogExtract(&tokens, tokens.logSize + 1, result, NULL);
+		}
+	}
+	
+	GlesCleanupTokenizer(tokenizer);
+	compiler->shader = NULL;
+	compiler->names = NULL;
+	
+cleanup:
+	if (pool)		GlesMemoryPoolDestroy(pool);
+	if (compiler)	GlesCompilerDestroy(compiler);
+	if (text) 		free(text);
+	
+	GlesLogDeInit(&shader.log);
+	GlesLogDeInit(&tokens);
+	
+	return result;
+}
+
+static void SkipGroups() {
+	char * tokens = Preprocess("frontend/skip_groups.vert");
+	
+	/* nested and commented directives do not end a skipped group, and the
+	 * line count includes the skipped lines */
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tokens);
+	CU_ASSERT_STRING_EQUAL(tokens, "first second 23");
+	free(tokens);
+}
+
+static void ElifChain() {
+	char * tokens = Preprocess("frontend/elif_chain.vert");
+	
+	/* only the first true branch of each conditional is included */
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tokens);
+	CU_ASSERT_STRING_EQUAL(tokens, "first second third 25");
+	free(tokens);
+}
+
+/**
+ * Register all preprocessor tests
+ */
+GLboolean TestRegisterPreprocessor() {
+	CU_pSuite pSuite = CU_add_suite("Preprocessor", NULL, NULL);
+	
+	if (!pSuite) {
+		return GL_FALSE;
+	}
+	
+	if (!CU_add_test(pSuite, "Skipped Groups",			SkipGroups)			||
+		!CU_add_test(pSuite, "Elif Chain",				ElifChain)) {
+		return GL_FALSE;
+	}
+	
+	return GL_TRUE;
+}
@@ -0,0 +1,23 @@
+#define ONE 1
+#if 0
+#if garbage (((
+	' characters that are no tokens @
+#else
+	skipped
+#endif
+/* #endif within a comment
+#else
+*/	skipped // #endif
+#endif
+/*
+#if 0
+*/
+first
+#ifdef ONE
+	#if 0
+	skipped
+	#else
+	second
+	#endif
+#endif
+__LINE__
@@ -0,0 +1,566 @@
+/*
+** ==========================================================================
+**
+** $Id$
+**
+** Rendering pipeline testing
+**
+** --------------------------------------------------------------------------
+**
+** $Author$
+** $Date$
+**
+** --------------------------------------------------------------------------
+**
+** Vincent 3D Rendering Library, Programmable Pipeline Edition
+**
+** Copyright (C) 2003-2007 Hans-Martin Will.
+**
+** @CDDL_HEADER_START@
+**
+** The contents of this file are subject to the terms of the
+** Common Development and Distribution License, Version 1.0 only
+** (the "License").  You may not use this file except in compliance
+** with the License.
+**
+** You can obtain a copy of the license at
+** http://www.vincent3d.com/software/ogles2/license/license.html
+** See the License for the specific language governing permissions
+** and limitations under the License.
+**
+** When distributing Covered Code, include this CDDL_HEADER in each
+** file and include the License file named LICENSE.TXT in the root folder
+** of your distribution.
+** If applicable, add the following below this CDDL_HEADER, with the
+** fields enclosed by brackets "[]" replaced with your own identifying
+** information: Portions Copyright [yyyy] [name of copyright owner]
+**
+** @CDDL_HEADER_END@
+**
+** ==========================================================================
+*/
+
+
+#include <GLES/gl.h>
+#include <vin.h>
+#include <stdlib.h>
+#include "CUnit/Basic.h"
+#include "config.h"
+#include "platform/platform.h"
+#include "gl/state.h"
+#include "frontend/memory.h"
+#include "frontend/il.h"
+#include "frontend/linker.h"
+#include "backend/interp.h"
+#include "backend/optimize.h"
+#include "render.h"
+#include "utils.h"
+
+
+#define SURFACE_WIDTH	64
+#define SURFACE_HEIGHT	64
+
+/** number of temporary vectors provided to test shaders */
+#define TEMP_SIZE		16
+
+static void SurfaceNop(struct Surface * surface) {
+	(void) surface;
+}
+
+static const SurfaceVtbl TestSurfaceVtbl = {
+	&SurfaceNop,
+	&SurfaceNop,
+	&SurfaceNop,
+	&SurfaceNop
+};
+
+/** in-memory surface that the tests of this suite render into */
+static Surface * TestSurface;
+
+/**
+ * Create an in-memory RGBA8 surface with 16-bit depth and 8-bit stencil 
+ * buffer.
+ * 
+ * @param	width	the width of the surface in pixels
+ * @param	height	the height of the surface in pixels
+ * 
+ * @return	the new surface, or NULL if out of memory
+ */
+static Surface * CreateSurface(GLsizei width, GLsizei height) {
+	Surface * surface = calloc(1, sizeof(Surface));
+	
+	if (!surface) {
+		return NULL;
+	}
+	
+	surface->vtbl = &TestSurfaceVtbl;
+	surface->colorBuffer = malloc(width * height * sizeof(GLuint));
+	surface->depthBuffer = malloc(width * height * sizeof(GLushort));
+	surface->stencilBuffer = malloc(width * height);
+	surface->size.width = surface->viewport.width = width;
+	surface->size.height = surface->viewport.height = height;
+	surface->colorPitch = width * sizeof(GLuint);
+	surface->depthPitch = width * sizeof(GLushort);
+	surface->stencilPitch = width;
+	surface->colorFormat = GL_RGBA8;
+	surface->colorReadFormat = GL_RGBA;
+	surface->colorReadType = GL_UNSIGNED_BYTE;
+	surface->depthFormat = GL_DEPTH_COMPONENT16;
+	surface->stencilFormat = GL_STENCIL_INDEX8_OES;
+	surface->redBits = surface->greenBits = surface->blueBits = surface->alphaBits = 8;
+	surface->depthBits = 16;
+	surface->stencilBits = 8;
+	
+	if (!surface->colorBuffer || !surface->depthBuffer || !surface->stencilBuffer) {
+		free(surface->colorBuffer);
+		free(surface->depthBuffer);
+		free(surface->stencilBuffer);
+		free(surface);
+		return NULL;
+	}
+	
+	return surface;
+}
+
+static void DestroySurface(Surface * surface) {
+	free(surface->colorBuffer);
+	free(surface->depthBuffer);
+	free(surface->stencilBuffer);
+	free(surface);
+}
+
+static int SetupFixture() {
+	if (!vinInitialize()) {
+		return CUE_SINIT_FAILED;
+	}
+	
+	TestSurface = CreateSurface(SURFACE_WIDTH, SURFACE_HEIGHT);
+	
+	if (!TestSurface) {
+		vinTerminate();
+		return CUE_SINIT_FAILED;
+	}
+	
+	vinMakeCurrent((VinSurface) TestSurface, (VinSurface) TestSurface);
+	
+	return CUE_SUCCESS;
+}
+
+static int CleanupFixture() {
+	vinMakeCurrent(NULL, NULL);
+	DestroySurface(TestSurface);
+	TestSurface = NULL;
+	
+	if (!vinTerminate()) {
+		return CUE_SCLEAN_FAILED;
+	} else {
+		return CUE_SUCCESS;
+	}
+}
+
+/**
+ * Create a program object from the intermediate code of a vertex and a 
+ * fragment shader. The shaders are linked by hand and passed to the library
+ * as program binary: attributes are addressed by location, and a single
+ * sampler uniform is bound to location 0 and texture unit 0.
+ * 
+ * @param	vertexFile		file containing the vertex shader IL
+ * @param	fragmentFile	file containing the fragment shader IL
+ * 
+ * @return	the new program object, which is also made current, or 0
+ */
+static GLuint LoadProgram(const char * vertexFile, const char * fragmentFile) {
+	static char samplerName[] = "s_texture";
+	static ShaderVariable sampler = { samplerName, sizeof(samplerName) - 1, 0, 1, GL_SAMPLER_2D };
+	char * vertexText = UtilLoadText(vertexFile);
+	char * fragmentText = UtilLoadText(fragmentFile);
+	MemoryPool * pool = NULL, * temp = NULL;
+	ShaderProgram * vertex, * fragment;
+	Executable * executable = NULL;
+	void * image = NULL;
+	GLsizeiptr size;
+	GLuint program = 0;
+	Linker linker;
+	
+	GlesMemset(&linker, 0, sizeof linker);
+	
+	if (!vertexText || !fragmentText) {
+		goto cleanup;
+	}
+	
+	if (setjmp(linker.allocationHandler)) {
+		goto cleanup;
+	}
+	
+	pool = GlesMemoryPoolCreate(0, &linker.allocationHandler);
+	temp = GlesMemoryPoolCreate(0, &linker.allocationHandler);
+	linker.resultMemory = pool;
+	linker.workMemory = linker.tempMemory = temp;
+	
+	vertex = GlesParseShaderProgram(vertexText, ~0, pool, temp);
+	fragment = GlesParseShaderProgram(fragmentText, ~0, pool, temp);
+	executable = GlesMalloc(sizeof(Executable));
+	
+	if (!vertex || !fragment || !executable) {
+		goto cleanup;
+	}
+	
+	GlesMemset(executable, 0, sizeof(Executable));
+	executable->numUniforms = 1;
+	executable->uniforms = GlesMalloc(sizeof(ShaderVariable));
+	executable->sizeUniforms = 1;
+	executable->numVarying = GLES_MAX_VARYING_FLOATS;
+	executable->earlyTests = GL_TRUE;
+	executable->varyingMask = GlesShaderInputMask(fragment, ProgVarSegVarying, 0);
+	executable->specialMask = 
+		GlesShaderInputMask(fragment, ProgVarSegSpecial, 
+							GLES_OFFSETOF(FragContext, fragCoord) / sizeof(GLfloat));
+	executable->vertex.bssSize = executable->fragment.bssSize = TEMP_SIZE;
+	
+	if (!executable->uniforms ||
+		!GlesInterpGenerate(&linker, vertex, &executable->vertex, GL_VERTEX_SHADER) ||
+		!GlesInterpGenerate(&linker, fragment, &executable->fragment, GL_FRAGMENT_SHADER)) {
+		goto cleanup;
+	}
+	
+	executable->uniforms[0] = sampler;
+	size = GlesExecutableImageSize(executable);
+	image = GlesMalloc(size);
+	
+	if (!image) {
+		goto cleanup;
+	}
+	
+	GlesSaveExecutable(executable, image);
+	program = glCreateProgram();
+	glProgramBinaryOES(program, GL_PROGRAM_BINARY_VIN, image, size);
+	glUseProgram(program);
+	glUniform1i(0, 0);
+	
+cleanup:
+	if (image) 			GlesFree(image);
+	if (executable) 	GlesDeleteExecutable(NULL, executable);
+	if (temp) 			GlesMemoryPoolDestroy(temp);
+	if (pool) 			GlesMemoryPoolDestroy(pool);
+	if (vertexText) 	free(vertexText);
+	if (fragmentText) 	free(fragmentText);
+	
+	return program;
+}
+
+/**
+ * Count the pixels of the test surface that have been written to since the
+ * last call to ClearSurface().
+ */
+static GLsizei CountPixels(void) {
+	const GLuint * color = (const GLuint *) TestSurface->colorBuffer;
+	GLsizei index, count = 0;
+	
+	for (index = 0; index < TestSurface->size.width * TestSurface->size.height; ++index) {
+		count += color[index] != 0;
+	}
+	
+	return count;
+}
+
+static void ClearSurface(void) {
+	GLsizei pixels = TestSurface->size.width * TestSurface->size.height;
+	
+	GlesMemset(TestSurface->colorBuffer, 0, pixels * sizeof(GLuint));
+	GlesMemset(TestSurface->depthBuffer, 0xff, pixels * sizeof(GLushort));
+}
+
+static void ClipFarPlane() {
+	/* the far plane cuts off the upper half of the triangle */
+	static const GLfloat positions[] = {
+		-1.0f, -1.0f, 0.0f, 1.0f,
+		 1.0f, -1.0f, 0.0f, 1.0f,
+		-1.0f,  1.0f, 2.0f, 1.0f
+	};
+	
+	GLuint program = LoadProgram("render/position.vert.il", "render/color.frag.il");
+	
+	CU_ASSERT_FATAL(program != 0);
+	
+	ClearSurface();
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, positions);
+	glEnableVertexAttribArray(0);
+	glVertexAttrib4f(1, 1.0f, 1.0f, 1.0f, 1.0f);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glDisableVertexAttribArray(0);
+	
+	/* trapezoid (0, 0), (64, 0), (32, 32), (0, 32) */
+	CU_ASSERT(abs(CountPixels() - 1536) <= SURFACE_WIDTH / 2);
+	CU_ASSERT(glGetError() == GL_NO_ERROR);
+	
+	glUseProgram(0);
+	glDeleteProgram(program);
+}
+
+static void GuardBand() {
+	/* 
+	 * The vertices reach to the limits of the guard band around a viewport
+	 * that is offset within the surface; products of their window 
+	 * coordinates exceed 32 bits.
+	 */
+	static const GLfloat positions[] = {
+		-1.5f, -1.5f, 0.0f, 1.0f,
+		 1.5f, -1.5f, 0.0f, 1.0f,
+		-1.5f,  1.5f, 0.0f, 1.0f
+	};
+	
+	Surface * surface = TestSurface;
+	GLuint program = LoadProgram("render/position.vert.il", "render/color.frag.il");
+	GLsizei width = GLES_MAX_VIEWPORT_WIDTH, height = GLES_MAX_VIEWPORT_HEIGHT;
+	
+	CU_ASSERT_FATAL(program != 0);
+	
+	TestSurface = CreateSurface(width, height);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(TestSurface);
+	vinMakeCurrent((VinSurface) TestSurface, (VinSurface) TestSurface);
+	
+	ClearSurface();
+	glViewport(width / 4, height / 4, width, height);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, positions);
+	glEnableVertexAttribArray(0);
+	glVertexAttrib4f(1, 1.0f, 1.0f, 1.0f, 1.0f);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glDisableVertexAttribArray(0);
+	
+	/* the hypotenuse cuts off a corner of the surface */
+	CU_ASSERT(abs(CountPixels() - width * height * 7 / 8) <= width);
+	CU_ASSERT(glGetError() == GL_NO_ERROR);
+	
+	vinMakeCurrent((VinSurface) surface, (VinSurface) surface);
+	glViewport(0, 0, SURFACE_WIDTH, SURFACE_HEIGHT);
+	DestroySurface(TestSurface);
+	TestSurface = surface;
+	
+	glUseProgram(0);
+	glDeleteProgram(program);
+}
+
+static void LineClipping() {
+	/* 
+	 * Horizontal, vertical and diagonal lines, reaching into the guard band 
+	 * or beyond it, in both directions
+	 */
+	static const GLfloat positions[][8] = {
+		{ -2.0f, 0.01f, 0.0f, 1.0f,   2.0f, 0.01f, 0.0f, 1.0f },
+		{ 40.0f, 0.01f, 0.0f, 1.0f, -40.0f, 0.01f, 0.0f, 1.0f },
+		{ 0.01f, -2.0f, 0.0f, 1.0f,  0.01f, 40.0f, 0.0f, 1.0f },
+		{ 0.01f, 40.0f, 0.0f, 1.0f,  0.01f, -2.0f, 0.0f, 1.0f },
+		{ -3.0f, -3.0f, 0.0f, 1.0f,   3.0f,  3.0f, 0.0f, 1.0f },
+		{ 30.0f, -30.0f, 0.0f, 1.0f, -30.0f, 30.0f, 0.0f, 1.0f }
+	};
+	
+	GLuint program = LoadProgram("render/position.vert.il", "render/color.frag.il");
+	GLsizei index;
+	
+	CU_ASSERT_FATAL(program != 0);
+	
+	glEnableVertexAttribArray(0);
+	glVertexAttrib4f(1, 1.0f, 1.0f, 1.0f, 1.0f);
+	
+	for (index = 0; index < (GLsizei) (sizeof positions / sizeof positions[0]); ++index) {
+		ClearSurface();
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, positions[index]);
+		glDrawArrays(GL_LINES, 0, 2);
+		
+		/* one fragment per pixel of the major axis within the surface */
+		CU_ASSERT(CountPixels() == SURFACE_WIDTH);
+	}
+	
+	/* a line outside of the surface, but within the guard band */
+	ClearSurface();
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, positions[0]);
+	glViewport(0, SURFACE_HEIGHT, SURFACE_WIDTH, SURFACE_HEIGHT);
+	glDrawArrays(GL_LINES, 0, 2);
+	glViewport(0, 0, SURFACE_WIDTH, SURFACE_HEIGHT);
+	CU_ASSERT(CountPixels() == 0);
+	
+	glDisableVertexAttribArray(0);
+	CU_ASSERT(glGetError() == GL_NO_ERROR);
+	
+	glUseProgram(0);
+	glDeleteProgram(program);
+}
+
+static void Minification() {
+	/* a screen-filling quad with texture coordinates from 0 to 1 */
+	static const GLfloat positions[] = {
+		-1.0f, -1.0f, 0.0f, 1.0f,	 1.0f, -1.0f, 0.0f, 1.0f,	-1.0f,  1.0f, 0.0f, 1.0f,
+		-1.0f,  1.0f, 0.0f, 1.0f,	 1.0f, -1.0f, 0.0f, 1.0f,	 1.0f,  1.0f, 0.0f, 1.0f
+	};
+	static const GLfloat texCoords[] = {
+		 0.0f,  0.0f, 0.0f, 1.0f,	 1.0f,  0.0f, 0.0f, 1.0f,	 0.0f,  1.0f, 0.0f, 1.0f,
+		 0.0f,  1.0f, 0.0f, 1.0f,	 1.0f,  0.0f, 0.0f, 1.0f,	 1.0f,  1.0f, 0.0f, 1.0f
+	};
+	
+	GLuint program = LoadProgram("render/position.vert.il", "render/texture.frag.il");
+	GLsizei size = SURFACE_WIDTH * 4, level, index, count = 0;
+	GLubyte * texels = malloc(size * size * 4);
+	const GLuint * color = (const GLuint *) TestSurface->colorBuffer;
+	GLuint texture;
+	
+	CU_ASSERT_FATAL(program != 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(texels);
+	
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	
+	/* each mipmap level is filled with a gray level of its own */
+	for (level = 0; size >> level; ++level) {
+		GLsizei width = size >> level;
+		
+		GlesMemset(texels, 255 - 28 * level, width * width * 4);
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, width, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+	}
+	
+	free(texels);
+	
+	ClearSurface();
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, positions);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, texCoords);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	glDisableVertexAttribArray(0);
+	glDisableVertexAttribArray(1);
+	
+	/* four texels per pixel select level 2; the middle bytes are color channels */
+	for (index = 0; index < SURFACE_WIDTH * SURFACE_HEIGHT; ++index) {
+		GLuint gray = 255 - 28 * 2;
+		
+		count += (color[index] & 0xffff00u) == (gray << 8 | gray << 16);
+	}
+	
+	CU_ASSERT(count == SURFACE_WIDTH * SURFACE_HEIGHT);
+	CU_ASSERT(glGetError() == GL_NO_ERROR);
+	
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDeleteTextures(1, &texture);
+	glUseProgram(0);
+	glDeleteProgram(program);
+}
+
+static void ColorPacking() {
+	/* a screen-filling quad sampling a single, repeated texel */
+	static const GLfloat positions[] = {
+		-1.0f, -1.0f, 0.0f, 1.0f,	 1.0f, -1.0f, 0.0f, 1.0f,	-1.0f,  1.0f, 0.0f, 1.0f,
+		-1.0f,  1.0f, 0.0f, 1.0f,	 1.0f, -1.0f, 0.0f, 1.0f,	 1.0f,  1.0f, 0.0f, 1.0f
+	};
+	static const GLubyte texel[] = { 200, 100, 50, 255 };
+	
+	GLuint program = LoadProgram("render/position.vert.il", "render/packing.frag.il");
+	const GLubyte * color = (const GLubyte *) TestSurface->colorBuffer;
+	GLsizei index, count = 0;
+	GLuint texture;
+	
+	CU_ASSERT_FATAL(program != 0);
+	
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+	
+	ClearSurface();
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, positions);
+	glEnableVertexAttribArray(0);
+	glVertexAttrib4f(1, 2.0f, 0.5f, -1.0f, 1.0f);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	glDisableVertexAttribArray(0);
+	
+	/* the texture access selects batched shading, which packs and clamps colors */
+	for (index = 0; index < SURFACE_WIDTH * SURFACE_HEIGHT; ++index) {
+		const GLubyte * pixel = color + index * 4;
+		
+		count += pixel[0] == 255 && abs(pixel[1] - 50) <= 1 && 
+			pixel[2] == 0 && pixel[3] == 255;
+	}
+	
+	CU_ASSERT(count == SURFACE_WIDTH * SURFACE_HEIGHT);
+	CU_ASSERT(glGetError() == GL_NO_ERROR);
+	
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDeleteTextures(1, &texture);
+	glUseProgram(0);
+	glDeleteProgram(program);
+}
+
+static void ProgramBinary() {
+	static const GLfloat positions[] = {
+		-1.0f, -1.0f, 0.0f, 1.0f,
+		 1.0f, -1.0f, 0.0f, 1.0f,
+		-1.0f,  1.0f, 0.0f, 1.0f
+	};
+	
+	GLuint program = LoadProgram("render/position.vert.il", "render/color.frag.il");
+	GLuint copy = glCreateProgram();
+	GLint length = 0, linked = GL_FALSE;
+	GLenum format;
+	GLubyte * binary;
+	
+	CU_ASSERT_FATAL(program != 0);
+	
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+	CU_ASSERT_FATAL(length > 0);
+	
+	binary = malloc(length);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(binary);
+	glGetProgramBinaryOES(program, length, &length, &format, binary);
+	CU_ASSERT(format == GL_PROGRAM_BINARY_VIN);
+	
+	/* a damaged image is rejected */
+	binary[length - 1] ^= 1;
+	glProgramBinaryOES(copy, format, binary, length);
+	glGetProgramiv(copy, GL_LINK_STATUS, &linked);
+	CU_ASSERT(linked == GL_FALSE);
+	
+	/* the intact image renders like the original program */
+	binary[length - 1] ^= 1;
+	glProgramBinaryOES(copy, format, binary, length);
+	glGetProgramiv(copy, GL_LINK_STATUS, &linked);
+	CU_ASSERT(linked == GL_TRUE);
+	free(binary);
+	
+	ClearSurface();
+	glUseProgram(copy);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, positions);
+	glEnableVertexAttribArray(0);
+	glVertexAttrib4f(1, 1.0f, 1.0f, 1.0f, 1.0f);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glDisableVertexAttribArray(0);
+	
+	CU_ASSERT(abs(CountPixels() - SURFACE_WIDTH * SURFACE_HEIGHT / 2) <= SURFACE_WIDTH);
+	CU_ASSERT(glGetError() == GL_NO_ERROR);
+	
+	glUseProgram(0);
+	glDeleteProgram(copy);
+	glDeleteProgram(program);
+}
+
+/**
+ * Register all rendering pipeline tests
+ */
+GLboolean TestRegisterRender() {
+	CU_pSuite pSuite = CU_add_suite("Rendering Pipeline", SetupFixture, CleanupFixture);
+	
+	if (!pSuite) {
+		return GL_FALSE;
+	}
+	
+	if (!CU_add_test(pSuite, "Clip Far Plane",			ClipFarPlane)		||
+		!CU_add_test(pSuite, "Guard Band",				GuardBand)			||
+		!CU_add_test(pSuite, "Line Clipping",			LineClipping)		||
+		!CU_add_test(pSuite, "Minification",			Minification)		||
+		!CU_add_test(pSuite, "Color Packing",			ColorPacking)		||
+		!CU_add_test(pSuite, "Program Binary",			ProgramBinary)) {
+		return GL_FALSE;
+	}
+	
+	return GL_TRUE;
+}
@@ -50,8 +50,10 @@
 #include "CUnit/CUnit.h"
 #include "CUnit/Basic.h"
 #include "CUnit/Console.h"
+#include "backend/backend.h"
 #include "frontend/frontend.h"
 #include "orange/orange.h"
+#include "render/render.h"
 #include "utils.h"
 
 GLboolean interactive = GL_FALSE;
@@ -78,7 +80,13 @@ int main(int argc, char * argv[]) {
 	}
 
 	/* add test suites to the registry */
-	if (!TestRegisterFrontend() /*||
+	if (!TestRegisterFrontend() ||
+		!TestRegisterPreprocessor() ||
+		!TestRegisterIntermediate() ||
+		!TestRegisterInterpreter() ||
+		!TestRegisterPacking() ||
+		!TestRegisterMathlib() ||
+		!TestRegisterRender() /*||
 		!TestRegisterOrange()*/) {
 		goto cleanup;
 	}
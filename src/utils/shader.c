@@ -64,16 +64,16 @@ static const char * ShaderPath(void) {
 }
 
 /**
- * Load a shader source file as shader source into the current shader.
+ * Load a text file, such as shader source or intermediate code, from the
+ * shader search path.
  *  
- * @param shader
- * 			the identifier of the shader to populate
  * @param filename
- * 			the filename of the shader source code
+ * 			the name of the file to load
  * 
- * @return	true if successful
+ * @return	the null-terminated contents of the file, to be released using
+ * 			free(), or NULL if the file could not be read
  */
-GLboolean UtilLoadShaderSource(GLuint shader, const char * filename) {
+char * UtilLoadText(const char * filename) {
 	const char * shaderPath = ShaderPath();
 	FILE * source = UtilFopenPath(filename, "r", shaderPath);
 	size_t length;
@@ -82,7 +82,7 @@ GLboolean UtilLoadShaderSource(GLuint shader, const char * filename) {
 	if (!source) {
 		fprintf(stderr, "Could not find the shader file \"%s\" in the SHADER_PATH [%s]\n",
 				filename,shaderPath);
-		return GL_FALSE;
+		return NULL;
 	}
 	
 	/* determine size of shader file */
@@ -95,19 +95,42 @@ GLboolean UtilLoadShaderSource(GLuint shader, const char * filename) {
 	if (!buffer) {
 		fprintf(stderr, "Fatal error: Out of memory in %s (%d)\n", __FILE__, __LINE__);
 		fclose(source);
-		return GL_FALSE;
+		return NULL;
 	}
 	
 	if (fread(buffer, 1, length, source) != length) {
 		fprintf(stderr, "Error reading shader source file %s\n", filename);
+		free(buffer);
+		buffer = NULL;
 	} else {
 		buffer[length] = '\0';
-		glShaderSource(shader, 1, (const char **) &buffer, NULL);
 	}
 	
-	free(buffer);
 	fclose(source);
 	
+	return buffer;
+}
+
+/**
+ * Load a shader source file as shader source into the current shader.
+ *  
+ * @param shader
+ * 			the identifier of the shader to populate
+ * @param filename
+ * 			the filename of the shader source code
+ * 
+ * @return	true if successful
+ */
+GLboolean UtilLoadShaderSource(GLuint shader, const char * filename) {
+	char * buffer = UtilLoadText(filename);
+	
+	if (!buffer) {
+		return GL_FALSE;
+	}
+	
+	glShaderSource(shader, 1, (const char **) &buffer, NULL);
+	free(buffer);
+	
 	return GL_TRUE;
 }
 
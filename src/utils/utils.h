@@ -64,6 +64,7 @@ typedef struct {
 
 GLint UtilGetOpts(GLint argc, char **argv, UtilOption opttable[]);
 
+char * UtilLoadText(const char * filename);
 GLboolean UtilLoadShaderSource(GLuint shader, const char * filename);
 GLboolean UtilResetState(void);
 void UtilSucceedCompile(const char * source, GLenum shaderType);